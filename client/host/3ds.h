@@ -0,0 +1,298 @@
+#ifndef HOST_3DS_H
+#define HOST_3DS_H
+
+/*
+ * Stand-in for the parts of libctru the client uses, so the sources in
+ * ../source build and run on Linux (see sim.c). Types, signatures and
+ * constants follow libctru; behavior is provided by shim.c:
+ *
+ *  - framebuffers live in memory, double-buffered like the real ones
+ *  - HID input, the clock, vblank and sleep/HOME (APT hooks) are driven by
+ *    the simulator
+ *  - threads run one at a time and only switch when the running one waits,
+ *    so a replayed session always takes the same path
+ *  - httpc requests are answered from a recorded session, or made with
+ *    curl while recording one
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef s32 Result;
+typedef u32 Handle;
+
+#define BIT(n) (1U << (n))
+#define R_SUCCEEDED(res) ((res) >= 0)
+#define R_FAILED(res) ((res) < 0)
+#define U64_MAX UINT64_MAX
+
+#define SYSCLOCK_ARM11 268111856LL
+#define CPU_TICKS_PER_MSEC (SYSCLOCK_ARM11 / 1000.0)
+#define CPU_TICKS_PER_USEC (SYSCLOCK_ARM11 / 1000000.0)
+
+// ---- gfx / gsp ----------------------------------------------------------
+
+typedef enum
+{
+    GFX_TOP = 0,
+    GFX_BOTTOM = 1,
+} gfxScreen_t;
+
+typedef enum
+{
+    GFX_LEFT = 0,
+    GFX_RIGHT = 1,
+} gfx3dSide_t;
+
+typedef enum
+{
+    GSP_RGBA8_OES = 0,
+    GSP_BGR8_OES = 1,
+    GSP_RGB565_OES = 2,
+    GSP_RGB5_A1_OES = 3,
+    GSP_RGBA4_OES = 4,
+} GSPGPU_FramebufferFormat;
+
+void gfxInitDefault(void);
+void gfxExit(void);
+u8 *gfxGetFramebuffer(gfxScreen_t screen, gfx3dSide_t side, u16 *width, u16 *height);
+void gfxSetScreenFormat(gfxScreen_t screen, GSPGPU_FramebufferFormat format);
+GSPGPU_FramebufferFormat gfxGetScreenFormat(gfxScreen_t screen);
+void gfxSetDoubleBuffering(gfxScreen_t screen, bool enable);
+void gfxFlushBuffers(void);
+void gfxSwapBuffers(void);
+void gspWaitForVBlank(void);
+Result GSPGPU_FlushDataCache(const void *adr, u32 size);
+
+// ---- console (only its font is used) ------------------------------------
+
+typedef struct
+{
+    u8 *gfx;
+    u16 asciiOffset;
+    u16 numChars;
+} ConsoleFont;
+
+typedef struct
+{
+    ConsoleFont font;
+} PrintConsole;
+
+PrintConsole *consoleGetDefault(void);
+
+// ---- hid ----------------------------------------------------------------
+
+enum
+{
+    KEY_A = BIT(0),
+    KEY_B = BIT(1),
+    KEY_SELECT = BIT(2),
+    KEY_START = BIT(3),
+    KEY_DRIGHT = BIT(4),
+    KEY_DLEFT = BIT(5),
+    KEY_DUP = BIT(6),
+    KEY_DDOWN = BIT(7),
+    KEY_R = BIT(8),
+    KEY_L = BIT(9),
+    KEY_X = BIT(10),
+    KEY_Y = BIT(11),
+    KEY_ZL = BIT(14),
+    KEY_ZR = BIT(15),
+    KEY_TOUCH = BIT(20),
+};
+
+void hidScanInput(void);
+u32 hidKeysDown(void);
+u32 hidKeysHeld(void);
+u32 hidKeysUp(void);
+
+// ---- apt / os / services ------------------------------------------------
+
+bool aptMainLoop(void);
+
+typedef enum
+{
+    APTHOOK_ONSUSPEND = 0,
+    APTHOOK_ONRESTORE,
+    APTHOOK_ONSLEEP,
+    APTHOOK_ONWAKEUP,
+    APTHOOK_ONEXIT,
+    APTHOOK_COUNT,
+} APT_HookType;
+
+typedef void (*aptHookFn)(APT_HookType hook, void *param);
+
+typedef struct tag_aptHookCookie
+{
+    struct tag_aptHookCookie *next;
+    aptHookFn callback;
+    void *param;
+} aptHookCookie;
+
+void aptHook(aptHookCookie *cookie, aptHookFn callback, void *param);
+void aptUnhook(aptHookCookie *cookie);
+u64 osGetTime(void);
+u64 svcGetSystemTick(void);
+void svcSleepThread(s64 ns);
+
+Result romfsInit(void);
+Result romfsExit(void);
+Result cfguInit(void);
+void cfguExit(void);
+Result socInit(u32 *context_addr, u32 context_size);
+Result socExit(void);
+Result acInit(void);
+void acExit(void);
+Result ACU_GetWifiStatus(u32 *out); // 0: not connected
+
+// ---- threads and synchronization ----------------------------------------
+
+typedef struct Thread_tag *Thread;
+typedef void (*ThreadFunc)(void *);
+
+Thread threadCreate(ThreadFunc entrypoint, void *arg, size_t stack_size, int prio, int core_id,
+                    bool detached);
+Result threadJoin(Thread thread, u64 timeout_ns);
+void threadFree(Thread thread);
+
+typedef enum
+{
+    RESET_ONESHOT = 0,
+    RESET_STICKY = 1,
+    RESET_PULSE = 2,
+} ResetType;
+
+typedef struct
+{
+    s32 state; // 1 while signaled
+    ResetType type;
+} LightEvent;
+
+void LightEvent_Init(LightEvent *event, ResetType reset_type);
+void LightEvent_Clear(LightEvent *event);
+void LightEvent_Signal(LightEvent *event);
+int LightEvent_TryWait(LightEvent *event);
+void LightEvent_Wait(LightEvent *event);
+
+typedef s32 LightLock;
+
+void LightLock_Init(LightLock *lock);
+void LightLock_Lock(LightLock *lock);
+void LightLock_Unlock(LightLock *lock);
+
+#define RESULT_TIMEOUT ((Result)0x09401bfe) // svcWaitSynchronization timed out
+
+Result svcCreateEvent(Handle *event, ResetType reset_type);
+Result svcSignalEvent(Handle handle);
+Result svcClearEvent(Handle handle);
+Result svcWaitSynchronization(Handle handle, s64 nanoseconds);
+Result svcCloseHandle(Handle handle);
+
+// ---- httpc --------------------------------------------------------------
+
+#define HTTPC_RESULTCODE_DOWNLOADPENDING ((Result)0xd840a02b)
+#define SSLCOPT_DisableVerify BIT(9)
+
+typedef struct
+{
+    Handle servhandle;
+    u32 httphandle;
+} httpcContext;
+
+typedef enum
+{
+    HTTPC_METHOD_GET = 1,
+    HTTPC_METHOD_POST,
+    HTTPC_METHOD_HEAD,
+    HTTPC_METHOD_PUT,
+    HTTPC_METHOD_DELETE,
+} HTTPC_RequestMethod;
+
+typedef enum
+{
+    HTTPC_KEEPALIVE_DISABLED = 0,
+    HTTPC_KEEPALIVE_ENABLED = 1,
+} HTTPC_KeepAlive;
+
+Result httpcInit(u32 sharedmem_size);
+void httpcExit(void);
+Result httpcOpenContext(httpcContext *context, HTTPC_RequestMethod method, const char *url,
+                        u32 use_defaultproxy);
+Result httpcCloseContext(httpcContext *context);
+Result httpcCancelConnection(httpcContext *context);
+Result httpcAddRequestHeaderField(httpcContext *context, const char *name, const char *value);
+Result httpcSetSSLOpt(httpcContext *context, u32 options);
+Result httpcSetKeepAlive(httpcContext *context, HTTPC_KeepAlive option);
+Result httpcBeginRequest(httpcContext *context);
+Result httpcGetResponseStatusCode(httpcContext *context, u32 *out);
+Result httpcGetDownloadSizeState(httpcContext *context, u32 *downloadedsize, u32 *contentsize);
+Result httpcReceiveData(httpcContext *context, u8 *buffer, u32 size);
+Result httpcDownloadData(httpcContext *context, u8 *buffer, u32 size, u32 *downloadedsize);
+
+// ---- software keyboard --------------------------------------------------
+
+typedef struct
+{
+    const char *hint;
+} SwkbdState;
+
+typedef enum
+{
+    SWKBD_TYPE_NORMAL = 0,
+    SWKBD_TYPE_QWERTY,
+    SWKBD_TYPE_NUMPAD,
+    SWKBD_TYPE_WESTERN,
+} SwkbdType;
+
+typedef enum
+{
+    SWKBD_ANYTHING = 0,
+    SWKBD_NOTEMPTY,
+    SWKBD_NOTEMPTY_NOTBLANK,
+    SWKBD_NOTBLANK_NOTEMPTY = SWKBD_NOTEMPTY_NOTBLANK,
+    SWKBD_NOTBLANK,
+    SWKBD_FIXEDLEN,
+} SwkbdValidInput;
+
+enum
+{
+    SWKBD_FILTER_DIGITS = BIT(0),
+    SWKBD_FILTER_AT = BIT(1),
+    SWKBD_FILTER_PERCENT = BIT(2),
+    SWKBD_FILTER_BACKSLASH = BIT(3),
+    SWKBD_FILTER_PROFANITY = BIT(4),
+    SWKBD_FILTER_CALLBACK = BIT(5),
+};
+
+enum
+{
+    SWKBD_MULTILINE = BIT(3),
+};
+
+typedef enum
+{
+    SWKBD_BUTTON_NONE = -1,
+    SWKBD_BUTTON_LEFT = 0,
+    SWKBD_BUTTON_MIDDLE,
+    SWKBD_BUTTON_RIGHT,
+    SWKBD_BUTTON_CONFIRM = SWKBD_BUTTON_RIGHT,
+} SwkbdButton;
+
+void swkbdInit(SwkbdState *swkbd, SwkbdType type, int numButtons, int maxTextLength);
+void swkbdSetValidation(SwkbdState *swkbd, SwkbdValidInput validInput, u32 filterFlags,
+                        int maxDigits);
+void swkbdSetFeatures(SwkbdState *swkbd, u32 features);
+void swkbdSetHintText(SwkbdState *swkbd, const char *text);
+SwkbdButton swkbdInputText(SwkbdState *swkbd, char *buf, size_t bufsize);
+
+#endif // HOST_3DS_H
@@ -0,0 +1,2 @@
+// libctru splits its headers; the host stand-in keeps everything in one
+#include "../3ds.h"
@@ -0,0 +1,77 @@
+#include <malloc.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "alloc.h"
+
+void *__real_calloc(size_t count, size_t size);
+void *__real_memalign(size_t alignment, size_t size);
+char *__real_strdup(const char *s);
+
+static atomic_ullong allocCount, allocBytes, liveBytes, peakBytes;
+
+static void *counted(void *ptr)
+{
+    if (ptr)
+    {
+        size_t size = malloc_usable_size(ptr);
+        atomic_fetch_add(&allocCount, 1);
+        atomic_fetch_add(&allocBytes, size);
+        unsigned long long live = atomic_fetch_add(&liveBytes, size) + size;
+        unsigned long long peak = atomic_load(&peakBytes);
+        while (live > peak && !atomic_compare_exchange_weak(&peakBytes, &peak, live))
+            ;
+    }
+    return ptr;
+}
+
+static void uncount(void *ptr)
+{
+    if (ptr)
+        atomic_fetch_sub(&liveBytes, malloc_usable_size(ptr));
+}
+
+void *__wrap_malloc(size_t size)
+{
+    return counted(__real_malloc(size));
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    return counted(__real_calloc(count, size));
+}
+
+void *__wrap_memalign(size_t alignment, size_t size)
+{
+    return counted(__real_memalign(alignment, size));
+}
+
+char *__wrap_strdup(const char *s)
+{
+    return (char *)counted(__real_strdup(s));
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    uncount(ptr);
+    return counted(__real_realloc(ptr, size));
+}
+
+void __wrap_free(void *ptr)
+{
+    uncount(ptr);
+    __real_free(ptr);
+}
+
+void allocStats(AllocStats *stats)
+{
+    stats->count = atomic_load(&allocCount);
+    stats->bytes = atomic_load(&allocBytes);
+    stats->live = atomic_load(&liveBytes);
+    stats->peak = atomic_load(&peakBytes);
+}
+
+void allocResetPeak(void)
+{
+    atomic_store(&peakBytes, atomic_load(&liveBytes));
+}
@@ -0,0 +1,32 @@
+#ifndef HOST_ALLOC_H
+#define HOST_ALLOC_H
+
+#include <stddef.h>
+
+/*
+ * Heap accounting for the host tools: a program linked with alloc.o and
+ * $(WRAP_ALLOC) (see the Makefile) counts every malloc, calloc, realloc,
+ * memalign and strdup the code it runs makes. The tools' own bookkeeping
+ * goes through the __real_ functions so it stays out of the figures.
+ */
+
+typedef struct
+{
+    unsigned long long count; // allocations made
+    unsigned long long bytes; // bytes allocated, as malloc_usable_size() reports them
+    unsigned long long live;  // bytes allocated and not freed yet
+    unsigned long long peak;  // highest live since the last allocResetPeak()
+} AllocStats;
+
+void allocStats(AllocStats *stats);
+
+/**
+ * @brief Restart the peak from what is live now
+ */
+void allocResetPeak(void);
+
+void *__real_malloc(size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+#endif // HOST_ALLOC_H
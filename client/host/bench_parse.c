@@ -0,0 +1,185 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "3ds.h"
+#include "alloc.h"
+#include "parse.h"
+
+/*
+ * Times parse.c over a corpus of /now-playing payloads, reading the fields
+ * main.c reads after each poll:
+ *
+ *   bench_parse [--iterations N] [DIR or FILE...]      default: corpus/now-playing
+ *
+ * For each payload: ns per field, ns for a whole poll, and the allocations
+ * a poll makes; strips found are also timed through decode_base64().
+ */
+
+#define MAX_PAYLOADS 256
+
+static const char *const fields[] = {
+    "name", "artist", "is_playing", "device", "volume_percent", "image_url", "name_strip",
+    "artist_strip", "progress_ms", "duration_ms", "request_ms", "server_time_ms",
+};
+#define FIELD_COUNT ((int)(sizeof(fields) / sizeof(fields[0])))
+
+typedef struct
+{
+    char name[64];
+    char *json;
+    size_t size;
+} Payload;
+
+static Payload payloads[MAX_PAYLOADS];
+static int payloadCount = 0;
+
+static u64 nowNs(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (u64)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static void addPayload(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f || payloadCount == MAX_PAYLOADS)
+    {
+        if (f)
+            fclose(f);
+        fprintf(stderr, "bench_parse: skipping %s\n", path);
+        return;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    // Like fetch(): the body as a NUL-terminated string
+    Payload *p = &payloads[payloadCount];
+    p->json = (char *)__real_malloc(size + 1);
+    if (p->json && fread(p->json, 1, size, f) == (size_t)size)
+    {
+        p->json[size] = '\0';
+        p->size = size;
+        const char *base = strrchr(path, '/');
+        snprintf(p->name, sizeof(p->name), "%s", base ? base + 1 : path);
+        payloadCount++;
+    }
+    fclose(f);
+}
+
+static int compareNames(const void *a, const void *b)
+{
+    return strcmp(((const Payload *)a)->name, ((const Payload *)b)->name);
+}
+
+static void addPath(const char *path)
+{
+    DIR *dir = opendir(path);
+    if (!dir)
+    {
+        addPayload(path);
+        return;
+    }
+    int first = payloadCount;
+    struct dirent *entry;
+    while ((entry = readdir(dir)))
+    {
+        if (entry->d_name[0] == '.')
+            continue;
+        char file[4096];
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        addPayload(file);
+    }
+    closedir(dir);
+    qsort(payloads + first, payloadCount - first, sizeof(Payload), compareNames);
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = 20000;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "--iterations") == 0)
+    {
+        iterations = atoi(argv[2]);
+        first = 3;
+    }
+    if (iterations < 1)
+    {
+        fprintf(stderr, "usage: bench_parse [--iterations N] [DIR or FILE...]\n");
+        return 2;
+    }
+    if (first == argc)
+        addPath("corpus/now-playing");
+    for (int i = first; i < argc; i++)
+        addPath(argv[i]);
+    if (payloadCount == 0)
+    {
+        fprintf(stderr, "bench_parse: no payloads\n");
+        return 1;
+    }
+
+    printf("%-20s %6s %9s %9s %7s %10s %12s\n", "payload", "bytes", "ns/field", "ns/poll",
+           "allocs", "alloc B", "ns/strip");
+
+    double fieldNs[FIELD_COUNT] = { 0 };
+    for (int n = 0; n < payloadCount; n++)
+    {
+        const Payload *p = &payloads[n];
+
+        // One poll's worth, untimed, for the allocation figures and the strips
+        AllocStats before, after;
+        allocStats(&before);
+        char *values[FIELD_COUNT];
+        for (int f = 0; f < FIELD_COUNT; f++)
+            values[f] = get(fields[f], p->json);
+        allocStats(&after);
+
+        double pollNs = 0;
+        for (int f = 0; f < FIELD_COUNT; f++)
+        {
+            u64 start = nowNs();
+            for (int i = 0; i < iterations; i++)
+                free(get(fields[f], p->json));
+            double ns = (double)(nowNs() - start) / iterations;
+            fieldNs[f] += ns;
+            pollNs += ns;
+        }
+
+        // The strips main.c decodes when they're there
+        double stripNs = 0;
+        int strips = 0;
+        for (int f = 0; f < FIELD_COUNT; f++)
+        {
+            if (!values[f] || !strstr(fields[f], "_strip"))
+                continue;
+            size_t size;
+            u64 start = nowNs();
+            for (int i = 0; i < iterations; i++)
+                free(decode_base64(values[f], &size));
+            stripNs += (double)(nowNs() - start) / iterations;
+            strips++;
+        }
+
+        for (int f = 0; f < FIELD_COUNT; f++)
+            free(values[f]);
+
+        char stripColumn[16] = "-";
+        if (strips)
+            snprintf(stripColumn, sizeof(stripColumn), "%.0f", stripNs / strips);
+        printf("%-20s %6zu %9.0f %9.0f %7llu %10llu %12s\n", p->name, p->size,
+               pollNs / FIELD_COUNT, pollNs, after.count - before.count, after.bytes - before.bytes,
+               stripColumn);
+    }
+
+    printf("\n%-20s %9s\n", "field", "ns (mean)");
+    for (int f = 0; f < FIELD_COUNT; f++)
+        printf("%-20s %9.0f\n", fields[f], fieldNs[f] / payloadCount);
+
+    for (int n = 0; n < payloadCount; n++)
+        __real_free(payloads[n].json);
+    return 0;
+}
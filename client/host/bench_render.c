@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "3ds.h"
+#include "shim.h"
+#include "image_display.h"
+#include "layers.h"
+#include "layout.h"
+
+/*
+ * Times the top screen renderer (image_display.c) on the shim's in-memory
+ * framebuffers over scripted scenarios: cover sizes, swaps, overlay fades,
+ * RGB565 and the blurred backdrop. Each run of a scenario happens in a
+ * forked child, so it starts from the renderer's initial state.
+ *
+ *   bench_render [--reps N] [--only SUBSTRING] [--layers FILE]
+ *                [--check GOLDEN | --update GOLDEN]
+ *
+ * The checksum covers every frame the scenario shows; --check fails when one
+ * differs from the golden file, --update rewrites it.
+ */
+
+#define MAX_FRAMES 120
+#define MAX_REPS 100
+#define NEVER -1
+
+typedef struct
+{
+    const char *name;
+    int artW, artH;     // 0: background only
+    bool rgb565;
+    bool backdrop;
+    int frames;
+    int coverFrom;      // frames before this show the background
+    int swapAt;         // switch to a second cover
+    int pauseFrom, pauseTo;
+    int playFrom, playTo;
+} Scenario;
+
+static const Scenario scenarios[] = {
+    { "background",         0,   0,   false, false, 60, NEVER, NEVER, NEVER, NEVER, NEVER, NEVER },
+    { "cover-64",           64,  64,  false, false, 60, 1,     NEVER, NEVER, NEVER, NEVER, NEVER },
+    { "cover-300",          300, 300, false, false, 60, 1,     NEVER, NEVER, NEVER, NEVER, NEVER },
+    { "cover-640",          640, 640, false, false, 60, 1,     NEVER, NEVER, NEVER, NEVER, NEVER },
+    { "cover-640x480",      640, 480, false, false, 60, 1,     NEVER, NEVER, NEVER, NEVER, NEVER },
+    { "swap-640",           640, 640, false, false, 60, 0,     30,    NEVER, NEVER, NEVER, NEVER },
+    { "pause-fade-640",     640, 640, false, false, 60, 0,     NEVER, 10,    40,    NEVER, NEVER },
+    { "play-fade-640",      640, 640, false, false, 60, 0,     NEVER, NEVER, NEVER, 10,    40 },
+    { "pause-steady-640",   640, 640, false, false, 60, 0,     NEVER, 0,     NEVER, NEVER, NEVER },
+    { "rgb565-cover-640",   640, 640, true,  false, 60, 1,     NEVER, NEVER, NEVER, NEVER, NEVER },
+    { "rgb565-pause-640",   640, 640, true,  false, 60, 0,     NEVER, 10,    40,    NEVER, NEVER },
+    { "backdrop-swap-640",  640, 640, false, true,  60, 0,     30,    NEVER, NEVER, NEVER, NEVER },
+    { "backdrop-pause-640", 640, 640, false, true,  60, 0,     NEVER, 10,    40,    NEVER, NEVER },
+};
+#define SCENARIO_COUNT ((int)(sizeof(scenarios) / sizeof(scenarios[0])))
+
+// Filled in by the child running a scenario, read by the parent
+typedef struct
+{
+    u64 ns[MAX_FRAMES];
+    u64 bytesChanged;
+    u32 checksum;
+    bool ok;
+} RunResult;
+
+// Deterministic stand-in for a decoded cover: gradients with some detail
+static u8 *makeArt(int w, int h, int seed)
+{
+    u8 *pixels = (u8 *)malloc(w * h * 4);
+    if (!pixels)
+        return NULL;
+    for (int y = 0; y < h; y++)
+    {
+        for (int x = 0; x < w; x++)
+        {
+            u8 *p = pixels + (y * w + x) * 4;
+            p[0] = (u8)(x * 255 / w + seed * 40);
+            p[1] = (u8)(y * 255 / h);
+            p[2] = (u8)(((x / 8) ^ (y / 8)) * (seed + 3) * 16);
+            p[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+static u64 nowNs(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (u64)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static u32 fnv1a(u32 hash, const u8 *data, u32 size)
+{
+    for (u32 i = 0; i < size; i++)
+        hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
+
+static u64 countChanged(const u8 *a, const u8 *b, u32 size)
+{
+    u64 changed = 0;
+    for (u32 i = 0; i < size; i++)
+        changed += (a[i] != b[i]);
+    return changed;
+}
+
+static void drawFrame(const Scenario *s, int i, u8 *artA, u8 *artB)
+{
+    if (i == s->pauseFrom)
+        setPlaybackPaused(true);
+    if (i == s->pauseTo)
+        setPlaybackPaused(false);
+    if (i == s->playFrom)
+        setTemporaryPlay(true);
+    if (i == s->playTo)
+        setTemporaryPlay(false);
+
+    if (s->coverFrom == NEVER || i < s->coverFrom)
+    {
+        drawBackgroundToScreen();
+        return;
+    }
+    // Like main.c: the cached copy goes before the next cover is shown
+    if (i == s->swapAt)
+        resetImageCache();
+    drawImageToScreen((s->swapAt != NEVER && i >= s->swapAt) ? artB : artA, s->artW, s->artH);
+}
+
+static void runScenario(const Scenario *s, u8 *artA, u8 *artB, bool measure, RunResult *result)
+{
+    setTopScreenRGB565(s->rgb565);
+    setBlurredBackdrop(s->backdrop);
+
+    static u8 before[TOP_WIDTH * TOP_HEIGHT * 3];
+    u32 hash = 2166136261u;
+    for (int i = 0; i < s->frames; i++)
+    {
+        u8 *back = gfxGetFramebuffer(GFX_TOP, GFX_LEFT, NULL, NULL);
+        u32 size;
+        shimFramebuffer(GFX_TOP, &size);
+        if (measure)
+            memcpy(before, back, size);
+
+        u64 start = nowNs();
+        drawFrame(s, i, artA, artB);
+        result->ns[i] = nowNs() - start;
+
+        if (measure)
+        {
+            result->bytesChanged += countChanged(before, back, size);
+            const u8 *shown = shimFramebuffer(GFX_TOP, &size);
+            hash = fnv1a(hash, shown, size);
+        }
+    }
+    result->checksum = hash;
+    result->ok = true;
+}
+
+static int compareU64(const void *a, const void *b)
+{
+    u64 x = *(const u64 *)a, y = *(const u64 *)b;
+    return (x > y) - (x < y);
+}
+
+// "name checksum" lines; unknown names are ignored
+static bool goldenFor(const char *path, const char *name, u32 *checksum)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return false;
+    char line[128], key[96];
+    unsigned int value;
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), f))
+    {
+        if (sscanf(line, "%95s %x", key, &value) == 2 && strcmp(key, name) == 0)
+        {
+            *checksum = value;
+            found = true;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+int main(int argc, char **argv)
+{
+    int reps = 10;
+    const char *only = NULL, *layersPath = NULL, *checkPath = NULL, *updatePath = NULL;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--reps") == 0)
+            reps = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--only") == 0)
+            only = argv[i + 1];
+        else if (strcmp(argv[i], "--layers") == 0)
+            layersPath = argv[i + 1];
+        else if (strcmp(argv[i], "--check") == 0)
+            checkPath = argv[i + 1];
+        else if (strcmp(argv[i], "--update") == 0)
+            updatePath = argv[i + 1];
+        else
+            reps = 0;
+    }
+    if (argc % 2 == 0 || reps < 1 || reps > MAX_REPS)
+    {
+        fprintf(stderr, "usage: bench_render [--reps N] [--only SUBSTRING] [--layers FILE]\n"
+                        "                    [--check GOLDEN | --update GOLDEN]\n");
+        return 2;
+    }
+
+    if (layersPath && !layersLoad(layersPath))
+        fprintf(stderr, "bench_render: can't load %s, rasterizing at runtime\n", layersPath);
+
+    FILE *update = updatePath ? fopen(updatePath, "w") : NULL;
+    if (updatePath && !update)
+    {
+        fprintf(stderr, "bench_render: can't write %s\n", updatePath);
+        return 1;
+    }
+
+    RunResult *results = (RunResult *)mmap(NULL, sizeof(RunResult) * MAX_REPS,
+                                           PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED)
+        return 1;
+
+    printf("%-20s %6s %10s %10s %10s %12s  %s\n", "scenario", "frames", "ns/frame", "p50",
+           "p99", "bytes/frame", "checksum");
+
+    int failures = 0;
+    for (int n = 0; n < SCENARIO_COUNT; n++)
+    {
+        const Scenario *s = &scenarios[n];
+        if (only && !strstr(s->name, only))
+            continue;
+
+        u8 *artA = s->artW ? makeArt(s->artW, s->artH, 1) : NULL;
+        u8 *artB = s->artW ? makeArt(s->artW, s->artH, 2) : NULL;
+        memset(results, 0, sizeof(RunResult) * reps);
+
+        // The first run also checksums and diffs every frame, outside the timed part
+        for (int r = 0; r < reps; r++)
+        {
+            fflush(stdout);
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                runScenario(s, artA, artB, r == 0, &results[r]);
+                _exit(0);
+            }
+            int status;
+            if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+                results[r].ok = false;
+        }
+        free(artA);
+        free(artB);
+
+        u64 samples[MAX_FRAMES * MAX_REPS];
+        int count = 0;
+        bool ok = true;
+        for (int r = 0; r < reps; r++)
+        {
+            ok = ok && results[r].ok;
+            for (int i = 0; i < s->frames; i++)
+                samples[count++] = results[r].ns[i];
+        }
+        if (!ok)
+        {
+            printf("%-20s crashed\n", s->name);
+            failures++;
+            continue;
+        }
+
+        u64 total = 0;
+        for (int i = 0; i < count; i++)
+            total += samples[i];
+        qsort(samples, count, sizeof(u64), compareU64);
+
+        u32 checksum = results[0].checksum;
+        const char *verdict = "";
+        u32 golden;
+        if (checkPath && !goldenFor(checkPath, s->name, &golden))
+            verdict = "  (no golden)";
+        else if (checkPath && golden != checksum)
+        {
+            verdict = "  MISMATCH";
+            failures++;
+        }
+        if (update)
+            fprintf(update, "%s %08x\n", s->name, (unsigned)checksum);
+
+        printf("%-20s %6d %10llu %10llu %10llu %12llu  %08x%s\n", s->name, s->frames,
+               (unsigned long long)(total / count), (unsigned long long)samples[count / 2],
+               (unsigned long long)samples[count * 99 / 100],
+               (unsigned long long)(results[0].bytesChanged / s->frames), (unsigned)checksum,
+               verdict);
+    }
+
+    if (update)
+        fclose(update);
+    if (failures)
+        fprintf(stderr, "bench_render: %d scenario(s) failed\n", failures);
+    return failures ? 1 : 0;
+}
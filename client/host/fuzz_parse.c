@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parse.h"
+
+/*
+ * libFuzzer target for parse.c, calling it the way main.c does: get() on a
+ * NUL-terminated response body, then decode_base64() on what comes back.
+ * The first input byte picks the key, so the fuzzer also explores the keys
+ * main.c asks for.
+ *
+ *   make fuzz          clang -fsanitize=fuzzer,address,undefined, seeded from corpus/
+ *   make fuzz-check    the corpus through the same entry point with gcc's sanitizers
+ */
+
+static const char *const keys[] = {
+    "name", "artist", "is_playing", "device", "volume_percent", "image_url", "name_strip",
+    "artist_strip", "progress_ms", "duration_ms", "request_ms", "server_time_ms", "",
+};
+#define KEY_COUNT (sizeof(keys) / sizeof(keys[0]))
+
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size)
+{
+    if (size == 0)
+        return 0;
+
+    // A response body arrives NUL-terminated (see fetch())
+    char *json = (char *)malloc(size);
+    if (!json)
+        return 0;
+    memcpy(json, data + 1, size - 1);
+    json[size - 1] = '\0';
+
+    char *value = get(keys[data[0] % KEY_COUNT], json);
+    if (value)
+    {
+        size_t len = 0;
+        free(decode_base64(value, &len));
+        free(value);
+    }
+
+    size_t len = 0;
+    free(decode_base64(json, &len));
+    free(json);
+    return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+// Runs each file given through the target once, for toolchains without libFuzzer
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        FILE *f = fopen(argv[i], "rb");
+        if (!f)
+        {
+            fprintf(stderr, "fuzz_parse: can't read %s\n", argv[i]);
+            return 1;
+        }
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+
+        // Every key against the same body
+        unsigned char *data = (unsigned char *)malloc(size + 1);
+        if (!data || fread(data + 1, 1, size, f) != (size_t)size)
+            return 1;
+        fclose(f);
+        for (size_t k = 0; k < KEY_COUNT; k++)
+        {
+            data[0] = (unsigned char)k;
+            LLVMFuzzerTestOneInput(data, size + 1);
+        }
+        free(data);
+    }
+    printf("fuzz_parse: %d inputs ok\n", argc - 1);
+    return 0;
+}
+#endif
@@ -0,0 +1,240 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "session.h"
+
+static bool addInput(Session *session, const SessionInput *input)
+{
+    SessionInput *inputs = (SessionInput *)realloc(
+        session->inputs, (session->inputCount + 1) * sizeof(SessionInput));
+    if (!inputs)
+        return false;
+    session->inputs = inputs;
+    session->inputs[session->inputCount++] = *input;
+    return true;
+}
+
+static bool addApt(Session *session, const SessionApt *apt)
+{
+    SessionApt *apts = (SessionApt *)realloc(
+        session->apts, (session->aptCount + 1) * sizeof(SessionApt));
+    if (!apts)
+        return false;
+    session->apts = apts;
+    session->apts[session->aptCount++] = *apt;
+    return true;
+}
+
+static bool addWifi(Session *session, const SessionWifi *wifi)
+{
+    SessionWifi *wifis = (SessionWifi *)realloc(
+        session->wifis, (session->wifiCount + 1) * sizeof(SessionWifi));
+    if (!wifis)
+        return false;
+    session->wifis = wifis;
+    session->wifis[session->wifiCount++] = *wifi;
+    return true;
+}
+
+// By APT_HookType, up to APTHOOK_ONEXIT
+static const char *const aptNames[] = { "suspend", "restore", "sleep", "wakeup" };
+
+const char *sessionAptName(APT_HookType hook)
+{
+    return hook < APTHOOK_ONEXIT ? aptNames[hook] : NULL;
+}
+
+static bool addResponse(Session *session, const SessionResponse *response)
+{
+    SessionResponse *responses = (SessionResponse *)realloc(
+        session->responses, (session->responseCount + 1) * sizeof(SessionResponse));
+    if (!responses)
+        return false;
+    session->responses = responses;
+
+    // Responses are written as they complete, but asked for as requests start: a command
+    // sent while a poll is in flight finishes first. Keep them in start order.
+    int at = session->responseCount++;
+    while (at > 0 && responses[at - 1].frame > response->frame)
+    {
+        responses[at] = responses[at - 1];
+        at--;
+    }
+    responses[at] = *response;
+    return true;
+}
+
+bool sessionLoad(Session *session, const char *path)
+{
+    memset(session, 0, sizeof(*session));
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    char line[1024];
+    if (!fgets(line, sizeof(line), f) || strncmp(line, SESSION_MAGIC, strlen(SESSION_MAGIC)) != 0)
+    {
+        fprintf(stderr, "sim: %s is not a session file\n", path);
+        fclose(f);
+        return false;
+    }
+
+    bool ok = true, ended = false;
+    u64 lastFrame = 0;
+    while (ok && fgets(line, sizeof(line), f))
+    {
+        unsigned long long frame;
+        unsigned int down, held, latency, ms, status, size;
+        int urlStart = 0;
+        char name[16];
+
+        if (sscanf(line, "server %63s", session->server) == 1)
+            continue;
+        if (sscanf(line, "end %llu", &frame) == 1)
+        {
+            session->endFrame = frame;
+            ended = true;
+            break;
+        }
+        if (sscanf(line, "input %llu %x %x", &frame, &down, &held) == 3)
+        {
+            SessionInput input = { frame, down, held };
+            ok = addInput(session, &input);
+            lastFrame = frame;
+            continue;
+        }
+        if (sscanf(line, "apt %llu %15s", &frame, name) == 2)
+        {
+            SessionApt apt = { frame, APTHOOK_COUNT };
+            for (int i = 0; i < APTHOOK_ONEXIT; i++)
+            {
+                if (strcmp(name, aptNames[i]) == 0)
+                    apt.hook = (APT_HookType)i;
+            }
+            ok = apt.hook != APTHOOK_COUNT && addApt(session, &apt);
+            lastFrame = frame;
+            continue;
+        }
+        if (sscanf(line, "wifi %llu %u", &frame, &down) == 2)
+        {
+            SessionWifi wifi = { frame, down != 0 };
+            ok = addWifi(session, &wifi);
+            lastFrame = frame;
+            continue;
+        }
+        if (sscanf(line, "http %llu %u %u %u %u %n", &frame, &latency, &ms, &status, &size,
+                   &urlStart) == 5 && urlStart > 0)
+        {
+            SessionResponse response = { frame, latency, ms, status, size, NULL, NULL, false };
+            line[strcspn(line, "\r\n")] = '\0';
+            response.url = strdup(line + urlStart);
+            response.body = (u8 *)malloc(size ? size : 1);
+            ok = response.url && response.body && fread(response.body, 1, size, f) == size &&
+                 fgetc(f) == '\n' && addResponse(session, &response);
+            lastFrame = frame + latency;
+            continue;
+        }
+
+        fprintf(stderr, "sim: %s: unexpected line: %s", path, line);
+        ok = false;
+    }
+    fclose(f);
+
+    if (!ok)
+    {
+        fprintf(stderr, "sim: %s is truncated or malformed\n", path);
+        sessionClose(session, 0);
+        return false;
+    }
+
+    // A recording that was cut short runs for another second after its last event
+    if (!ended)
+        session->endFrame = lastFrame + 60;
+    return true;
+}
+
+bool sessionCreate(Session *session, const char *path, const char *server)
+{
+    memset(session, 0, sizeof(*session));
+    snprintf(session->server, sizeof(session->server), "%s", server);
+    session->out = fopen(path, "wb");
+    if (!session->out)
+        return false;
+
+    fprintf(session->out, "%s\nserver %s\n", SESSION_MAGIC, session->server);
+    return true;
+}
+
+void sessionWriteInput(Session *session, u64 frame, u32 down, u32 held)
+{
+    if (session->out)
+        fprintf(session->out, "input %llu %x %x\n", (unsigned long long)frame, (unsigned)down,
+                (unsigned)held);
+}
+
+void sessionWriteApt(Session *session, u64 frame, APT_HookType hook)
+{
+    if (session->out && sessionAptName(hook))
+        fprintf(session->out, "apt %llu %s\n", (unsigned long long)frame, sessionAptName(hook));
+}
+
+void sessionWriteWifi(Session *session, u64 frame, bool connected)
+{
+    if (session->out)
+        fprintf(session->out, "wifi %llu %d\n", (unsigned long long)frame, connected ? 1 : 0);
+}
+
+void sessionWriteResponse(Session *session, const SessionResponse *response)
+{
+    if (!session->out)
+        return;
+
+    fprintf(session->out, "http %llu %u %u %u %u %s\n", (unsigned long long)response->frame,
+            (unsigned)response->latency, (unsigned)response->ms, (unsigned)response->status,
+            (unsigned)response->size, response->url);
+    fwrite(response->body, 1, response->size, session->out);
+    fputc('\n', session->out);
+    fflush(session->out);
+}
+
+void sessionClose(Session *session, u64 endFrame)
+{
+    if (session->out)
+    {
+        fprintf(session->out, "end %llu\n", (unsigned long long)endFrame);
+        fclose(session->out);
+    }
+
+    for (int i = 0; i < session->responseCount; i++)
+    {
+        free(session->responses[i].url);
+        free(session->responses[i].body);
+    }
+    free(session->responses);
+    free(session->inputs);
+    free(session->apts);
+    free(session->wifis);
+    memset(session, 0, sizeof(*session));
+}
+
+SessionResponse *sessionTakeResponse(Session *session, const char *url)
+{
+    bool inOrder = true;
+    for (int i = 0; i < session->responseCount; i++)
+    {
+        SessionResponse *response = &session->responses[i];
+        if (response->used)
+            continue;
+        if (strcmp(response->url, url) == 0)
+        {
+            if (!inOrder)
+                session->mismatches++;
+            response->used = true;
+            return response;
+        }
+        inOrder = false;
+    }
+
+    session->mismatches++;
+    return NULL;
+}
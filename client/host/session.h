@@ -0,0 +1,107 @@
+#ifndef HOST_SESSION_H
+#define HOST_SESSION_H
+
+#include <stdio.h>
+#include "3ds.h"
+
+/*
+ * A recorded session: the server it talked to, the input timeline and every
+ * HTTP response with the frame it was requested on, in one file. Text lines,
+ * each response followed by its body:
+ *
+ *   S3DS-SESSION 1
+ *   server <address>
+ *   input <frame> <down> <held>                           key masks in hex; held
+ *                                                         lasts until the next line
+ *   apt <frame> <suspend|restore|sleep|wakeup>            HOME menu, lid
+ *   wifi <frame> <0|1>                                    link state, from then on
+ *   http <frame> <latency> <ms> <status> <size> <url>
+ *   <size bytes>
+ *   end <frame>
+ *
+ * latency is the number of frames the response took to reach the thread
+ * that asked for it; ms is how long a request made on the main thread
+ * blocked it (0 for requests from other threads). A status of 0 is a request
+ * that couldn't connect.
+ */
+
+#define SESSION_MAGIC "S3DS-SESSION 1"
+
+typedef struct
+{
+    u64 frame;
+    u32 down, held;
+} SessionInput;
+
+typedef struct
+{
+    u64 frame;
+    APT_HookType hook;
+} SessionApt;
+
+typedef struct
+{
+    u64 frame;
+    bool connected;
+} SessionWifi;
+
+typedef struct
+{
+    u64 frame;
+    u32 latency;
+    u32 ms;
+    u32 status;
+    u32 size;
+    char *url;
+    u8 *body;
+    bool used; // replay: already handed out
+} SessionResponse;
+
+typedef struct
+{
+    char server[64];
+    SessionInput *inputs;
+    int inputCount;
+    SessionApt *apts;
+    int aptCount;
+    SessionWifi *wifis;
+    int wifiCount;
+    SessionResponse *responses;
+    int responseCount;
+    u64 endFrame;
+    int mismatches; // replay: requests that didn't come in the recorded order
+    FILE *out;      // recording
+} Session;
+
+/**
+ * @brief Read a whole session file for replay
+ */
+bool sessionLoad(Session *session, const char *path);
+
+/**
+ * @brief Start recording a session into a new file
+ */
+bool sessionCreate(Session *session, const char *path, const char *server);
+
+void sessionWriteInput(Session *session, u64 frame, u32 down, u32 held);
+void sessionWriteApt(Session *session, u64 frame, APT_HookType hook);
+void sessionWriteWifi(Session *session, u64 frame, bool connected);
+void sessionWriteResponse(Session *session, const SessionResponse *response);
+
+/**
+ * @brief Finish a recording with its last frame, and free a loaded session
+ */
+void sessionClose(Session *session, u64 endFrame);
+
+/**
+ * @brief Name of an APT hook as sessions write it, or NULL for one they don't record
+ */
+const char *sessionAptName(APT_HookType hook);
+
+/**
+ * @brief The recorded response to hand out for a request, or NULL if there is none left
+ * Responses are taken in recorded order; one for another URL first counts as a mismatch.
+ */
+SessionResponse *sessionTakeResponse(Session *session, const char *url);
+
+#endif // HOST_SESSION_H
@@ -0,0 +1,1195 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "3ds.h"
+#include "shim.h"
+
+#define SCREEN_HEIGHT 240
+#define TOP_WIDTH 400
+#define BOTTOM_WIDTH 320
+#define MAX_BPP 4
+
+#define EPOCH_MS 1700000000000ULL // osGetTime() at frame 0
+#define TICKS_PER_CALL 268        // svcGetSystemTick() moves ~1 us per call within a frame
+#define MAX_REQUESTS 16
+#define MAX_EVENTS 16
+
+static Session *session = NULL;
+static bool recording = false;
+static u64 frameLimit = 0;
+static volatile bool quitRequested = false;
+static ShimFrameHook frameHook = NULL;
+
+// ---- scheduler ------------------------------------------------------------
+//
+// Threads are real pthreads, but only the one holding the token runs. It
+// passes the token on only when it waits for something, to the next thread
+// (in creation order) that can go on. Frames advance when no thread can, so
+// everything between two vblanks happens in the same order on every run.
+
+typedef enum
+{
+    THREAD_RUNNABLE,
+    THREAD_WAIT_FRAME, // until frame >= wakeFrame
+    THREAD_WAIT_EVENT,
+    THREAD_WAIT_LOCK,
+    THREAD_WAIT_JOIN,
+    THREAD_WAIT_IO,    // recording: a request is in flight without the token
+    THREAD_EXITED,
+} ThreadState;
+
+struct Thread_tag
+{
+    pthread_t handle;
+    ThreadFunc entry;
+    void *arg;
+    ThreadState state;
+    u64 wakeFrame; // THREAD_WAIT_FRAME, and the timeout of other waits (0 for none)
+    LightEvent *event;
+    LightLock *lock;
+    Thread target;
+    bool ioDone;
+    pthread_cond_t turn;
+    Thread next;
+};
+
+static pthread_mutex_t schedMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ioCond; // on CLOCK_MONOTONIC, see shimInit()
+static struct Thread_tag mainThread = { .state = THREAD_RUNNABLE, .turn = PTHREAD_COND_INITIALIZER };
+static Thread threads = &mainThread; // every thread, in creation order
+static Thread current = &mainThread; // the one holding the token
+
+static u64 frame = 0;
+static double blockedMs = 0; // time spent in requests made on the main thread
+static u64 tickCalls = 0;
+static struct timespec realStart;
+
+static bool timedOut(const Thread t)
+{
+    return t->wakeFrame && frame >= t->wakeFrame;
+}
+
+static bool canRun(const Thread t)
+{
+    switch (t->state)
+    {
+    case THREAD_RUNNABLE:
+        return true;
+    case THREAD_WAIT_FRAME:
+        return frame >= t->wakeFrame;
+    case THREAD_WAIT_EVENT:
+        return t->event->state || timedOut(t);
+    case THREAD_WAIT_LOCK:
+        return *t->lock == 0;
+    case THREAD_WAIT_JOIN:
+        return t->target->state == THREAD_EXITED || timedOut(t);
+    case THREAD_WAIT_IO:
+        return t->ioDone;
+    case THREAD_EXITED:
+        return false;
+    }
+    return false;
+}
+
+// The next thread after self that can run, self last
+static Thread pickNext(Thread self)
+{
+    Thread t = self;
+    do
+    {
+        t = t->next ? t->next : threads;
+        if (canRun(t))
+            return t;
+    } while (t != self);
+    return NULL;
+}
+
+static bool anyWaitingForFrame(void)
+{
+    for (Thread t = threads; t; t = t->next)
+    {
+        if (t->state == THREAD_WAIT_FRAME || (t->state != THREAD_EXITED && t->wakeFrame))
+            return true;
+    }
+    return false;
+}
+
+static double nowMs(void)
+{
+    return frame * SHIM_FRAME_MS + blockedMs;
+}
+
+static void advanceFrame(void)
+{
+    if (frameHook)
+        frameHook(frame);
+    frame++;
+}
+
+// Real time at which the next frame starts, when recording
+static struct timespec nextFrameDeadline(void)
+{
+    double ms = (frame + 1) * SHIM_FRAME_MS + blockedMs;
+    struct timespec t = realStart;
+    t.tv_sec += (time_t)(ms / 1000);
+    t.tv_nsec += (long)((ms - (time_t)(ms / 1000) * 1000.0) * 1e6);
+    if (t.tv_nsec >= 1000000000L)
+    {
+        t.tv_sec++;
+        t.tv_nsec -= 1000000000L;
+    }
+    return t;
+}
+
+// Called with schedMutex held once self's state says what it waits for; returns
+// when self holds the token again (or at once if self exited)
+static void schedule(Thread self)
+{
+    for (;;)
+    {
+        Thread t = pickNext(self);
+        if (t)
+        {
+            if (t != self)
+            {
+                current = t;
+                pthread_cond_signal(&t->turn);
+                if (self->state == THREAD_EXITED)
+                    return;
+                while (current != self)
+                    pthread_cond_wait(&self->turn, &schedMutex);
+            }
+            self->state = THREAD_RUNNABLE;
+            self->wakeFrame = 0;
+            return;
+        }
+
+        // Nothing can go on until time passes
+        if (recording)
+        {
+            struct timespec deadline = nextFrameDeadline();
+            if (pthread_cond_timedwait(&ioCond, &schedMutex, &deadline) == ETIMEDOUT &&
+                anyWaitingForFrame())
+                advanceFrame();
+        }
+        else if (anyWaitingForFrame())
+        {
+            advanceFrame();
+        }
+        else
+        {
+            fprintf(stderr, "sim: every thread is waiting on another, frame %llu\n",
+                    (unsigned long long)frame);
+            abort();
+        }
+    }
+}
+
+// Frames a timeout lasts, to the nearest frame but at least one
+static u64 framesFor(u64 ns)
+{
+    if (ns == 0)
+        return 0;
+    u64 frames = (u64)(ns / (SHIM_FRAME_MS * 1e6) + 0.5);
+    return frames ? frames : 1;
+}
+
+static void *threadMain(void *arg)
+{
+    Thread self = (Thread)arg;
+    pthread_mutex_lock(&schedMutex);
+    while (current != self)
+        pthread_cond_wait(&self->turn, &schedMutex);
+    pthread_mutex_unlock(&schedMutex);
+
+    self->entry(self->arg);
+
+    pthread_mutex_lock(&schedMutex);
+    self->state = THREAD_EXITED;
+    schedule(self);
+    pthread_mutex_unlock(&schedMutex);
+    return NULL;
+}
+
+Thread threadCreate(ThreadFunc entrypoint, void *arg, size_t stack_size, int prio, int core_id,
+                    bool detached)
+{
+    Thread t = (Thread)calloc(1, sizeof(*t));
+    if (!t)
+        return NULL;
+    t->entry = entrypoint;
+    t->arg = arg;
+    t->state = THREAD_RUNNABLE;
+    pthread_cond_init(&t->turn, NULL);
+
+    pthread_mutex_lock(&schedMutex);
+    Thread *link = &threads;
+    while (*link)
+        link = &(*link)->next;
+    *link = t;
+    pthread_mutex_unlock(&schedMutex);
+
+    if (pthread_create(&t->handle, NULL, threadMain, t) != 0)
+    {
+        threadFree(t);
+        return NULL;
+    }
+    if (detached)
+        pthread_detach(t->handle);
+    return t;
+}
+
+Result threadJoin(Thread thread, u64 timeout_ns)
+{
+    pthread_mutex_lock(&schedMutex);
+    if (thread->state != THREAD_EXITED)
+    {
+        Thread self = current;
+        self->state = THREAD_WAIT_JOIN;
+        self->target = thread;
+        self->wakeFrame = (timeout_ns == U64_MAX) ? 0 : frame + framesFor(timeout_ns);
+        schedule(self);
+    }
+    Result res = (thread->state == THREAD_EXITED) ? 0 : RESULT_TIMEOUT;
+    pthread_mutex_unlock(&schedMutex);
+    return res;
+}
+
+void threadFree(Thread thread)
+{
+    if (!thread)
+        return;
+    if (thread->state == THREAD_EXITED)
+        pthread_join(thread->handle, NULL);
+
+    pthread_mutex_lock(&schedMutex);
+    for (Thread *link = &threads; *link; link = &(*link)->next)
+    {
+        if (*link == thread)
+        {
+            *link = thread->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&schedMutex);
+    pthread_cond_destroy(&thread->turn);
+    free(thread);
+}
+
+void svcSleepThread(s64 ns)
+{
+    pthread_mutex_lock(&schedMutex);
+    Thread self = current;
+    self->state = THREAD_WAIT_FRAME;
+    self->wakeFrame = frame + framesFor(ns > 0 ? (u64)ns : 0);
+    schedule(self);
+    pthread_mutex_unlock(&schedMutex);
+}
+
+void LightEvent_Init(LightEvent *event, ResetType reset_type)
+{
+    event->state = 0;
+    event->type = reset_type;
+}
+
+void LightEvent_Clear(LightEvent *event)
+{
+    event->state = 0;
+}
+
+void LightEvent_Signal(LightEvent *event)
+{
+    event->state = 1;
+}
+
+int LightEvent_TryWait(LightEvent *event)
+{
+    int signaled = event->state;
+    if (signaled && event->type != RESET_STICKY)
+        event->state = 0;
+    return signaled;
+}
+
+void LightEvent_Wait(LightEvent *event)
+{
+    pthread_mutex_lock(&schedMutex);
+    if (!event->state)
+    {
+        Thread self = current;
+        self->state = THREAD_WAIT_EVENT;
+        self->event = event;
+        schedule(self);
+    }
+    if (event->type != RESET_STICKY)
+        event->state = 0;
+    pthread_mutex_unlock(&schedMutex);
+}
+
+// Kernel events are LightEvents behind a handle (1-based index)
+static LightEvent events[MAX_EVENTS];
+static bool eventUsed[MAX_EVENTS];
+
+static LightEvent *eventFor(Handle handle)
+{
+    u32 i = handle - 1;
+    return (i < MAX_EVENTS && eventUsed[i]) ? &events[i] : NULL;
+}
+
+Result svcCreateEvent(Handle *event, ResetType reset_type)
+{
+    for (int i = 0; i < MAX_EVENTS; i++)
+    {
+        if (!eventUsed[i])
+        {
+            eventUsed[i] = true;
+            LightEvent_Init(&events[i], reset_type);
+            *event = i + 1;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+Result svcSignalEvent(Handle handle)
+{
+    LightEvent *event = eventFor(handle);
+    if (!event)
+        return -1;
+    LightEvent_Signal(event);
+    return 0;
+}
+
+Result svcClearEvent(Handle handle)
+{
+    LightEvent *event = eventFor(handle);
+    if (!event)
+        return -1;
+    LightEvent_Clear(event);
+    return 0;
+}
+
+Result svcWaitSynchronization(Handle handle, s64 nanoseconds)
+{
+    LightEvent *event = eventFor(handle);
+    if (!event)
+        return -1;
+
+    pthread_mutex_lock(&schedMutex);
+    if (!event->state && nanoseconds != 0)
+    {
+        Thread self = current;
+        self->state = THREAD_WAIT_EVENT;
+        self->event = event;
+        self->wakeFrame = (nanoseconds < 0) ? 0 : frame + framesFor((u64)nanoseconds);
+        schedule(self);
+    }
+    bool signaled = event->state;
+    if (signaled && event->type != RESET_STICKY)
+        event->state = 0;
+    pthread_mutex_unlock(&schedMutex);
+    return signaled ? 0 : RESULT_TIMEOUT;
+}
+
+Result svcCloseHandle(Handle handle)
+{
+    if (!eventFor(handle))
+        return -1;
+    eventUsed[handle - 1] = false;
+    return 0;
+}
+
+void LightLock_Init(LightLock *lock)
+{
+    *lock = 0;
+}
+
+void LightLock_Lock(LightLock *lock)
+{
+    pthread_mutex_lock(&schedMutex);
+    if (*lock)
+    {
+        Thread self = current;
+        self->state = THREAD_WAIT_LOCK;
+        self->lock = lock;
+        schedule(self);
+    }
+    *lock = 1;
+    pthread_mutex_unlock(&schedMutex);
+}
+
+void LightLock_Unlock(LightLock *lock)
+{
+    *lock = 0;
+}
+
+// ---- apt / os / services ----------------------------------------------------
+
+void shimInit(Session *s, bool record, u64 maxFrames)
+{
+    session = s;
+    recording = record;
+    frameLimit = maxFrames;
+    if (!frameLimit && !recording)
+        frameLimit = session->endFrame;
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&ioCond, &attr);
+    pthread_condattr_destroy(&attr);
+    clock_gettime(CLOCK_MONOTONIC, &realStart);
+}
+
+void shimSetFrameHook(ShimFrameHook hook)
+{
+    frameHook = hook;
+}
+
+void shimQuit(void)
+{
+    quitRequested = true;
+}
+
+u64 shimFrame(void)
+{
+    return frame;
+}
+
+// APT events: replayed from the session, or queued by shimAptEvent() while recording
+static aptHookCookie *aptHooks = NULL;
+static pthread_mutex_t aptMutex = PTHREAD_MUTEX_INITIALIZER;
+static APT_HookType pendingApts[8];
+static int pendingAptCount = 0;
+static int nextApt = 0;
+static bool asleep = false, suspended = false;
+
+void shimAptEvent(APT_HookType hook)
+{
+    pthread_mutex_lock(&aptMutex);
+    if (pendingAptCount < (int)(sizeof(pendingApts) / sizeof(pendingApts[0])))
+        pendingApts[pendingAptCount++] = hook;
+    pthread_mutex_unlock(&aptMutex);
+}
+
+static bool takeAptEvent(APT_HookType *hook)
+{
+    bool taken = false;
+    if (recording)
+    {
+        pthread_mutex_lock(&aptMutex);
+        if (pendingAptCount > 0)
+        {
+            *hook = pendingApts[0];
+            memmove(pendingApts, pendingApts + 1, --pendingAptCount * sizeof(pendingApts[0]));
+            sessionWriteApt(session, frame, *hook);
+            taken = true;
+        }
+        pthread_mutex_unlock(&aptMutex);
+    }
+    else if (nextApt < session->aptCount && session->apts[nextApt].frame <= frame)
+    {
+        *hook = session->apts[nextApt++].hook;
+        taken = true;
+    }
+    return taken;
+}
+
+void aptHook(aptHookCookie *cookie, aptHookFn callback, void *param)
+{
+    cookie->callback = callback;
+    cookie->param = param;
+    cookie->next = aptHooks;
+    aptHooks = cookie;
+}
+
+void aptUnhook(aptHookCookie *cookie)
+{
+    for (aptHookCookie **link = &aptHooks; *link; link = &(*link)->next)
+    {
+        if (*link == cookie)
+        {
+            *link = cookie->next;
+            break;
+        }
+    }
+}
+
+// Like libctru's, this runs the hooks and doesn't return while the app is asleep
+// or in the background; other threads carry on as the frames pass
+bool aptMainLoop(void)
+{
+    while (!quitRequested && !(frameLimit && frame >= frameLimit))
+    {
+        APT_HookType hook;
+        while (takeAptEvent(&hook))
+        {
+            if (hook == APTHOOK_ONSLEEP || hook == APTHOOK_ONWAKEUP)
+                asleep = hook == APTHOOK_ONSLEEP;
+            else
+                suspended = hook == APTHOOK_ONSUSPEND;
+            for (aptHookCookie *cookie = aptHooks; cookie; cookie = cookie->next)
+                cookie->callback(hook, cookie->param);
+        }
+        if (!asleep && !suspended)
+            return true;
+        svcSleepThread(1); // the next frame
+    }
+    return false;
+}
+
+u64 osGetTime(void)
+{
+    return EPOCH_MS + (u64)nowMs();
+}
+
+u64 svcGetSystemTick(void)
+{
+    return (u64)(nowMs() * CPU_TICKS_PER_MSEC) + ++tickCalls * TICKS_PER_CALL;
+}
+
+Result romfsInit(void)
+{
+    return 0;
+}
+
+Result romfsExit(void)
+{
+    return 0;
+}
+
+Result cfguInit(void)
+{
+    return 0;
+}
+
+void cfguExit(void)
+{
+}
+
+Result socInit(u32 *context_addr, u32 context_size)
+{
+    return 0;
+}
+
+Result socExit(void)
+{
+    return 0;
+}
+
+Result acInit(void)
+{
+    return 0;
+}
+
+void acExit(void)
+{
+}
+
+// Replayed from the session, or set by shimSetWifi() and written to it when the client
+// next looks, so the line lands on the frame the client saw the change
+static volatile bool pendingWifi = true;
+static bool wifi = true;
+static int nextWifi = 0;
+
+void shimSetWifi(bool connected)
+{
+    pendingWifi = connected;
+}
+
+Result ACU_GetWifiStatus(u32 *out)
+{
+    if (recording && wifi != pendingWifi)
+    {
+        wifi = pendingWifi;
+        sessionWriteWifi(session, frame, wifi);
+    }
+    while (!recording && nextWifi < session->wifiCount && session->wifis[nextWifi].frame <= frame)
+        wifi = session->wifis[nextWifi++].connected;
+    *out = wifi ? 1 : 0;
+    return 0;
+}
+
+// ---- gfx / gsp ------------------------------------------------------------
+
+typedef struct
+{
+    u8 *buffers[2];
+    int back; // the one drawn into while the other is shown
+    bool doubleBuffered;
+    GSPGPU_FramebufferFormat format;
+    u16 width;
+} Screen;
+
+static u8 topPixels[2][SCREEN_HEIGHT * TOP_WIDTH * MAX_BPP];
+static u8 bottomPixels[2][SCREEN_HEIGHT * BOTTOM_WIDTH * MAX_BPP];
+static Screen screens[2] = {
+    { { topPixels[0], topPixels[1] }, 0, true, GSP_BGR8_OES, TOP_WIDTH },
+    { { bottomPixels[0], bottomPixels[1] }, 0, true, GSP_BGR8_OES, BOTTOM_WIDTH },
+};
+
+static int bytesPerPixel(GSPGPU_FramebufferFormat format)
+{
+    switch (format)
+    {
+    case GSP_RGBA8_OES:
+        return 4;
+    case GSP_BGR8_OES:
+        return 3;
+    default:
+        return 2;
+    }
+}
+
+void gfxInitDefault(void)
+{
+}
+
+void gfxExit(void)
+{
+}
+
+u8 *gfxGetFramebuffer(gfxScreen_t screen, gfx3dSide_t side, u16 *width, u16 *height)
+{
+    // Rotated like the real ones: width is the screen's height
+    Screen *s = &screens[screen];
+    if (width)
+        *width = SCREEN_HEIGHT;
+    if (height)
+        *height = s->width;
+    return s->buffers[s->doubleBuffered ? s->back : 0];
+}
+
+void gfxSetScreenFormat(gfxScreen_t screen, GSPGPU_FramebufferFormat format)
+{
+    screens[screen].format = format;
+}
+
+GSPGPU_FramebufferFormat gfxGetScreenFormat(gfxScreen_t screen)
+{
+    return screens[screen].format;
+}
+
+void gfxSetDoubleBuffering(gfxScreen_t screen, bool enable)
+{
+    screens[screen].doubleBuffered = enable;
+}
+
+void gfxFlushBuffers(void)
+{
+}
+
+void gfxSwapBuffers(void)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (screens[i].doubleBuffered)
+            screens[i].back ^= 1;
+    }
+}
+
+void gspWaitForVBlank(void)
+{
+    pthread_mutex_lock(&schedMutex);
+    Thread self = current;
+    self->state = THREAD_WAIT_FRAME;
+    self->wakeFrame = frame + 1;
+    schedule(self);
+    pthread_mutex_unlock(&schedMutex);
+}
+
+Result GSPGPU_FlushDataCache(const void *adr, u32 size)
+{
+    return 0;
+}
+
+const u8 *shimFramebuffer(gfxScreen_t screen, u32 *size)
+{
+    Screen *s = &screens[screen];
+    *size = SCREEN_HEIGHT * s->width * bytesPerPixel(s->format);
+    return s->buffers[s->doubleBuffered ? s->back ^ 1 : 0];
+}
+
+// ---- console font -----------------------------------------------------------
+
+// libctru's font isn't available here; printable characters get a made-up
+// but distinct pattern so text still costs what it does on the console
+PrintConsole *consoleGetDefault(void)
+{
+    static u8 fontGfx[256 * 8];
+    static PrintConsole console;
+    if (!console.font.gfx)
+    {
+        for (int c = '!'; c <= '~'; c++)
+        {
+            u32 h = (u32)c * 2654435761u;
+            for (int row = 0; row < 7; row++)
+                fontGfx[c * 8 + row] = (u8)((h >> (row * 4)) & 0x7e) | 0x40;
+        }
+        console.font.gfx = fontGfx;
+        console.font.asciiOffset = 0;
+        console.font.numChars = 256;
+    }
+    return &console;
+}
+
+// ---- hid --------------------------------------------------------------------
+
+static pthread_mutex_t inputMutex = PTHREAD_MUTEX_INITIALIZER;
+static u32 pendingKeys = 0, holdingKeys = 0;
+static u32 keysDown = 0, keysHeld = 0, keysUp = 0;
+static int nextInput = 0;
+
+void shimPressKeys(u32 keys)
+{
+    pthread_mutex_lock(&inputMutex);
+    pendingKeys |= keys;
+    pthread_mutex_unlock(&inputMutex);
+}
+
+void shimHoldKeys(u32 keys)
+{
+    pthread_mutex_lock(&inputMutex);
+    pendingKeys |= keys & ~holdingKeys;
+    holdingKeys = keys;
+    pthread_mutex_unlock(&inputMutex);
+}
+
+void hidScanInput(void)
+{
+    u32 down = 0, held = 0;
+    if (recording)
+    {
+        pthread_mutex_lock(&inputMutex);
+        down = pendingKeys;
+        held = pendingKeys | holdingKeys;
+        pendingKeys = 0;
+        pthread_mutex_unlock(&inputMutex);
+        // A line for each press and each change in what is held, releases included
+        if (down || held != keysHeld)
+            sessionWriteInput(session, frame, down, held);
+    }
+    else
+    {
+        // Presses made while the client wasn't scanning still show on its next scan
+        while (nextInput < session->inputCount && session->inputs[nextInput].frame <= frame)
+        {
+            down |= session->inputs[nextInput].down;
+            held = session->inputs[nextInput].held;
+            nextInput++;
+        }
+    }
+
+    // As on the console, a key pressed is held on that scan, even if released since
+    held |= down;
+    keysUp = keysHeld & ~held;
+    keysDown = down;
+    keysHeld = held;
+}
+
+u32 hidKeysDown(void)
+{
+    return keysDown;
+}
+
+u32 hidKeysHeld(void)
+{
+    return keysHeld;
+}
+
+u32 hidKeysUp(void)
+{
+    return keysUp;
+}
+
+// ---- software keyboard ------------------------------------------------------
+
+void swkbdInit(SwkbdState *swkbd, SwkbdType type, int numButtons, int maxTextLength)
+{
+    swkbd->hint = NULL;
+}
+
+void swkbdSetValidation(SwkbdState *swkbd, SwkbdValidInput validInput, u32 filterFlags,
+                        int maxDigits)
+{
+}
+
+void swkbdSetFeatures(SwkbdState *swkbd, u32 features)
+{
+}
+
+void swkbdSetHintText(SwkbdState *swkbd, const char *text)
+{
+    swkbd->hint = text;
+}
+
+// The only thing the client asks for is the server address
+SwkbdButton swkbdInputText(SwkbdState *swkbd, char *buf, size_t bufsize)
+{
+    snprintf(buf, bufsize, "%s", session->server);
+    return SWKBD_BUTTON_CONFIRM;
+}
+
+// ---- httpc ------------------------------------------------------------------
+
+typedef struct
+{
+    bool open;
+    char url[512];
+    u32 status;
+    u8 *body;
+    u32 size;
+    u32 pos;
+    bool mapped;    // recorded by us rather than borrowed from the session
+    Thread waiter;  // the thread in httpcBeginRequest() while it waits for the response
+    bool cancelled; // by httpcCancelConnection()
+} Request;
+
+static Request requests[MAX_REQUESTS];
+
+static Request *requestFor(httpcContext *context)
+{
+    u32 i = context->httphandle - 1;
+    return (i < MAX_REQUESTS && requests[i].open) ? &requests[i] : NULL;
+}
+
+// Fetch a URL with curl, without the token; false if curl couldn't be run. A status
+// of 0 means it ran but couldn't connect
+static bool curlFetch(const char *url, u32 *status, u8 **body, u32 *size)
+{
+    if (strchr(url, '\''))
+        return false;
+
+    char path[] = "/tmp/s3ds-body-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return false;
+    close(fd);
+
+    char command[1024];
+    snprintf(command, sizeof(command),
+             "curl -s -k -m 30 -A 'Mozilla/5.0 (Nintendo 3DS)' -o '%s' -w '%%{http_code}' '%s'",
+             path, url);
+    FILE *p = popen(command, "r");
+    unsigned int code = 0;
+    bool ok = p && fscanf(p, "%u", &code) == 1;
+    if (p)
+        pclose(p);
+
+    // Mapped rather than read into the heap, which sim.c counts as the client's
+    *status = code;
+    *body = NULL;
+    *size = 0;
+    fd = ok ? open(path, O_RDONLY) : -1;
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void *mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED)
+        {
+            *body = (u8 *)mapped;
+            *size = (u32)st.st_size;
+        }
+    }
+    if (fd >= 0)
+        close(fd);
+    unlink(path);
+    return ok;
+}
+
+static double realMs(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000.0 + t.tv_nsec / 1e6;
+}
+
+// A request in flight on a helper thread. If it is cancelled the waiter goes on without
+// it, and the helper releases it once curl is done. They come from a pool rather than
+// the heap, which sim.c counts as the client's
+typedef struct
+{
+    bool used;
+    char url[512];
+    Thread waiter;
+    bool ok;
+    u32 status;
+    u8 *body;
+    u32 size;
+    bool finished;
+    bool orphaned;
+} Fetch;
+
+static Fetch fetches[MAX_REQUESTS * 2];
+
+static void releaseFetch(Fetch *fetch)
+{
+    if (fetch->orphaned && fetch->body)
+        munmap(fetch->body, fetch->size);
+    fetch->used = false;
+}
+
+static void *fetchMain(void *arg)
+{
+    Fetch *fetch = (Fetch *)arg;
+    u32 status;
+    u8 *body;
+    u32 size;
+    bool ok = curlFetch(fetch->url, &status, &body, &size);
+
+    pthread_mutex_lock(&schedMutex);
+    fetch->ok = ok;
+    fetch->status = status;
+    fetch->body = body;
+    fetch->size = size;
+    fetch->finished = true;
+    if (fetch->orphaned)
+        releaseFetch(fetch);
+    else
+    {
+        fetch->waiter->ioDone = true;
+        pthread_cond_broadcast(&ioCond);
+    }
+    pthread_mutex_unlock(&schedMutex);
+    return NULL;
+}
+
+static Result recordRequest(Request *request)
+{
+    pthread_mutex_lock(&schedMutex);
+    Thread self = current;
+    u64 requestFrame = frame;
+    u32 ms = 0;
+    bool ok;
+
+    if (self == &mainThread)
+    {
+        // Blocks the main loop; the frame stretches by as long as the request took
+        double start = realMs();
+        ok = curlFetch(request->url, &request->status, &request->body, &request->size);
+        ms = (u32)(realMs() - start);
+        blockedMs += ms;
+    }
+    else
+    {
+        // Other threads go on, and frames pass, while the request is in flight
+        Fetch *fetch = NULL;
+        for (int i = 0; i < (int)(sizeof(fetches) / sizeof(fetches[0])) && !fetch; i++)
+        {
+            if (!fetches[i].used)
+                fetch = &fetches[i];
+        }
+        if (!fetch)
+        {
+            pthread_mutex_unlock(&schedMutex);
+            return -1;
+        }
+        memset(fetch, 0, sizeof(*fetch));
+        fetch->used = true;
+        snprintf(fetch->url, sizeof(fetch->url), "%s", request->url);
+        fetch->waiter = self;
+
+        pthread_t helper;
+        self->state = THREAD_WAIT_IO;
+        self->ioDone = false;
+        if (pthread_create(&helper, NULL, fetchMain, fetch) != 0)
+        {
+            self->state = THREAD_RUNNABLE;
+            fetch->used = false;
+            pthread_mutex_unlock(&schedMutex);
+            return -1;
+        }
+        request->waiter = self;
+        schedule(self);
+        request->waiter = NULL;
+
+        if (request->cancelled)
+        {
+            // Recorded as failing on the frame it was given up on, however curl ends
+            ok = true;
+            request->status = 0;
+            request->body = NULL;
+            request->size = 0;
+            fetch->orphaned = true;
+            pthread_detach(helper);
+            if (fetch->finished)
+                releaseFetch(fetch);
+        }
+        else
+        {
+            pthread_join(helper, NULL);
+            ok = fetch->ok;
+            request->status = fetch->status;
+            request->body = fetch->body;
+            request->size = fetch->size;
+            fetch->used = false;
+        }
+    }
+    request->mapped = request->body != NULL;
+
+    SessionResponse response = { requestFrame, (u32)(frame - requestFrame), ms, request->status,
+                                 request->size, request->url, request->body, true };
+    if (ok)
+        sessionWriteResponse(session, &response);
+    pthread_mutex_unlock(&schedMutex);
+    return (ok && request->status) ? 0 : -1;
+}
+
+static Result replayRequest(Request *request)
+{
+    SessionResponse *response = sessionTakeResponse(session, request->url);
+    if (!response)
+    {
+        fprintf(stderr, "sim: frame %llu: no recorded response for %s\n",
+                (unsigned long long)frame, request->url);
+        return -1;
+    }
+
+    request->status = response->status;
+    request->body = response->body;
+    request->size = response->size;
+    request->mapped = false;
+
+    // Arrive as late as it did when recorded, letting the other threads run meanwhile
+    pthread_mutex_lock(&schedMutex);
+    Thread self = current;
+    if (self == &mainThread)
+        blockedMs += response->ms;
+    else
+    {
+        self->state = THREAD_WAIT_FRAME;
+        self->wakeFrame = frame + response->latency;
+        request->waiter = self;
+        schedule(self);
+        request->waiter = NULL;
+    }
+    pthread_mutex_unlock(&schedMutex);
+    return (response->status && !request->cancelled) ? 0 : -1;
+}
+
+Result httpcInit(u32 sharedmem_size)
+{
+    return 0;
+}
+
+void httpcExit(void)
+{
+}
+
+Result httpcOpenContext(httpcContext *context, HTTPC_RequestMethod method, const char *url,
+                        u32 use_defaultproxy)
+{
+    for (int i = 0; i < MAX_REQUESTS; i++)
+    {
+        if (!requests[i].open)
+        {
+            memset(&requests[i], 0, sizeof(requests[i]));
+            requests[i].open = true;
+            snprintf(requests[i].url, sizeof(requests[i].url), "%s", url);
+            context->servhandle = 0;
+            context->httphandle = i + 1;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+Result httpcCloseContext(httpcContext *context)
+{
+    Request *request = requestFor(context);
+    if (!request)
+        return -1;
+    if (request->mapped)
+        munmap(request->body, request->size);
+    request->open = false;
+    return 0;
+}
+
+// Wakes the thread waiting on the request, which then fails it
+Result httpcCancelConnection(httpcContext *context)
+{
+    Request *request = requestFor(context);
+    if (!request)
+        return -1;
+
+    pthread_mutex_lock(&schedMutex);
+    request->cancelled = true;
+    if (request->waiter && recording)
+        request->waiter->ioDone = true;
+    else if (request->waiter)
+        request->waiter->wakeFrame = frame;
+    pthread_mutex_unlock(&schedMutex);
+    return 0;
+}
+
+Result httpcAddRequestHeaderField(httpcContext *context, const char *name, const char *value)
+{
+    return requestFor(context) ? 0 : -1;
+}
+
+Result httpcSetSSLOpt(httpcContext *context, u32 options)
+{
+    return requestFor(context) ? 0 : -1;
+}
+
+Result httpcSetKeepAlive(httpcContext *context, HTTPC_KeepAlive option)
+{
+    return requestFor(context) ? 0 : -1;
+}
+
+Result httpcBeginRequest(httpcContext *context)
+{
+    Request *request = requestFor(context);
+    if (!request || request->cancelled)
+        return -1;
+    return recording ? recordRequest(request) : replayRequest(request);
+}
+
+Result httpcGetResponseStatusCode(httpcContext *context, u32 *out)
+{
+    Request *request = requestFor(context);
+    if (!request)
+        return -1;
+    *out = request->status;
+    return 0;
+}
+
+Result httpcGetDownloadSizeState(httpcContext *context, u32 *downloadedsize, u32 *contentsize)
+{
+    Request *request = requestFor(context);
+    if (!request)
+        return -1;
+    if (downloadedsize)
+        *downloadedsize = request->pos;
+    if (contentsize)
+        *contentsize = request->size;
+    return 0;
+}
+
+Result httpcReceiveData(httpcContext *context, u8 *buffer, u32 size)
+{
+    return httpcDownloadData(context, buffer, size, NULL);
+}
+
+Result httpcDownloadData(httpcContext *context, u8 *buffer, u32 size, u32 *downloadedsize)
+{
+    Request *request = requestFor(context);
+    if (!request)
+        return -1;
+
+    u32 n = request->size - request->pos;
+    if (n > size)
+        n = size;
+    memcpy(buffer, request->body + request->pos, n);
+    request->pos += n;
+    if (downloadedsize)
+        *downloadedsize = n;
+    return (request->pos < request->size) ? HTTPC_RESULTCODE_DOWNLOADPENDING : 0;
+}
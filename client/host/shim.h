@@ -0,0 +1,63 @@
+#ifndef HOST_SHIM_H
+#define HOST_SHIM_H
+
+#include "3ds.h"
+#include "session.h"
+
+/*
+ * Simulator side of the libctru stand-in: what sim.c sets up before running
+ * the client and reads back afterwards.
+ */
+
+#define SHIM_FRAME_MS (1000.0 / 60.0)
+
+typedef void (*ShimFrameHook)(u64 frame);
+
+/**
+ * @brief Answer requests from a loaded session, or record into a new one if recording
+ * @param maxFrames Stop after this many frames (0: when the session ends, or never when recording)
+ */
+void shimInit(Session *session, bool recording, u64 maxFrames);
+
+/**
+ * @brief Called each time a frame ends, before the next one starts
+ */
+void shimSetFrameHook(ShimFrameHook hook);
+
+/**
+ * @brief Keys to report as pressed on the next frame (recording)
+ */
+void shimPressKeys(u32 keys);
+
+/**
+ * @brief Keys to report as held from the next frame on, pressed where they weren't
+ * held already; shimHoldKeys(0) releases them (recording)
+ */
+void shimHoldKeys(u32 keys);
+
+/**
+ * @brief APT event for aptMainLoop() to deliver on the next frame (recording)
+ * APTHOOK_ONSLEEP/ONWAKEUP close and open the lid, ONSUSPEND/ONRESTORE go to
+ * the HOME menu and back.
+ */
+void shimAptEvent(APT_HookType hook);
+
+/**
+ * @brief Link state for ACU_GetWifiStatus() to report from its next call on (recording)
+ */
+void shimSetWifi(bool connected);
+
+/**
+ * @brief Make aptMainLoop() return false from the next frame on
+ */
+void shimQuit(void);
+
+u64 shimFrame(void);
+
+/**
+ * @brief The framebuffer a screen is currently showing
+ * @param size Receives its size in bytes
+ */
+const u8 *shimFramebuffer(gfxScreen_t screen, u32 *size);
+
+#endif // HOST_SHIM_H
@@ -0,0 +1,417 @@
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "3ds.h"
+#include "alloc.h"
+#include "session.h"
+#include "shim.h"
+#include "ui.h"
+
+/*
+ * Runs the client on Linux against shim.c, either replaying a recorded
+ * session or recording a new one from a live server, and reports what each
+ * frame cost and how the glyph atlas did:
+ *
+ *   sim --record session.s3ds --server 192.168.1.20   keys on stdin, e.g. "a", "select+r", "quit",
+ *                                                     "sleep", "wake", "home", "back",
+ *                                                     "wifi off", "wifi on",
+ *                                                     "hold up", "release"
+ *   sim --replay session.s3ds [--csv frames.csv]
+ *
+ * The client's files (sdmc:/..., romfs:/...) resolve relative to --dir;
+ * --romfs points romfs: at a directory such as the one the Makefile bakes.
+ */
+
+int clientMain(int argc, char **argv);
+
+// ---- per-frame statistics ---------------------------------------------------
+
+typedef struct
+{
+    double cpuUs;
+    u32 allocs;
+    u32 allocBytes;
+} FrameStats;
+
+static FrameStats *frames = NULL;
+static size_t frameCount = 0, frameCapacity = 0;
+static double lastCpuUs = 0;
+static unsigned long long lastAllocs = 0, lastAllocBytes = 0, baseLiveBytes = 0;
+
+static double processCpuUs(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+    return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+static void onFrame(u64 frame)
+{
+    double cpu = processCpuUs();
+    AllocStats heap;
+    allocStats(&heap);
+
+    if (frameCount == frameCapacity)
+    {
+        size_t capacity = frameCapacity ? frameCapacity * 2 : 4096;
+        FrameStats *grown = (FrameStats *)__real_realloc(frames, capacity * sizeof(FrameStats));
+        if (!grown)
+            return;
+        frames = grown;
+        frameCapacity = capacity;
+    }
+    frames[frameCount++] = (FrameStats){ cpu - lastCpuUs, (u32)(heap.count - lastAllocs),
+                                         (u32)(heap.bytes - lastAllocBytes) };
+    lastCpuUs = cpu;
+    lastAllocs = heap.count;
+    lastAllocBytes = heap.bytes;
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// FNV-1a, to compare what two runs left on screen
+static u32 checksum(const u8 *data, u32 size)
+{
+    u32 hash = 2166136261u;
+    for (u32 i = 0; i < size; i++)
+        hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
+
+static void report(const Session *session, bool recording)
+{
+    fprintf(stderr, "frames        %zu\n", frameCount);
+    if (frameCount > 0)
+    {
+        double *cpu = (double *)__real_malloc(frameCount * sizeof(double));
+        double total = 0;
+        unsigned long long allocs = 0, bytes = 0;
+        for (size_t i = 0; i < frameCount; i++)
+        {
+            cpu[i] = frames[i].cpuUs;
+            total += cpu[i];
+            allocs += frames[i].allocs;
+            bytes += frames[i].allocBytes;
+        }
+        qsort(cpu, frameCount, sizeof(double), compareDouble);
+        fprintf(stderr, "cpu/frame us  mean %.1f  p50 %.1f  p99 %.1f  max %.1f\n",
+                total / frameCount, cpu[frameCount / 2], cpu[frameCount * 99 / 100],
+                cpu[frameCount - 1]);
+        fprintf(stderr, "allocs        %llu (%.2f/frame)\n", allocs, (double)allocs / frameCount);
+        AllocStats heap;
+        allocStats(&heap);
+        fprintf(stderr, "alloc bytes   %llu total, %llu peak live\n", bytes,
+                heap.peak - baseLiveBytes);
+        __real_free(cpu);
+    }
+    UiGlyphStats glyphs;
+    uiGetGlyphStats(&glyphs);
+    fprintf(stderr, "glyph atlas   %lu hits, %lu misses, %lu evictions\n",
+            (unsigned long)glyphs.hits, (unsigned long)glyphs.misses,
+            (unsigned long)glyphs.evictions);
+    if (!recording)
+        fprintf(stderr, "mismatches    %d\n", session->mismatches);
+
+    u32 size;
+    const u8 *top = shimFramebuffer(GFX_TOP, &size);
+    fprintf(stderr, "top           %08x\n", (unsigned)checksum(top, size));
+    const u8 *bottom = shimFramebuffer(GFX_BOTTOM, &size);
+    fprintf(stderr, "bottom        %08x\n", (unsigned)checksum(bottom, size));
+}
+
+static bool writeCsv(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return false;
+    fprintf(f, "frame,cpu_us,allocs,alloc_bytes\n");
+    for (size_t i = 0; i < frameCount; i++)
+        fprintf(f, "%zu,%.1f,%u,%u\n", i, frames[i].cpuUs, (unsigned)frames[i].allocs,
+                (unsigned)frames[i].allocBytes);
+    fclose(f);
+    return true;
+}
+
+// ---- live input (recording) -------------------------------------------------
+
+static const struct
+{
+    const char *name;
+    u32 key;
+} keyNames[] = {
+    { "a", KEY_A },         { "b", KEY_B },         { "x", KEY_X },
+    { "y", KEY_Y },         { "l", KEY_L },         { "r", KEY_R },
+    { "start", KEY_START }, { "select", KEY_SELECT }, { "up", KEY_DUP },
+    { "down", KEY_DDOWN },  { "left", KEY_DLEFT },  { "right", KEY_DRIGHT },
+};
+
+// "select+r" -> KEY_SELECT | KEY_R; 0 if any name is unknown
+static u32 parseKeys(char *line)
+{
+    u32 keys = 0;
+    for (char *name = strtok(line, "+ \t\r\n"); name; name = strtok(NULL, "+ \t\r\n"))
+    {
+        u32 key = 0;
+        for (size_t i = 0; i < sizeof(keyNames) / sizeof(keyNames[0]); i++)
+        {
+            if (strcmp(name, keyNames[i].name) == 0)
+                key = keyNames[i].key;
+        }
+        if (!key)
+        {
+            fprintf(stderr, "sim: unknown key '%s'\n", name);
+            return 0;
+        }
+        keys |= key;
+    }
+    return keys;
+}
+
+// By APT_HookType
+static const char *const aptCommands[] = { "home", "back", "sleep", "wake" };
+
+static void *readKeys(void *arg)
+{
+    char line[128];
+    while (fgets(line, sizeof(line), stdin))
+    {
+        if (strncmp(line, "quit", 4) == 0)
+            break;
+        // "sleep"/"wake" close and open the lid, "home"/"back" leave and return to the app
+        bool apt = false;
+        for (int hook = 0; hook < APTHOOK_ONEXIT; hook++)
+        {
+            if (strncmp(line, aptCommands[hook], strlen(aptCommands[hook])) == 0)
+            {
+                shimAptEvent((APT_HookType)hook);
+                apt = true;
+            }
+        }
+        if (apt)
+            continue;
+        if (strncmp(line, "wifi ", 5) == 0)
+        {
+            shimSetWifi(strncmp(line + 5, "on", 2) == 0);
+            continue;
+        }
+        // "hold <keys>" keeps them down until "release"
+        if (strncmp(line, "hold ", 5) == 0)
+        {
+            u32 keys = parseKeys(line + 5);
+            if (keys)
+                shimHoldKeys(keys);
+            continue;
+        }
+        if (strncmp(line, "release", 7) == 0)
+        {
+            shimHoldKeys(0);
+            continue;
+        }
+        u32 keys = parseKeys(line);
+        if (keys)
+            shimPressKeys(keys);
+    }
+    shimQuit();
+    return NULL;
+}
+
+static void onInterrupt(int sig)
+{
+    shimQuit();
+}
+
+// ---- main -------------------------------------------------------------------
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: sim --replay FILE [options]\n"
+            "       sim --record FILE --server ADDR [options]\n"
+            "options: --frames N  --dir DIR  --romfs DIR  --csv FILE  --screens PREFIX\n");
+}
+
+// Paths from the command line, made absolute before moving into --dir
+static const char *absolute(const char *path, const char *cwd, char *buffer, size_t size)
+{
+    if (!path || path[0] == '/')
+        return path;
+    snprintf(buffer, size, "%s/%s", cwd, path);
+    return buffer;
+}
+
+// What a screen shows, upright, as a binary PPM
+static bool writeScreen(const char *prefix, const char *name, gfxScreen_t screen)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s-%s.ppm", prefix, name);
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return false;
+
+    u32 size;
+    const u8 *fb = shimFramebuffer(screen, &size);
+    int height = 240, width = size / height / 3;
+    bool rgb565 = gfxGetScreenFormat(screen) == GSP_RGB565_OES;
+    if (rgb565)
+        width = size / height / 2;
+
+    fprintf(f, "P6\n%d %d\n255\n", width, height);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int i = (height - 1 - y) + x * height;
+            u8 rgb[3];
+            if (rgb565)
+            {
+                u16 p = fb[i * 2] | (fb[i * 2 + 1] << 8);
+                rgb[0] = (p >> 11) << 3;
+                rgb[1] = ((p >> 5) & 0x3f) << 2;
+                rgb[2] = (p & 0x1f) << 3;
+            }
+            else
+            {
+                rgb[0] = fb[i * 3 + 2];
+                rgb[1] = fb[i * 3 + 1];
+                rgb[2] = fb[i * 3];
+            }
+            fwrite(rgb, 1, 3, f);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// The client keeps its settings under sdmc:/3ds/spotify-3ds
+static bool prepareDir(const char *dir, const char *romfs, const char *server)
+{
+    mkdir(dir, 0777);
+    if (chdir(dir) != 0)
+        return false;
+    unlink("romfs:");
+    if (romfs && symlink(romfs, "romfs:") != 0)
+        return false;
+    mkdir("sdmc:", 0777);
+    mkdir("sdmc:/3ds", 0777);
+    mkdir("sdmc:/3ds/spotify-3ds", 0777);
+
+    FILE *f = fopen("sdmc:/3ds/spotify-3ds/ip.cfg", "w");
+    if (!f)
+        return false;
+    fprintf(f, "%s\n", server);
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *replayPath = NULL, *recordPath = NULL, *server = NULL;
+    const char *dir = "build/run", *romfsPath = NULL, *csvPath = NULL, *screensPrefix = NULL;
+    u64 maxFrames = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!value)
+        {
+            usage();
+            return 2;
+        }
+        if (strcmp(argv[i], "--replay") == 0)
+            replayPath = value;
+        else if (strcmp(argv[i], "--record") == 0)
+            recordPath = value;
+        else if (strcmp(argv[i], "--server") == 0)
+            server = value;
+        else if (strcmp(argv[i], "--frames") == 0)
+            maxFrames = strtoull(value, NULL, 10);
+        else if (strcmp(argv[i], "--dir") == 0)
+            dir = value;
+        else if (strcmp(argv[i], "--romfs") == 0)
+            romfsPath = value;
+        else if (strcmp(argv[i], "--csv") == 0)
+            csvPath = value;
+        else if (strcmp(argv[i], "--screens") == 0)
+            screensPrefix = value;
+        else
+        {
+            usage();
+            return 2;
+        }
+        i++;
+    }
+    if (!replayPath == !recordPath || (recordPath && !server))
+    {
+        usage();
+        return 2;
+    }
+
+    // Opened before moving into dir, so relative paths mean what they say
+    Session session;
+    bool recording = recordPath != NULL;
+    if (recording ? !sessionCreate(&session, recordPath, server)
+                  : !sessionLoad(&session, replayPath))
+    {
+        fprintf(stderr, "sim: can't open %s: %s\n", recording ? recordPath : replayPath,
+                strerror(errno));
+        return 1;
+    }
+    char cwd[4096], csvBuffer[4096], romfsBuffer[4096], screensBuffer[4096];
+    if (!getcwd(cwd, sizeof(cwd)))
+        return 1;
+    csvPath = absolute(csvPath, cwd, csvBuffer, sizeof(csvBuffer));
+    romfsPath = absolute(romfsPath, cwd, romfsBuffer, sizeof(romfsBuffer));
+    screensPrefix = absolute(screensPrefix, cwd, screensBuffer, sizeof(screensBuffer));
+
+    if (!prepareDir(dir, romfsPath, session.server))
+    {
+        fprintf(stderr, "sim: can't set up %s\n", dir);
+        return 1;
+    }
+
+    shimInit(&session, recording, maxFrames);
+    shimSetFrameHook(onFrame);
+
+    // Count from here on, not what loading the session took
+    lastCpuUs = processCpuUs();
+    AllocStats heap;
+    allocResetPeak();
+    allocStats(&heap);
+    lastAllocs = heap.count;
+    lastAllocBytes = heap.bytes;
+    baseLiveBytes = heap.live;
+
+    if (recording)
+    {
+        pthread_t input;
+        pthread_create(&input, NULL, readKeys, NULL);
+        pthread_detach(input);
+        signal(SIGINT, onInterrupt);
+    }
+
+    char *clientArgv[] = { "spotify-3ds", NULL };
+    int result = clientMain(1, clientArgv);
+
+    report(&session, recording);
+    if (csvPath && !writeCsv(csvPath))
+        fprintf(stderr, "sim: can't write %s\n", csvPath);
+    if (screensPrefix &&
+        !(writeScreen(screensPrefix, "top", GFX_TOP) && writeScreen(screensPrefix, "bottom", GFX_BOTTOM)))
+        fprintf(stderr, "sim: can't write %s-*.ppm\n", screensPrefix);
+    // A replay that asked for other requests than were recorded went another way
+    if (!recording && session.mismatches && !result)
+        result = 1;
+    sessionClose(&session, shimFrame());
+    return result;
+}
@@ -0,0 +1,108 @@
+#ifndef BLIT_H
+#define BLIT_H
+
+#include <3ds.h>
+
+/*
+ * Framebuffer-order blitter.
+ *
+ * The 3DS screens are mounted rotated: the top screen is 400x240 in landscape
+ * but its framebuffer is 400 columns of 240 pixels, and screen pixel (x, y)
+ * lives at (239 - y) + x * 240. Every routine here takes a rect in screen
+ * coordinates, clips it once, and then walks memory sequentially along the
+ * framebuffer columns instead of jumping a whole column per pixel.
+ *
+ * Tiles and masks use the same layout as the framebuffer: w columns of h
+ * pixels, each column stored from the bottom row of the rect up to the top.
+ * Pixel (cx, cy) of a w x h tile is at index cx * h + (h - 1 - cy).
+ *
+ * Tiles are in the target's pixel format: 3 bytes (BGR8) or 2 bytes (RGB565)
+ * per pixel. Colors passed as r, g, b are always 8 bits per channel.
+ */
+
+typedef struct
+{
+    u8 *pixels; // framebuffer base
+    int width;  // screen width in pixels (400 top, 320 bottom)
+    int height; // screen height in pixels (240)
+    int bpp;    // bytes per pixel: 3 (BGR8) or 2 (RGB565)
+} BlitTarget;
+
+// Run-length encoded sprite with per-run color and alpha, in framebuffer order.
+// Each column is a sequence of runs covering its h pixels; runs with alpha 0
+// are skipped without touching the framebuffer.
+typedef struct
+{
+    int w, h;
+    u32 *columns; // offset of each column's first run in runs (w + 1 entries)
+    u8 *runs;     // BLIT_RLE_RUN_SIZE bytes per run: length, alpha, b, g, r
+} BlitRle;
+
+#define BLIT_RLE_RUN_SIZE 5
+
+/**
+ * @brief Point a blit target at the current back buffer of a screen
+ * @return false if the framebuffer is not available
+ */
+bool blitTargetForScreen(BlitTarget *target, gfxScreen_t screen);
+
+/**
+ * @brief Store one tile pixel in the given format
+ * RGB565 pixels get a 4x4 ordered dither keyed on the pixel's screen position
+ * (x, y), so smooth gradients don't band.
+ */
+void blitPackPixel(u8 *dst, int bpp, u8 r, u8 g, u8 b, int x, int y);
+
+/**
+ * @brief Fill a rect with a solid color
+ */
+void blitFillRect(const BlitTarget *target, int x, int y, int w, int h, u8 r, u8 g, u8 b);
+
+/**
+ * @brief Copy a tile into the framebuffer
+ * @param tile Tile pixels in framebuffer order (see above)
+ * @param tileStride Bytes between tile columns; normally h * bpp, or 0 to repeat one column across the rect
+ */
+void blitTile(const BlitTarget *target, int x, int y, int w, int h, const u8 *tile, int tileStride);
+
+/**
+ * @brief Linear blend between two tiles: out = from + (to - from) * t / 256
+ * @param fromStride Bytes between columns of from
+ * @param toStride Bytes between columns of to
+ * @param t Blend position, 0 (all from) to 256 (all to)
+ */
+void blitBlendTiles(const BlitTarget *target, int x, int y, int w, int h, const u8 *from,
+                    int fromStride, const u8 *to, int toStride, int t);
+
+/**
+ * @brief Blend a solid color through an 8-bit coverage mask
+ * @param mask w x h coverage values in framebuffer order
+ * @param alpha Global opacity (0-255) applied on top of the mask
+ */
+void blitBlendMask(const BlitTarget *target, int x, int y, int w, int h, const u8 *mask,
+                   u8 r, u8 g, u8 b, int alpha);
+
+/**
+ * @brief Blend a tile through an 8-bit coverage mask
+ * @param alpha Global opacity (0-255) applied on top of the mask
+ */
+void blitBlendSprite(const BlitTarget *target, int x, int y, int w, int h, const u8 *tile,
+                     const u8 *mask, int alpha);
+
+/**
+ * @brief Encode a BGR tile and its alpha mask (both in framebuffer order) as runs
+ * @return false on allocation failure
+ */
+bool blitRleEncode(BlitRle *rle, int w, int h, const u8 *tile, const u8 *alpha);
+
+/**
+ * @brief Release the runs of an encoded sprite
+ */
+void blitRleFree(BlitRle *rle);
+
+/**
+ * @brief Blend an RLE sprite with its alpha scaled by a global opacity (0-255)
+ */
+void blitBlendRle(const BlitTarget *target, int x, int y, const BlitRle *rle, int alpha);
+
+#endif // BLIT_H
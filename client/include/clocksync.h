@@ -0,0 +1,35 @@
+#ifndef CLOCKSYNC_H
+#define CLOCKSYNC_H
+
+#include <3ds.h>
+
+/*
+ * Offset between the console's clock (osGetTime) and the server's,
+ * estimated NTP-style from the four timestamps of each request:
+ *
+ *   t0 console sent it, t1 server received it, t2 server replied, t3 console got the reply
+ *   offset = ((t1 - t0) + (t2 - t3)) / 2         delay = (t3 - t0) - (t2 - t1)
+ *
+ * A sample is only as good as its delay is short (the unknown split of the
+ * delay between the two directions bounds its error), so of the last
+ * CLOCK_SAMPLES the one with the least delay is used.
+ */
+
+#define CLOCK_SAMPLES 8
+
+/**
+ * @brief Add the timestamps of a request; t1 and t2 are the server's, the others osGetTime()
+ */
+void clockSyncAdd(u64 t0, u64 t1, u64 t2, u64 t3);
+
+/**
+ * @brief Whether any sample has been added
+ */
+bool clockSyncReady(void);
+
+/**
+ * @brief A time on the server's clock, on the console's (unchanged until clockSyncReady())
+ */
+u64 clockSyncToLocal(u64 serverMs);
+
+#endif // CLOCKSYNC_H
@@ -0,0 +1,114 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <3ds.h>
+
+/*
+ * Playback controls, shown before the server has them. Each press becomes a
+ * pending control whose expected effect is applied to the displayed state at
+ * once; the controls go out one at a time, and each stays pending until a poll
+ * started after its acknowledgement confirms it. A control that fails rolls
+ * back at once, one the server hasn't confirmed after CONTROL_TIMEOUT_MS rolls
+ * back then: rolling back just drops it, so the display returns to whatever the
+ * server last said.
+ */
+
+#define CONTROL_MAX 8
+#define CONTROL_TIMEOUT_MS 5000
+// A volume press made before the previous one went out only moves that one's target;
+// it goes out once the presses pause this long, or at most this often while they go on
+#define CONTROL_VOLUME_SETTLE_MS 200
+#define CONTROL_VOLUME_INTERVAL_MS 400
+
+typedef enum
+{
+    CONTROL_PLAY,
+    CONTROL_PAUSE,
+    CONTROL_NEXT,
+    CONTROL_PREVIOUS,
+    CONTROL_VOLUME,
+} ControlKind;
+
+// Player state, as polled or as displayed
+typedef struct
+{
+    bool playing;
+    int volume;      // percent, -1 if unknown
+    u32 track;       // controlTrackKey() of the track
+    u32 progressMs;  // where playback was at progressAt (console time)
+    u64 progressAt;
+    u32 durationMs;  // 0 if the server didn't say where playback is
+    bool skipping;   // displayed only: a next or previous is pending
+} PlayerState;
+
+// A pressed control
+typedef struct
+{
+    ControlKind kind;
+    int volume;     // CONTROL_VOLUME: the target percent
+    u32 track;      // the displayed track when pressed (next and previous)
+    u64 pressedAt;  // for CONTROL_VOLUME, when its target last moved
+    u32 seq;        // its sequence number once sent, else 0
+    u32 freshFrom;  // once acknowledged: the first poll that can confirm it, else 0
+} Control;
+
+/**
+ * @brief Identify a track by its name and artist (the server sends no id)
+ */
+u32 controlTrackKey(const char *name, const char *artist);
+
+/**
+ * @brief Record a press; false if too many controls are pending already
+ * (a volume press whose predecessor hasn't gone out yet only changes its target)
+ */
+bool controlPress(ControlKind kind, int volume, const PlayerState *shown, u64 now);
+
+/**
+ * @brief The oldest control not sent yet, or NULL
+ */
+const Control *controlWaiting(void);
+
+/**
+ * @brief controlWaiting() if it may go now, else NULL; mark it sent with controlSent()
+ */
+const Control *controlToSend(u64 now);
+
+/**
+ * @brief When the oldest control not sent yet may go, or U64_MAX if there is none
+ */
+u64 controlSendAt(void);
+
+void controlSent(u32 seq, u64 now);
+
+/**
+ * @brief A control got its reply (nothing happens if it timed out meanwhile)
+ * @param seq The control's sequence number
+ * @param ok Whether the server took it (if not, it rolls back)
+ * @param freshFrom Sequence number of the first poll started after the reply
+ */
+void controlAcknowledged(u32 seq, bool ok, u32 freshFrom);
+
+/**
+ * @brief Drop the controls a poll confirms, with any pressed before them
+ * @param seq Sequence number of the poll
+ */
+void controlReconcile(const PlayerState *polled, u32 seq);
+
+/**
+ * @brief Drop the controls past CONTROL_TIMEOUT_MS; true if any was
+ */
+bool controlExpire(u64 now);
+
+/**
+ * @brief When the oldest pending control times out, or U64_MAX if none is pending
+ */
+u64 controlDeadline(void);
+
+bool controlPending(void);
+
+/**
+ * @brief The polled state with every pending control applied
+ */
+void controlApply(const PlayerState *polled, PlayerState *shown);
+
+#endif // CONTROL_H
@@ -1,7 +1,22 @@
 #ifndef FETCH_H
 #define FETCH_H
 
+#include <3ds.h>
+
+// Lets another thread cancel a request in flight
+typedef struct
+{
+    LightLock lock; // guards the rest
+    httpcContext context;
+    bool open;
+    bool cancelled; // set by fetch_cancel(); clear it before starting the next request
+} FetchCancel;
+
 char *fetch(const char *url);
 char *fetch_with_params(const char *url, const char *params);
 
+void fetch_cancel_init(FetchCancel *cancel);
+char *fetch_cancellable(const char *url, FetchCancel *cancel);
+void fetch_cancel(FetchCancel *cancel);
+
 #endif
@@ -0,0 +1,55 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Bitmap font for text outside ASCII, baked at build time by
+ * tools/bake_font.c from BDF files and packed into romfs. ASCII keeps using
+ * the console's built-in font. All multi-byte fields are little-endian.
+ *
+ *   FontHeader
+ *   FontEntry[count], sorted by codepoint
+ *   glyph bitmaps: FONT_HEIGHT rows of `cells` bytes each, MSB leftmost
+ *
+ * Glyphs are one 8 px cell wide (Latin, Kana halfwidth forms) or two cells
+ * wide (CJK, Hangul), and as tall as the console font.
+ */
+
+#define FONT_PATH "romfs:/font.bin"
+#define FONT_MAGIC 0x46443353 // "S3DF"
+#define FONT_VERSION 1
+#define FONT_HEIGHT 8
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+} FontHeader;
+
+typedef struct
+{
+    uint32_t codepoint;
+    uint16_t cells; // width in 8 px cells: 1 or 2
+    uint16_t reserved;
+    uint32_t offset; // from the start of the file
+} FontEntry;
+
+/**
+ * @brief Load the font file into memory (replacing any font loaded before)
+ * @return false if the file is missing or malformed
+ */
+bool fontLoad(const char *path);
+
+bool fontLoaded(void);
+
+/**
+ * @brief Look up a glyph by Unicode codepoint
+ * @param cells Receives the glyph's width in cells
+ * @return The glyph's bitmap, or NULL if the font doesn't have it
+ */
+const uint8_t *fontFind(uint32_t codepoint, int *cells);
+
+#endif // FONT_H
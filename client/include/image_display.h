@@ -7,9 +7,10 @@
  * @brief Download an image from a URL
  * @param url The URL to download from (HTTP or HTTPS)
  * @param size Output parameter for the size of downloaded data
+ * @param error Set to what went wrong on failure, for the status line (valid until the next call)
  * @return Pointer to downloaded image data (must be freed by caller), or NULL on failure
  */
-u8* downloadImage(const char* url, u32* size);
+u8* downloadImage(const char* url, u32* size, const char** error);
 
 /**
  * @brief Display an image on the top screen
@@ -20,6 +21,25 @@ u8* downloadImage(const char* url, u32* size);
  */
 void drawImageToScreen(u8* pixels, int width, int height);
 
+/**
+ * @brief Switch the top screen between BGR8 (default) and RGB565
+ * RGB565 cuts framebuffer and cached art size by a third; art and the
+ * background gradient are ordered-dithered so they don't band.
+ */
+void setTopScreenRGB565(bool enable);
+
+/**
+ * @brief Use a darkened, blurred copy of the cover as the background instead of the gradient
+ * The backdrop is computed once per cover and cached with it.
+ */
+void setBlurredBackdrop(bool enable);
+
+/**
+ * @brief Drop the scaled copy of the current image
+ * Must be called before the pixels passed to drawImageToScreen are freed.
+ */
+void resetImageCache(void);
+
 /**
  * @brief Fill the top screen with a solid color (used when no image is available)
  * @param r Red component (0-255)
@@ -35,6 +55,12 @@ void drawBackgroundToScreen();
 void setPlaybackPaused(bool paused);
 void setTemporaryPlay(bool show);
 
+/**
+ * @brief Whether the top screen is mid crossfade or overlay fade
+ * While it is, it must be drawn again on the next frame even if nothing else changed.
+ */
+bool topScreenAnimating(void);
+
 /**
  * @brief Initialize network services required for downloading images
  * @return 0 on success, error code on failure
@@ -0,0 +1,57 @@
+#ifndef LAYERS_H
+#define LAYERS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Static layers baked at build time by tools/bake_layers.c and packed into
+ * romfs. All multi-byte fields are little-endian.
+ *
+ *   LayersHeader
+ *   LayersEntry[count]
+ *   layer data, each layer in framebuffer order (see blit.h)
+ */
+
+#define LAYERS_PATH "romfs:/layers.bin"
+#define LAYERS_MAGIC 0x4c443353 // "S3DL"
+#define LAYERS_VERSION 1
+
+typedef enum
+{
+    LAYER_GRADIENT_BGR8 = 1, // full-screen background gradient, 3 bytes per pixel
+    LAYER_FRAME_MASK,        // outer rounded corners of the cover frame
+    LAYER_SHADOW_MASK,       // drop shadow falloff around the frame
+    LAYER_ICON_BG_MASK,      // rounded background of the play/pause overlay
+    LAYER_PLAY_MASK,         // play triangle
+    LAYER_PAUSE_MASK,        // pause bars
+} LayerId;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+} LayersHeader;
+
+typedef struct
+{
+    uint32_t id;
+    uint16_t w, h;
+    uint32_t offset; // from the start of the file
+    uint32_t size;
+} LayersEntry;
+
+/**
+ * @brief Load the baked layers file with a single read
+ * @return false if the file is missing or malformed; callers then rasterize at runtime
+ */
+bool layersLoad(const char *path);
+
+/**
+ * @brief Find a baked layer with the given size
+ * @return The layer's data, or NULL if there is none for that size
+ */
+const uint8_t *layersFind(LayerId id, int w, int h);
+
+#endif // LAYERS_H
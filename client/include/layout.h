@@ -0,0 +1,62 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+// Top screen layout (landscape). Shared by the renderer and the host tool
+// that bakes the static layers, so both agree on the default geometry.
+#define TOP_WIDTH 400
+#define TOP_HEIGHT 240
+#define ART_BORDER 4         // white border around the cover
+#define ART_PADDING 10       // gap between the border and the screen edge
+#define ART_CORNER_RADIUS 8  // rounded corners of the cover itself
+#define SHADOW_OFFSET 8      // drop shadow offset (both axes)
+#define SHADOW_BLUR 12       // how far the shadow spreads
+#define SHADOW_MAX_ALPHA 160 // max shadow alpha (0-255)
+#define ICON_CORNER_RADIUS 12
+#define ICON_BG_ALPHA 200    // overlay background alpha (stronger)
+
+// Spotify covers are square; this is the size the baked layers are made for
+#define DEFAULT_COVER_SIZE 640
+
+/**
+ * @brief Size of a width x height cover scaled to fit inside the border and padding
+ * @param scale Output scale factor from source to screen pixels
+ */
+static inline void layoutArtSize(int width, int height, int *scaledWidth, int *scaledHeight, float *scale)
+{
+    // Calculate scale to fit the entire image (accounting for the border on each side)
+    // AND making the image 10px smaller in each direction
+    int maxWidth = TOP_WIDTH - 2 * ART_BORDER - 2 * ART_PADDING;
+    int maxHeight = TOP_HEIGHT - 2 * ART_BORDER - 2 * ART_PADDING;
+    float scaleX = (float)maxWidth / width;
+    float scaleY = (float)maxHeight / height;
+    *scale = (scaleX < scaleY) ? scaleX : scaleY;
+
+    int w = (int)(width * *scale);
+    int h = (int)(height * *scale);
+
+    // Ensure scaled dimensions don't exceed available space
+    if (w > maxWidth)
+        w = maxWidth;
+    if (h > maxHeight)
+        h = maxHeight;
+    if (w <= 0)
+        w = 1;
+    if (h <= 0)
+        h = 1;
+
+    *scaledWidth = w;
+    *scaledHeight = h;
+}
+
+/**
+ * @brief Size of the play/pause icon: roughly 2/3 of the scaled image
+ */
+static inline void layoutIconSize(int imageW, int imageH, int *iconW, int *iconH)
+{
+    *iconW = (imageW * 2) / 3;
+    *iconH = (imageH * 2) / 3;
+    if (*iconW < 80) *iconW = 80;
+    if (*iconH < 80) *iconH = 80;
+}
+
+#endif // LAYOUT_H
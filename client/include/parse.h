@@ -1,6 +1,9 @@
 #ifndef PARSE_H
 #define PARSE_H
 
+#include <stddef.h>
+
 char* get(const char* key, const char* json);
+unsigned char* decode_base64(const char* text, size_t* len);
 
 #endif
@@ -0,0 +1,68 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <3ds.h>
+
+/*
+ * Frame-stage profiler, built in with `make PROFILE=1` (after a clean).
+ *
+ * PROFILE_BEGIN/PROFILE_END around a stage record its duration, measured
+ * with svcGetSystemTick, into a ring buffer holding the last PROFILE_RING
+ * samples. Scopes must be opened and closed on the main thread.
+ *
+ * The HUD shows each stage's p50/p99 over the ring, in milliseconds, on
+ * the rows under the bottom-screen frame. profileDump() writes the ring as
+ * CSV (stage, start, duration) so it can be looked at on a computer.
+ *
+ * Without PROFILE every macro expands to nothing.
+ */
+
+#define PROFILE_RING 4096 // samples kept, about 7 s at 60 fps
+
+typedef enum
+{
+    PROFILE_FRAME,    // one main loop iteration
+    PROFILE_INPUT,    // hidScanInput
+    PROFILE_RESULT,   // parsing a fetched response and updating the widgets
+    PROFILE_DOWNLOAD, // downloadImage
+    PROFILE_DECODE,   // stb_image decode of the cover
+    PROFILE_COVER,    // drawing the top screen
+    PROFILE_PANEL,    // repainting the bottom screen and flushing it
+    PROFILE_WAIT,     // gspWaitForVBlank, or sleeping until the next event when idle
+    PROFILE_STAGE_COUNT
+} ProfileStage;
+
+#ifdef PROFILE
+
+void profileBegin(ProfileStage stage);
+void profileEnd(ProfileStage stage);
+
+/**
+ * @brief Show or hide the HUD
+ */
+void profileToggleHud(void);
+
+/**
+ * @brief Refresh the HUD if it's shown; call once per frame, before uiPresent()
+ * Percentiles are recomputed every PROFILE_HUD_PERIOD frames.
+ */
+void profileDrawHud(void);
+
+/**
+ * @brief Write the ring buffer to a new CSV file in dir
+ * @param path Receives the file's path
+ * @return false if the file could not be written
+ */
+bool profileDump(const char *dir, char *path, size_t pathSize);
+
+#define PROFILE_BEGIN(stage) profileBegin(stage)
+#define PROFILE_END(stage) profileEnd(stage)
+
+#else
+
+#define PROFILE_BEGIN(stage) ((void)0)
+#define PROFILE_END(stage) ((void)0)
+
+#endif // PROFILE
+
+#endif // PROFILE_H
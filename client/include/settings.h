@@ -0,0 +1,21 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <stdbool.h>
+
+#define SETTINGS_PATH "sdmc:/3ds/spotify-3ds/settings.cfg"
+
+// Optional features, read from SETTINGS_PATH as "key=value" lines.
+// Missing file or keys leave the defaults below.
+typedef struct
+{
+    bool rgb565;           // rgb565=1: run the top screen in RGB565 (default: BGR8)
+    bool blurred_backdrop; // blurred_backdrop=1: blurred cover behind the art (default: gradient)
+} Settings;
+
+/**
+ * @brief Fill settings with defaults, then apply SETTINGS_PATH if it exists
+ */
+void loadSettings(Settings *settings);
+
+#endif // SETTINGS_H
@@ -0,0 +1,50 @@
+#ifndef SHAPES_H
+#define SHAPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Rasterizers for the fixed shapes of the now-playing screen (frame corners,
+ * drop shadow, play/pause icons). They have no 3DS dependencies so the same
+ * geometry can be generated on the host.
+ *
+ * Masks are 8-bit coverage in framebuffer order, as described in blit.h:
+ * w columns of h bytes, pixel (x, y) at index x * h + (h - 1 - y).
+ */
+
+/**
+ * @brief Color of row y of the green background gradient
+ */
+void shapeGradientColor(int y, int height, uint8_t *r, uint8_t *g, uint8_t *b);
+
+/**
+ * @brief Test whether a pixel lies inside a w x h rect with rounded corners
+ * @param x Column relative to the rect's left edge
+ * @param y Row relative to the rect's top edge
+ */
+bool shapeInRoundedRect(int x, int y, int w, int h, int radius);
+
+/**
+ * @brief Coverage mask of a rounded rect (255 inside, 0 outside)
+ */
+void shapeRoundedRectMask(uint8_t *mask, int w, int h, int radius);
+
+/**
+ * @brief Soft drop shadow around a rounded rect
+ * The mask is (rectW + 2 * blur) x (rectH + 2 * blur) with the rect centered in it;
+ * alpha falls off linearly from maxAlpha at the rect edge to 0 at blur pixels out.
+ */
+void shapeShadowMask(uint8_t *mask, int rectW, int rectH, int radius, int blur, int maxAlpha);
+
+/**
+ * @brief Right-pointing play triangle inside a w x h icon
+ */
+void shapePlayMask(uint8_t *mask, int w, int h);
+
+/**
+ * @brief Two vertical pause bars inside a w x h icon
+ */
+void shapePauseMask(uint8_t *mask, int w, int h);
+
+#endif // SHAPES_H
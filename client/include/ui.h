@@ -0,0 +1,133 @@
+#ifndef UI_H
+#define UI_H
+
+#include <3ds.h>
+
+/*
+ * Bottom-screen renderer.
+ *
+ * Text and the decorative frame are drawn straight into the bottom
+ * framebuffer on the same 40 x 30 grid of 8x8 cells the libctru console
+ * used, so rows and columns are 1-based like the console's cursor escapes.
+ *
+ * Text is UTF-8. ASCII comes from the console's built-in font, everything
+ * else from the romfs font (font.h); wide glyphs take two cells. Glyphs are
+ * rasterized on demand into opaque cells in framebuffer order and kept in
+ * an LRU atlas, so drawing a character is usually a copy of 8 short
+ * columns. The frame is drawn once into a cached layer and copied back from
+ * there instead of being redrawn.
+ *
+ * The renderer remembers which glyph and color each cell shows, so drawing
+ * text that is already on screen costs nothing and clearing only touches
+ * cells that hold something.
+ */
+
+#define UI_COLS 40
+#define UI_ROWS 30
+#define UI_CELL 8
+
+// Frame geometry, in cells
+#define UI_FRAME_MARGIN 3 // columns left of the frame (and right of it, minus one)
+#define UI_FRAME_TOP 4
+#define UI_FRAME_BOTTOM 26
+
+typedef struct
+{
+    u8 r, g, b;
+} UiColor;
+
+// Glyph atlas counters since uiInit()
+typedef struct
+{
+    u32 hits;      // cell found already rasterized
+    u32 misses;    // cell had to be rasterized
+    u32 evictions; // misses that pushed out the least recently used cell
+} UiGlyphStats;
+
+// A line of text rendered once, UI_CELL pixels tall, in framebuffer order
+typedef struct
+{
+    int width; // in pixels
+    u8 *pixels;
+} UiStrip;
+
+// Every cell is drawn on the panel background
+#define UI_COLOR_BACKGROUND ((UiColor){ 30, 33, 36 })
+#define UI_COLOR_TEXT ((UiColor){ 30, 215, 96 })    // Spotify green
+#define UI_COLOR_SHADOW ((UiColor){ 0, 0, 0 })
+#define UI_COLOR_INACTIVE ((UiColor){ 120, 120, 120 })
+
+/**
+ * @brief Take over the bottom screen and build the glyph atlas and cached frame layer
+ * Must be called after gfxInitDefault(), instead of consoleInit() for GFX_BOTTOM.
+ * @return false if the atlas or frame layer could not be allocated
+ */
+bool uiInit(void);
+
+/**
+ * @brief Release the glyph cells and the frame layer
+ */
+void uiExit(void);
+
+/**
+ * @brief Show the empty frame
+ * Only cells holding text are copied back from the cached layer.
+ */
+void uiDrawFrame(void);
+
+/**
+ * @brief Restore count cells of a row, starting at a 1-based column, to the empty frame
+ */
+void uiClearCells(int row, int col, int count);
+
+/**
+ * @brief Draw text at a 1-based cell position; characters outside the grid are dropped
+ * Cells already showing the same character in the same color are skipped.
+ */
+void uiDrawText(int row, int col, const char *text, UiColor color);
+
+/**
+ * @brief Width of UTF-8 text in cells
+ */
+int uiTextWidth(const char *text);
+
+/**
+ * @brief Length in bytes of the longest prefix of text that fits in the given number of cells
+ */
+int uiTextFit(const char *text, int cells);
+
+void uiGetGlyphStats(UiGlyphStats *stats);
+
+/**
+ * @brief Render text into an off-screen strip, followed by padCells blank cells
+ * @return false if the strip could not be allocated
+ */
+bool uiStripBuild(UiStrip *strip, const char *text, int padCells, UiColor color);
+
+/**
+ * @brief Build a strip from text rendered elsewhere, 1 bit per pixel
+ * @param bits UI_CELL rows of cells bytes each, MSB leftmost (the font.h glyph layout)
+ * @return false if the strip could not be allocated
+ */
+bool uiStripFromBits(UiStrip *strip, const u8 *bits, int cells, int padCells, UiColor color);
+
+/**
+ * @brief Build a strip that shows first, then second, pixel for pixel
+ */
+bool uiStripJoin(UiStrip *strip, const UiStrip *first, const UiStrip *second);
+
+void uiStripFree(UiStrip *strip);
+
+/**
+ * @brief Draw a window of a strip into cells [col, col + cells) of a row
+ * @param offset Strip pixel shown at the window's left edge; the strip repeats past its end
+ */
+void uiDrawStrip(int row, int col, int cells, const UiStrip *strip, int offset);
+
+/**
+ * @brief Flush everything drawn since the last call so the LCD sees it
+ * Call once per frame, before waiting for VBlank.
+ */
+void uiPresent(void);
+
+#endif // UI_H
@@ -0,0 +1,126 @@
+#ifndef WIDGETS_H
+#define WIDGETS_H
+
+#include <3ds.h>
+#include "ui.h"
+
+/*
+ * Retained widgets for the bottom screen.
+ *
+ * Each widget keeps the value it shows and the cells it covered when it was
+ * last drawn. Setters only mark a widget dirty when the value actually
+ * changes, and widgetsUpdate() repaints just the dirty ones: the new content
+ * is drawn (ui.c skips cells that already show the same glyph) and cells the
+ * widget no longer covers are restored to the empty frame.
+ */
+
+#define WIDGET_TEXT_SIZE 128
+#define WIDGET_MAX_SPANS 5
+
+typedef enum
+{
+    WIDGET_LABEL,    // centered between the frame margins, with a shadow one cell down-right
+    WIDGET_MARQUEE,  // a label that scrolls pixel by pixel when its text doesn't fit
+    WIDGET_VOLUME,   // "Volume: NN%" label and a 10-segment bar two rows below
+    WIDGET_STATUS,   // plain line centered across the whole screen
+    WIDGET_PROGRESS, // "m:ss" elapsed, a bar that fills pixel by pixel, "m:ss" total
+} WidgetKind;
+
+typedef struct
+{
+    int row, c0, c1; // 1-based columns [c0, c1)
+} WidgetSpan;
+
+typedef struct
+{
+    WidgetKind kind;
+    int row;
+    bool visible;
+    bool dirty;
+    char text[WIDGET_TEXT_SIZE]; // UTF-8
+    int width;        // of text, in cells
+    int value;        // WIDGET_VOLUME: percent, WIDGET_PROGRESS: bar pixels filled; -1 when unknown
+    u32 position, duration; // WIDGET_PROGRESS: seconds
+    int scroll;       // WIDGET_MARQUEE: pixel offset of the visible window into the strips
+    u64 scrollStart;  // WIDGET_MARQUEE: time the text started scrolling (ms), 0 until the first tick
+    bool bitmap;      // text is drawn from strips the server rendered, not from fonts
+    UiStrip strip;    // text and its shadow, rendered once per text for a marquee that
+    UiStrip shadowStrip; // scrolls or a bitmap label; WIDGET_PROGRESS keeps its bar in strip
+    int spanCount;    // cells covered on screen
+    WidgetSpan spans[WIDGET_MAX_SPANS];
+} Widget;
+
+/**
+ * @brief Set up an empty, visible widget at a 1-based row
+ */
+void widgetInit(Widget *widget, WidgetKind kind, int row);
+
+/**
+ * @brief Change the text shown by a label, marquee or status line
+ */
+void widgetSetText(Widget *widget, const char *text);
+
+/**
+ * @brief Show text rendered by the server on a label or marquee
+ * @param text The text itself, to tell when it changes
+ * @param bits 1 bit per pixel, UI_CELL rows of cells bytes (see uiStripFromBits)
+ */
+void widgetSetBitmap(Widget *widget, const char *text, const u8 *bits, int cells);
+
+/**
+ * @brief Change the volume shown by a volume widget (-1 for unknown)
+ */
+void widgetSetValue(Widget *widget, int value);
+
+/**
+ * @brief Change where playback is on a progress widget
+ * @param durationMs Length of the track, 0 when unknown (the widget then shows nothing)
+ */
+void widgetSetProgress(Widget *widget, u32 positionMs, u32 durationMs);
+
+void widgetSetVisible(Widget *widget, bool visible);
+
+/**
+ * @brief Free the pre-rendered strips of a marquee or bitmap label
+ */
+void widgetRelease(Widget *widget);
+
+/**
+ * @brief Forget what the widget covered, after the screen was cleared under it
+ */
+void widgetInvalidate(Widget *widget);
+
+/**
+ * @brief Advance a marquee whose text doesn't fit; a no-op for other widgets
+ * Call every frame: the position follows the clock, so motion stays even if frames are dropped.
+ * @param now osGetTime() in full; widgetNextTick() and widgetDelayScroll() share this clock
+ */
+void widgetTick(Widget *widget, u64 now);
+
+/**
+ * @brief How long until a playing progress widget next changes (a pixel of bar, or a second)
+ * @return That delay in milliseconds, or UINT32_MAX if it won't change
+ */
+u32 widgetProgressDue(const Widget *widget, u32 positionMs, u32 durationMs);
+
+/**
+ * @brief When a marquee's text next moves by a pixel
+ * @param now osGetTime() in full, as for widgetTick()
+ * @return That time in milliseconds, or U64_MAX if the widget doesn't scroll
+ */
+u64 widgetNextTick(const Widget *widget, u64 now);
+
+/**
+ * @brief Resume a marquee where it stopped rather than where it would be by now
+ * @param pausedMs How long it went without ticks (the app was asleep or in the background)
+ */
+void widgetDelayScroll(Widget *widget, u64 pausedMs);
+
+/**
+ * @brief Repaint the widgets whose value changed
+ * Old cells of every dirty widget are cleared before any of them draws, so
+ * widgets sharing cells can swap visibility in one update.
+ */
+void widgetsUpdate(Widget *const *widgets, int count);
+
+#endif // WIDGETS_H
@@ -0,0 +1,419 @@
+#include "blit.h"
+#include <stdlib.h>
+#include <string.h>
+
+// A rect after clipping against the screen
+typedef struct
+{
+    int x0, x1;  // screen columns [x0, x1)
+    int y0, y1;  // screen rows [y0, y1)
+    int srcSkip; // pixels to skip at the start of each tile/mask column
+} BlitClip;
+
+static bool clipRect(const BlitTarget *target, int x, int y, int w, int h, BlitClip *clip)
+{
+    if (!target || !target->pixels || w <= 0 || h <= 0)
+        return false;
+
+    clip->x0 = (x < 0) ? 0 : x;
+    clip->x1 = (x + w > target->width) ? target->width : x + w;
+    clip->y0 = (y < 0) ? 0 : y;
+    clip->y1 = (y + h > target->height) ? target->height : y + h;
+    if (clip->x0 >= clip->x1 || clip->y0 >= clip->y1)
+        return false;
+
+    // Columns are stored bottom-up, so rows clipped off the bottom of the
+    // rect are the ones at the start of each column.
+    clip->srcSkip = (y + h) - clip->y1;
+    return true;
+}
+
+// First byte of the clipped span in framebuffer column `sx`
+static inline u8 *columnStart(const BlitTarget *target, const BlitClip *clip, int sx)
+{
+    return target->pixels + (sx * target->height + (target->height - clip->y1)) * target->bpp;
+}
+
+// out = (a * src + (255 - a) * dst) / 255, rounded, without a divide
+static inline u8 blend(int src, int dst, int a)
+{
+    int v = a * src + (255 - a) * dst + 128;
+    return (u8)((v + (v >> 8)) >> 8);
+}
+
+// 4x4 Bayer matrix, thresholds 0-15
+static const u8 bayer4[4][4] = {
+    { 0, 8, 2, 10 },
+    { 12, 4, 14, 6 },
+    { 3, 11, 1, 9 },
+    { 15, 7, 13, 5 },
+};
+
+static inline u16 pack565(int r, int g, int b)
+{
+    return (u16)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+static inline void unpack565(const u8 *px, int *r, int *g, int *b)
+{
+    u16 p = (u16)(px[0] | (px[1] << 8));
+    int r5 = p >> 11, g6 = (p >> 5) & 0x3f, b5 = p & 0x1f;
+    *r = (r5 << 3) | (r5 >> 2);
+    *g = (g6 << 2) | (g6 >> 4);
+    *b = (b5 << 3) | (b5 >> 2);
+}
+
+static inline void store565(u8 *px, u16 p)
+{
+    px[0] = (u8)p;
+    px[1] = (u8)(p >> 8);
+}
+
+static inline void storePixel(u8 *px, int bpp, int r, int g, int b)
+{
+    if (bpp == 3)
+    {
+        px[0] = (u8)b;
+        px[1] = (u8)g;
+        px[2] = (u8)r;
+    }
+    else
+    {
+        store565(px, pack565(r, g, b));
+    }
+}
+
+static inline void blendPixel(u8 *px, int bpp, int r, int g, int b, int a)
+{
+    if (bpp == 3)
+    {
+        px[0] = blend(b, px[0], a);
+        px[1] = blend(g, px[1], a);
+        px[2] = blend(r, px[2], a);
+    }
+    else
+    {
+        int dr, dg, db;
+        unpack565(px, &dr, &dg, &db);
+        store565(px, pack565(blend(r, dr, a), blend(g, dg, a), blend(b, db, a)));
+    }
+}
+
+// Color of a tile pixel in the target's format
+static inline void loadPixel(const u8 *px, int bpp, int *r, int *g, int *b)
+{
+    if (bpp == 3)
+    {
+        *b = px[0];
+        *g = px[1];
+        *r = px[2];
+    }
+    else
+    {
+        unpack565(px, r, g, b);
+    }
+}
+
+void blitPackPixel(u8 *dst, int bpp, u8 r, u8 g, u8 b, int x, int y)
+{
+    if (bpp == 3)
+    {
+        storePixel(dst, 3, r, g, b);
+        return;
+    }
+
+    // Ordered dither: spread the bits lost to 5/6-bit precision over a 4x4 pattern
+    int t = bayer4[y & 3][x & 3];
+    int r5 = (r + (t >> 1)) >> 3;
+    int g6 = (g + (t >> 2)) >> 2;
+    int b5 = (b + (t >> 1)) >> 3;
+    if (r5 > 31) r5 = 31;
+    if (g6 > 63) g6 = 63;
+    if (b5 > 31) b5 = 31;
+    store565(dst, (u16)((r5 << 11) | (g6 << 5) | b5));
+}
+
+bool blitTargetForScreen(BlitTarget *target, gfxScreen_t screen)
+{
+    u16 fbWidth, fbHeight;
+    u8 *fb = gfxGetFramebuffer(screen, GFX_LEFT, &fbWidth, &fbHeight);
+    if (!fb)
+        return false;
+
+    // gfxGetFramebuffer reports the rotated size (240 x 400 for the top screen)
+    target->pixels = fb;
+    target->width = fbHeight;
+    target->height = fbWidth;
+    target->bpp = (gfxGetScreenFormat(screen) == GSP_RGB565_OES) ? 2 : 3;
+    return true;
+}
+
+void blitFillRect(const BlitTarget *target, int x, int y, int w, int h, u8 r, u8 g, u8 b)
+{
+    BlitClip clip;
+    if (!clipRect(target, x, y, w, h, &clip))
+        return;
+
+    int bpp = target->bpp;
+    int n = clip.y1 - clip.y0;
+    u8 *first = columnStart(target, &clip, clip.x0);
+    for (int i = 0; i < n; i++)
+        storePixel(first + i * bpp, bpp, r, g, b);
+
+    // Every other column is identical to the first one
+    for (int sx = clip.x0 + 1; sx < clip.x1; sx++)
+        memcpy(columnStart(target, &clip, sx), first, n * bpp);
+}
+
+void blitTile(const BlitTarget *target, int x, int y, int w, int h, const u8 *tile, int tileStride)
+{
+    BlitClip clip;
+    if (!tile || !clipRect(target, x, y, w, h, &clip))
+        return;
+
+    int n = clip.y1 - clip.y0;
+    const u8 *src = tile + (clip.x0 - x) * tileStride + clip.srcSkip * target->bpp;
+    for (int sx = clip.x0; sx < clip.x1; sx++)
+    {
+        memcpy(columnStart(target, &clip, sx), src, n * target->bpp);
+        src += tileStride;
+    }
+}
+
+void blitBlendTiles(const BlitTarget *target, int x, int y, int w, int h, const u8 *from,
+                    int fromStride, const u8 *to, int toStride, int t)
+{
+    BlitClip clip;
+    if (!from || !to || !clipRect(target, x, y, w, h, &clip))
+        return;
+    if (t < 0) t = 0;
+    if (t > 256) t = 256;
+
+    int bpp = target->bpp;
+    int n = clip.y1 - clip.y0;
+    int skip = clip.srcSkip * bpp;
+    int inv = 256 - t;
+    for (int sx = clip.x0; sx < clip.x1; sx++)
+    {
+        u8 *dst = columnStart(target, &clip, sx);
+        const u8 *a = from + (sx - x) * fromStride + skip;
+        const u8 *b = to + (sx - x) * toStride + skip;
+        if (bpp == 3)
+        {
+            for (int i = 0; i < n * 3; i++)
+                dst[i] = (u8)((a[i] * inv + b[i] * t) >> 8);
+            continue;
+        }
+        for (int i = 0; i < n; i++, dst += 2, a += 2, b += 2)
+        {
+            int ar, ag, ab, br, bg, bb;
+            unpack565(a, &ar, &ag, &ab);
+            unpack565(b, &br, &bg, &bb);
+            store565(dst, pack565((ar * inv + br * t) >> 8, (ag * inv + bg * t) >> 8,
+                                  (ab * inv + bb * t) >> 8));
+        }
+    }
+}
+
+void blitBlendMask(const BlitTarget *target, int x, int y, int w, int h, const u8 *mask,
+                   u8 r, u8 g, u8 b, int alpha)
+{
+    BlitClip clip;
+    if (!mask || alpha <= 0 || !clipRect(target, x, y, w, h, &clip))
+        return;
+    if (alpha > 255)
+        alpha = 255;
+
+    int bpp = target->bpp;
+    int n = clip.y1 - clip.y0;
+    const u8 *src = mask + (clip.x0 - x) * h + clip.srcSkip;
+    for (int sx = clip.x0; sx < clip.x1; sx++)
+    {
+        u8 *dst = columnStart(target, &clip, sx);
+        for (int i = 0; i < n; i++, dst += bpp)
+        {
+            int m = src[i];
+            if (m == 0)
+                continue;
+            int a = (alpha == 255) ? m : blend(m, 0, alpha);
+            if (a == 255)
+                storePixel(dst, bpp, r, g, b);
+            else
+                blendPixel(dst, bpp, r, g, b, a);
+        }
+        src += h;
+    }
+}
+
+void blitBlendSprite(const BlitTarget *target, int x, int y, int w, int h, const u8 *tile,
+                     const u8 *mask, int alpha)
+{
+    BlitClip clip;
+    if (!tile || !mask || alpha <= 0 || !clipRect(target, x, y, w, h, &clip))
+        return;
+    if (alpha > 255)
+        alpha = 255;
+
+    int bpp = target->bpp;
+    int n = clip.y1 - clip.y0;
+    const u8 *srcMask = mask + (clip.x0 - x) * h + clip.srcSkip;
+    const u8 *srcPx = tile + ((clip.x0 - x) * h + clip.srcSkip) * bpp;
+    for (int sx = clip.x0; sx < clip.x1; sx++)
+    {
+        u8 *dst = columnStart(target, &clip, sx);
+        const u8 *px = srcPx;
+        for (int i = 0; i < n; i++, dst += bpp, px += bpp)
+        {
+            int m = srcMask[i];
+            if (m == 0)
+                continue;
+            int a = (alpha == 255) ? m : blend(m, 0, alpha);
+            if (a == 255)
+            {
+                memcpy(dst, px, bpp);
+            }
+            else
+            {
+                int r, g, b;
+                loadPixel(px, bpp, &r, &g, &b);
+                blendPixel(dst, bpp, r, g, b, a);
+            }
+        }
+        srcMask += h;
+        srcPx += h * bpp;
+    }
+}
+
+static inline bool samePixel(const u8 *tile, const u8 *alpha, int a, int b)
+{
+    if (alpha[a] != alpha[b])
+        return false;
+    // Color doesn't matter under a fully transparent run
+    return alpha[a] == 0 || memcmp(tile + a * 3, tile + b * 3, 3) == 0;
+}
+
+bool blitRleEncode(BlitRle *rle, int w, int h, const u8 *tile, const u8 *alpha)
+{
+    memset(rle, 0, sizeof(*rle));
+    if (w <= 0 || h <= 0 || !tile || !alpha)
+        return false;
+
+    // First pass counts runs so the buffer can be allocated exactly
+    int count = 0;
+    for (int cx = 0; cx < w; cx++)
+    {
+        int base = cx * h;
+        for (int i = 0; i < h;)
+        {
+            int len = 1;
+            while (i + len < h && len < 255 && samePixel(tile, alpha, base + i, base + i + len))
+                len++;
+            i += len;
+            count++;
+        }
+    }
+
+    rle->columns = (u32 *)malloc((w + 1) * sizeof(u32));
+    rle->runs = (u8 *)malloc(count * BLIT_RLE_RUN_SIZE);
+    if (!rle->columns || !rle->runs)
+    {
+        blitRleFree(rle);
+        return false;
+    }
+
+    u8 *run = rle->runs;
+    for (int cx = 0; cx < w; cx++)
+    {
+        int base = cx * h;
+        rle->columns[cx] = run - rle->runs;
+        for (int i = 0; i < h;)
+        {
+            int len = 1;
+            while (i + len < h && len < 255 && samePixel(tile, alpha, base + i, base + i + len))
+                len++;
+            const u8 *px = tile + (base + i) * 3;
+            run[0] = (u8)len;
+            run[1] = alpha[base + i];
+            run[2] = px[0];
+            run[3] = px[1];
+            run[4] = px[2];
+            run += BLIT_RLE_RUN_SIZE;
+            i += len;
+        }
+    }
+    rle->columns[w] = run - rle->runs;
+
+    rle->w = w;
+    rle->h = h;
+    return true;
+}
+
+void blitRleFree(BlitRle *rle)
+{
+    free(rle->columns);
+    free(rle->runs);
+    memset(rle, 0, sizeof(*rle));
+}
+
+void blitBlendRle(const BlitTarget *target, int x, int y, const BlitRle *rle, int alpha)
+{
+    BlitClip clip;
+    if (!rle || !rle->runs || alpha <= 0 || !clipRect(target, x, y, rle->w, rle->h, &clip))
+        return;
+    if (alpha > 255)
+        alpha = 255;
+
+    int bpp = target->bpp;
+    int n = clip.y1 - clip.y0;
+    for (int sx = clip.x0; sx < clip.x1; sx++)
+    {
+        const u8 *run = rle->runs + rle->columns[sx - x];
+        const u8 *end = rle->runs + rle->columns[sx - x + 1];
+        u8 *dst = columnStart(target, &clip, sx);
+
+        // pos is the run's start relative to the clipped span
+        int pos = -clip.srcSkip;
+        for (; run < end && pos < n; run += BLIT_RLE_RUN_SIZE)
+        {
+            int start = pos;
+            int stop = pos + run[0];
+            pos = stop;
+
+            int a = (alpha == 255) ? run[1] : blend(run[1], 0, alpha);
+            if (a == 0 || stop <= 0)
+                continue;
+            if (start < 0)
+                start = 0;
+            if (stop > n)
+                stop = n;
+
+            u8 *px = dst + start * bpp;
+            int count = stop - start;
+            if (a == 255)
+            {
+                for (int i = 0; i < count; i++, px += bpp)
+                    storePixel(px, bpp, run[4], run[3], run[2]);
+                continue;
+            }
+            if (bpp != 3)
+            {
+                for (int i = 0; i < count; i++, px += bpp)
+                    blendPixel(px, bpp, run[4], run[3], run[2], a);
+                continue;
+            }
+
+            // Source terms are constant across the run
+            int inv = 255 - a;
+            int sb = a * run[2] + 128, sg = a * run[3] + 128, sr = a * run[4] + 128;
+            for (int i = 0; i < count; i++, px += 3)
+            {
+                int vb = sb + inv * px[0];
+                int vg = sg + inv * px[1];
+                int vr = sr + inv * px[2];
+                px[0] = (u8)((vb + (vb >> 8)) >> 8);
+                px[1] = (u8)((vg + (vg >> 8)) >> 8);
+                px[2] = (u8)((vr + (vr >> 8)) >> 8);
+            }
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#include "clocksync.h"
+
+typedef struct
+{
+    s64 offset; // server minus console
+    u32 delay;
+} ClockSample;
+
+static ClockSample samples[CLOCK_SAMPLES];
+static int sampleCount = 0, nextSample = 0;
+static int best = -1;
+
+void clockSyncAdd(u64 t0, u64 t1, u64 t2, u64 t3)
+{
+    // Replies the server took longer to send than the console waited are nonsense
+    s64 delay = ((s64)t3 - (s64)t0) - ((s64)t2 - (s64)t1);
+    if (t3 < t0 || t2 < t1 || delay < 0)
+        return;
+
+    ClockSample *sample = &samples[nextSample];
+    sample->offset = (((s64)t1 - (s64)t0) + ((s64)t2 - (s64)t3)) / 2;
+    sample->delay = (u32)delay;
+    nextSample = (nextSample + 1) % CLOCK_SAMPLES;
+    if (sampleCount < CLOCK_SAMPLES)
+        sampleCount++;
+
+    best = 0;
+    for (int i = 1; i < sampleCount; i++)
+    {
+        if (samples[i].delay < samples[best].delay)
+            best = i;
+    }
+}
+
+bool clockSyncReady(void)
+{
+    return best >= 0;
+}
+
+u64 clockSyncToLocal(u64 serverMs)
+{
+    return best >= 0 ? (u64)((s64)serverMs - samples[best].offset) : serverMs;
+}
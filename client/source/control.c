@@ -0,0 +1,203 @@
+#include "control.h"
+
+// A skip counts as done once the track changed, or started over (previous, a few
+// seconds in, restarts the same track); this much slack allows for clock error
+#define RESTART_SLACK_MS 1500
+
+// Pending controls, oldest first; they are sent in that order
+static Control pending[CONTROL_MAX];
+static int pendingCount = 0;
+static u64 volumeSentAt = 0;
+
+u32 controlTrackKey(const char *name, const char *artist)
+{
+    // FNV-1a over both, with a separator so "ab"+"c" differs from "a"+"bc"
+    u32 hash = 2166136261u;
+    for (const char *s = name; s && *s; s++)
+        hash = (hash ^ (u8)*s) * 16777619u;
+    hash = (hash ^ 0xff) * 16777619u;
+    for (const char *s = artist; s && *s; s++)
+        hash = (hash ^ (u8)*s) * 16777619u;
+    return hash;
+}
+
+static void dropThrough(int last)
+{
+    for (int i = last + 1; i < pendingCount; i++)
+        pending[i - (last + 1)] = pending[i];
+    pendingCount -= last + 1;
+}
+
+bool controlPress(ControlKind kind, int volume, const PlayerState *shown, u64 now)
+{
+    Control *last = pendingCount ? &pending[pendingCount - 1] : NULL;
+    if (kind == CONTROL_VOLUME && last && last->kind == CONTROL_VOLUME && !last->seq)
+    {
+        last->volume = volume;
+        last->pressedAt = now;
+        return true;
+    }
+    if (pendingCount == CONTROL_MAX)
+        return false;
+
+    Control *control = &pending[pendingCount++];
+    control->kind = kind;
+    control->volume = volume;
+    control->track = shown->track;
+    control->pressedAt = now;
+    control->seq = 0;
+    control->freshFrom = 0;
+    return true;
+}
+
+static Control *firstUnsent(void)
+{
+    for (int i = 0; i < pendingCount; i++)
+    {
+        if (!pending[i].seq)
+            return &pending[i];
+    }
+    return NULL;
+}
+
+const Control *controlWaiting(void)
+{
+    return firstUnsent();
+}
+
+u64 controlSendAt(void)
+{
+    const Control *control = controlWaiting();
+    if (!control)
+        return U64_MAX;
+    if (control->kind != CONTROL_VOLUME)
+        return 0;
+
+    u64 settled = control->pressedAt + CONTROL_VOLUME_SETTLE_MS;
+    u64 spaced = volumeSentAt + CONTROL_VOLUME_INTERVAL_MS;
+    return settled < spaced ? settled : spaced;
+}
+
+const Control *controlToSend(u64 now)
+{
+    return now >= controlSendAt() ? controlWaiting() : NULL;
+}
+
+void controlSent(u32 seq, u64 now)
+{
+    Control *control = firstUnsent();
+    if (!control)
+        return;
+    control->seq = seq;
+    if (control->kind == CONTROL_VOLUME)
+        volumeSentAt = now;
+}
+
+void controlAcknowledged(u32 seq, bool ok, u32 freshFrom)
+{
+    for (int i = 0; i < pendingCount; i++)
+    {
+        if (pending[i].seq != seq)
+            continue;
+        if (ok)
+        {
+            pending[i].freshFrom = freshFrom;
+            return;
+        }
+        for (int j = i + 1; j < pendingCount; j++)
+            pending[j - 1] = pending[j];
+        pendingCount--;
+        return;
+    }
+}
+
+static bool confirms(const PlayerState *polled, const Control *control)
+{
+    switch (control->kind)
+    {
+    case CONTROL_PLAY:
+        return polled->playing;
+    case CONTROL_PAUSE:
+        return !polled->playing;
+    case CONTROL_VOLUME:
+        return polled->volume == control->volume;
+    case CONTROL_NEXT:
+    case CONTROL_PREVIOUS:
+        return polled->track != control->track ||
+               (s64)polled->progressMs <=
+                   (s64)polled->progressAt - (s64)control->pressedAt + RESTART_SLACK_MS;
+    }
+    return false;
+}
+
+void controlReconcile(const PlayerState *polled, u32 seq)
+{
+    // A later control confirmed settles the earlier ones too: the poll came after them all
+    for (int i = pendingCount - 1; i >= 0; i--)
+    {
+        if (pending[i].freshFrom && seq >= pending[i].freshFrom && confirms(polled, &pending[i]))
+        {
+            dropThrough(i);
+            return;
+        }
+    }
+}
+
+bool controlExpire(u64 now)
+{
+    int last = -1;
+    for (int i = 0; i < pendingCount && now - pending[i].pressedAt >= CONTROL_TIMEOUT_MS; i++)
+        last = i;
+    if (last < 0)
+        return false;
+
+    dropThrough(last);
+    return true;
+}
+
+u64 controlDeadline(void)
+{
+    return pendingCount ? pending[0].pressedAt + CONTROL_TIMEOUT_MS : U64_MAX;
+}
+
+bool controlPending(void)
+{
+    return pendingCount > 0;
+}
+
+// Carry the progress forward to a console time, as it would have played on
+static void progressTo(PlayerState *state, u64 at)
+{
+    if (state->playing && at > state->progressAt)
+        state->progressMs += (u32)(at - state->progressAt);
+    state->progressAt = at;
+}
+
+void controlApply(const PlayerState *polled, PlayerState *shown)
+{
+    *shown = *polled;
+    shown->skipping = false;
+    for (int i = 0; i < pendingCount; i++)
+    {
+        const Control *control = &pending[i];
+        switch (control->kind)
+        {
+        case CONTROL_PLAY:
+        case CONTROL_PAUSE:
+            progressTo(shown, control->pressedAt);
+            shown->playing = control->kind == CONTROL_PLAY;
+            break;
+        case CONTROL_VOLUME:
+            shown->volume = control->volume;
+            break;
+        case CONTROL_NEXT:
+        case CONTROL_PREVIOUS:
+            // Where the new track starts is known, how long it is isn't: the bar waits
+            shown->skipping = true;
+            shown->progressMs = 0;
+            shown->progressAt = control->pressedAt;
+            shown->durationMs = 0;
+            break;
+        }
+    }
+}
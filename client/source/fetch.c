@@ -5,41 +5,26 @@
 
 #include "fetch.h"
 
-// ------------------------------
-// Returns a char* with the JSON
-// Returns NULL on failure
-// Caller must free()
-// ------------------------------
-char *fetch(const char *url)
+// The response to a request on an open context, or NULL
+static char *receive(httpcContext *context)
 {
-    httpcContext context;
-    Result ret;
-
-    ret = httpcOpenContext(&context, HTTPC_METHOD_GET, url, 1);
-    if (R_FAILED(ret))
-    {
-        return NULL;
-    }
-
-    ret = httpcBeginRequest(&context);
+    Result ret = httpcBeginRequest(context);
     if (R_FAILED(ret))
     {
-        httpcCloseContext(&context);
         return NULL;
     }
 
     u32 statusCode = 0;
-    httpcGetResponseStatusCode(&context, &statusCode);
+    httpcGetResponseStatusCode(context, &statusCode);
 
     if (statusCode != 200)
     {
-        httpcCloseContext(&context);
         return NULL;
     }
 
     u32 downloadedSize = 0;
     u32 totalSize = 0;
-    httpcGetDownloadSizeState(&context, &downloadedSize, &totalSize);
+    httpcGetDownloadSizeState(context, &downloadedSize, &totalSize);
 
     // If the server doesn't provide it, use an arbitrary size (e.g., 8KB)
     if (totalSize == 0)
@@ -49,25 +34,79 @@ char *fetch(const char *url)
     char *buffer = (char *)malloc(totalSize + 1);
     if (!buffer)
     {
-        httpcCloseContext(&context);
         return NULL;
     }
 
     // Read data
-    ret = httpcReceiveData(&context, (u8 *)buffer, totalSize);
+    ret = httpcReceiveData(context, (u8 *)buffer, totalSize);
     if (R_FAILED(ret))
     {
         free(buffer);
-        httpcCloseContext(&context);
         return NULL;
     }
 
     buffer[totalSize] = '\0'; // end of string
+    return buffer;
+}
 
+// ------------------------------
+// Returns a char* with the JSON
+// Returns NULL on failure
+// Caller must free()
+// ------------------------------
+char *fetch(const char *url)
+{
+    httpcContext context;
+    if (R_FAILED(httpcOpenContext(&context, HTTPC_METHOD_GET, url, 1)))
+        return NULL;
+
+    char *buffer = receive(&context);
     httpcCloseContext(&context);
     return buffer;
 }
 
+void fetch_cancel_init(FetchCancel *cancel)
+{
+    LightLock_Init(&cancel->lock);
+    cancel->open = false;
+    cancel->cancelled = false;
+}
+
+// ------------------------------
+// fetch(), but fetch_cancel() from another thread makes it return NULL at once
+// ------------------------------
+char *fetch_cancellable(const char *url, FetchCancel *cancel)
+{
+    LightLock_Lock(&cancel->lock);
+    cancel->open = !cancel->cancelled &&
+                   R_SUCCEEDED(httpcOpenContext(&cancel->context, HTTPC_METHOD_GET, url, 1));
+    LightLock_Unlock(&cancel->lock);
+    if (!cancel->open)
+        return NULL;
+
+    char *buffer = receive(&cancel->context);
+
+    LightLock_Lock(&cancel->lock);
+    httpcCloseContext(&cancel->context);
+    cancel->open = false;
+    if (cancel->cancelled)
+    {
+        free(buffer);
+        buffer = NULL;
+    }
+    LightLock_Unlock(&cancel->lock);
+    return buffer;
+}
+
+void fetch_cancel(FetchCancel *cancel)
+{
+    LightLock_Lock(&cancel->lock);
+    cancel->cancelled = true;
+    if (cancel->open)
+        httpcCancelConnection(&cancel->context);
+    LightLock_Unlock(&cancel->lock);
+}
+
 // ------------------------------
 // Returns a char* with the JSON
 // Returns NULL on failure
@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "font.h"
+
+static uint8_t *fontData = NULL;
+static uint32_t fontSize = 0;
+
+bool fontLoad(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < (long)sizeof(FontHeader))
+    {
+        fclose(f);
+        return false;
+    }
+
+    uint8_t *data = (uint8_t *)malloc(size);
+    if (!data)
+    {
+        fclose(f);
+        return false;
+    }
+
+    // One read for the whole file; glyphs are looked up in place afterwards
+    size_t got = fread(data, 1, size, f);
+    fclose(f);
+
+    const FontHeader *header = (const FontHeader *)data;
+    if (got != (size_t)size || header->magic != FONT_MAGIC || header->version != FONT_VERSION ||
+        sizeof(FontHeader) + (size_t)header->count * sizeof(FontEntry) > (size_t)size)
+    {
+        free(data);
+        return false;
+    }
+
+    free(fontData);
+    fontData = data;
+    fontSize = (uint32_t)size;
+    return true;
+}
+
+bool fontLoaded(void)
+{
+    return fontData != NULL;
+}
+
+const uint8_t *fontFind(uint32_t codepoint, int *cells)
+{
+    if (!fontData)
+        return NULL;
+
+    const FontHeader *header = (const FontHeader *)fontData;
+    const FontEntry *entries = (const FontEntry *)(fontData + sizeof(FontHeader));
+
+    // Entries are sorted by codepoint
+    uint32_t lo = 0, hi = header->count;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (entries[mid].codepoint < codepoint)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == header->count || entries[lo].codepoint != codepoint)
+        return NULL;
+
+    const FontEntry *e = &entries[lo];
+    uint32_t size = (uint32_t)e->cells * FONT_HEIGHT;
+    if (e->cells < 1 || e->cells > 2 || e->offset > fontSize || size > fontSize - e->offset)
+        return NULL;
+
+    *cells = e->cells;
+    return fontData + e->offset;
+}
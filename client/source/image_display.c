@@ -1,4 +1,8 @@
 #include "image_display.h"
+#include "blit.h"
+#include "shapes.h"
+#include "layout.h"
+#include "layers.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,6 +23,82 @@ static int overlay_alpha = 0; // 0..255
 // 0 = none, 1 = temp play, 2 = pause
 static int current_overlay = 0;
 static const int overlay_fade_step = 85; // alpha change per frame (higher = faster)
+static bool animating = false;          // the last frame drawn wasn't the final one
+// Bytes per pixel of the top framebuffer: 3 (BGR8, default) or 2 (RGB565)
+static int topBpp = 3;
+// Replace the gradient with a blurred copy of the cover
+static bool blurredBackdrop = false;
+
+// Blurred backdrop (see layout.h for the rest of the top screen layout)
+#define BACKDROP_W 50        // size the cover is reduced to before blurring
+#define BACKDROP_H 30
+#define BACKDROP_RADIUS 3    // box blur radius at BACKDROP_W x BACKDROP_H
+#define BACKDROP_PASSES 3    // three box passes approximate a gaussian
+#define BACKDROP_DIM 110     // brightness kept (out of 255) so the cover stands out
+
+// Cover art scaled, framed and masked once per image, in framebuffer order
+typedef struct
+{
+    const u8 *source;
+    int sourceWidth, sourceHeight;
+    int bpp;                            // bytes per pixel of frameTile
+    int imageX, imageY, imageW, imageH; // scaled image rect on screen
+    int frameX, frameY, frameW, frameH; // image plus white border
+    u8 *frameTile;                      // BGR pixels of the frame
+    u8 *frameMask;                      // outer rounded corners of the frame
+    int shadowX, shadowY, shadowW, shadowH;
+    u8 *shadowMask;
+    u8 *backdrop; // blurred full-screen copy of the cover, or NULL
+} ArtCache;
+
+static ArtCache art = {0};
+
+// Overlay icon precomposited (dark background + white icon) into a single
+// RLE sprite for the last icon size drawn
+typedef struct
+{
+    int kind; // 1 = play, 2 = pause
+    BlitRle sprite;
+} OverlayCache;
+
+static OverlayCache overlayCache = {0};
+
+// The frame without any overlay, kept so overlay fades only restore and
+// re-blend the icon rect instead of recomposing the whole screen
+static u8 *baseFrame = NULL;
+static const u8 *baseSource = NULL; // cover the base was built from (NULL = background only)
+static bool baseValid = false;
+static u32 baseGeneration = 0;
+static bool baseHadBackdrop = false;
+static bool coverReplaced = false; // resetImageCache() called since the base was built
+
+typedef struct
+{
+    int x, y, w, h;
+} Rect;
+
+// Contents of each of the top screen's two framebuffers
+typedef struct
+{
+    const u8 *pixels;
+    u32 generation; // baseGeneration copied in, 0 = unknown
+    int overlayKind, overlayAlpha;
+    int fadeStep;   // crossfade step drawn, 0 = none
+    Rect dirty;     // area drawn over the base frame
+} FrameState;
+
+static FrameState frameStates[2];
+
+// Crossfade from the previous base frame to the current one on cover change.
+// Only the area the covers occupy fades; the old pixels of that rect are
+// snapshotted when the base is rebuilt.
+#define CROSSFADE_FRAMES 12       // frames from old to new cover
+#define CROSSFADE_BUDGET_US 4000  // blend time allowed per frame
+#define CROSSFADE_STRIP 16        // columns blended between budget checks
+static Rect baseArtRect;          // shadow + frame of the cover in the base frame
+static Rect fadeRect;
+static u8 *fadeFrom = NULL;       // old pixels of fadeRect, framebuffer order
+static int fadeStep = 0;          // 1..CROSSFADE_FRAMES while fading, 0 = idle
 
 void setPlaybackPaused(bool paused)
 {
@@ -86,11 +166,13 @@ void cleanupNetwork(void)
     network_initialized = false;
 }
 
-u8 *downloadImage(const char *url, u32 *size)
+u8 *downloadImage(const char *url, u32 *size, const char **error)
 {
+    static char message[48];
+    *error = message;
     if (!network_initialized)
     {
-        printf("Network not initialized!\n");
+        snprintf(message, sizeof(message), "Image: network not initialized");
         return NULL;
     }
 
@@ -103,7 +185,7 @@ u8 *downloadImage(const char *url, u32 *size)
     ret = httpcOpenContext(&context, HTTPC_METHOD_GET, url, 0);
     if (ret != 0)
     {
-        printf("httpcOpenContext failed: 0x%lx\n", ret);
+        snprintf(message, sizeof(message), "Image: open failed (0x%08lx)", (unsigned long)ret);
         return NULL;
     }
 
@@ -111,7 +193,7 @@ u8 *downloadImage(const char *url, u32 *size)
     ret = httpcSetSSLOpt(&context, SSLCOPT_DisableVerify);
     if (ret != 0)
     {
-        printf("httpcSetSSLOpt failed: 0x%lx\n", ret);
+        snprintf(message, sizeof(message), "Image: SSL setup failed (0x%08lx)", (unsigned long)ret);
         httpcCloseContext(&context);
         return NULL;
     }
@@ -125,7 +207,7 @@ u8 *downloadImage(const char *url, u32 *size)
     ret = httpcBeginRequest(&context);
     if (ret != 0)
     {
-        printf("httpcBeginRequest failed: 0x%lx\n", ret);
+        snprintf(message, sizeof(message), "Image: request failed (0x%08lx)", (unsigned long)ret);
         httpcCloseContext(&context);
         return NULL;
     }
@@ -133,7 +215,7 @@ u8 *downloadImage(const char *url, u32 *size)
     ret = httpcGetResponseStatusCode(&context, &statuscode);
     if (ret != 0 || statuscode != 200)
     {
-        printf("Status code: %lu\n", statuscode);
+        snprintf(message, sizeof(message), "Image: HTTP status %lu", (unsigned long)statuscode);
         httpcCloseContext(&context);
         return NULL;
     }
@@ -141,7 +223,8 @@ u8 *downloadImage(const char *url, u32 *size)
     ret = httpcGetDownloadSizeState(&context, NULL, &contentsize);
     if (ret != 0)
     {
-        printf("httpcGetDownloadSizeState failed: 0x%lx\n", ret);
+        snprintf(message, sizeof(message), "Image: size query failed (0x%08lx)",
+                 (unsigned long)ret);
         httpcCloseContext(&context);
         return NULL;
     }
@@ -149,7 +232,7 @@ u8 *downloadImage(const char *url, u32 *size)
     // Add size validation check
     if (contentsize == 0 || contentsize > 10 * 1024 * 1024)
     { // Limit to 10MB
-        printf("Invalid content size: %lu\n", contentsize);
+        snprintf(message, sizeof(message), "Image: invalid size %lu", (unsigned long)contentsize);
         httpcCloseContext(&context);
         return NULL;
     }
@@ -157,7 +240,7 @@ u8 *downloadImage(const char *url, u32 *size)
     buffer = (u8 *)malloc(contentsize);
     if (buffer == NULL)
     {
-        printf("Memory allocation failed\n");
+        snprintf(message, sizeof(message), "Image: out of memory");
         httpcCloseContext(&context);
         return NULL;
     }
@@ -165,7 +248,7 @@ u8 *downloadImage(const char *url, u32 *size)
     ret = httpcDownloadData(&context, buffer, contentsize, NULL);
     if (ret != 0)
     {
-        printf("httpcDownloadData failed: 0x%lx\n", ret);
+        snprintf(message, sizeof(message), "Image: download failed (0x%08lx)", (unsigned long)ret);
         free(buffer);
         httpcCloseContext(&context);
         return NULL;
@@ -176,328 +259,607 @@ u8 *downloadImage(const char *url, u32 *size)
     return buffer;
 }
 
-void drawGradient(u8 *fb, u16 fbWidth, u16 fbHeight)
-{
-    const int screenW = 400;
-    const int screenH = 240;
-    const int topB = 30, topG = 80, topR = 40;
-    // Softer/dessaturated bottom color to reduce contrast
-    const int botB = 70, botG = 200, botR = 55;
-
-    for (int y = 0; y < screenH; y++) {
-        float t = (float)y / (float)(screenH - 1);
-        u8 colB = (u8)((1.0f - t) * topB + t * botB);
-        u8 colG = (u8)((1.0f - t) * topG + t * botG);
-        u8 colR = (u8)((1.0f - t) * topR + t * botR);
-
-        for (int x = 0; x < screenW; x++) {
-            int fbX = 239 - y;
-            int fbY = x;
-            if (fbX < 0 || fbX >= fbWidth || fbY < 0 || fbY >= fbHeight) continue;
-            int fbIdx = (fbX + fbY * fbWidth) * 3;
-            fb[fbIdx + 0] = colB;
-            fb[fbIdx + 1] = colG;
-            fb[fbIdx + 2] = colR;
-        }
-    }
+
+static void freeArtCache(void)
+{
+    free(art.frameTile);
+    free(art.frameMask);
+    free(art.shadowMask);
+    free(art.backdrop);
+    memset(&art, 0, sizeof(art));
 }
 
-void drawImageToScreen(u8 *pixels, int width, int height)
+void setBlurredBackdrop(bool enable)
 {
-    if (!pixels || width <= 0 || height <= 0)
-    {
-        return; // Invalid parameters
-    }
+    if (enable == blurredBackdrop)
+        return;
+
+    blurredBackdrop = enable;
+    freeArtCache();
+    baseValid = false;
+}
+
+void setTopScreenRGB565(bool enable)
+{
+    int bpp = enable ? 2 : 3;
+    if (bpp == topBpp)
+        return;
+
+    gfxSetScreenFormat(GFX_TOP, enable ? GSP_RGB565_OES : GSP_BGR8_OES);
+    topBpp = bpp;
+
+    // Everything cached is in the old format
+    freeArtCache();
+    free(baseFrame);
+    baseFrame = NULL;
+    baseValid = false;
+    memset(frameStates, 0, sizeof(frameStates));
+    free(fadeFrom);
+    fadeFrom = NULL;
+    fadeStep = 0;
+}
+
+void resetImageCache(void)
+{
+    freeArtCache();
+    baseValid = false;
+    coverReplaced = true;
+}
+
+static inline int clampi(int v, int lo, int hi)
+{
+    return (v < lo) ? lo : (v > hi) ? hi : v;
+}
 
-    // Get framebuffer dimensions
-    u16 fbWidth, fbHeight;
-    u8 *fb = gfxGetFramebuffer(GFX_TOP, GFX_LEFT, &fbWidth, &fbHeight);
+// Running-sum box blur of `count` BGR pixels spaced `step` pixels apart;
+// the cost per pixel doesn't depend on the radius. Edges are clamped.
+static void boxBlurLine(u8 *line, int count, int step, int radius, u8 *scratch)
+{
+    for (int i = 0; i < count; i++)
+        memcpy(scratch + i * 3, line + i * step * 3, 3);
 
-    if (!fb)
+    int window = 2 * radius + 1;
+    for (int c = 0; c < 3; c++)
     {
-        return; // No framebuffer
-    }
+        int sum = 0;
+        for (int k = -radius; k <= radius; k++)
+            sum += scratch[clampi(k, 0, count - 1) * 3 + c];
 
-    drawGradient(fb, fbWidth, fbHeight);
-
-    // The top screen is 400x240 but framebuffer is 240x400 (rotated)
-    // Calculate scale to fit the entire image (accounting for 4px border on each side)
-    // AND making the image 10px smaller in each direction
-    float scaleX = (400.0f - 8.0f - 20.0f) / width;   // Subtract border (8px) and 10px padding on each side (20px total)
-    float scaleY = (240.0f - 8.0f - 20.0f) / height;  // Subtract border (8px) and 10px padding on each side (20px total)
-    float scale = (scaleX < scaleY) ? scaleX : scaleY;
-
-    int scaledWidth = (int)(width * scale);
-    int scaledHeight = (int)(height * scale);
-
-    // Ensure scaled dimensions don't exceed available space (accounting for border and padding)
-    int maxWidth = 400 - 8 - 20;  // Screen width - border - padding
-    int maxHeight = 240 - 8 - 20; // Screen height - border - padding
-    
-    if (scaledWidth > maxWidth)
-        scaledWidth = maxWidth;
-    if (scaledHeight > maxHeight)
-        scaledHeight = maxHeight;
-    if (scaledWidth <= 0)
-        scaledWidth = 1;
-    if (scaledHeight <= 0)
-        scaledHeight = 1;
-
-    // Center the scaled image (accounting for border AND 10px padding)
-    int imageStartX = (400 - scaledWidth) / 2;
-    int imageStartY = (240 - scaledHeight) / 2;
-    int imageEndX = imageStartX + scaledWidth;
-    int imageEndY = imageStartY + scaledHeight;
-
-    // Corner radius for slightly rounded corners (8 pixels radius)
-    const int cornerRadius = 8;
-    
-    // Border width
-    const int borderWidth = 4;
-    
-    // Outer border coordinates (including the border)
-    int outerStartX = imageStartX - borderWidth;
-    int outerStartY = imageStartY - borderWidth;
-    int outerEndX = imageEndX + borderWidth;
-    int outerEndY = imageEndY + borderWidth;
-    
-    // Outer corner radius (larger for the border)
-    int outerCornerRadius = cornerRadius + borderWidth;
-
-    // Draw a soft drop shadow outside the outer rounded border (blended)
-    const int shadowOffsetX = 8;
-    const int shadowOffsetY = 8;
-    const int shadowBlur = 12; // how far the shadow spreads
-    const int maxShadowAlpha = 160; // max alpha (0-255)
-
-    // Shadow is computed relative to the outer rounded rectangle shifted by the offset
-    int shiftedOuterStartX = outerStartX + shadowOffsetX;
-    int shiftedOuterEndX   = outerEndX   + shadowOffsetX;
-    int shiftedOuterStartY = outerStartY + shadowOffsetY;
-    int shiftedOuterEndY   = outerEndY   + shadowOffsetY;
-
-    int shadowMinX = shiftedOuterStartX - shadowBlur;
-    int shadowMaxX = shiftedOuterEndX + shadowBlur - 1;
-    int shadowMinY = shiftedOuterStartY - shadowBlur;
-    int shadowMaxY = shiftedOuterEndY + shadowBlur - 1;
-
-    for (int y = shadowMinY; y <= shadowMaxY; y++) {
-        for (int x = shadowMinX; x <= shadowMaxX; x++) {
-            if (x < 0 || x >= 400 || y < 0 || y >= 240) continue;
-
-            // Compute distance from (x,y) to the shifted outer rounded rectangle.
-            // For rounded rect, distance is computed by clamping to the central rectangle
-            // defined by removing the corner radius; outside that area distance to corner circle applies.
-            int innerStartX = shiftedOuterStartX + outerCornerRadius;
-            int innerEndX   = shiftedOuterEndX   - outerCornerRadius - 1;
-            int innerStartY = shiftedOuterStartY + outerCornerRadius;
-            int innerEndY   = shiftedOuterEndY   - outerCornerRadius - 1;
-
-            int dx = 0;
-            if (x < innerStartX) dx = innerStartX - x;
-            else if (x > innerEndX) dx = x - innerEndX;
-
-            int dy = 0;
-            if (y < innerStartY) dy = innerStartY - y;
-            else if (y > innerEndY) dy = y - innerEndY;
-
-            float dist = sqrtf((float)(dx * dx + dy * dy));
-
-            // If the point lies inside the shifted rounded rect (dist == 0), skip — shadow should not draw over the object
-            if (dist <= 0.0f) continue;
-
-            // If distance is beyond blur radius, skip
-            if (dist >= shadowBlur) continue;
-
-            // Alpha falls off linearly with distance
-            int alpha = (int)((1.0f - (dist / (float)shadowBlur)) * maxShadowAlpha);
-            if (alpha <= 0) continue;
-
-            // Map to framebuffer (rotated coordinates)
-            int fbX = 239 - y;
-            int fbY = x;
-            if (fbX < 0 || fbX >= 240 || fbY < 0 || fbY >= 400) continue;
-
-            int fbIdx = (fbX + fbY * 240) * 3;
-            int maxFbIdx = fbWidth * fbHeight * 3 - 3;
-            if (fbIdx < 0 || fbIdx > maxFbIdx) continue;
-
-            // Shadow color (very dark gray)
-            const int sB = 18, sG = 18, sR = 18;
-
-            // Blend shadow over existing framebuffer pixel: out = alpha*shadow + (255-alpha)*dst / 255
-            u8 dstB = fb[fbIdx + 0];
-            u8 dstG = fb[fbIdx + 1];
-            u8 dstR = fb[fbIdx + 2];
-
-            fb[fbIdx + 0] = (u8)((alpha * sB + (255 - alpha) * dstB) / 255);
-            fb[fbIdx + 1] = (u8)((alpha * sG + (255 - alpha) * dstG) / 255);
-            fb[fbIdx + 2] = (u8)((alpha * sR + (255 - alpha) * dstR) / 255);
+        for (int i = 0; i < count; i++)
+        {
+            line[i * step * 3 + c] = (u8)(sum / window);
+            int out = clampi(i - radius, 0, count - 1);
+            int in = clampi(i + radius + 1, 0, count - 1);
+            sum += scratch[in * 3 + c] - scratch[out * 3 + c];
         }
     }
+}
 
-    // SIMPLIFIED: Draw the entire white border area first (including corners)
-    // This will create a white rectangle with rounded corners
-    for (int y = outerStartY; y < outerEndY; y++) {
-        for (int x = outerStartX; x < outerEndX; x++) {
-            // Skip if outside screen bounds
-            if (x < 0 || x >= 400 || y < 0 || y >= 240) {
-                continue;
-            }
-            
-            // Check if this pixel is within the rounded border area
-            bool inBorderArea = false;
-            
-            // Check all four corners
-            // Top-left corner
-            if (x < outerStartX + outerCornerRadius && y < outerStartY + outerCornerRadius) {
-                int dx = (outerStartX + outerCornerRadius) - x;
-                int dy = (outerStartY + outerCornerRadius) - y;
-                if (dx * dx + dy * dy <= outerCornerRadius * outerCornerRadius) {
-                    inBorderArea = true;
-                }
-            }
-            // Top-right corner
-            else if (x >= outerEndX - outerCornerRadius && y < outerStartY + outerCornerRadius) {
-                int dx = x - (outerEndX - outerCornerRadius);
-                int dy = (outerStartY + outerCornerRadius) - y;
-                if (dx * dx + dy * dy <= outerCornerRadius * outerCornerRadius) {
-                    inBorderArea = true;
-                }
-            }
-            // Bottom-left corner
-            else if (x < outerStartX + outerCornerRadius && y >= outerEndY - outerCornerRadius) {
-                int dx = (outerStartX + outerCornerRadius) - x;
-                int dy = y - (outerEndY - outerCornerRadius);
-                if (dx * dx + dy * dy <= outerCornerRadius * outerCornerRadius) {
-                    inBorderArea = true;
-                }
-            }
-            // Bottom-right corner
-            else if (x >= outerEndX - outerCornerRadius && y >= outerEndY - outerCornerRadius) {
-                int dx = x - (outerEndX - outerCornerRadius);
-                int dy = y - (outerEndY - outerCornerRadius);
-                if (dx * dx + dy * dy <= outerCornerRadius * outerCornerRadius) {
-                    inBorderArea = true;
-                }
-            }
-            // Not in a corner - check if it's within the rectangle area
-            else {
-                inBorderArea = true;
-            }
-            
-            // Draw the white border pixel
-            if (inBorderArea) {
-                // Convert to framebuffer coordinates (rotated)
-                int fbX = 239 - y;
-                int fbY = x;
-                
-                // Ensure within framebuffer bounds
-                if (fbX >= 0 && fbX < 240 && fbY >= 0 && fbY < 400) {
-                    int fbIdx = (fbX + fbY * 240) * 3;
-                    // Draw white border
-                    fb[fbIdx + 0] = 255;     // Blue
-                    fb[fbIdx + 1] = 255;     // Green  
-                    fb[fbIdx + 2] = 255;     // Red
+// Darkened, heavily blurred copy of the cover filling the screen. The blur
+// runs on a small downscaled copy and the result is upscaled bilinearly,
+// so it costs about one pass over the screen per cover.
+static u8 *buildBackdrop(const u8 *pixels, int width, int height)
+{
+    u8 *backdrop = (u8 *)malloc(TOP_WIDTH * TOP_HEIGHT * topBpp);
+    if (!backdrop)
+        return NULL;
+
+    // Center-crop the cover to the screen's aspect ratio
+    int cropW = width, cropH = height;
+    if (width * TOP_HEIGHT > height * TOP_WIDTH)
+        cropW = height * TOP_WIDTH / TOP_HEIGHT;
+    else
+        cropH = width * TOP_HEIGHT / TOP_WIDTH;
+    int cropX = (width - cropW) / 2;
+    int cropY = (height - cropH) / 2;
+
+    // Box-filter down to BACKDROP_W x BACKDROP_H (row-major BGR)
+    static u8 small[BACKDROP_W * BACKDROP_H * 3];
+    static u8 scratch[BACKDROP_W * 3];
+    for (int by = 0; by < BACKDROP_H; by++)
+    {
+        int y0 = cropY + by * cropH / BACKDROP_H;
+        int y1 = cropY + (by + 1) * cropH / BACKDROP_H;
+        if (y1 <= y0) y1 = y0 + 1;
+        for (int bx = 0; bx < BACKDROP_W; bx++)
+        {
+            int x0 = cropX + bx * cropW / BACKDROP_W;
+            int x1 = cropX + (bx + 1) * cropW / BACKDROP_W;
+            if (x1 <= x0) x1 = x0 + 1;
+
+            u32 sumR = 0, sumG = 0, sumB = 0, count = 0;
+            for (int y = y0; y < y1 && y < height; y++)
+            {
+                const u8 *src = pixels + (y * width + x0) * 4;
+                for (int x = x0; x < x1 && x < width; x++, src += 4)
+                {
+                    sumR += src[0];
+                    sumG += src[1];
+                    sumB += src[2];
+                    count++;
                 }
             }
+            u8 *dst = small + (by * BACKDROP_W + bx) * 3;
+            if (count == 0) count = 1;
+            dst[0] = (u8)(sumB / count);
+            dst[1] = (u8)(sumG / count);
+            dst[2] = (u8)(sumR / count);
         }
     }
 
-    // Draw the actual image content with rounded corners
-    // The image will be drawn on top of the white border
-    for (int screenY = 0; screenY < scaledHeight; screenY++)
+    // Separable blur: rows then columns, repeated
+    for (int pass = 0; pass < BACKDROP_PASSES; pass++)
     {
-        int posY = imageStartY + screenY;
-        
-        for (int screenX = 0; screenX < scaledWidth; screenX++)
+        for (int by = 0; by < BACKDROP_H; by++)
+            boxBlurLine(small + by * BACKDROP_W * 3, BACKDROP_W, 1, BACKDROP_RADIUS, scratch);
+        for (int bx = 0; bx < BACKDROP_W; bx++)
+            boxBlurLine(small + bx * 3, BACKDROP_H, BACKDROP_W, BACKDROP_RADIUS, scratch);
+    }
+
+    // Bilinear upscale in 8.8 fixed point, written in framebuffer order
+    u8 *dst = backdrop;
+    for (int x = 0; x < TOP_WIDTH; x++)
+    {
+        int fx = ((2 * x + 1) * BACKDROP_W * 128) / TOP_WIDTH - 128;
+        fx = clampi(fx, 0, (BACKDROP_W - 1) * 256);
+        int sx = fx >> 8, wx = fx & 0xff;
+        int sx1 = (sx + 1 < BACKDROP_W) ? sx + 1 : sx;
+
+        for (int y = TOP_HEIGHT - 1; y >= 0; y--, dst += topBpp)
         {
-            int posX = imageStartX + screenX;
-            
-            // Check if pixel is within the image's rounded rectangle area
-            bool inImageArea = false;
-            
-            // First check if it's within the rectangular bounds
-            if (posX >= imageStartX && posX < imageEndX && posY >= imageStartY && posY < imageEndY) {
-                // Now check corners
-                // Top-left corner
-                if (posX < imageStartX + cornerRadius && posY < imageStartY + cornerRadius) {
-                    int dx = (imageStartX + cornerRadius) - posX;
-                    int dy = (imageStartY + cornerRadius) - posY;
-                    if (dx * dx + dy * dy <= cornerRadius * cornerRadius) {
-                        inImageArea = true;
-                    }
-                }
-                // Top-right corner
-                else if (posX >= imageEndX - cornerRadius && posY < imageStartY + cornerRadius) {
-                    int dx = posX - (imageEndX - cornerRadius);
-                    int dy = (imageStartY + cornerRadius) - posY;
-                    if (dx * dx + dy * dy <= cornerRadius * cornerRadius) {
-                        inImageArea = true;
-                    }
-                }
-                // Bottom-left corner
-                else if (posX < imageStartX + cornerRadius && posY >= imageEndY - cornerRadius) {
-                    int dx = (imageStartX + cornerRadius) - posX;
-                    int dy = posY - (imageEndY - cornerRadius);
-                    if (dx * dx + dy * dy <= cornerRadius * cornerRadius) {
-                        inImageArea = true;
-                    }
-                }
-                // Bottom-right corner
-                else if (posX >= imageEndX - cornerRadius && posY >= imageEndY - cornerRadius) {
-                    int dx = posX - (imageEndX - cornerRadius);
-                    int dy = posY - (imageEndY - cornerRadius);
-                    if (dx * dx + dy * dy <= cornerRadius * cornerRadius) {
-                        inImageArea = true;
-                    }
-                }
-                // Not in a corner area - it's in the main rectangle
-                else {
-                    inImageArea = true;
-                }
+            int fy = ((2 * y + 1) * BACKDROP_H * 128) / TOP_HEIGHT - 128;
+            fy = clampi(fy, 0, (BACKDROP_H - 1) * 256);
+            int sy = fy >> 8, wy = fy & 0xff;
+            int sy1 = (sy + 1 < BACKDROP_H) ? sy + 1 : sy;
+
+            const u8 *p00 = small + (sy * BACKDROP_W + sx) * 3;
+            const u8 *p01 = small + (sy * BACKDROP_W + sx1) * 3;
+            const u8 *p10 = small + (sy1 * BACKDROP_W + sx) * 3;
+            const u8 *p11 = small + (sy1 * BACKDROP_W + sx1) * 3;
+
+            int c[3];
+            for (int i = 0; i < 3; i++)
+            {
+                int top = p00[i] * (256 - wx) + p01[i] * wx;
+                int bottom = p10[i] * (256 - wx) + p11[i] * wx;
+                int v = (top * (256 - wy) + bottom * wy) >> 16;
+                c[i] = (v * BACKDROP_DIM) / 255;
             }
-            
-            // Skip drawing if pixel is NOT in the image's rounded area
-            if (!inImageArea) {
+            blitPackPixel(dst, topBpp, c[2], c[1], c[0], x, y);
+        }
+    }
+
+    return backdrop;
+}
+
+// Scale, frame and mask the cover once; every frame after that is a few blits
+static bool buildArtCache(const u8 *pixels, int width, int height)
+{
+    freeArtCache();
+
+    int scaledWidth, scaledHeight;
+    float scale;
+    layoutArtSize(width, height, &scaledWidth, &scaledHeight, &scale);
+
+    // Center the scaled image
+    art.imageW = scaledWidth;
+    art.imageH = scaledHeight;
+    art.imageX = (TOP_WIDTH - scaledWidth) / 2;
+    art.imageY = (TOP_HEIGHT - scaledHeight) / 2;
+
+    // The frame is the image plus its white border
+    art.frameX = art.imageX - ART_BORDER;
+    art.frameY = art.imageY - ART_BORDER;
+    art.frameW = scaledWidth + 2 * ART_BORDER;
+    art.frameH = scaledHeight + 2 * ART_BORDER;
+
+    // The shadow mask is centered on the frame shifted by the shadow offset
+    art.shadowX = art.frameX + SHADOW_OFFSET - SHADOW_BLUR;
+    art.shadowY = art.frameY + SHADOW_OFFSET - SHADOW_BLUR;
+    art.shadowW = art.frameW + 2 * SHADOW_BLUR;
+    art.shadowH = art.frameH + 2 * SHADOW_BLUR;
+
+    art.frameTile = (u8 *)malloc(art.frameW * art.frameH * topBpp);
+    art.frameMask = (u8 *)malloc(art.frameW * art.frameH);
+    art.shadowMask = (u8 *)malloc(art.shadowW * art.shadowH);
+    if (!art.frameTile || !art.frameMask || !art.shadowMask)
+    {
+        freeArtCache();
+        return false;
+    }
+
+    // Masks come from the baked layers when the cover has the default size
+    const int outerCornerRadius = ART_CORNER_RADIUS + ART_BORDER;
+    const u8 *baked = layersFind(LAYER_FRAME_MASK, art.frameW, art.frameH);
+    if (baked)
+        memcpy(art.frameMask, baked, art.frameW * art.frameH);
+    else
+        shapeRoundedRectMask(art.frameMask, art.frameW, art.frameH, outerCornerRadius);
+
+    baked = layersFind(LAYER_SHADOW_MASK, art.shadowW, art.shadowH);
+    if (baked)
+        memcpy(art.shadowMask, baked, art.shadowW * art.shadowH);
+    else
+        shapeShadowMask(art.shadowMask, art.frameW, art.frameH, outerCornerRadius,
+                        SHADOW_BLUR, SHADOW_MAX_ALPHA);
+
+    // Image with rounded corners on top of a white border, in framebuffer order
+    u8 *dst = art.frameTile;
+    for (int x = 0; x < art.frameW; x++)
+    {
+        int screenX = x - ART_BORDER;
+        int srcX = (int)(screenX / scale);
+        if (srcX >= width)
+            srcX = width - 1;
+
+        for (int y = art.frameH - 1; y >= 0; y--, dst += topBpp)
+        {
+            int screenY = y - ART_BORDER;
+            if (!shapeInRoundedRect(screenX, screenY, scaledWidth, scaledHeight, ART_CORNER_RADIUS))
+            {
+                blitPackPixel(dst, topBpp, 255, 255, 255, art.frameX + x, art.frameY + y);
                 continue;
             }
 
             // Map back to source image
-            int srcX = (int)(screenX / scale);
             int srcY = (int)(screenY / scale);
-
-            if (srcX >= width)
-                srcX = width - 1;
             if (srcY >= height)
                 srcY = height - 1;
 
-            int srcIdx = (srcY * width + srcX) * 4;
-            u8 r = pixels[srcIdx + 0];
-            u8 g = pixels[srcIdx + 1];
-            u8 b = pixels[srcIdx + 2];
+            const u8 *src = pixels + (srcY * width + srcX) * 4;
+            blitPackPixel(dst, topBpp, src[0], src[1], src[2], art.frameX + x, art.frameY + y);
+        }
+    }
 
-            // Convert to framebuffer coordinates (rotated)
-            int fbX = 239 - posY;
-            int fbY = posX;
+    // The backdrop is optional: without it the gradient is drawn instead
+    if (blurredBackdrop)
+        art.backdrop = buildBackdrop(pixels, width, height);
 
-            // Ensure within framebuffer bounds
-            if (fbX < 0 || fbX >= 240 || fbY < 0 || fbY >= 400)
-            {
-                continue;
-            }
+    art.bpp = topBpp;
+    art.source = pixels;
+    art.sourceWidth = width;
+    art.sourceHeight = height;
+    return true;
+}
 
-            int fbIdx = (fbX + fbY * 240) * 3;
-            int maxFbIdx = fbWidth * fbHeight * 3 - 3;
+static void drawGradient(const BlitTarget *target)
+{
+    // The gradient only varies with y, so a few framebuffer columns repeated
+    // across the screen are the whole background. Four columns cover the
+    // width of the RGB565 dither pattern.
+    static u8 columns[4 * TOP_HEIGHT * 3];
+    static int columnsBpp = 0;
+    int bpp = target->bpp;
+
+    // The baked full-screen gradient is a single copy
+    const u8 *baked = layersFind(LAYER_GRADIENT_BGR8, TOP_WIDTH, TOP_HEIGHT);
+    if (baked && bpp == 3 && target->width == TOP_WIDTH && target->height == TOP_HEIGHT)
+    {
+        memcpy(target->pixels, baked, TOP_WIDTH * TOP_HEIGHT * 3);
+        return;
+    }
 
-            // Write BGR (with bounds check) - this overwrites the white border
-            if (fbIdx >= 0 && fbIdx <= maxFbIdx)
+    if (columnsBpp != bpp)
+    {
+        for (int y = 0; y < TOP_HEIGHT; y++)
+        {
+            u8 colR, colG, colB;
+            shapeGradientColor(y, TOP_HEIGHT, &colR, &colG, &colB);
+            for (int x = 0; x < 4; x++)
             {
-                fb[fbIdx + 0] = b;
-                fb[fbIdx + 1] = g;
-                fb[fbIdx + 2] = r;
+                u8 *px = columns + (x * TOP_HEIGHT + (TOP_HEIGHT - 1 - y)) * bpp;
+                blitPackPixel(px, bpp, colR, colG, colB, x, y);
             }
         }
+        columnsBpp = bpp;
+    }
+
+    for (int x = 0; x < TOP_WIDTH; x += 4)
+        blitTile(target, x, 0, 4, TOP_HEIGHT, columns, TOP_HEIGHT * bpp);
+}
+
+// Composite a layer of color c and alpha sa over (dc, da), non-premultiplied
+static void compositeOver(u8 *dc, u8 *da, u8 c, int sa)
+{
+    if (sa <= 0)
+        return;
+    int under = (*da * (255 - sa)) / 255;
+    int outA = sa + under;
+    for (int i = 0; i < 3; i++)
+        dc[i] = (u8)((c * sa + dc[i] * under) / outA);
+    *da = (u8)outA;
+}
+
+// Render the overlay once for the current size into an RLE sprite; reused
+// until the size or kind changes, so fade frames are a scaled-alpha blit
+static bool prepareOverlay(int kind, int w, int h)
+{
+    if (overlayCache.kind == kind && overlayCache.sprite.w == w && overlayCache.sprite.h == h)
+        return true;
+
+    blitRleFree(&overlayCache.sprite);
+    overlayCache.kind = 0;
+
+    u8 *bg = (u8 *)malloc(w * h);
+    u8 *icon = (u8 *)malloc(w * h);
+    u8 *tile = (u8 *)calloc(w * h, 3);
+    u8 *alpha = (u8 *)calloc(w * h, 1);
+    bool ok = bg && icon && tile && alpha;
+    if (ok)
+    {
+        const u8 *bakedBg = layersFind(LAYER_ICON_BG_MASK, w, h);
+        const u8 *bakedIcon = layersFind(kind == 1 ? LAYER_PLAY_MASK : LAYER_PAUSE_MASK, w, h);
+        if (bakedBg)
+            memcpy(bg, bakedBg, w * h);
+        else
+            shapeRoundedRectMask(bg, w, h, ICON_CORNER_RADIUS);
+        if (bakedIcon)
+            memcpy(icon, bakedIcon, w * h);
+        else if (kind == 1)
+            shapePlayMask(icon, w, h);
+        else
+            shapePauseMask(icon, w, h);
+
+        for (int i = 0; i < w * h; i++)
+        {
+            compositeOver(tile + i * 3, alpha + i, 10, (ICON_BG_ALPHA * bg[i]) / 255);
+            compositeOver(tile + i * 3, alpha + i, 255, icon[i]);
+        }
+        ok = blitRleEncode(&overlayCache.sprite, w, h, tile, alpha);
+    }
+
+    free(bg);
+    free(icon);
+    free(tile);
+    free(alpha);
+
+    if (ok)
+        overlayCache.kind = kind;
+    return ok;
+}
+
+// Icon rect centered on the cover: roughly 2/3 of the scaled image
+static void overlayRect(int *x, int *y, int *w, int *h)
+{
+    int iconW, iconH;
+    layoutIconSize(art.imageW, art.imageH, &iconW, &iconH);
+
+    int iconCX = art.imageX + art.imageW / 2;
+    int iconCY = art.imageY + art.imageH / 2;
+    *x = iconCX - iconW / 2;
+    *y = iconCY - iconH / 2;
+    *w = iconW;
+    *h = iconH;
+}
+
+static void drawOverlay(const BlitTarget *target, int kind, int alpha, int x, int y, int w, int h)
+{
+    if (!prepareOverlay(kind, w, h))
+        return;
+
+    // Rounded dark background and white icon in one pass, scaled by the fade alpha
+    blitBlendRle(target, x, y, &overlayCache.sprite, alpha);
+}
+
+static Rect rectUnion(Rect a, Rect b)
+{
+    if (a.w <= 0 || a.h <= 0)
+        return b;
+    if (b.w <= 0 || b.h <= 0)
+        return a;
+    int x0 = (a.x < b.x) ? a.x : b.x;
+    int y0 = (a.y < b.y) ? a.y : b.y;
+    int x1 = (a.x + a.w > b.x + b.w) ? a.x + a.w : b.x + b.w;
+    int y1 = (a.y + a.h > b.y + b.h) ? a.y + a.h : b.y + b.h;
+    return (Rect){ x0, y0, x1 - x0, y1 - y0 };
+}
+
+// Pointer to the top-left pixel of `rect` in a full-screen framebuffer-order buffer
+static inline const u8 *screenTileAt(const u8 *frame, Rect rect)
+{
+    return frame + (rect.x * TOP_HEIGHT + (TOP_HEIGHT - rect.y - rect.h)) * topBpp;
+}
+
+// Snapshot `rect` of the current base frame before it is overwritten
+static void startCrossfade(Rect rect)
+{
+    fadeStep = 0;
+
+    // Clip to the screen so the snapshot can be copied column by column
+    int x1 = rect.x + rect.w, y1 = rect.y + rect.h;
+    rect.x = clampi(rect.x, 0, TOP_WIDTH);
+    rect.y = clampi(rect.y, 0, TOP_HEIGHT);
+    rect.w = clampi(x1, 0, TOP_WIDTH) - rect.x;
+    rect.h = clampi(y1, 0, TOP_HEIGHT) - rect.y;
+    if (rect.w <= 0 || rect.h <= 0)
+        return;
+
+    free(fadeFrom);
+    fadeFrom = (u8 *)malloc(rect.w * rect.h * topBpp);
+    if (!fadeFrom)
+        return;
+
+    const u8 *src = screenTileAt(baseFrame, rect);
+    for (int x = 0; x < rect.w; x++)
+        memcpy(fadeFrom + x * rect.h * topBpp, src + x * TOP_HEIGHT * topBpp, rect.h * topBpp);
+
+    fadeRect = rect;
+    fadeStep = 1;
+}
+
+// Blend the fade rect between the old and new base for the current step. Work
+// is checked against a per-frame budget; if it runs out, the remaining
+// columns show the new cover so the frame is never late.
+static void drawCrossfade(const BlitTarget *target)
+{
+    int t = (fadeStep * 256) / CROSSFADE_FRAMES;
+    const u8 *to = screenTileAt(baseFrame, fadeRect);
+    int fromStride = fadeRect.h * topBpp;
+    int toStride = TOP_HEIGHT * topBpp;
+    u64 deadline = svcGetSystemTick() + (u64)(CROSSFADE_BUDGET_US * CPU_TICKS_PER_USEC);
+
+    for (int x = 0; x < fadeRect.w; x += CROSSFADE_STRIP)
+    {
+        int w = (fadeRect.w - x < CROSSFADE_STRIP) ? fadeRect.w - x : CROSSFADE_STRIP;
+        if (svcGetSystemTick() < deadline)
+            blitBlendTiles(target, fadeRect.x + x, fadeRect.y, w, fadeRect.h,
+                           fadeFrom + x * fromStride, fromStride, to + x * toStride, toStride, t);
+        else
+            blitTile(target, fadeRect.x + x, fadeRect.y, w, fadeRect.h, to + x * toStride, toStride);
+    }
+}
+
+// Compose the un-overlaid frame (gradient, shadow and cover) into baseFrame
+static bool buildBaseFrame(bool withArt)
+{
+    bool hadBase = (baseFrame != NULL);
+    if (!baseFrame)
+    {
+        baseFrame = (u8 *)malloc(TOP_WIDTH * TOP_HEIGHT * topBpp);
+        if (!baseFrame)
+            return false;
+    }
+
+    // The new base gets the area of the old cover plus the new one; keep the old
+    // pixels of that area to fade from
+    Rect artRect = { 0, 0, 0, 0 };
+    if (withArt)
+    {
+        Rect shadow = { art.shadowX, art.shadowY, art.shadowW, art.shadowH };
+        Rect frame = { art.frameX, art.frameY, art.frameW, art.frameH };
+        artRect = rectUnion(shadow, frame);
+    }
+    // Only a new cover fades in; a rebuild of the same one (a setting changed) doesn't
+    const u8 *source = withArt ? art.source : NULL;
+    if (hadBase && (coverReplaced || source != baseSource))
+        startCrossfade((withArt && art.backdrop) || baseHadBackdrop
+                           ? (Rect){ 0, 0, TOP_WIDTH, TOP_HEIGHT }
+                           : rectUnion(baseArtRect, artRect));
+
+    BlitTarget base = { baseFrame, TOP_WIDTH, TOP_HEIGHT, topBpp };
+    if (withArt && art.backdrop)
+        blitTile(&base, 0, 0, TOP_WIDTH, TOP_HEIGHT, art.backdrop, TOP_HEIGHT * topBpp);
+    else
+        drawGradient(&base);
+
+    if (withArt)
+    {
+        // Soft drop shadow, then the framed image over it
+        blitBlendMask(&base, art.shadowX, art.shadowY, art.shadowW, art.shadowH, art.shadowMask,
+                      18, 18, 18, 255);
+        blitBlendSprite(&base, art.frameX, art.frameY, art.frameW, art.frameH, art.frameTile,
+                        art.frameMask, 255);
+    }
+
+    baseSource = source;
+    coverReplaced = false;
+    baseArtRect = artRect;
+    baseHadBackdrop = withArt && art.backdrop;
+    baseValid = true;
+    baseGeneration++;
+    return true;
+}
+
+// What a framebuffer currently holds, so the next frame only redraws the difference
+static FrameState *frameStateFor(const u8 *pixels)
+{
+    static int nextSlot = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        if (frameStates[i].pixels == pixels)
+            return &frameStates[i];
+    }
+
+    FrameState *state = &frameStates[nextSlot];
+    nextSlot = (nextSlot + 1) % 2;
+    memset(state, 0, sizeof(*state));
+    state->pixels = pixels;
+    return state;
+}
+
+// Bring the back buffer to base frame + crossfade + overlay, touching only what
+// changed since this buffer was last drawn: the whole frame after the base
+// changes, otherwise just the rects being faded.
+static void presentFrame(int overlayKind, int overlayAlpha)
+{
+    BlitTarget target;
+    if (!blitTargetForScreen(&target, GFX_TOP))
+    {
+        return; // No framebuffer
+    }
+
+    int ox = 0, oy = 0, ow = 0, oh = 0;
+    if (overlayKind != 0 && overlayAlpha > 0)
+        overlayRect(&ox, &oy, &ow, &oh);
+    else
+        overlayKind = overlayAlpha = 0;
+
+    if (target.bpp != topBpp)
+    {
+        return; // Format switch not applied yet
+    }
+
+    FrameState *state = frameStateFor(target.pixels);
+    if (state->generation != baseGeneration)
+    {
+        memcpy(target.pixels, baseFrame, TOP_WIDTH * TOP_HEIGHT * topBpp);
+        state->generation = baseGeneration;
+        state->dirty = (Rect){ 0, 0, 0, 0 };
+    }
+    else if (state->overlayKind == overlayKind && state->overlayAlpha == overlayAlpha &&
+             state->fadeStep == fadeStep)
+    {
+        // Buffer already holds exactly this frame
+        gfxSwapBuffers();
+        return;
+    }
+    else if (state->dirty.w > 0)
+    {
+        // Restore whatever was drawn over the base frame last time
+        blitTile(&target, state->dirty.x, state->dirty.y, state->dirty.w, state->dirty.h,
+                 screenTileAt(baseFrame, state->dirty), TOP_HEIGHT * topBpp);
+    }
+
+    Rect dirty = { 0, 0, 0, 0 };
+    state->fadeStep = fadeStep;
+    if (fadeStep > 0)
+    {
+        drawCrossfade(&target);
+        dirty = fadeRect;
+        fadeStep = (fadeStep < CROSSFADE_FRAMES) ? fadeStep + 1 : 0;
+    }
+
+    if (overlayKind != 0)
+    {
+        drawOverlay(&target, overlayKind, overlayAlpha, ox, oy, ow, oh);
+        dirty = rectUnion(dirty, (Rect){ ox, oy, ow, oh });
+    }
+
+    state->overlayKind = overlayKind;
+    state->overlayAlpha = overlayAlpha;
+    state->dirty = dirty;
+
+    gfxFlushBuffers();
+    gfxSwapBuffers();
+}
+
+void drawImageToScreen(u8 *pixels, int width, int height)
+{
+    if (!pixels || width <= 0 || height <= 0)
+    {
+        return; // Invalid parameters
+    }
+
+    if (art.source != pixels || art.sourceWidth != width || art.sourceHeight != height || art.bpp != topBpp)
+    {
+        if (!buildArtCache(pixels, width, height))
+            return;
+    }
+
+    if (!baseValid || baseSource != art.source)
+    {
+        if (!buildBaseFrame(true))
+            return;
     }
 
     // Update overlay animation state (fade in/out)
@@ -526,252 +888,23 @@ void drawImageToScreen(u8 *pixels, int width, int height)
         current_overlay = 0;
 
     // If an overlay is currently active (possibly fading), draw it using overlay_alpha
-    if (current_overlay == 1)
-    {
-        // Icon size: larger (roughly 2/3 of scaled image)
-        int iconW = (scaledWidth * 2) / 3;
-        int iconH = (scaledHeight * 2) / 3;
-        if (iconW < 80) iconW = 80;
-        if (iconH < 80) iconH = 80;
-
-        int iconCX = imageStartX + scaledWidth / 2;
-        int iconCY = imageStartY + scaledHeight / 2;
-        int iconStartX = iconCX - iconW / 2;
-        int iconStartY = iconCY - iconH / 2;
-        int iconEndX = iconStartX + iconW;
-        int iconEndY = iconStartY + iconH;
-
-        const int iconCorner = 12;
-        const int bgBaseAlpha = 200; // background overlay alpha (stronger)
-        int bgAlpha = (bgBaseAlpha * overlay_alpha) / 255;
-
-        // Draw rounded dark background (same as pause)
-        for (int y = iconStartY; y < iconEndY; y++) {
-            for (int x = iconStartX; x < iconEndX; x++) {
-                if (x < 0 || x >= 400 || y < 0 || y >= 240) continue;
-
-                bool inArea = false;
-                if (x < iconStartX + iconCorner && y < iconStartY + iconCorner) {
-                    int dx = (iconStartX + iconCorner) - x;
-                    int dy = (iconStartY + iconCorner) - y;
-                    if (dx*dx + dy*dy <= iconCorner*iconCorner) inArea = true;
-                }
-                else if (x >= iconEndX - iconCorner && y < iconStartY + iconCorner) {
-                    int dx = x - (iconEndX - iconCorner);
-                    int dy = (iconStartY + iconCorner) - y;
-                    if (dx*dx + dy*dy <= iconCorner*iconCorner) inArea = true;
-                }
-                else if (x < iconStartX + iconCorner && y >= iconEndY - iconCorner) {
-                    int dx = (iconStartX + iconCorner) - x;
-                    int dy = y - (iconEndY - iconCorner);
-                    if (dx*dx + dy*dy <= iconCorner*iconCorner) inArea = true;
-                }
-                else if (x >= iconEndX - iconCorner && y >= iconEndY - iconCorner) {
-                    int dx = x - (iconEndX - iconCorner);
-                    int dy = y - (iconEndY - iconCorner);
-                    if (dx*dx + dy*dy <= iconCorner*iconCorner) inArea = true;
-                }
-                else {
-                    inArea = true;
-                }
-
-                if (!inArea) continue;
-
-                int fbX = 239 - y;
-                int fbY = x;
-                if (fbX < 0 || fbX >= 240 || fbY < 0 || fbY >= 400) continue;
-                int fbIdx = (fbX + fbY * 240) * 3;
-                int maxFbIdx = fbWidth * fbHeight * 3 - 3;
-                if (fbIdx < 0 || fbIdx > maxFbIdx) continue;
-
-                const int sB = 10, sG = 10, sR = 10;
-                u8 dstB = fb[fbIdx + 0];
-                u8 dstG = fb[fbIdx + 1];
-                u8 dstR = fb[fbIdx + 2];
-                fb[fbIdx + 0] = (u8)((bgAlpha * sB + (255 - bgAlpha) * dstB) / 255);
-                fb[fbIdx + 1] = (u8)((bgAlpha * sG + (255 - bgAlpha) * dstG) / 255);
-                fb[fbIdx + 2] = (u8)((bgAlpha * sR + (255 - bgAlpha) * dstR) / 255);
-            }
-        }
-
-        // Draw a right-pointing play triangle with inner padding
-        // padding inside the icon on all sides
-        int pad = iconW / 4;
-        int padH = iconH / 4;
-        if (pad < 16) pad = 16;
-        if (padH < 16) padH = 16;
-
-        int Ax = iconStartX + pad, Ay = iconStartY + padH;
-        int Bx = iconStartX + pad, By = iconEndY - padH;
-        int Cx = iconEndX - pad, Cy = iconCY;
-
-        int triMinX = Ax;
-        int triMaxX = Cx;
-        int triMinY = Ay;
-        int triMaxY = By;
-
-        for (int y = triMinY; y <= triMaxY; y++) {
-            for (int x = triMinX; x <= triMaxX; x++) {
-                if (x < 0 || x >= 400 || y < 0 || y >= 240) continue;
-                int v0x = Cx - Ax; int v0y = Cy - Ay;
-                int v1x = Bx - Ax; int v1y = By - Ay;
-                int v2x = x - Ax;  int v2y = y - Ay;
-                int denom = v0x * v1y - v1x * v0y;
-                if (denom == 0) continue;
-                float u = (float)(v2x * v1y - v1x * v2y) / (float)denom;
-                float v = (float)(v0x * v2y - v2x * v0y) / (float)denom;
-                if (u >= 0.0f && v >= 0.0f && (u + v) <= 1.0f) {
-                    int fbX = 239 - y;
-                    int fbY = x;
-                    if (fbX < 0 || fbX >= 240 || fbY < 0 || fbY >= 400) continue;
-                    int fbIdx = (fbX + fbY * 240) * 3;
-                    int maxFbIdx = fbWidth * fbHeight * 3 - 3;
-                    if (fbIdx < 0 || fbIdx > maxFbIdx) continue;
-                    // Blend white triangle using overlay_alpha
-                    u8 dstB = fb[fbIdx + 0];
-                    u8 dstG = fb[fbIdx + 1];
-                    u8 dstR = fb[fbIdx + 2];
-                    int a = overlay_alpha;
-                    fb[fbIdx + 0] = (u8)((a * 255 + (255 - a) * dstB) / 255);
-                    fb[fbIdx + 1] = (u8)((a * 255 + (255 - a) * dstG) / 255);
-                    fb[fbIdx + 2] = (u8)((a * 255 + (255 - a) * dstR) / 255);
-                }
-            }
-        }
-    }
-    else if (current_overlay == 2)
-    {
-        // Icon size: larger (roughly 2/3 of scaled image)
-        int iconW = (scaledWidth * 2) / 3;
-        int iconH = (scaledHeight * 2) / 3;
-        if (iconW < 80) iconW = 80;
-        if (iconH < 80) iconH = 80;
-
-        int iconCX = imageStartX + scaledWidth / 2;
-        int iconCY = imageStartY + scaledHeight / 2;
-        int iconStartX = iconCX - iconW / 2;
-        int iconStartY = iconCY - iconH / 2;
-        int iconEndX = iconStartX + iconW;
-        int iconEndY = iconStartY + iconH;
-
-        const int iconCorner = 12;
-        const int bgBaseAlpha = 200; // background overlay alpha (stronger)
-        int bgAlpha = (bgBaseAlpha * overlay_alpha) / 255;
-
-        for (int y = iconStartY; y < iconEndY; y++) {
-            for (int x = iconStartX; x < iconEndX; x++) {
-                if (x < 0 || x >= 400 || y < 0 || y >= 240) continue;
-
-                // Rounded rect test (same approach as above)
-                bool inArea = false;
-                // TL
-                if (x < iconStartX + iconCorner && y < iconStartY + iconCorner) {
-                    int dx = (iconStartX + iconCorner) - x;
-                    int dy = (iconStartY + iconCorner) - y;
-                    if (dx*dx + dy*dy <= iconCorner*iconCorner) inArea = true;
-                }
-                // TR
-                else if (x >= iconEndX - iconCorner && y < iconStartY + iconCorner) {
-                    int dx = x - (iconEndX - iconCorner);
-                    int dy = (iconStartY + iconCorner) - y;
-                    if (dx*dx + dy*dy <= iconCorner*iconCorner) inArea = true;
-                }
-                // BL
-                else if (x < iconStartX + iconCorner && y >= iconEndY - iconCorner) {
-                    int dx = (iconStartX + iconCorner) - x;
-                    int dy = y - (iconEndY - iconCorner);
-                    if (dx*dx + dy*dy <= iconCorner*iconCorner) inArea = true;
-                }
-                // BR
-                else if (x >= iconEndX - iconCorner && y >= iconEndY - iconCorner) {
-                    int dx = x - (iconEndX - iconCorner);
-                    int dy = y - (iconEndY - iconCorner);
-                    if (dx*dx + dy*dy <= iconCorner*iconCorner) inArea = true;
-                }
-                else {
-                    inArea = true;
-                }
-
-                if (!inArea) continue;
-
-                int fbX = 239 - y;
-                int fbY = x;
-                if (fbX < 0 || fbX >= 240 || fbY < 0 || fbY >= 400) continue;
-                int fbIdx = (fbX + fbY * 240) * 3;
-                int maxFbIdx = fbWidth * fbHeight * 3 - 3;
-                if (fbIdx < 0 || fbIdx > maxFbIdx) continue;
-
-                // Blend dark background (scaled by overlay alpha)
-                const int sB = 10, sG = 10, sR = 10;
-                u8 dstB = fb[fbIdx + 0];
-                u8 dstG = fb[fbIdx + 1];
-                u8 dstR = fb[fbIdx + 2];
-                fb[fbIdx + 0] = (u8)((bgAlpha * sB + (255 - bgAlpha) * dstB) / 255);
-                fb[fbIdx + 1] = (u8)((bgAlpha * sG + (255 - bgAlpha) * dstG) / 255);
-                fb[fbIdx + 2] = (u8)((bgAlpha * sR + (255 - bgAlpha) * dstR) / 255);
-            }
-        }
-
-        // Draw two white pause bars (thicker for larger icon)
-        int barW = iconW / 5;
-        if (barW < 10) barW = 10;
-        int barH = (int)(iconH * 0.7f);
-        int barTop = iconCY - barH / 2;
-        int leftBarX = iconStartX + iconW/3 - barW/2;
-        int rightBarX = iconStartX + (2*iconW)/3 - barW/2;
-
-        for (int y = barTop; y < barTop + barH; y++) {
-            for (int x = leftBarX; x < leftBarX + barW; x++) {
-                if (x < 0 || x >= 400 || y < 0 || y >= 240) continue;
-                int fbX = 239 - y;
-                int fbY = x;
-                int fbIdx = (fbX + fbY * 240) * 3;
-                int maxFbIdx = fbWidth * fbHeight * 3 - 3;
-                if (fbIdx < 0 || fbIdx > maxFbIdx) continue;
-                // Blend white pause bar using overlay_alpha
-                u8 dstB = fb[fbIdx + 0];
-                u8 dstG = fb[fbIdx + 1];
-                u8 dstR = fb[fbIdx + 2];
-                int a = overlay_alpha;
-                fb[fbIdx + 0] = (u8)((a * 255 + (255 - a) * dstB) / 255);
-                fb[fbIdx + 1] = (u8)((a * 255 + (255 - a) * dstG) / 255);
-                fb[fbIdx + 2] = (u8)((a * 255 + (255 - a) * dstR) / 255);
-            }
-            for (int x = rightBarX; x < rightBarX + barW; x++) {
-                if (x < 0 || x >= 400 || y < 0 || y >= 240) continue;
-                int fbX = 239 - y;
-                int fbY = x;
-                int fbIdx = (fbX + fbY * 240) * 3;
-                int maxFbIdx = fbWidth * fbHeight * 3 - 3;
-                if (fbIdx < 0 || fbIdx > maxFbIdx) continue;
-                u8 dstB = fb[fbIdx + 0];
-                u8 dstG = fb[fbIdx + 1];
-                u8 dstR = fb[fbIdx + 2];
-                int a = overlay_alpha;
-                fb[fbIdx + 0] = (u8)((a * 255 + (255 - a) * dstB) / 255);
-                fb[fbIdx + 1] = (u8)((a * 255 + (255 - a) * dstG) / 255);
-                fb[fbIdx + 2] = (u8)((a * 255 + (255 - a) * dstR) / 255);
-            }
-        }
-    }
-
-    gfxFlushBuffers();
-    gfxSwapBuffers();
+    presentFrame(current_overlay, overlay_alpha);
+    animating = fadeStep > 0 || overlay_alpha != target_alpha;
 }
 
 void drawBackgroundToScreen()
 {
-    u16 fbWidth, fbHeight;
-    u8 *fb = gfxGetFramebuffer(GFX_TOP, GFX_LEFT, &fbWidth, &fbHeight);
-
-    if (!fb)
+    if (!baseValid || baseSource != NULL)
     {
-        return; // No framebuffer
+        if (!buildBaseFrame(false))
+            return;
     }
 
-    drawGradient(fb, fbWidth, fbHeight);
-
-    gfxFlushBuffers();
-    gfxSwapBuffers();
+    presentFrame(0, 0);
+    animating = fadeStep > 0;
 }
 
+bool topScreenAnimating(void)
+{
+    return animating;
+}
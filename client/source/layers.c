@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "layers.h"
+
+static uint8_t *layersData = NULL;
+static uint32_t layersSize = 0;
+
+bool layersLoad(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < (long)sizeof(LayersHeader))
+    {
+        fclose(f);
+        return false;
+    }
+
+    uint8_t *data = (uint8_t *)malloc(size);
+    if (!data)
+    {
+        fclose(f);
+        return false;
+    }
+
+    // One read for the whole file; layers are used in place afterwards
+    size_t got = fread(data, 1, size, f);
+    fclose(f);
+
+    const LayersHeader *header = (const LayersHeader *)data;
+    if (got != (size_t)size || header->magic != LAYERS_MAGIC || header->version != LAYERS_VERSION ||
+        sizeof(LayersHeader) + header->count * sizeof(LayersEntry) > (size_t)size)
+    {
+        free(data);
+        return false;
+    }
+
+    free(layersData);
+    layersData = data;
+    layersSize = (uint32_t)size;
+    return true;
+}
+
+const uint8_t *layersFind(LayerId id, int w, int h)
+{
+    if (!layersData)
+        return NULL;
+
+    const LayersHeader *header = (const LayersHeader *)layersData;
+    const LayersEntry *entries = (const LayersEntry *)(layersData + sizeof(LayersHeader));
+    for (uint32_t i = 0; i < header->count; i++)
+    {
+        const LayersEntry *e = &entries[i];
+        if (e->id == (uint32_t)id && e->w == w && e->h == h)
+        {
+            uint32_t bpp = (id == LAYER_GRADIENT_BGR8) ? 3 : 1;
+            if (e->size != (uint32_t)w * h * bpp || e->offset > layersSize || e->size > layersSize - e->offset)
+                return NULL;
+            return layersData + e->offset;
+        }
+    }
+    return NULL;
+}
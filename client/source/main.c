@@ -9,6 +9,14 @@
 
 #include "fetch.h"
 #include "parse.h"
+#include "settings.h"
+#include "layers.h"
+#include "font.h"
+#include "ui.h"
+#include "widgets.h"
+#include "profile.h"
+#include "clocksync.h"
+#include "control.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include "image_display.h"
@@ -18,93 +26,281 @@ typedef struct
 {
     char url[128];
     char *json_result;
+    u32 seq;            // of the request, see lastSeq
+    u64 sent, received; // osGetTime() around the request, for the clock estimate
+    FetchCancel cancel; // lets the main loop give up on the request
     volatile bool done;
-    LightEvent event;
+    volatile bool quit;
+    LightEvent request; // signaled for each fetch, and to stop the worker
+    Handle wake;        // signaled when done, to end the main loop's idle wait
 } FetchJob;
 
-// Worker thread function
+// Every poll and command takes the next sequence number. A poll numbered below freshFrom
+// started before something that outdates its answer (an acknowledged command, the app
+// sleeping, a new server address), so that answer is dropped rather than shown
+static u32 lastSeq = 0, freshFrom = 0;
+
+// Worker thread function; it lives as long as the app, so a retry costs no thread setup
 void fetch_worker(void *arg)
 {
     FetchJob *job = (FetchJob *)arg;
-    job->json_result = fetch(job->url);
-    job->done = true;
-    LightEvent_Signal(&job->event);
+    for (;;)
+    {
+        LightEvent_Wait(&job->request);
+        if (job->quit)
+            break;
+        job->sent = osGetTime();
+        job->json_result = fetch_cancellable(job->url, &job->cancel);
+        job->received = osGetTime();
+        job->done = true;
+        svcSignalEvent(job->wake);
+    }
 }
 
 #define CONFIG_DIR "sdmc:/3ds/spotify-3ds"
 #define CONFIG_PATH "sdmc:/3ds/spotify-3ds/ip.cfg"
 
-const int SCREEN_WIDTH = 40;
-static const int H_MARGIN = 3; // left/right horizontal margin in characters
+#define POLL_INTERVAL_MS 5000 // while playing, if the server doesn't say where playback is
+// Polls are rare mid-track and while paused or idle, and come just after a track should end
+#define POLL_MID_TRACK_MS 30000
+#define POLL_PAUSED_MS 15000
+#define POLL_TRACK_END_MS 400 // after the expected end, for Spotify to have moved on
+#define POLL_PENDING_MS 1000  // while a control waits for the server to show it
+// A volume press steps by VOLUME_STEP; held, it repeats by VOLUME_REPEAT_STEP after
+// VOLUME_REPEAT_DELAY_MS, faster each time down to every VOLUME_REPEAT_MIN_MS
+#define VOLUME_STEP 10
+#define VOLUME_REPEAT_STEP 2
+#define VOLUME_REPEAT_DELAY_MS 400
+#define VOLUME_REPEAT_MS 200
+#define VOLUME_REPEAT_MIN_MS 40
+// Retries after failed polls back off up to this, and are spread by up to a quarter either
+// way without going over it
+#define BACKOFF_MAX_MS 60000
+// How often the Wi-Fi link is checked while it is down
+#define WIFI_CHECK_MS 1000
+// Longest the loop sleeps while idle: input is sampled (and aptMainLoop() runs) about
+// every other frame. HID signals its events on every sample, so they can't be waited on
+#define INPUT_POLL_MS 33
+
+// Set by the APT hook, which runs inside aptMainLoop(); no polls start while suspended
+typedef struct
+{
+    volatile bool asleep;     // lid closed
+    volatile bool background; // HOME menu or another applet
+    volatile bool resumed;    // both cleared since the loop last looked
+    u64 pausedAt;
+} AppState;
 
-// Ensures directory exists
-void ensureDirectory(const char *path)
+static void onAptEvent(APT_HookType hook, void *param)
 {
-    mkdir(path, 0777); // Safe on 3DS, does nothing if exists
+    AppState *app = (AppState *)param;
+    bool wasSuspended = app->asleep || app->background;
+    switch (hook)
+    {
+    case APTHOOK_ONSLEEP:
+        app->asleep = true;
+        break;
+    case APTHOOK_ONWAKEUP:
+        app->asleep = false;
+        break;
+    case APTHOOK_ONSUSPEND:
+        app->background = true;
+        break;
+    case APTHOOK_ONRESTORE:
+        app->background = false;
+        break;
+    default:
+        return;
+    }
+    bool suspended = app->asleep || app->background;
+    if (suspended && !wasSuspended)
+        app->pausedAt = osGetTime();
+    if (!suspended && wasSuspended)
+        app->resumed = true;
 }
 
-// Center helper
-int center(const char *text, int width)
+// Delay before the next poll, from what the last one said about playback
+// (durationMs is 0 when the server didn't say where playback is)
+u32 nextPollDelay(bool playing, u32 progressMs, u32 durationMs)
 {
-    int len = strlen(text);
-    if (len >= width)
-        return 0;
-    return (width - len) / 2;
+    if (!playing)
+        return POLL_PAUSED_MS;
+    if (durationMs == 0)
+        return POLL_INTERVAL_MS;
+
+    u32 remaining = progressMs < durationMs ? durationMs - progressMs : 0;
+    if (remaining + POLL_TRACK_END_MS > POLL_MID_TRACK_MS)
+        return POLL_MID_TRACK_MS;
+    return remaining + POLL_TRACK_END_MS;
 }
 
-// forward declaration for a function defined later
-void printWithShadowCentered(int y, const char *text);
-
-// Marquee state for long track titles
-static int track_scroll_index = 0;
-static u32 track_last_scroll_tick = 0;
-static const int track_scroll_delay_ms = 200; // time between scroll steps
+// Delay before the next poll after a run of failed ones
+u32 backoffDelay(int failures)
+{
+    u32 delay = POLL_INTERVAL_MS;
+    for (int i = 1; i < failures && delay < BACKOFF_MAX_MS; i++)
+        delay *= 2;
+    if (delay > BACKOFF_MAX_MS)
+        delay = BACKOFF_MAX_MS;
+
+    // The spread stays under the cap, so at the cap it only goes down
+    u32 low = delay - delay / 4, high = delay + delay / 4;
+    if (high > BACKOFF_MAX_MS)
+        high = BACKOFF_MAX_MS;
+    return low + rand() % (high - low + 1);
+}
 
-// Print a line with shadow; if text fits, center it, otherwise show a marquee within SCREEN_WIDTH
-void printMarqueeLine(int y, const char *text)
+// Without the AC service, assume the link is up and let the request find out
+bool wifiConnected()
 {
-    if (!text)
-        return;
-    int len = strlen(text);
-    int fieldWidth = SCREEN_WIDTH - 2 * H_MARGIN;
+    u32 status = 0;
+    return R_FAILED(ACU_GetWifiStatus(&status)) || status != 0;
+}
 
-    if (len < fieldWidth)
+// While offline, what went wrong and how old the data on screen is (ageMs -1: no data yet)
+void showOffline(Widget *status, bool wifiUp, s64 ageMs)
+{
+    const char *reason = wifiUp ? "Server unreachable" : "No Wi-Fi connection";
+    char line[64];
+    if (ageMs < 0)
     {
-        printWithShadowCentered(y, text);
-        return;
+        snprintf(line, sizeof(line), "%s", reason);
     }
-
-    // Build visible window of width fieldWidth using scroll index and a small spacer
-    int pad = 4;
-    int loopLen = len + pad;
-    char buf[64];
-    if (fieldWidth >= (int)sizeof(buf))
-        fieldWidth = (int)sizeof(buf) - 1;
-    for (int i = 0; i < fieldWidth; i++)
+    else
     {
-        int idx = (track_scroll_index + i) % loopLen;
-        if (idx < len)
-            buf[i] = text[idx];
+        u32 age = ageMs / 1000;
+        if (age < 60)
+            snprintf(line, sizeof(line), "%s, updated %lus ago", reason, (unsigned long)age);
+        else if (age < 3600)
+            snprintf(line, sizeof(line), "%s, updated %lum ago", reason, (unsigned long)(age / 60));
         else
-            buf[i] = ' ';
+            snprintf(line, sizeof(line), "%s, updated %luh ago", reason,
+                     (unsigned long)(age / 3600));
     }
-    buf[fieldWidth] = '\0';
+    widgetSetText(status, line);
+}
 
-    // Print shadow (one row down, one column right) with left margin
-    int mainCol = H_MARGIN + 1;
-    int shadowCol = mainCol + 1;
-    int shadowLen = (fieldWidth > 0) ? (fieldWidth - 1) : 0;
-    if (shadowLen > 0)
-    {
-        char shadowBuf[64];
-        if (shadowLen >= (int)sizeof(shadowBuf))
-            shadowLen = (int)sizeof(shadowBuf) - 1;
-        memcpy(shadowBuf, buf, shadowLen);
-        shadowBuf[shadowLen] = '\0';
-        printf("\x1b[%d;%dH\x1b[38;2;0;0;0m%s", y + 1, shadowCol, shadowBuf);
-    }
-    // Print main text
-    printf("\x1b[%d;%dH\x1b[38;2;30;215;96m%s", y, mainCol, buf);
+// A millisecond count from a reply, 0 if missing (strtoull: they outgrow a 32-bit long)
+u64 getMs(const char *key, const char *json)
+{
+    char *value = get(key, json);
+    u64 ms = value ? strtoull(value, NULL, 10) : 0;
+    free(value);
+    return ms;
+}
+
+// Feed the clock estimate with when the server got a request and answered it
+void syncClock(const char *json, u64 sent, u64 received)
+{
+    u64 requestMs = getMs("request_ms", json);
+    u64 replyMs = getMs("server_time_ms", json);
+    if (requestMs && replyMs)
+        clockSyncAdd(sent, requestMs, replyMs, received);
+}
+
+// Read the playback state from a poll, or from a control's reply (which carries it
+// unless the server predates that). The server says when progress_ms held; without
+// that, take the reply's arrival
+void readPlayer(const char *json, PlayerState *state, u64 received)
+{
+    char *playing = get("is_playing", json);
+    if (playing)
+        state->playing = strcmp(playing, "true") == 0;
+    free(playing);
+
+    char *volume = get("volume_percent", json);
+    state->volume = volume ? atoi(volume) : -1;
+    free(volume);
+
+    char *name = get("name", json);
+    char *artist = get("artist", json);
+    state->track = controlTrackKey(name, artist);
+    free(name);
+    free(artist);
+
+    char *progress = get("progress_ms", json);
+    state->progressMs = progress ? getMs("progress_ms", json) : 0;
+    state->durationMs = progress ? getMs("duration_ms", json) : 0;
+    free(progress);
+    u64 serverMs = getMs("server_time_ms", json);
+    state->progressAt = serverMs && clockSyncReady() ? clockSyncToLocal(serverMs) : received;
+}
+
+// Where playback is now, running on from progressMs at progressAt while it plays
+u32 progressPosition(u32 progressMs, u64 progressAt, bool runs)
+{
+    u64 now = osGetTime();
+    if (!runs || now <= progressAt)
+        return progressMs;
+    return progressMs + (u32)(now - progressAt);
+}
+
+// Ensures directory exists
+void ensureDirectory(const char *path)
+{
+    mkdir(path, 0777); // Safe on 3DS, does nothing if exists
+}
+
+// Bottom screen widgets; the idle pair replaces the rest when no session is active
+static Widget statusLine, stateLabel, trackLine, artistLabel, progressBar, deviceLabel, volumeBar,
+    idleLabel, idleHint;
+static Widget *const panel[] = { &statusLine, &stateLabel, &trackLine, &artistLabel,
+                                 &progressBar, &deviceLabel, &volumeBar, &idleLabel,
+                                 &idleHint };
+#define PANEL_SIZE ((int)(sizeof(panel) / sizeof(panel[0])))
+
+// Switch between the now-playing widgets and the idle message
+void showIdle(bool idle)
+{
+    widgetSetVisible(&stateLabel, !idle);
+    widgetSetVisible(&trackLine, !idle);
+    widgetSetVisible(&artistLabel, !idle);
+    widgetSetVisible(&progressBar, !idle);
+    widgetSetVisible(&deviceLabel, !idle);
+    widgetSetVisible(&volumeBar, !idle);
+    widgetSetVisible(&idleLabel, idle);
+    widgetSetVisible(&idleHint, idle);
+}
+
+void initPanel()
+{
+    widgetInit(&statusLine, WIDGET_STATUS, 1);
+    widgetInit(&stateLabel, WIDGET_LABEL, 7);
+    widgetInit(&trackLine, WIDGET_MARQUEE, 10);
+    widgetInit(&artistLabel, WIDGET_LABEL, 13);
+    widgetInit(&progressBar, WIDGET_PROGRESS, 15);
+    widgetInit(&deviceLabel, WIDGET_LABEL, 17);
+    widgetInit(&volumeBar, WIDGET_VOLUME, 20);
+    widgetInit(&idleLabel, WIDGET_LABEL, 13);
+    widgetInit(&idleHint, WIDGET_LABEL, 16);
+    widgetSetText(&idleLabel, "Spotify session is not active");
+    widgetSetText(&idleHint, "Play a song now!");
+
+    // Only the status line shows until the first response arrives
+    for (int i = 0; i < PANEL_SIZE; i++)
+        widgetSetVisible(panel[i], panel[i] == &statusLine);
+}
+
+// Wipe the bottom screen back to the empty frame; widgets repaint on the next update
+void clearPanel()
+{
+    uiDrawFrame();
+    for (int i = 0; i < PANEL_SIZE; i++)
+        widgetInvalidate(panel[i]);
+}
+
+// Show text on a label or marquee, from the server's rendering of it if it sent one
+void showText(Widget *widget, const char *text, const char *strip)
+{
+    size_t size = 0;
+    unsigned char *bits = strip ? decode_base64(strip, &size) : NULL;
+
+    // UI_CELL rows of one byte per cell
+    if (bits && size > 0 && size % UI_CELL == 0)
+        widgetSetBitmap(widget, text, bits, size / UI_CELL);
+    else
+        widgetSetText(widget, text);
+    free(bits);
 }
 
 // Persistent IP load
@@ -154,239 +350,74 @@ char *askUser(const char *prompt)
     return inputbuf;
 }
 
-// Make bottomConsole file-scope so clearScreen can use it
-static PrintConsole bottomConsole;
-
-// Clear screen
-void clearScreen()
+// Helper to build URLs
+void build_url(char *buf, size_t buflen, const char *server_ip, const char *endpoint)
 {
-    // Set background to dark (near-black) and clear the console
-    printf("\x1b[48;2;30;33;36m"); // Darker background (almost black)
-    printf("\x1b[2J");
-
-    // Draw visible frame margins: vertical lines at left/right margins and horizontal lines at top/bottom
-    int leftCol = H_MARGIN;
-    int rightCol = SCREEN_WIDTH - H_MARGIN + 1;
-    // Keep the printable frame roughly in the previous area
-    int topRow = 4;
-    int bottomRow = 26;
-
-    // Frame color (light gray)
-    printf("\x1b[38;2;200;200;200m");
-
-    int innerWidth = rightCol - leftCol - 1;
-
-    // Decorative title to show in the top border
-    const char *title = " Spotify-3DS ";
-    int titleLen = (int)strlen(title);
-    int titleStart = (innerWidth - titleLen) / 2;
-    if (titleStart < 0)
-        titleStart = 0;
-
-    // Top border with centered title
-    for (int c = leftCol; c <= rightCol; c++)
-    {
-        int pos = c - leftCol - 1; // 0-based inside
-        if (c == leftCol)
-        {
-            printf("\x1b[%d;%dH+", topRow, c);
-        }
-        else if (c == rightCol)
-        {
-            printf("\x1b[%d;%dH+", topRow, c);
-        }
-        else
-        {
-            if (pos >= titleStart && pos < titleStart + titleLen)
-            {
-                char ch = title[pos - titleStart];
-                printf("\x1b[%d;%dH%c", topRow, c, ch);
-            }
-            else
-            {
-                printf("\x1b[%d;%dH-", topRow, c);
-            }
-        }
-    }
-
-    // Bottom border with a small pattern
-    const char *bottomStamp = "~ Enjoy the music ~";
-    int stampLen = (int)strlen(bottomStamp);
-    int stampStart = (innerWidth - stampLen) / 2;
-    if (stampStart < 0)
-        stampStart = 0;
-    for (int c = leftCol; c <= rightCol; c++)
-    {
-        int pos = c - leftCol - 1;
-        if (c == leftCol)
-        {
-            printf("\x1b[%d;%dH+", bottomRow, c);
-        }
-        else if (c == rightCol)
-        {
-            printf("\x1b[%d;%dH+", bottomRow, c);
-        }
-        else
-        {
-            if (pos >= stampStart && pos < stampStart + stampLen)
-            {
-                char ch = bottomStamp[pos - stampStart];
-                printf("\x1b[%d;%dH%c", bottomRow, c, ch);
-            }
-            else
-            {
-                printf("\x1b[%d;%dH=", bottomRow, c);
-            }
-        }
-    }
-
-    // Vertical sides and small corner flourishes
-    for (int r = topRow + 1; r < bottomRow; r++)
-    {
-        // left side
-        printf("\x1b[%d;%dH|", r, leftCol);
-        // right side
-        printf("\x1b[%d;%dH|", r, rightCol);
-    }
-
-    // Small corner art inside the frame
-    printf("\x1b[%d;%dH%c", topRow + 1, leftCol + 2, '/');
-    printf("\x1b[%d;%dH%c", topRow + 2, leftCol + 1, '/');
-    printf("\x1b[%d;%dH%c", topRow + 1, rightCol - 2, '\\');
-    printf("\x1b[%d;%dH%c", topRow + 2, rightCol - 1, '\\');
-    printf("\x1b[%d;%dH%c", bottomRow - 1, leftCol + 2, '\\');
-    printf("\x1b[%d;%dH%c", bottomRow - 2, leftCol + 1, '\\');
-    printf("\x1b[%d;%dH%c", bottomRow - 1, rightCol - 2, '/');
-    printf("\x1b[%d;%dH%c", bottomRow - 2, rightCol - 1, '/');
-
-    // Soft shadow along bottom and right borders (one row/col offset)
-    printf("\x1b[38;2;100;100;100m");
-    int shadowRow = bottomRow + 1;
-    for (int c = leftCol + 1; c <= rightCol + 1; c++)
-    {
-        if (c == leftCol + 1)
-        {
-            // leftmost point of bottom shadow: backslash
-            printf("\x1b[%d;%dH\\", shadowRow, c);
-        }
-        else
-        {
-            printf("\x1b[%d;%dH.", shadowRow, c);
-        }
-    }
-    int shadowCol = rightCol + 1;
-    for (int r = topRow + 1; r <= bottomRow + 1; r++)
-    {
-        if (r == topRow + 1)
-        {
-            // uppermost point of right shadow: backslash
-            printf("\x1b[%d;%dH\\", r, shadowCol);
-        }
-        else
-        {
-            printf("\x1b[%d;%dH.", r, shadowCol);
-        }
-    }
-
-    // Restore main text color (Spotify green)
-    printf("\x1b[38;2;30;215;96m");
+    snprintf(buf, buflen, "http://%s:8000/%s", server_ip, endpoint);
 }
 
-void printWithShadowCentered(int y, const char *text)
+// The request that carries out a control
+void controlUrl(char *url, size_t size, const char *server_ip, const Control *control)
 {
-    int len = strlen(text);
-    int effectiveWidth = SCREEN_WIDTH - 2 * H_MARGIN;
-    int x = (effectiveWidth - len) / 2;
-    if (x < 0)
-        x = 0;
-
-    int col = H_MARGIN + x + 1; // 1-based column
-
-    // Black shadow: if the text fits within the effective width, draw full-length shadow;
-    // otherwise draw the shadow one character shorter to avoid trailing overflow.
-    int shadowLen = len;
-    if (len > effectiveWidth)
-    {
-        shadowLen = (len > 0) ? (len - 1) : 0;
-    }
-    if (shadowLen > effectiveWidth)
-        shadowLen = effectiveWidth;
-    if (shadowLen > 0)
-    {
-        char shadowBuf[256];
-        if (shadowLen >= (int)sizeof(shadowBuf))
-            shadowLen = (int)sizeof(shadowBuf) - 1;
-        memcpy(shadowBuf, text, shadowLen);
-        shadowBuf[shadowLen] = '\0';
-        printf("\x1b[%d;%dH\x1b[38;2;0;0;0m%s", y + 1, col + 1, shadowBuf);
-    }
-
-    // Main text
-    printf("\x1b[%d;%dH\x1b[38;2;30;215;96m%s", y, col, text);
+    static const char *const endpoints[] = { "play", "pause", "next", "previous" };
+    char endpoint[32];
+    if (control->kind == CONTROL_VOLUME)
+        snprintf(endpoint, sizeof(endpoint), "volume?volume_percent=%d", control->volume);
+    else
+        snprintf(endpoint, sizeof(endpoint), "%s", endpoints[control->kind]);
+    build_url(url, size, server_ip, endpoint);
 }
 
-// Helper to print the volume as a 10-segment ASCII bar (each segment = 10%)
-void printVolumeBar(int volume)
+// Whether the server carried out a control: it answers 200 with Spotify's status inside
+bool controlTaken(const char *reply)
 {
-    int filled = volume / 10;
-    if (filled < 0)
-        filled = 0;
-    if (filled > 10)
-        filled = 10;
-
-    // Print percent with shadow on the original line (row 21)
-    char percent_line[32];
-    snprintf(percent_line, sizeof(percent_line), "Volume: %3d%%", volume);
-    printWithShadowCentered(20, percent_line);
-
-    // Print 10 single-character segments (one per 10%) two lines below (row 22), centered.
-    int effectiveWidth = SCREEN_WIDTH - 2 * H_MARGIN;
-    int barLen = 10; // 10 single-char segments
-    int x = (effectiveWidth - barLen) / 2;
-    if (x < 0)
-        x = 0;
-    int col = H_MARGIN + x + 1; // 1-based column
-    for (int i = 0; i < 10; i++)
-    {
-        int segCol = col + i;
-        // Draw shadow one row down, one column right (black)
-        printf("\x1b[%d;%dH\x1b[38;2;0;0;0m#", 23, segCol + 1);
-        // Draw main segment on the intended row (22) with color indicating activity
-        if (i < filled)
-        {
-            // Active segment: green '#'
-            printf("\x1b[%d;%dH\x1b[38;2;30;215;96m#", 22, segCol);
-        }
-        else
-        {
-            // Inactive segment: gray '#'
-            printf("\x1b[%d;%dH\x1b[38;2;120;120;120m#", 22, segCol);
-        }
-    }
-    // Restore main text color after drawing
-    printf("\x1b[38;2;30;215;96m");
+    if (!reply)
+        return false;
+    char *status = get("status", reply);
+    bool taken = !status || atoi(status) < 300;
+    free(status);
+    return taken;
 }
 
-// Helper to build URLs
-void build_url(char *buf, size_t buflen, const char *server_ip, const char *endpoint)
+// Show the playback state, with the pending controls applied
+void showPlayer(const PlayerState *shown, const PlayerState *polled)
 {
-    snprintf(buf, buflen, "http://%s:8000/%s", server_ip, endpoint);
+    if (shown->skipping)
+        widgetSetText(&stateLabel, "Changing track...");
+    else
+        widgetSetText(&stateLabel, shown->playing ? "Now playing:" : "Playback paused:");
+    widgetSetValue(&volumeBar, shown->volume);
+    // The play icon stands for a play the server hasn't shown yet
+    setPlaybackPaused(!shown->playing);
+    setTemporaryPlay(shown->playing && !polled->playing);
 }
 
 int main(int argc, char **argv)
 {
     gfxInitDefault();
+    romfsInit();
     cfguInit();
+    acInit();
     httpcInit(0);
     Result ret = initNetwork();
-    consoleInit(GFX_BOTTOM, &bottomConsole);
-    consoleSelect(&bottomConsole);
-    bool is_playing = false;
-    char url[128];
+    uiInit();
+    uiDrawFrame();
+    initPanel();
 
     // Ensure directory exists
     ensureDirectory(CONFIG_DIR);
 
+    // Baked static layers; without them everything is rasterized at runtime
+    layersLoad(LAYERS_PATH);
+    // Glyphs beyond ASCII; without them the server sends such titles pre-rendered
+    // (or romanized, if it has no font either)
+    fontLoad(FONT_PATH);
+
+    Settings settings;
+    loadSettings(&settings);
+    setTopScreenRGB565(settings.rgb565);
+    setBlurredBackdrop(settings.blurred_backdrop);
+
     char server_ip[60];
 
     // Load or ask for IP
@@ -401,164 +432,294 @@ int main(int argc, char **argv)
     // Initial connection message
     char connect_msg[80];
     snprintf(connect_msg, sizeof(connect_msg), "Connecting to %s...", server_ip);
-    int col_connect = center(connect_msg, SCREEN_WIDTH);
-    printf("\x1b[1;%dH%s\n", col_connect + 1, connect_msg);
+    widgetSetText(&statusLine, connect_msg);
+    widgetsUpdate(panel, PANEL_SIZE);
 
     // Variables for now-playing info
-    static u32 lastTick = 0;
+    static u64 lastTick = 0;
     char *track = NULL;
     char *artist = NULL;
     char *device_name = NULL;
-    char *volume_str = NULL;
-    int volume = 0;
-    char *is_playing_str = NULL;
     bool need_refresh = true;
+    bool idle = true;
+
+    // What the server last said, and that with the pending controls applied
+    PlayerState polled = { .volume = -1 }, shown = polled;
 
     // Image data variables
     char *imageURL = NULL;
+    char *coverURL = NULL; // the image_url imagePixels came from
     u8 *imagePixels = NULL;
     int imageWidth = 0, imageHeight = 0;
 
     // Async fetch state
-    FetchJob fetchJob;
-    Thread fetchThread = NULL;
+    FetchJob fetchJob = { 0 };
     bool fetchInProgress = false;
+    LightEvent_Init(&fetchJob.request, RESET_ONESHOT);
+    svcCreateEvent(&fetchJob.wake, RESET_ONESHOT);
+    fetch_cancel_init(&fetchJob.cancel);
+    Thread fetchThread = threadCreate(fetch_worker, &fetchJob, 8 * 1024, 0x18, -2, false);
+
+    // Controls go out on a worker of their own, so a press never waits for the network;
+    // it shares the poll worker's wake event
+    FetchJob commandJob = { 0 };
+    bool commandInFlight = false;
+    ControlKind commandKind = CONTROL_PLAY;
+    bool commandCancelled = false;
+    LightEvent_Init(&commandJob.request, RESET_ONESHOT);
+    commandJob.wake = fetchJob.wake;
+    fetch_cancel_init(&commandJob.cancel);
+    u64 volumeRepeatAt = 0;
+    u32 volumeRepeatMs = VOLUME_REPEAT_MS;
+    Thread commandThread = threadCreate(fetch_worker, &commandJob, 8 * 1024, 0x18, -2, false);
+
+    // Backoff and offline state: polls wait for the link, and space out while they fail
+    srand(osGetTime());
+    u32 pollDelay = POLL_INTERVAL_MS;
+    int failures = 0;
+    bool wifiUp = true;
+    u64 lastWifiCheck = 0;
+    bool updated = false; // whether any poll has succeeded yet
+    u64 lastUpdate = 0;
+
+    AppState app = { 0 };
+    aptHookCookie aptCookie;
+    aptHook(&aptCookie, onAptEvent, &app);
+
+    // The top screen is drawn only when something on it changed or a fade is running
+    bool redraw_top = true;
 
     while (aptMainLoop())
     {
+        PROFILE_BEGIN(PROFILE_FRAME);
+        PROFILE_BEGIN(PROFILE_INPUT);
         hidScanInput();
+        PROFILE_END(PROFILE_INPUT);
         u32 kDown = hidKeysDown();
-        u32 currentTick = osGetTime();
+        u64 currentTick = osGetTime();
 
         // Handle input every frame
         if (kDown & KEY_START)
             break;
+        if (kDown)
+            redraw_top = true;
+
+        // Back from sleep or HOME: resync at once instead of showing old data until the
+        // next poll, and carry on the marquee from where it stopped
+        if (app.resumed)
+        {
+            app.resumed = false;
+            widgetDelayScroll(&trackLine, currentTick - app.pausedAt);
+            freshFrom = lastSeq + 1;
+            need_refresh = true;
+            redraw_top = true;
+        }
 
         // Re-enter IP on pressing Y
         if (kDown & KEY_Y)
         {
-            clearScreen();
+            clearPanel();
             char *input = askUser("Enter new server IP address:");
             strncpy(server_ip, input, sizeof(server_ip) - 1);
             server_ip[sizeof(server_ip) - 1] = '\0';
             saveIP(server_ip);
 
             snprintf(connect_msg, sizeof(connect_msg), "Connecting to %s...", server_ip);
-            col_connect = center(connect_msg, SCREEN_WIDTH);
-            printf("\x1b[1;%dH%s\n", col_connect + 1, connect_msg);
+            widgetSetText(&statusLine, connect_msg);
             need_refresh = true; // force refresh after IP change
+            freshFrom = lastSeq + 1;
+            failures = 0;
+            pollDelay = POLL_INTERVAL_MS;
         }
 
-        if (kDown & KEY_A)
+#ifdef PROFILE
+        // SELECT+R shows the profiler HUD, SELECT+L saves what it recorded
+        if ((hidKeysHeld() & KEY_SELECT) && (kDown & KEY_R))
+            profileToggleHud();
+        if ((hidKeysHeld() & KEY_SELECT) && (kDown & KEY_L))
         {
-            if (is_playing)
-                build_url(url, sizeof(url), server_ip, "pause");
+            char path[96];
+            if (profileDump(CONFIG_DIR, path, sizeof(path)))
+                widgetSetText(&statusLine, path);
             else
-                build_url(url, sizeof(url), server_ip, "play");
-            fetch(url);
-            // If user requested play, immediately show play overlay until server confirms
-            if (!is_playing)
-                setTemporaryPlay(true);
-            need_refresh = true;
+                widgetSetText(&statusLine, "Failed to save profile");
         }
+#endif
+
+        // Controls show at once, and go to the server in the background
+        bool pressed = false;
+        if (kDown & KEY_A)
+            pressed |= controlPress(shown.playing ? CONTROL_PAUSE : CONTROL_PLAY, 0, &shown,
+                                    currentTick);
         if (kDown & KEY_DRIGHT)
+            pressed |= controlPress(CONTROL_NEXT, 0, &shown, currentTick);
+        if (kDown & KEY_DLEFT)
+            pressed |= controlPress(CONTROL_PREVIOUS, 0, &shown, currentTick);
+        u32 volumeKeys = hidKeysHeld() & (KEY_DUP | KEY_DDOWN);
+        int volumeStep = 0;
+        if (kDown & (KEY_DUP | KEY_DDOWN))
         {
-            build_url(url, sizeof(url), server_ip, "next");
-            fetch(url);
-            need_refresh = true;
+            volumeStep = VOLUME_STEP;
+            volumeRepeatAt = currentTick + VOLUME_REPEAT_DELAY_MS;
+            volumeRepeatMs = VOLUME_REPEAT_MS;
         }
-        if (kDown & KEY_DLEFT)
+        else if (volumeKeys && currentTick >= volumeRepeatAt)
         {
-            build_url(url, sizeof(url), server_ip, "previous");
-            fetch(url);
-            need_refresh = true;
+            volumeStep = VOLUME_REPEAT_STEP;
+            volumeRepeatAt = currentTick + volumeRepeatMs;
+            volumeRepeatMs = volumeRepeatMs * 3 / 4;
+            if (volumeRepeatMs < VOLUME_REPEAT_MIN_MS)
+                volumeRepeatMs = VOLUME_REPEAT_MIN_MS;
+        }
+        if (volumeStep)
+        {
+            // Rapid presses make one control, whose target each moves (see controlPress)
+            int target = shown.volume < 0 ? 0 : shown.volume;
+            if (volumeKeys & KEY_DUP)
+                target = target <= 100 - volumeStep ? target + volumeStep : 100;
+            if (volumeKeys & KEY_DDOWN)
+                target = target >= volumeStep ? target - volumeStep : 0;
+            if (target != shown.volume)
+                pressed |= controlPress(CONTROL_VOLUME, target, &shown, currentTick);
         }
-        if (kDown & KEY_DUP || kDown & KEY_DDOWN)
+        // Ones the server never showed roll back to what it did show
+        if (pressed | controlExpire(currentTick))
         {
-            build_url(url, sizeof(url), server_ip, "volume");
-            char params[32];
-            if (kDown & KEY_DUP)
+            controlApply(&polled, &shown);
+            showPlayer(&shown, &polled);
+            redraw_top = true;
+        }
+
+        // One control at a time; once the server takes it, polls on their way are outdated.
+        // A volume on its way is given up on when a newer one is ready to replace it: it
+        // fails, and so rolls back to the newer one
+        const Control *control = controlToSend(currentTick);
+        if (control && commandInFlight && !commandCancelled &&
+            commandKind == CONTROL_VOLUME && control->kind == CONTROL_VOLUME)
+        {
+            fetch_cancel(&commandJob.cancel);
+            commandCancelled = true;
+        }
+        if (control && !commandInFlight)
+        {
+            controlUrl(commandJob.url, sizeof(commandJob.url), server_ip, control);
+            commandJob.json_result = NULL;
+            commandJob.seq = ++lastSeq;
+            commandJob.done = false;
+            commandJob.cancel.cancelled = false;
+            commandKind = control->kind;
+            commandCancelled = false;
+            controlSent(commandJob.seq, currentTick);
+            LightEvent_Signal(&commandJob.request);
+            commandInFlight = true;
+        }
+        if (commandInFlight && commandJob.done)
+        {
+            commandInFlight = false;
+            char *reply = commandJob.json_result;
+            bool taken = controlTaken(reply);
+            if (reply)
+                syncClock(reply, commandJob.sent, commandJob.received);
+            controlAcknowledged(commandJob.seq, taken, lastSeq + 1);
+            if (taken)
+                freshFrom = lastSeq + 1;
+
+            // The reply says what the control did, so no poll is needed to show it; a skip
+            // only shows once Spotify has moved on, so it is checked on shortly
+            bool carriesState = taken && strstr(reply, "\"player_state\":");
+            if (carriesState)
             {
-                if (volume <= 90)
-                    volume += 10;
-                else
-                    volume = 100;
+                readPlayer(reply, &polled, commandJob.received);
+                controlReconcile(&polled, freshFrom);
+                u32 since = (u32)(currentTick - lastTick);
+                if (controlPending() && pollDelay > since + POLL_PENDING_MS)
+                    pollDelay = since + POLL_PENDING_MS;
             }
-            if (kDown & KEY_DDOWN)
+            else if (taken)
             {
-                if (volume >= 10)
-                    volume -= 10;
-                else
-                    volume = 0;
+                need_refresh = true;
+            }
+            free(reply);
+            if (!taken || carriesState)
+            {
+                controlApply(&polled, &shown);
+                showPlayer(&shown, &polled);
+                redraw_top = true;
             }
-            if (volume > 0 || volume < 100)
+        }
+
+        // While the link is down, only watch for it to come back, then poll at once
+        if (!wifiUp && currentTick - lastWifiCheck >= WIFI_CHECK_MS)
+        {
+            lastWifiCheck = currentTick;
+            if (wifiConnected())
             {
-                snprintf(params, sizeof(params), "volume_percent=%d", volume);
-                fetch_with_params(url, params);
+                wifiUp = true;
+                failures = 0;
+                pollDelay = POLL_INTERVAL_MS;
                 need_refresh = true;
             }
         }
 
-        // declare previous state variables for comparison
-        static char prev_track[128] = "";
-        static char prev_artist[128] = "";
-        static char prev_device_name[128] = "";
-        static int prev_volume = -1;
-        static bool prev_is_playing = false;
         // Start async fetch if needed and not already in progress
-        if ((need_refresh || (currentTick - lastTick >= 5000)) && !fetchInProgress)
+        if ((need_refresh || (currentTick - lastTick >= pollDelay)) && !fetchInProgress &&
+            wifiUp && !app.asleep && !app.background)
         {
             lastTick = currentTick;
-            need_refresh = false;
-
-            build_url(fetchJob.url, sizeof(fetchJob.url), server_ip, "now-playing");
-            fetchJob.json_result = NULL;
-            fetchJob.done = false;
-            LightEvent_Init(&fetchJob.event, RESET_ONESHOT);
-            fetchThread = threadCreate(fetch_worker, &fetchJob, 8 * 1024, 0x18, -2, false);
-            fetchInProgress = true;
+            if (!wifiConnected())
+            {
+                wifiUp = false;
+                lastWifiCheck = currentTick;
+            }
+            else
+            {
+                need_refresh = false;
+                build_url(fetchJob.url, sizeof(fetchJob.url), server_ip,
+                          fontLoaded() ? "now-playing?romanize=0" : "now-playing?strips=1");
+                fetchJob.json_result = NULL;
+                fetchJob.seq = ++lastSeq;
+                fetchJob.done = false;
+                fetchJob.cancel.cancelled = false;
+                LightEvent_Signal(&fetchJob.request);
+                fetchInProgress = true;
+            }
         }
 
         // If fetch is done, process result
         if (fetchInProgress && fetchJob.done)
         {
-            threadJoin(fetchThread, U64_MAX);
-            threadFree(fetchThread);
-            fetchThread = NULL;
             fetchInProgress = false;
+            redraw_top = true;
 
             char *json = fetchJob.json_result;
-            if (json)
+            if (fetchJob.seq < freshFrom)
+            {
+                // Whatever outdated it set need_refresh if a new answer is needed at once
+                // (a control whose reply carried the state doesn't)
+                free(json);
+            }
+            else if (json)
             {
+                syncClock(json, fetchJob.sent, fetchJob.received);
+                failures = 0;
+                lastUpdate = currentTick;
+                updated = true;
+
+                PROFILE_BEGIN(PROFILE_RESULT);
                 if (track)
                     free(track);
                 if (artist)
                     free(artist);
-                if (is_playing_str)
-                    free(is_playing_str);
                 if (device_name)
                     free(device_name);
-                if (volume_str)
-                    free(volume_str);
+                if (imageURL)
+                    free(imageURL);
 
                 track = get("name", json);
                 artist = get("artist", json);
-                is_playing_str = get("is_playing", json);
-                // update playback paused overlay
-                if (is_playing_str)
-                    is_playing = strcmp(is_playing_str, "true") == 0;
-                setPlaybackPaused(!is_playing);
-                if (is_playing)
-                {
-                    // Server reports playback is playing — clear temporary play overlay
-                    setTemporaryPlay(false);
-                }
                 device_name = get("device", json);
-                volume_str = get("volume_percent", json);
                 imageURL = get("image_url", json);
-
-                if (is_playing_str)
-                    is_playing = strcmp(is_playing_str, "true") == 0;
+                readPlayer(json, &polled, fetchJob.received);
 
                 if (!track)
                     track = strdup("Unknown");
@@ -566,141 +727,179 @@ int main(int argc, char **argv)
                     artist = strdup("Unknown");
                 if (!device_name)
                     device_name = strdup("Unknown Device");
-                if (!volume_str)
-                    volume_str = strdup("N/A");
-                else
-                    volume = atoi(volume_str);
 
-                // only clear the screen if the data is different from before
-                if (strcmp(track, prev_track) != 0 || strcmp(artist, prev_artist) != 0 || strcmp(device_name, prev_device_name) != 0 || volume != prev_volume || is_playing != prev_is_playing)
+                // Widgets only repaint the parts whose value changed
+                widgetSetText(&statusLine, "");
+                idle = strcmp(track, "Unknown") == 0 && strcmp(artist, "Unknown") == 0;
+                if (idle)
                 {
-                    clearScreen();
-                    // Save current state as previous
-                    strncpy(prev_track, track, sizeof(prev_track) - 1);
-                    prev_track[sizeof(prev_track) - 1] = '\0';
-                    strncpy(prev_artist, artist, sizeof(prev_artist) - 1);
-                    prev_artist[sizeof(prev_artist) - 1] = '\0';
-                    strncpy(prev_device_name, device_name, sizeof(prev_device_name) - 1);
-                    prev_device_name[sizeof(prev_device_name) - 1] = '\0';
-                    prev_volume = volume;
-                    prev_is_playing = is_playing;
-
-                    if (strcmp(track, "Unknown") == 0 && strcmp(artist, "Unknown") == 0)
-                    {
-                        const char *no_data_msg = "Spotify session is not active";
-                        const char *no_data_msg2 = "Play a song now!";
-                        printWithShadowCentered(13, no_data_msg);
-                        printWithShadowCentered(16, no_data_msg2);
-                    }
-                    else
-                    {
-                        // Status with spacing
-                        char line1[64];
-                        snprintf(line1, sizeof(line1),
-                                 is_playing ? "Now playing:" : "Playback paused:");
-
-                        // Status - centered with shadow
-                        printWithShadowCentered(7, line1);
-
-                        // Track - use marquee-aware printing
-                        printMarqueeLine(10, track);
-
-                        // Artist - centered with shadow
-                        printWithShadowCentered(13, artist);
-
-                        // Playing in device
-                        char device_line[128];
-                        snprintf(device_line, sizeof(device_line), "Playing on: %s", device_name);
-                        printWithShadowCentered(17, device_line);
-
-                        // Volume - use helper to render as 10-segment ASCII bar
-                        if (volume_str && strcmp(volume_str, "N/A") == 0)
-                        {
-                            printWithShadowCentered(20, "Volume: N/A");
-                        }
-                        else
-                        {
-                            printVolumeBar(volume);
-                        }
-                    }
+                    showIdle(true);
                 }
-                // Handle image download/display
-                if (ret == 0 && imageURL && strlen(imageURL) > 0)
+                else
+                {
+                    char device_line[128];
+                    snprintf(device_line, sizeof(device_line), "Playing on: %s", device_name);
+
+                    showIdle(false);
+                    char *track_strip = get("name_strip", json);
+                    char *artist_strip = get("artist_strip", json);
+                    showText(&trackLine, track, track_strip);
+                    showText(&artistLabel, artist, artist_strip);
+                    free(track_strip);
+                    free(artist_strip);
+                    widgetSetText(&deviceLabel, device_line);
+                }
+
+                // Settle the controls this shows, and show the rest on top of it
+                controlReconcile(&polled, fetchJob.seq);
+                controlApply(&polled, &shown);
+                showPlayer(&shown, &polled);
+
+                // The delay runs from when this poll started; pending controls are
+                // checked on sooner
+                u32 delay = nextPollDelay(!idle && polled.playing, polled.progressMs,
+                                          polled.durationMs);
+                if (controlPending() && delay > POLL_PENDING_MS)
+                    delay = POLL_PENDING_MS;
+                pollDelay = (u32)(currentTick - lastTick) + delay;
+                PROFILE_END(PROFILE_RESULT);
+
+                // Handle image download/display; the same cover keeps its pixels and
+                // everything drawn from them
+                bool sameCover = imagePixels && imageURL && coverURL &&
+                                 strcmp(imageURL, coverURL) == 0;
+                if (ret == 0 && imageURL && strlen(imageURL) > 0 && !sameCover)
                 {
                     // Free old image data
                     if (imagePixels)
                     {
+                        resetImageCache();
                         stbi_image_free(imagePixels);
                         imagePixels = NULL;
                         imageWidth = 0;
                         imageHeight = 0;
                     }
+                    free(coverURL);
+                    coverURL = NULL;
 
                     // Download and decode image
                     u32 imageSize = 0;
-                    u8 *imageData = downloadImage(imageURL, &imageSize);
+                    PROFILE_BEGIN(PROFILE_DOWNLOAD);
+                    const char *imageError = NULL;
+                    u8 *imageData = downloadImage(imageURL, &imageSize, &imageError);
+                    PROFILE_END(PROFILE_DOWNLOAD);
                     if (imageData && imageSize > 0)
                     {
+                        PROFILE_BEGIN(PROFILE_DECODE);
                         imagePixels = stbi_load_from_memory(imageData, imageSize,
                                                             &imageWidth, &imageHeight, NULL, STBI_rgb_alpha);
+                        PROFILE_END(PROFILE_DECODE);
                         free(imageData);
 
                         if (!imagePixels)
                         {
-                            printf("Failed to decode image\n");
+                            widgetSetText(&statusLine, "Failed to decode image");
+                        }
+                        else
+                        {
+                            coverURL = strdup(imageURL);
                         }
                     }
                     else if (imageData)
                     {
                         free(imageData);
                     }
+                    else
+                    {
+                        widgetSetText(&statusLine, imageError);
+                    }
                 }
 
                 free(json);
             }
             else
             {
-                const char *err_msg = "Error fetching data from server.";
-                int col_err = center(err_msg, SCREEN_WIDTH);
-                printf("\x1b[1;%dH%s\n", col_err + 1, err_msg);
+                // What was last shown stays, with its age on the status line
+                failures++;
+                pollDelay = backoffDelay(failures);
             }
         }
+        if (!wifiUp || failures > 0)
+            showOffline(&statusLine, wifiUp, updated ? (s64)(currentTick - lastUpdate) : -1);
 
         // Draw image if we have one
-        if (imagePixels && imageURL)
+        bool drew_top = redraw_top || topScreenAnimating();
+        PROFILE_BEGIN(PROFILE_COVER);
+        if (drew_top)
         {
-            drawImageToScreen(imagePixels, imageWidth, imageHeight);
+            if (imagePixels && imageURL)
+                drawImageToScreen(imagePixels, imageWidth, imageHeight);
+            else
+                drawBackgroundToScreen();
+            redraw_top = false;
         }
-        else
+        PROFILE_END(PROFILE_COVER);
+
+        // Scroll long track titles, then repaint whatever changed
+        PROFILE_BEGIN(PROFILE_PANEL);
+        widgetTick(&trackLine, currentTick);
+        bool progressRuns = !idle && shown.playing;
+        widgetSetProgress(&progressBar,
+                          progressPosition(shown.progressMs, shown.progressAt, progressRuns),
+                          shown.durationMs);
+        widgetsUpdate(panel, PANEL_SIZE);
+        PROFILE_END(PROFILE_PANEL);
+
+#ifdef PROFILE
+        profileDrawHud();
+#endif
+        uiPresent();
+
+        // Pace by vblank while the top screen changes; otherwise sleep until the next
+        // thing due (a marquee step, the next poll, input) or the fetch finishing
+        PROFILE_BEGIN(PROFILE_WAIT);
+        if (drew_top || topScreenAnimating())
         {
-            drawBackgroundToScreen();
+            gspWaitForVBlank();
         }
-
-        // Update marquee scroll state for long track titles
-        if (track)
+        else
         {
-            int tlen = strlen(track);
-            int fieldWidth = SCREEN_WIDTH - 2 * H_MARGIN;
-            if (tlen > fieldWidth)
+            u64 now = osGetTime();
+            u64 deadline = now + INPUT_POLL_MS;
+            u64 marquee = widgetNextTick(&trackLine, now);
+            if (marquee < deadline)
+                deadline = marquee;
+            if (progressRuns)
             {
-                if (currentTick - track_last_scroll_tick >= track_scroll_delay_ms)
-                {
-                    track_scroll_index = (track_scroll_index + 1) % (tlen + 4);
-                    track_last_scroll_tick = currentTick;
-                }
+                u32 due = widgetProgressDue(&progressBar,
+                                            progressPosition(shown.progressMs, shown.progressAt,
+                                                             true),
+                                            shown.durationMs);
+                if (due < deadline - now)
+                    deadline = now + due;
             }
-            else
+            if (controlDeadline() < deadline)
+                deadline = controlDeadline();
+            if (volumeKeys && volumeRepeatAt < deadline)
+                deadline = volumeRepeatAt;
+            // A control waiting to go, unless it waits for the one on its way anyway
+            const Control *waiting = controlWaiting();
+            bool replaces = waiting && waiting->kind == CONTROL_VOLUME &&
+                            commandKind == CONTROL_VOLUME && !commandCancelled;
+            if (waiting && (!commandInFlight || replaces) && controlSendAt() < deadline)
+                deadline = controlSendAt();
+            if (!fetchInProgress && wifiUp)
             {
-                // reset when short
-                track_scroll_index = 0;
+                u32 since = (u32)(now - lastTick);
+                u64 poll = (need_refresh || since >= pollDelay) ? now : now + pollDelay - since;
+                if (poll < deadline)
+                    deadline = poll;
             }
-
-            // Always draw the track line (centered or marquee) each frame so animation updates
-            if (strcmp(track, "Unknown") != 0)
-                printMarqueeLine(10, track);
+            if (deadline > now)
+                svcWaitSynchronization(fetchJob.wake, (s64)(deadline - now) * 1000000LL);
         }
-
-        gspWaitForVBlank();
+        PROFILE_END(PROFILE_WAIT);
+        PROFILE_END(PROFILE_FRAME);
     }
 
     // Cleanup
@@ -708,18 +907,38 @@ int main(int argc, char **argv)
         free(track);
     if (artist)
         free(artist);
-    if (is_playing_str)
-        free(is_playing_str);
     if (device_name)
         free(device_name);
-    if (volume_str)
-        free(volume_str);
+    free(imageURL);
+    free(coverURL);
+    resetImageCache();
     if (imagePixels)
         stbi_image_free(imagePixels);
+    widgetRelease(&trackLine);
+    // Requests still on their way would only hold up the exit
+    fetch_cancel(&fetchJob.cancel);
+    fetch_cancel(&commandJob.cancel);
+    fetchJob.quit = true;
+    LightEvent_Signal(&fetchJob.request);
+    threadJoin(fetchThread, U64_MAX);
+    threadFree(fetchThread);
+    if (fetchInProgress)
+        free(fetchJob.json_result);
+    commandJob.quit = true;
+    LightEvent_Signal(&commandJob.request);
+    threadJoin(commandThread, U64_MAX);
+    threadFree(commandThread);
+    if (commandInFlight)
+        free(commandJob.json_result);
+    aptUnhook(&aptCookie);
+    svcCloseHandle(fetchJob.wake);
+    uiExit();
 
     cleanupNetwork();
     httpcExit();
+    acExit();
     cfguExit();
+    romfsExit();
     gfxExit();
     return 0;
 }
\ No newline at end of file
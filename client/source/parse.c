@@ -55,3 +55,56 @@ char *get(const char *key, const char *json)
 
     return value;
 }
+
+// ------------------------------
+// Decodes base64 text (padding optional); NULL on invalid input
+// Caller must free() the returned buffer
+// ------------------------------
+unsigned char *decode_base64(const char *text, size_t *len)
+{
+    if (!text || !len)
+        return NULL;
+
+    size_t n = strlen(text);
+    while (n > 0 && text[n - 1] == '=')
+        n--;
+
+    unsigned char *out = (unsigned char *)malloc(n * 3 / 4 + 1);
+    if (!out)
+        return NULL;
+
+    unsigned int acc = 0;
+    int bits = 0;
+    size_t o = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        char c = text[i];
+        int v;
+        if (c >= 'A' && c <= 'Z')
+            v = c - 'A';
+        else if (c >= 'a' && c <= 'z')
+            v = c - 'a' + 26;
+        else if (c >= '0' && c <= '9')
+            v = c - '0' + 52;
+        else if (c == '+')
+            v = 62;
+        else if (c == '/')
+            v = 63;
+        else
+        {
+            free(out);
+            return NULL;
+        }
+
+        acc = (acc << 6) | v;
+        bits += 6;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            out[o++] = (unsigned char)(acc >> bits);
+        }
+    }
+
+    *len = o;
+    return out;
+}
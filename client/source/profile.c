@@ -0,0 +1,157 @@
+#include "profile.h"
+
+#ifdef PROFILE
+
+#include "ui.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROFILE_HUD_PERIOD 30 // frames between HUD refreshes
+#define HUD_ROW 27            // first of the rows under the frame; covers its shadow while shown
+#define HUD_COLUMNS 2
+#define HUD_WIDTH (UI_COLS / HUD_COLUMNS)
+
+typedef struct
+{
+    u64 start;
+    u32 ticks;
+    u32 stage;
+} ProfileSample;
+
+static const char *const stageNames[PROFILE_STAGE_COUNT] = {
+    "frame", "input", "result", "dl", "decode", "cover", "panel", "wait",
+};
+
+static ProfileSample ring[PROFILE_RING];
+static u32 ringNext = 0;  // slot the next sample goes to
+static u32 ringCount = 0; // valid samples, up to PROFILE_RING
+static u64 openedAt[PROFILE_STAGE_COUNT];
+static bool hudShown = false;
+static int hudFrames = 0;
+
+void profileBegin(ProfileStage stage)
+{
+    openedAt[stage] = svcGetSystemTick();
+}
+
+void profileEnd(ProfileStage stage)
+{
+    u64 now = svcGetSystemTick();
+    if (!openedAt[stage])
+        return;
+
+    ProfileSample *sample = &ring[ringNext];
+    sample->start = openedAt[stage];
+    sample->ticks = (u32)(now - openedAt[stage]);
+    sample->stage = stage;
+    openedAt[stage] = 0;
+
+    ringNext = (ringNext + 1) % PROFILE_RING;
+    if (ringCount < PROFILE_RING)
+        ringCount++;
+}
+
+static int compareTicks(const void *a, const void *b)
+{
+    u32 x = *(const u32 *)a, y = *(const u32 *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentiles of one stage over the ring; false if it has no samples
+static bool stagePercentiles(ProfileStage stage, u32 *scratch, double *p50, double *p99)
+{
+    u32 n = 0;
+    for (u32 i = 0; i < ringCount; i++)
+    {
+        if (ring[i].stage == (u32)stage)
+            scratch[n++] = ring[i].ticks;
+    }
+    if (n == 0)
+        return false;
+
+    qsort(scratch, n, sizeof(u32), compareTicks);
+    *p50 = scratch[(n - 1) * 50 / 100] / CPU_TICKS_PER_MSEC;
+    *p99 = scratch[(n - 1) * 99 / 100] / CPU_TICKS_PER_MSEC;
+    return true;
+}
+
+// Milliseconds in 5 characters, with as many decimals as fit
+static void formatMs(char *out, size_t size, double ms)
+{
+    if (ms < 10.0)
+        snprintf(out, size, "%5.2f", ms);
+    else if (ms < 100.0)
+        snprintf(out, size, "%5.1f", ms);
+    else
+        snprintf(out, size, "%5.0f", ms);
+}
+
+static void clearHud(void)
+{
+    for (int row = HUD_ROW; row <= UI_ROWS; row++)
+        uiClearCells(row, 1, UI_COLS);
+}
+
+void profileToggleHud(void)
+{
+    hudShown = !hudShown;
+    hudFrames = 0;
+    if (!hudShown)
+        clearHud();
+}
+
+void profileDrawHud(void)
+{
+    if (!hudShown || hudFrames-- > 0)
+        return;
+    hudFrames = PROFILE_HUD_PERIOD;
+
+    static u32 scratch[PROFILE_RING];
+    for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++)
+    {
+        // "name   p50/p99", two stages per row
+        char line[32], p50Text[16], p99Text[16];
+        double p50, p99;
+        if (stagePercentiles((ProfileStage)stage, scratch, &p50, &p99))
+        {
+            formatMs(p50Text, sizeof(p50Text), p50);
+            formatMs(p99Text, sizeof(p99Text), p99);
+        }
+        else
+        {
+            strcpy(p50Text, "    -");
+            strcpy(p99Text, "-    ");
+        }
+        snprintf(line, sizeof(line), "%-7s%s/%-*s", stageNames[stage], p50Text,
+                 HUD_WIDTH - 13, p99Text);
+
+        int row = HUD_ROW + stage / HUD_COLUMNS;
+        int col = 1 + (stage % HUD_COLUMNS) * HUD_WIDTH;
+        uiDrawText(row, col, line, UI_COLOR_INACTIVE);
+    }
+}
+
+bool profileDump(const char *dir, char *path, size_t pathSize)
+{
+    snprintf(path, pathSize, "%s/profile-%llu.csv", dir, (unsigned long long)osGetTime());
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return false;
+
+    // Oldest sample first; start is relative to it (negative for a frame that began earlier)
+    u32 first = (ringCount < PROFILE_RING) ? 0 : ringNext;
+    u64 origin = ringCount ? ring[first].start : 0;
+    fprintf(f, "stage,start_us,duration_us\n");
+    for (u32 i = 0; i < ringCount; i++)
+    {
+        const ProfileSample *sample = &ring[(first + i) % PROFILE_RING];
+        fprintf(f, "%s,%.1f,%.1f\n", stageNames[sample->stage],
+                (double)(s64)(sample->start - origin) / CPU_TICKS_PER_USEC,
+                sample->ticks / CPU_TICKS_PER_USEC);
+    }
+
+    return fclose(f) == 0;
+}
+
+#endif // PROFILE
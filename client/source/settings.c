@@ -0,0 +1,51 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#include "settings.h"
+
+static bool parseBool(const char *value)
+{
+    return strcmp(value, "1") == 0 || strcasecmp(value, "true") == 0 ||
+           strcasecmp(value, "yes") == 0 || strcasecmp(value, "on") == 0;
+}
+
+// Trim leading/trailing whitespace in place
+static char *trim(char *s)
+{
+    while (*s && isspace((unsigned char)*s))
+        s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1]))
+        end--;
+    *end = '\0';
+    return s;
+}
+
+void loadSettings(Settings *settings)
+{
+    memset(settings, 0, sizeof(*settings));
+
+    FILE *f = fopen(SETTINGS_PATH, "r");
+    if (!f)
+        return;
+
+    char line[128];
+    while (fgets(line, sizeof(line), f))
+    {
+        char *eq = strchr(line, '=');
+        if (line[0] == '#' || !eq)
+            continue;
+        *eq = '\0';
+        char *key = trim(line);
+        char *value = trim(eq + 1);
+
+        if (strcmp(key, "rgb565") == 0)
+            settings->rgb565 = parseBool(value);
+        else if (strcmp(key, "blurred_backdrop") == 0)
+            settings->blurred_backdrop = parseBool(value);
+    }
+
+    fclose(f);
+}
@@ -0,0 +1,150 @@
+#include "shapes.h"
+#include <string.h>
+#include <math.h>
+
+#define MASK_AT(mask, x, y, h) ((mask)[(x) * (h) + ((h) - 1 - (y))])
+
+void shapeGradientColor(int y, int height, uint8_t *r, uint8_t *g, uint8_t *b)
+{
+    const int topB = 30, topG = 80, topR = 40;
+    // Softer/dessaturated bottom color to reduce contrast
+    const int botB = 70, botG = 200, botR = 55;
+
+    float t = (float)y / (float)(height - 1);
+    *b = (uint8_t)((1.0f - t) * topB + t * botB);
+    *g = (uint8_t)((1.0f - t) * topG + t * botG);
+    *r = (uint8_t)((1.0f - t) * topR + t * botR);
+}
+
+bool shapeInRoundedRect(int x, int y, int w, int h, int radius)
+{
+    if (x < 0 || x >= w || y < 0 || y >= h)
+        return false;
+
+    int dx, dy;
+    // Top-left corner
+    if (x < radius && y < radius)
+    {
+        dx = radius - x;
+        dy = radius - y;
+    }
+    // Top-right corner
+    else if (x >= w - radius && y < radius)
+    {
+        dx = x - (w - radius);
+        dy = radius - y;
+    }
+    // Bottom-left corner
+    else if (x < radius && y >= h - radius)
+    {
+        dx = radius - x;
+        dy = y - (h - radius);
+    }
+    // Bottom-right corner
+    else if (x >= w - radius && y >= h - radius)
+    {
+        dx = x - (w - radius);
+        dy = y - (h - radius);
+    }
+    // Not in a corner - it's in the main rectangle
+    else
+    {
+        return true;
+    }
+
+    return dx * dx + dy * dy <= radius * radius;
+}
+
+void shapeRoundedRectMask(uint8_t *mask, int w, int h, int radius)
+{
+    for (int x = 0; x < w; x++)
+        for (int y = 0; y < h; y++)
+            MASK_AT(mask, x, y, h) = shapeInRoundedRect(x, y, w, h, radius) ? 255 : 0;
+}
+
+void shapeShadowMask(uint8_t *mask, int rectW, int rectH, int radius, int blur, int maxAlpha)
+{
+    int w = rectW + 2 * blur;
+    int h = rectH + 2 * blur;
+
+    // Distance to a rounded rect: clamp to the central rectangle left after
+    // removing the corner radius, then measure to that.
+    int innerStartX = blur + radius;
+    int innerEndX = blur + rectW - radius - 1;
+    int innerStartY = blur + radius;
+    int innerEndY = blur + rectH - radius - 1;
+
+    for (int x = 0; x < w; x++)
+    {
+        int dx = 0;
+        if (x < innerStartX) dx = innerStartX - x;
+        else if (x > innerEndX) dx = x - innerEndX;
+
+        for (int y = 0; y < h; y++)
+        {
+            int dy = 0;
+            if (y < innerStartY) dy = innerStartY - y;
+            else if (y > innerEndY) dy = y - innerEndY;
+
+            float dist = sqrtf((float)(dx * dx + dy * dy));
+            int alpha = 0;
+            // Inside the rect (dist == 0) the shadow is hidden by the object
+            if (dist > 0.0f && dist < blur)
+                alpha = (int)((1.0f - (dist / (float)blur)) * maxAlpha);
+            MASK_AT(mask, x, y, h) = (alpha > 0) ? (uint8_t)alpha : 0;
+        }
+    }
+}
+
+void shapePlayMask(uint8_t *mask, int w, int h)
+{
+    memset(mask, 0, (size_t)w * h);
+
+    // Padding inside the icon on all sides
+    int pad = w / 4;
+    int padH = h / 4;
+    if (pad < 16) pad = 16;
+    if (padH < 16) padH = 16;
+
+    int Ax = pad, Ay = padH;
+    int Bx = pad, By = h - padH;
+    int Cx = w - pad, Cy = h / 2;
+
+    // Barycentric test in integers: u = nu / denom, v = nv / denom
+    int v0x = Cx - Ax, v0y = Cy - Ay;
+    int v1x = Bx - Ax, v1y = By - Ay;
+    int denom = v0x * v1y - v1x * v0y;
+    if (denom == 0)
+        return;
+    int sign = (denom < 0) ? -1 : 1;
+    denom *= sign;
+
+    for (int x = Ax; x <= Cx && x < w; x++)
+    {
+        for (int y = Ay; y <= By && y < h; y++)
+        {
+            int v2x = x - Ax, v2y = y - Ay;
+            int nu = (v2x * v1y - v1x * v2y) * sign;
+            int nv = (v0x * v2y - v2x * v0y) * sign;
+            if (nu >= 0 && nv >= 0 && nu + nv <= denom)
+                MASK_AT(mask, x, y, h) = 255;
+        }
+    }
+}
+
+void shapePauseMask(uint8_t *mask, int w, int h)
+{
+    memset(mask, 0, (size_t)w * h);
+
+    int barW = w / 5;
+    if (barW < 10) barW = 10;
+    int barH = (int)(h * 0.7f);
+    int barTop = h / 2 - barH / 2;
+    int barX[2] = { w / 3 - barW / 2, (2 * w) / 3 - barW / 2 };
+
+    for (int i = 0; i < 2; i++)
+        for (int x = barX[i]; x < barX[i] + barW; x++)
+            for (int y = barTop; y < barTop + barH; y++)
+                if (x >= 0 && x < w && y >= 0 && y < h)
+                    MASK_AT(mask, x, y, h) = 255;
+}
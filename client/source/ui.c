@@ -0,0 +1,633 @@
+#include "ui.h"
+#include "blit.h"
+#include "font.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define UI_WIDTH (UI_COLS * UI_CELL)   // 320
+#define UI_HEIGHT (UI_ROWS * UI_CELL)  // 240
+#define UI_BPP 3                       // the bottom screen stays in BGR8
+
+#define CELL_BYTES (UI_CELL * UI_CELL * UI_BPP)
+#define ATLAS_SIZE 512                 // rasterized cells kept (96 KB)
+#define ATLAS_BUCKETS 1024             // hash buckets, a power of two
+#define NO_ENTRY (-1)
+
+#define FRAME_COLOR ((UiColor){ 200, 200, 200 })
+#define FRAME_SHADOW_COLOR ((UiColor){ 100, 100, 100 })
+
+// A glyph resolved to its 1-bit bitmap: ASCII from the console font, the rest from font.bin
+typedef struct
+{
+    u32 codepoint;  // '?' when the requested one isn't available
+    const u8 *bits; // UI_CELL rows of `cells` bytes, MSB leftmost
+    int cells;      // width in cells: 1, or 2 for wide (CJK, Hangul) glyphs
+} Glyph;
+
+// One cell of a glyph rasterized in one color. Entries form a list from most
+// to least recently used; a miss takes over the entry at the tail.
+typedef struct
+{
+    u32 key;        // codepoint << 1, | 1 for the right half of a wide glyph; 0 if unused
+    UiColor color;
+    s16 prev, next; // LRU list
+    s16 chain;      // next entry in the same hash bucket
+} AtlasEntry;
+
+static AtlasEntry atlas[ATLAS_SIZE];
+static s16 buckets[ATLAS_BUCKETS];
+static s16 lruHead = NO_ENTRY, lruTail = NO_ENTRY;
+static u8 *atlasPixels = NULL; // ATLAS_SIZE cells, framebuffer order
+static UiGlyphStats glyphStats;
+static const ConsoleFont *consoleFont = NULL;
+
+// Empty frame, full screen in framebuffer order
+static u8 *frameLayer = NULL;
+static bool frameShown = false;
+
+// What each cell shows on screen; glyph 0 means the frame layer shows through,
+// raw means pixels that aren't a single glyph (part of a scrolled strip)
+typedef struct
+{
+    u32 glyph; // atlas key of the cell shown
+    bool raw;
+    UiColor color;
+} UiCell;
+
+static UiCell screenCells[UI_ROWS][UI_COLS];
+
+// Framebuffer columns written since the last flush: [x0, x1)
+static int flushX0 = UI_WIDTH, flushX1 = 0;
+
+static inline bool sameColor(UiColor a, UiColor b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+// Decode one UTF-8 sequence and advance past it; malformed input decodes as U+FFFD
+static u32 nextCodepoint(const char **text)
+{
+    const u8 *s = (const u8 *)*text;
+    u32 cp;
+    int extra;
+    if (s[0] < 0x80)
+    {
+        *text += 1;
+        return s[0];
+    }
+    else if ((s[0] & 0xe0) == 0xc0)
+    {
+        cp = s[0] & 0x1f;
+        extra = 1;
+    }
+    else if ((s[0] & 0xf0) == 0xe0)
+    {
+        cp = s[0] & 0x0f;
+        extra = 2;
+    }
+    else if ((s[0] & 0xf8) == 0xf0)
+    {
+        cp = s[0] & 0x07;
+        extra = 3;
+    }
+    else
+    {
+        *text += 1;
+        return 0xfffd;
+    }
+
+    // A truncated sequence stops at the first byte that isn't a continuation (including the NUL)
+    for (int i = 1; i <= extra; i++)
+    {
+        if ((s[i] & 0xc0) != 0x80)
+        {
+            *text += i;
+            return 0xfffd;
+        }
+        cp = (cp << 6) | (s[i] & 0x3f);
+    }
+    *text += extra + 1;
+    return cp;
+}
+
+static bool consoleGlyph(u32 codepoint, Glyph *glyph)
+{
+    if (!consoleFont)
+        return false;
+    int index = (int)codepoint - consoleFont->asciiOffset;
+    if (index < 0 || index >= consoleFont->numChars)
+        return false;
+
+    glyph->codepoint = codepoint;
+    glyph->bits = consoleFont->gfx + index * UI_CELL;
+    glyph->cells = 1;
+    return true;
+}
+
+static void resolveGlyph(u32 codepoint, Glyph *glyph)
+{
+    // The console font's upper half is CP437, not Unicode, so only ASCII comes from it
+    if (codepoint < 0x80 && consoleGlyph(codepoint, glyph))
+        return;
+
+    int cells;
+    const u8 *bits = (codepoint >= 0x80) ? fontFind(codepoint, &cells) : NULL;
+    if (bits)
+    {
+        glyph->codepoint = codepoint;
+        glyph->bits = bits;
+        glyph->cells = cells;
+        return;
+    }
+
+    if (!consoleGlyph('?', glyph))
+    {
+        glyph->codepoint = '?';
+        glyph->bits = NULL;
+        glyph->cells = 1;
+    }
+}
+
+static inline u32 bucketOf(u32 key, UiColor color)
+{
+    u32 h = key * 2654435761u ^ ((u32)color.r | (u32)color.g << 8 | (u32)color.b << 16) * 40503u;
+    return (h >> 12) & (ATLAS_BUCKETS - 1);
+}
+
+static void lruUnlink(int i)
+{
+    if (atlas[i].prev != NO_ENTRY)
+        atlas[atlas[i].prev].next = atlas[i].next;
+    else
+        lruHead = atlas[i].next;
+    if (atlas[i].next != NO_ENTRY)
+        atlas[atlas[i].next].prev = atlas[i].prev;
+    else
+        lruTail = atlas[i].prev;
+}
+
+static void lruPushFront(int i)
+{
+    atlas[i].prev = NO_ENTRY;
+    atlas[i].next = lruHead;
+    if (lruHead != NO_ENTRY)
+        atlas[lruHead].prev = i;
+    lruHead = i;
+    if (lruTail == NO_ENTRY)
+        lruTail = i;
+}
+
+static void atlasReset(void)
+{
+    for (int b = 0; b < ATLAS_BUCKETS; b++)
+        buckets[b] = NO_ENTRY;
+    lruHead = lruTail = NO_ENTRY;
+    for (int i = ATLAS_SIZE - 1; i >= 0; i--)
+    {
+        atlas[i].key = 0;
+        atlas[i].chain = NO_ENTRY;
+        lruPushFront(i);
+    }
+}
+
+// Expand half of a 1-bit glyph into an opaque cell on the panel background
+static void rasterizeCell(u8 *cell, const Glyph *glyph, int half, UiColor color)
+{
+    UiColor bg = UI_COLOR_BACKGROUND;
+    for (int cx = 0; cx < UI_CELL; cx++)
+    {
+        for (int cy = 0; cy < UI_CELL; cy++)
+        {
+            u8 *px = cell + (cx * UI_CELL + (UI_CELL - 1 - cy)) * UI_BPP;
+            bool on = glyph->bits && (glyph->bits[cy * glyph->cells + half] & (0x80 >> cx));
+            if (on)
+                blitPackPixel(px, UI_BPP, color.r, color.g, color.b, cx, cy);
+            else
+                blitPackPixel(px, UI_BPP, bg.r, bg.g, bg.b, cx, cy);
+        }
+    }
+}
+
+// Rasterized cell for half of a glyph in a color, from the atlas or rasterized into it
+static const u8 *atlasCell(const Glyph *glyph, int half, UiColor color)
+{
+    if (!atlasPixels)
+        return NULL;
+
+    u32 key = (glyph->codepoint << 1) | half;
+    u32 bucket = bucketOf(key, color);
+    for (int i = buckets[bucket]; i != NO_ENTRY; i = atlas[i].chain)
+    {
+        if (atlas[i].key == key && sameColor(atlas[i].color, color))
+        {
+            glyphStats.hits++;
+            lruUnlink(i);
+            lruPushFront(i);
+            return atlasPixels + i * CELL_BYTES;
+        }
+    }
+
+    // Miss: reuse the least recently used entry
+    glyphStats.misses++;
+    int i = lruTail;
+    if (atlas[i].key)
+    {
+        glyphStats.evictions++;
+        s16 *link = &buckets[bucketOf(atlas[i].key, atlas[i].color)];
+        while (*link != i)
+            link = &atlas[*link].chain;
+        *link = atlas[i].chain;
+    }
+
+    atlas[i].key = key;
+    atlas[i].color = color;
+    atlas[i].chain = buckets[bucket];
+    buckets[bucket] = i;
+    lruUnlink(i);
+    lruPushFront(i);
+
+    u8 *cell = atlasPixels + i * CELL_BYTES;
+    rasterizeCell(cell, glyph, half, color);
+    return cell;
+}
+
+// Draw a single ASCII character at a 1-based cell position
+static void drawChar(const BlitTarget *target, int row, int col, char ch, UiColor color)
+{
+    Glyph glyph;
+    resolveGlyph((unsigned char)ch, &glyph);
+    const u8 *cell = atlasCell(&glyph, 0, color);
+    if (cell)
+        blitTile(target, (col - 1) * UI_CELL, (row - 1) * UI_CELL, UI_CELL, UI_CELL, cell,
+                 UI_CELL * UI_BPP);
+}
+
+// The decorative frame around the now-playing panel
+static void drawFrame(const BlitTarget *target)
+{
+    UiColor bg = UI_COLOR_BACKGROUND;
+    blitFillRect(target, 0, 0, UI_WIDTH, UI_HEIGHT, bg.r, bg.g, bg.b);
+
+    int leftCol = UI_FRAME_MARGIN;
+    int rightCol = UI_COLS - UI_FRAME_MARGIN + 1;
+    int topRow = UI_FRAME_TOP;
+    int bottomRow = UI_FRAME_BOTTOM;
+    int innerWidth = rightCol - leftCol - 1;
+
+    // Top border with a centered title, bottom border with a small stamp
+    const char *title = " Spotify-3DS ";
+    const char *bottomStamp = "~ Enjoy the music ~";
+    int titleLen = (int)strlen(title);
+    int stampLen = (int)strlen(bottomStamp);
+    int titleStart = (innerWidth - titleLen) / 2;
+    int stampStart = (innerWidth - stampLen) / 2;
+    if (titleStart < 0)
+        titleStart = 0;
+    if (stampStart < 0)
+        stampStart = 0;
+
+    for (int c = leftCol; c <= rightCol; c++)
+    {
+        int pos = c - leftCol - 1; // 0-based inside
+        char top = '-', bottom = '=';
+        if (c == leftCol || c == rightCol)
+            top = bottom = '+';
+        else
+        {
+            if (pos >= titleStart && pos < titleStart + titleLen)
+                top = title[pos - titleStart];
+            if (pos >= stampStart && pos < stampStart + stampLen)
+                bottom = bottomStamp[pos - stampStart];
+        }
+        drawChar(target, topRow, c, top, FRAME_COLOR);
+        drawChar(target, bottomRow, c, bottom, FRAME_COLOR);
+    }
+
+    // Vertical sides
+    for (int r = topRow + 1; r < bottomRow; r++)
+    {
+        drawChar(target, r, leftCol, '|', FRAME_COLOR);
+        drawChar(target, r, rightCol, '|', FRAME_COLOR);
+    }
+
+    // Small corner art inside the frame
+    drawChar(target, topRow + 1, leftCol + 2, '/', FRAME_COLOR);
+    drawChar(target, topRow + 2, leftCol + 1, '/', FRAME_COLOR);
+    drawChar(target, topRow + 1, rightCol - 2, '\\', FRAME_COLOR);
+    drawChar(target, topRow + 2, rightCol - 1, '\\', FRAME_COLOR);
+    drawChar(target, bottomRow - 1, leftCol + 2, '\\', FRAME_COLOR);
+    drawChar(target, bottomRow - 2, leftCol + 1, '\\', FRAME_COLOR);
+    drawChar(target, bottomRow - 1, rightCol - 2, '/', FRAME_COLOR);
+    drawChar(target, bottomRow - 2, rightCol - 1, '/', FRAME_COLOR);
+
+    // Soft shadow along the bottom and right borders (one row/col offset)
+    for (int c = leftCol + 1; c <= rightCol + 1; c++)
+        drawChar(target, bottomRow + 1, c, (c == leftCol + 1) ? '\\' : '.', FRAME_SHADOW_COLOR);
+    for (int r = topRow + 1; r <= bottomRow + 1; r++)
+        drawChar(target, r, rightCol + 1, (r == topRow + 1) ? '\\' : '.', FRAME_SHADOW_COLOR);
+}
+
+static bool screenTarget(BlitTarget *target)
+{
+    return blitTargetForScreen(target, GFX_BOTTOM) && target->bpp == UI_BPP;
+}
+
+static void markFlush(int x0, int x1)
+{
+    if (x0 < flushX0)
+        flushX0 = x0;
+    if (x1 > flushX1)
+        flushX1 = x1;
+}
+
+// Copy cells [c0, c1) of a row back from the frame layer
+static void restoreCells(const BlitTarget *target, int row, int c0, int c1)
+{
+    int x = c0 * UI_CELL, y = (row - 1) * UI_CELL, w = (c1 - c0) * UI_CELL;
+    if (frameLayer)
+    {
+        const u8 *tile = frameLayer + (x * UI_HEIGHT + (UI_HEIGHT - y - UI_CELL)) * UI_BPP;
+        blitTile(target, x, y, w, UI_CELL, tile, UI_HEIGHT * UI_BPP);
+    }
+    else
+    {
+        UiColor bg = UI_COLOR_BACKGROUND;
+        blitFillRect(target, x, y, w, UI_CELL, bg.r, bg.g, bg.b);
+    }
+    markFlush(x, x + w);
+}
+
+bool uiInit(void)
+{
+    // Single buffered like the console, so what was drawn stays on screen
+    gfxSetScreenFormat(GFX_BOTTOM, GSP_BGR8_OES);
+    gfxSetDoubleBuffering(GFX_BOTTOM, false);
+
+    consoleFont = &consoleGetDefault()->font;
+    frameShown = false;
+    memset(screenCells, 0, sizeof(screenCells));
+
+    atlasPixels = (u8 *)malloc(ATLAS_SIZE * CELL_BYTES);
+    if (!atlasPixels)
+        return false;
+    atlasReset();
+
+    frameLayer = (u8 *)malloc(UI_WIDTH * UI_HEIGHT * UI_BPP);
+    if (!frameLayer)
+        return false;
+
+    BlitTarget layer = { frameLayer, UI_WIDTH, UI_HEIGHT, UI_BPP };
+    drawFrame(&layer);
+    return true;
+}
+
+void uiExit(void)
+{
+    free(atlasPixels);
+    atlasPixels = NULL;
+    free(frameLayer);
+    frameLayer = NULL;
+    consoleFont = NULL;
+}
+
+void uiDrawFrame(void)
+{
+    BlitTarget target;
+    if (!screenTarget(&target))
+        return;
+
+    if (frameShown)
+    {
+        for (int row = 1; row <= UI_ROWS; row++)
+            uiClearCells(row, 1, UI_COLS);
+        return;
+    }
+
+    if (frameLayer)
+        blitTile(&target, 0, 0, UI_WIDTH, UI_HEIGHT, frameLayer, UI_HEIGHT * UI_BPP);
+    else
+        drawFrame(&target);
+    memset(screenCells, 0, sizeof(screenCells));
+    markFlush(0, UI_WIDTH);
+    frameShown = true;
+}
+
+void uiClearCells(int row, int col, int count)
+{
+    BlitTarget target;
+    if (row < 1 || row > UI_ROWS || !screenTarget(&target))
+        return;
+
+    int c0 = (col < 1) ? 0 : col - 1;
+    int c1 = (col - 1 + count > UI_COLS) ? UI_COLS : col - 1 + count;
+    UiCell *cells = screenCells[row - 1];
+
+    // Restore each run of covered cells with one copy
+    for (int c = c0; c < c1;)
+    {
+        if (!cells[c].glyph && !cells[c].raw)
+        {
+            c++;
+            continue;
+        }
+        int start = c;
+        for (; c < c1 && (cells[c].glyph || cells[c].raw); c++)
+        {
+            cells[c].glyph = 0;
+            cells[c].raw = false;
+        }
+        restoreCells(&target, row, start, c);
+    }
+}
+
+void uiDrawText(int row, int col, const char *text, UiColor color)
+{
+    BlitTarget target;
+    if (!text || row < 1 || row > UI_ROWS || !consoleFont || !screenTarget(&target))
+        return;
+
+    UiCell *cells = screenCells[row - 1];
+    int c = col - 1;
+    while (*text && c < UI_COLS)
+    {
+        Glyph glyph;
+        resolveGlyph(nextCodepoint(&text), &glyph);
+        for (int half = 0; half < glyph.cells; half++, c++)
+        {
+            // Cells that already show this glyph in this color are left alone
+            u32 key = (glyph.codepoint << 1) | half;
+            if (c < 0 || c >= UI_COLS ||
+                (cells[c].glyph == key && !cells[c].raw && sameColor(cells[c].color, color)))
+                continue;
+
+            const u8 *cell = atlasCell(&glyph, half, color);
+            if (!cell)
+                return;
+            blitTile(&target, c * UI_CELL, (row - 1) * UI_CELL, UI_CELL, UI_CELL, cell,
+                     UI_CELL * UI_BPP);
+            cells[c].glyph = key;
+            cells[c].raw = false;
+            cells[c].color = color;
+            markFlush(c * UI_CELL, (c + 1) * UI_CELL);
+        }
+    }
+}
+
+int uiTextWidth(const char *text)
+{
+    int width = 0;
+    while (text && *text)
+    {
+        Glyph glyph;
+        resolveGlyph(nextCodepoint(&text), &glyph);
+        width += glyph.cells;
+    }
+    return width;
+}
+
+int uiTextFit(const char *text, int cells)
+{
+    const char *start = text, *end = text;
+    int width = 0;
+    while (text && *text)
+    {
+        Glyph glyph;
+        resolveGlyph(nextCodepoint(&text), &glyph);
+        if (width + glyph.cells > cells)
+            break;
+        width += glyph.cells;
+        end = text;
+    }
+    return (int)(end - start);
+}
+
+void uiGetGlyphStats(UiGlyphStats *stats)
+{
+    *stats = glyphStats;
+}
+
+bool uiStripBuild(UiStrip *strip, const char *text, int padCells, UiColor color)
+{
+    memset(strip, 0, sizeof(*strip));
+    if (!text || !consoleFont || !atlasPixels)
+        return false;
+
+    int cells = uiTextWidth(text) + padCells;
+    if (cells <= 0)
+        return false;
+    strip->pixels = (u8 *)malloc(cells * CELL_BYTES);
+    if (!strip->pixels)
+        return false;
+    strip->width = cells * UI_CELL;
+
+    // A strip one cell tall is just its cells side by side
+    u8 *dst = strip->pixels;
+    Glyph space;
+    resolveGlyph(' ', &space);
+    for (int i = 0; i < cells;)
+    {
+        Glyph glyph = space;
+        if (*text)
+            resolveGlyph(nextCodepoint(&text), &glyph);
+        for (int half = 0; half < glyph.cells && i < cells; half++, i++, dst += CELL_BYTES)
+            memcpy(dst, atlasCell(&glyph, half, color), CELL_BYTES);
+    }
+    return true;
+}
+
+bool uiStripFromBits(UiStrip *strip, const u8 *bits, int cells, int padCells, UiColor color)
+{
+    memset(strip, 0, sizeof(*strip));
+    if (!bits || cells <= 0 || padCells < 0)
+        return false;
+
+    strip->pixels = (u8 *)malloc((cells + padCells) * CELL_BYTES);
+    if (!strip->pixels)
+        return false;
+    strip->width = (cells + padCells) * UI_CELL;
+
+    // Same row layout as a font glyph, just wider; one-off text stays out of the atlas
+    Glyph line = { 0, bits, cells };
+    Glyph blank = { ' ', NULL, 1 };
+    for (int i = 0; i < cells + padCells; i++)
+    {
+        if (i < cells)
+            rasterizeCell(strip->pixels + i * CELL_BYTES, &line, i, color);
+        else
+            rasterizeCell(strip->pixels + i * CELL_BYTES, &blank, 0, color);
+    }
+    return true;
+}
+
+bool uiStripJoin(UiStrip *strip, const UiStrip *first, const UiStrip *second)
+{
+    memset(strip, 0, sizeof(*strip));
+    if (!first->pixels || !second->pixels)
+        return false;
+
+    // Strips are stored a pixel column at a time, so joining them is two copies
+    int column = UI_CELL * UI_BPP;
+    strip->pixels = (u8 *)malloc((first->width + second->width) * column);
+    if (!strip->pixels)
+        return false;
+    strip->width = first->width + second->width;
+    memcpy(strip->pixels, first->pixels, first->width * column);
+    memcpy(strip->pixels + first->width * column, second->pixels, second->width * column);
+    return true;
+}
+
+void uiStripFree(UiStrip *strip)
+{
+    free(strip->pixels);
+    memset(strip, 0, sizeof(*strip));
+}
+
+void uiDrawStrip(int row, int col, int cells, const UiStrip *strip, int offset)
+{
+    BlitTarget target;
+    if (!strip || !strip->pixels || row < 1 || row > UI_ROWS || !screenTarget(&target))
+        return;
+
+    int c0 = (col < 1) ? 0 : col - 1;
+    int c1 = (col - 1 + cells > UI_COLS) ? UI_COLS : col - 1 + cells;
+    if (c1 <= c0)
+        return;
+
+    // Copy the window in at most a few pieces, wrapping at the end of the strip
+    int x = (col - 1) * UI_CELL, y = (row - 1) * UI_CELL, w = cells * UI_CELL;
+    int stride = UI_CELL * UI_BPP;
+    offset %= strip->width;
+    if (offset < 0)
+        offset += strip->width;
+    while (w > 0)
+    {
+        int n = strip->width - offset;
+        if (n > w)
+            n = w;
+        blitTile(&target, x, y, n, UI_CELL, strip->pixels + offset * stride, stride);
+        x += n;
+        w -= n;
+        offset = 0;
+    }
+
+    UiCell *line = screenCells[row - 1];
+    for (int c = c0; c < c1; c++)
+    {
+        line[c].glyph = 0;
+        line[c].raw = true;
+    }
+    markFlush(c0 * UI_CELL, c1 * UI_CELL);
+}
+
+void uiPresent(void)
+{
+    BlitTarget target;
+    if (flushX1 <= flushX0 || !screenTarget(&target))
+        return;
+
+    // Columns are contiguous in memory, so the dirty columns are one range
+    GSPGPU_FlushDataCache(target.pixels + flushX0 * UI_HEIGHT * UI_BPP,
+                          (flushX1 - flushX0) * UI_HEIGHT * UI_BPP);
+    flushX0 = UI_WIDTH;
+    flushX1 = 0;
+}
@@ -0,0 +1,475 @@
+#include "widgets.h"
+#include "ui.h"
+#include <stdio.h>
+#include <string.h>
+
+#define FIELD_WIDTH (UI_COLS - 2 * UI_FRAME_MARGIN) // text area between the frame margins
+#define FIELD_COL (UI_FRAME_MARGIN + 1)             // its first column
+
+#define MARQUEE_PAD 4           // blank cells between the end of the text and its repeat
+#define MARQUEE_SPEED 30        // pixels per second; one pixel every other frame at 60 fps
+#define VOLUME_SEGMENTS 10      // one segment per 10%
+#define PROGRESS_CELLS 22       // the bar, between two 5-cell times and a space either side
+#define PROGRESS_TIME_CELLS 5
+
+// One run of same-colored text a widget draws, or a window into a strip
+typedef struct
+{
+    int row, col;
+    char text[WIDGET_TEXT_SIZE];
+    UiColor color;
+    const UiStrip *strip; // if set, draw cells cells of it from offset instead of text
+    int offset, cells;
+} WidgetItem;
+
+// len is in bytes; text is UTF-8
+static void addItem(WidgetItem *items, int *count, int row, int col, const char *text, int len,
+                    UiColor color)
+{
+    if (len <= 0 || *count >= WIDGET_MAX_SPANS)
+        return;
+    if (len >= WIDGET_TEXT_SIZE)
+        len = WIDGET_TEXT_SIZE - 1;
+
+    WidgetItem *item = &items[(*count)++];
+    item->row = row;
+    item->col = col;
+    memcpy(item->text, text, len);
+    item->text[len] = '\0';
+    item->color = color;
+    item->strip = NULL;
+    item->cells = uiTextWidth(item->text);
+}
+
+static void addStrip(WidgetItem *items, int *count, int row, int col, const UiStrip *strip,
+                     int offset, int cells)
+{
+    if (cells <= 0 || *count >= WIDGET_MAX_SPANS)
+        return;
+
+    WidgetItem *item = &items[(*count)++];
+    item->row = row;
+    item->col = col;
+    item->text[0] = '\0';
+    item->strip = strip;
+    item->offset = offset;
+    item->cells = cells;
+}
+
+// Centered text with a shadow one row down, one column right
+static void layoutLabel(const char *text, int row, WidgetItem *items, int *count)
+{
+    int width = uiTextWidth(text);
+    int x = (FIELD_WIDTH - width) / 2;
+    if (x < 0)
+        x = 0;
+    int col = FIELD_COL + x;
+
+    // Text wider than the field gets a shadow one cell shorter so it doesn't overflow
+    int shadowWidth = (width > FIELD_WIDTH) ? width - 1 : width;
+    if (shadowWidth > FIELD_WIDTH)
+        shadowWidth = FIELD_WIDTH;
+
+    addItem(items, count, row + 1, col + 1, text, uiTextFit(text, shadowWidth), UI_COLOR_SHADOW);
+    addItem(items, count, row, col, text, strlen(text), UI_COLOR_TEXT);
+}
+
+// layoutLabel for text the server rendered into the widget's strips
+static void layoutBitmapLabel(const Widget *widget, WidgetItem *items, int *count)
+{
+    int x = (FIELD_WIDTH - widget->width) / 2;
+    if (x < 0)
+        x = 0;
+    int col = FIELD_COL + x;
+
+    int shadowWidth = (widget->width > FIELD_WIDTH) ? widget->width - 1 : widget->width;
+    if (shadowWidth > FIELD_WIDTH)
+        shadowWidth = FIELD_WIDTH;
+
+    addStrip(items, count, widget->row + 1, col + 1, &widget->shadowStrip, 0, shadowWidth);
+    addStrip(items, count, widget->row, col, &widget->strip, 0, widget->width);
+}
+
+static void layoutMarquee(const Widget *widget, WidgetItem *items, int *count)
+{
+    if (widget->width < FIELD_WIDTH)
+    {
+        if (widget->bitmap)
+            layoutBitmapLabel(widget, items, count);
+        else
+            layoutLabel(widget->text, widget->row, items, count);
+        return;
+    }
+
+    // Slide a window over the pre-rendered strips; the shadow starts one cell in
+    if (widget->strip.pixels && widget->shadowStrip.pixels)
+    {
+        addStrip(items, count, widget->row + 1, FIELD_COL + 1, &widget->shadowStrip,
+                 widget->scroll, FIELD_WIDTH - 1);
+        addStrip(items, count, widget->row, FIELD_COL, &widget->strip, widget->scroll, FIELD_WIDTH);
+        return;
+    }
+
+    // No memory for the strips: show as much of the start as fits
+    const char *text = widget->text;
+    addItem(items, count, widget->row + 1, FIELD_COL + 1, text, uiTextFit(text, FIELD_WIDTH - 1),
+            UI_COLOR_SHADOW);
+    addItem(items, count, widget->row, FIELD_COL, text, uiTextFit(text, FIELD_WIDTH), UI_COLOR_TEXT);
+}
+
+static void layoutVolume(const Widget *widget, WidgetItem *items, int *count)
+{
+    if (widget->value < 0)
+    {
+        layoutLabel("Volume: N/A", widget->row, items, count);
+        return;
+    }
+
+    char percent[32];
+    snprintf(percent, sizeof(percent), "Volume: %3d%%", widget->value);
+    layoutLabel(percent, widget->row, items, count);
+
+    int filled = widget->value / 10;
+    if (filled > VOLUME_SEGMENTS)
+        filled = VOLUME_SEGMENTS;
+
+    // Segments two rows below the label, centered, with their own shadow
+    const char *bar = "##########";
+    int col = FIELD_COL + (FIELD_WIDTH - VOLUME_SEGMENTS) / 2;
+    addItem(items, count, widget->row + 3, col + 1, bar, VOLUME_SEGMENTS, UI_COLOR_SHADOW);
+    addItem(items, count, widget->row + 2, col, bar, filled, UI_COLOR_TEXT);
+    addItem(items, count, widget->row + 2, col + filled, bar, VOLUME_SEGMENTS - filled,
+            UI_COLOR_INACTIVE);
+}
+
+static void formatTime(char *text, size_t size, u32 seconds)
+{
+    snprintf(text, size, "%lu:%02lu", (unsigned long)(seconds / 60), (unsigned long)(seconds % 60));
+}
+
+static void layoutProgress(const Widget *widget, WidgetItem *items, int *count)
+{
+    if (widget->value < 0 || !widget->strip.pixels)
+        return;
+
+    char elapsed[16], total[16];
+    formatTime(elapsed, sizeof(elapsed), widget->position);
+    formatTime(total, sizeof(total), widget->duration);
+
+    // Elapsed time right-aligned against the bar, the total left-aligned after it
+    int barCol = FIELD_COL + PROGRESS_TIME_CELLS + 1;
+    int col = barCol - 1 - uiTextWidth(elapsed);
+    addItem(items, count, widget->row + 1, col + 1, elapsed, strlen(elapsed), UI_COLOR_SHADOW);
+    addItem(items, count, widget->row, col, elapsed, strlen(elapsed), UI_COLOR_TEXT);
+    col = barCol + PROGRESS_CELLS + 1;
+    addItem(items, count, widget->row + 1, col + 1, total, strlen(total), UI_COLOR_SHADOW);
+    addItem(items, count, widget->row, col, total, strlen(total), UI_COLOR_INACTIVE);
+
+    // The strip is the full bar then the empty one: a window that starts value pixels
+    // before the join shows that many filled
+    addStrip(items, count, widget->row, barCol, &widget->strip,
+             PROGRESS_CELLS * UI_CELL - widget->value, PROGRESS_CELLS);
+}
+
+static void layoutWidget(const Widget *widget, WidgetItem *items, int *count)
+{
+    *count = 0;
+    if (!widget->visible)
+        return;
+
+    switch (widget->kind)
+    {
+    case WIDGET_LABEL:
+        if (widget->bitmap)
+            layoutBitmapLabel(widget, items, count);
+        else if (widget->text[0])
+            layoutLabel(widget->text, widget->row, items, count);
+        break;
+    case WIDGET_MARQUEE:
+        if (widget->text[0])
+            layoutMarquee(widget, items, count);
+        break;
+    case WIDGET_VOLUME:
+        layoutVolume(widget, items, count);
+        break;
+    case WIDGET_PROGRESS:
+        layoutProgress(widget, items, count);
+        break;
+    case WIDGET_STATUS:
+    {
+        int x = (widget->width >= UI_COLS) ? 0 : (UI_COLS - widget->width) / 2;
+        addItem(items, count, widget->row, x + 1, widget->text, strlen(widget->text), UI_COLOR_TEXT);
+        break;
+    }
+    }
+}
+
+static bool spanCovers(const WidgetSpan *spans, int count, int row, int col)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (spans[i].row == row && col >= spans[i].c0 && col < spans[i].c1)
+            return true;
+    }
+    return false;
+}
+
+void widgetInit(Widget *widget, WidgetKind kind, int row)
+{
+    memset(widget, 0, sizeof(*widget));
+    widget->kind = kind;
+    widget->row = row;
+    widget->visible = true;
+    widget->value = -1;
+}
+
+// Copy text into a widget-sized buffer
+static void clipText(char *clipped, const char *text)
+{
+    if (!text)
+        text = "";
+    strncpy(clipped, text, WIDGET_TEXT_SIZE - 1);
+    clipped[WIDGET_TEXT_SIZE - 1] = '\0';
+
+    // Don't leave half a UTF-8 sequence at the end of truncated text
+    size_t len = strlen(clipped);
+    if (len == WIDGET_TEXT_SIZE - 1 && (text[len] & 0xc0) == 0x80)
+    {
+        while (len > 0 && (clipped[len - 1] & 0xc0) == 0x80)
+            len--;
+        if (len > 0)
+            clipped[--len] = '\0';
+    }
+}
+
+static void resetText(Widget *widget, const char *clipped)
+{
+    memcpy(widget->text, clipped, WIDGET_TEXT_SIZE);
+    widgetRelease(widget);
+    widget->bitmap = false;
+    widget->scroll = 0;
+    widget->scrollStart = 0;
+    widget->dirty = true;
+}
+
+void widgetSetText(Widget *widget, const char *text)
+{
+    char clipped[WIDGET_TEXT_SIZE];
+    clipText(clipped, text);
+    if (!widget->bitmap && strcmp(widget->text, clipped) == 0)
+        return;
+    resetText(widget, clipped);
+    widget->width = uiTextWidth(widget->text);
+
+    // A marquee renders text that doesn't fit once, then only moves a window over it
+    if (widget->kind == WIDGET_MARQUEE && widget->width >= FIELD_WIDTH &&
+        (!uiStripBuild(&widget->strip, widget->text, MARQUEE_PAD, UI_COLOR_TEXT) ||
+         !uiStripBuild(&widget->shadowStrip, widget->text, MARQUEE_PAD, UI_COLOR_SHADOW)))
+        widgetRelease(widget);
+}
+
+void widgetSetBitmap(Widget *widget, const char *text, const u8 *bits, int cells)
+{
+    char clipped[WIDGET_TEXT_SIZE];
+    clipText(clipped, text);
+    if (widget->bitmap && strcmp(widget->text, clipped) == 0)
+        return;
+    resetText(widget, clipped);
+
+    // Text that scrolls repeats after a gap, as with font-rendered strips
+    int pad = (widget->kind == WIDGET_MARQUEE && cells >= FIELD_WIDTH) ? MARQUEE_PAD : 0;
+    if (uiStripFromBits(&widget->strip, bits, cells, pad, UI_COLOR_TEXT) &&
+        uiStripFromBits(&widget->shadowStrip, bits, cells, pad, UI_COLOR_SHADOW))
+    {
+        widget->bitmap = true;
+        widget->width = cells;
+        return;
+    }
+
+    // No memory for the strips: draw the text with whatever glyphs there are
+    widgetRelease(widget);
+    widget->text[0] = '\0';
+    widgetSetText(widget, clipped);
+}
+
+void widgetRelease(Widget *widget)
+{
+    uiStripFree(&widget->strip);
+    uiStripFree(&widget->shadowStrip);
+}
+
+void widgetSetValue(Widget *widget, int value)
+{
+    if (value > 100)
+        value = 100;
+    if (value < -1)
+        value = -1;
+    if (widget->value == value)
+        return;
+
+    widget->value = value;
+    widget->dirty = true;
+}
+
+// A 4-pixel bar over a 2-pixel track, both centered in the row
+static bool buildProgressStrip(UiStrip *strip)
+{
+    u8 filled[UI_CELL * PROGRESS_CELLS] = { 0 }, empty[UI_CELL * PROGRESS_CELLS] = { 0 };
+    memset(filled + 2 * PROGRESS_CELLS, 0xff, 4 * PROGRESS_CELLS);
+    memset(empty + 3 * PROGRESS_CELLS, 0xff, 2 * PROGRESS_CELLS);
+
+    UiStrip bar = { 0 }, track = { 0 };
+    bool ok = uiStripFromBits(&bar, filled, PROGRESS_CELLS, 0, UI_COLOR_TEXT) &&
+              uiStripFromBits(&track, empty, PROGRESS_CELLS, 0, UI_COLOR_INACTIVE) &&
+              uiStripJoin(strip, &bar, &track);
+    uiStripFree(&bar);
+    uiStripFree(&track);
+    return ok;
+}
+
+void widgetSetProgress(Widget *widget, u32 positionMs, u32 durationMs)
+{
+    int pixels = -1;
+    u32 position = 0, duration = 0;
+    if (durationMs > 0 && (widget->strip.pixels || buildProgressStrip(&widget->strip)))
+    {
+        if (positionMs > durationMs)
+            positionMs = durationMs;
+        pixels = (int)((u64)positionMs * PROGRESS_CELLS * UI_CELL / durationMs);
+        position = positionMs / 1000;
+        duration = durationMs / 1000;
+    }
+    if (widget->value == pixels && widget->position == position && widget->duration == duration)
+        return;
+
+    widget->value = pixels;
+    widget->position = position;
+    widget->duration = duration;
+    widget->dirty = true;
+}
+
+void widgetSetVisible(Widget *widget, bool visible)
+{
+    if (widget->visible == visible)
+        return;
+
+    widget->visible = visible;
+    widget->dirty = true;
+}
+
+void widgetInvalidate(Widget *widget)
+{
+    widget->spanCount = 0;
+    widget->dirty = true;
+}
+
+void widgetTick(Widget *widget, u64 now)
+{
+    if (widget->kind != WIDGET_MARQUEE || !widget->visible)
+        return;
+
+    if (widget->width < FIELD_WIDTH)
+        return;
+    if (!widget->scrollStart)
+        widget->scrollStart = now;
+
+    int loop = (widget->width + MARQUEE_PAD) * UI_CELL;
+    int scroll = (int)(((now - widget->scrollStart) * MARQUEE_SPEED / 1000) % loop);
+    if (scroll != widget->scroll)
+    {
+        widget->scroll = scroll;
+        widget->dirty = true;
+    }
+}
+
+u64 widgetNextTick(const Widget *widget, u64 now)
+{
+    if (widget->kind != WIDGET_MARQUEE || !widget->visible || widget->width < FIELD_WIDTH)
+        return U64_MAX;
+    if (!widget->scrollStart || now < widget->scrollStart)
+        return now;
+
+    // First whole millisecond at which the offset reaches the next pixel
+    u64 pixel = (now - widget->scrollStart) * MARQUEE_SPEED / 1000 + 1;
+    return widget->scrollStart + (pixel * 1000 + MARQUEE_SPEED - 1) / MARQUEE_SPEED;
+}
+
+u32 widgetProgressDue(const Widget *widget, u32 positionMs, u32 durationMs)
+{
+    if (widget->kind != WIDGET_PROGRESS || !widget->visible || positionMs >= durationMs)
+        return UINT32_MAX;
+
+    // First whole millisecond at which the bar reaches its next pixel
+    u64 pixel = (u64)positionMs * PROGRESS_CELLS * UI_CELL / durationMs + 1;
+    u32 nextPixel = (pixel * durationMs + PROGRESS_CELLS * UI_CELL - 1) / (PROGRESS_CELLS * UI_CELL);
+    u32 nextSecond = 1000 - positionMs % 1000;
+    return nextPixel - positionMs < nextSecond ? nextPixel - positionMs : nextSecond;
+}
+
+void widgetDelayScroll(Widget *widget, u64 pausedMs)
+{
+    if (widget->scrollStart)
+        widget->scrollStart += pausedMs;
+}
+
+void widgetsUpdate(Widget *const *widgets, int count)
+{
+    WidgetItem items[WIDGET_MAX_SPANS];
+    int itemCount;
+
+    // Clear what each dirty widget covered and won't cover any more
+    for (int i = 0; i < count; i++)
+    {
+        Widget *widget = widgets[i];
+        if (!widget->dirty)
+            continue;
+
+        WidgetSpan spans[WIDGET_MAX_SPANS];
+        layoutWidget(widget, items, &itemCount);
+        for (int k = 0; k < itemCount; k++)
+        {
+            spans[k].row = items[k].row;
+            spans[k].c0 = items[k].col;
+            spans[k].c1 = items[k].col + items[k].cells;
+        }
+
+        for (int s = 0; s < widget->spanCount; s++)
+        {
+            const WidgetSpan *old = &widget->spans[s];
+            for (int c = old->c0; c < old->c1;)
+            {
+                if (spanCovers(spans, itemCount, old->row, c))
+                {
+                    c++;
+                    continue;
+                }
+                int start = c;
+                while (c < old->c1 && !spanCovers(spans, itemCount, old->row, c))
+                    c++;
+                uiClearCells(old->row, start, c - start);
+            }
+        }
+
+        memcpy(widget->spans, spans, itemCount * sizeof(WidgetSpan));
+        widget->spanCount = itemCount;
+    }
+
+    // Then draw; cells that already show the right glyph are skipped by ui.c
+    for (int i = 0; i < count; i++)
+    {
+        Widget *widget = widgets[i];
+        if (!widget->dirty)
+            continue;
+
+        layoutWidget(widget, items, &itemCount);
+        for (int k = 0; k < itemCount; k++)
+        {
+            const WidgetItem *item = &items[k];
+            if (item->strip)
+                uiDrawStrip(item->row, item->col, item->cells, item->strip, item->offset);
+            else
+                uiDrawText(item->row, item->col, item->text, item->color);
+        }
+        widget->dirty = false;
+    }
+}
@@ -0,0 +1,251 @@
+// Host tool: bakes the subset of one or more BDF bitmap fonts the client can
+// show into romfs/font.bin. Built and run by the Makefile with the host
+// compiler when FONT_BDF is set; see include/font.h for the file format.
+//
+// Only a subset is kept: Latin beyond ASCII, Greek, Cyrillic, punctuation,
+// Kana, fullwidth forms, and the common CJK ideographs and Hangul syllables
+// listed in font_subset.h (regenerate it with font_subset.py).
+//
+// Glyphs are placed on an 8 px tall cell with the font's baseline at its
+// ascent, so fonts designed for 8 px (misaki, for example) fit as drawn.
+// Glyphs up to 8 px wide take one cell, up to 16 px two; wider ones are
+// skipped. When several files cover a codepoint the first one wins.
+//
+// Usage: bake_font <output file> <font.bdf> [<font.bdf> ...]
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "font.h"
+#include "font_subset.h"
+
+// Unicode blocks carried whole; CJK ideographs and Hangul syllables come from
+// the common lists in font_subset.h instead
+static const struct
+{
+    uint32_t first, last;
+} ranges[] = {
+    { 0x00a0, 0x024f }, // Latin-1 Supplement, Latin Extended-A and -B
+    { 0x0370, 0x03ff }, // Greek
+    { 0x0400, 0x04ff }, // Cyrillic
+    { 0x2000, 0x206f }, // General Punctuation
+    { 0x3000, 0x30ff }, // CJK Symbols and Punctuation, Hiragana, Katakana
+    { 0x3130, 0x318f }, // Hangul Compatibility Jamo
+    { 0xff00, 0xffef }, // Halfwidth and Fullwidth Forms
+};
+
+typedef struct
+{
+    uint32_t codepoint;
+    int cells;
+    uint8_t bits[FONT_HEIGHT * 2];
+} Glyph;
+
+static Glyph *glyphs = NULL;
+static int glyphCount = 0, glyphCapacity = 0;
+static uint8_t seen[0x110000 / 8]; // codepoints already taken from an earlier file
+static int clippedRows = 0;
+
+static int compareCodepoints(const void *a, const void *b)
+{
+    uint16_t x = *(const uint16_t *)a, y = *(const uint16_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int listed(const uint16_t *list, size_t count, uint32_t cp)
+{
+    uint16_t key = (uint16_t)cp;
+    return bsearch(&key, list, count, sizeof(uint16_t), compareCodepoints) != NULL;
+}
+
+static int wanted(uint32_t cp)
+{
+    if (cp >= 0x4e00 && cp <= 0x9fff)
+        return listed(commonIdeographs, sizeof(commonIdeographs) / sizeof(uint16_t), cp);
+    if (cp >= 0xac00 && cp <= 0xd7a3)
+        return listed(commonHangul, sizeof(commonHangul) / sizeof(uint16_t), cp);
+    for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++)
+    {
+        if (cp >= ranges[i].first && cp <= ranges[i].last)
+            return 1;
+    }
+    return 0;
+}
+
+static int haveGlyph(uint32_t cp)
+{
+    return (seen[cp / 8] >> (cp % 8)) & 1;
+}
+
+static Glyph *newGlyph(void)
+{
+    if (glyphCount == glyphCapacity)
+    {
+        glyphCapacity = glyphCapacity ? glyphCapacity * 2 : 1024;
+        glyphs = (Glyph *)realloc(glyphs, glyphCapacity * sizeof(Glyph));
+        if (!glyphs)
+        {
+            fprintf(stderr, "bake_font: out of memory\n");
+            exit(1);
+        }
+    }
+    Glyph *g = &glyphs[glyphCount++];
+    memset(g, 0, sizeof(*g));
+    return g;
+}
+
+static int compareGlyphs(const void *a, const void *b)
+{
+    uint32_t x = ((const Glyph *)a)->codepoint, y = ((const Glyph *)b)->codepoint;
+    return (x > y) - (x < y);
+}
+
+// Read one BDF file, adding the wanted glyphs that aren't known yet
+static int readBdf(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+        perror(path);
+        return 0;
+    }
+
+    char line[512];
+    int ascent = -1, bboxH = 0, bboxY = 0;
+    long encoding = -1;
+    int dwidth = 0, w = 0, h = 0, xoff = 0, yoff = 0;
+    int added = 0;
+    while (fgets(line, sizeof(line), f))
+    {
+        if (sscanf(line, "FONT_ASCENT %d", &ascent) == 1)
+            continue;
+        if (sscanf(line, "FONTBOUNDINGBOX %*d %d %*d %d", &bboxH, &bboxY) == 2)
+            continue;
+        if (strncmp(line, "STARTCHAR", 9) == 0)
+        {
+            encoding = -1;
+            dwidth = w = h = xoff = yoff = 0;
+            continue;
+        }
+        if (sscanf(line, "ENCODING %ld", &encoding) == 1)
+            continue;
+        if (sscanf(line, "DWIDTH %d", &dwidth) == 1)
+            continue;
+        if (sscanf(line, "BBX %d %d %d %d", &w, &h, &xoff, &yoff) == 4)
+            continue;
+        if (strncmp(line, "BITMAP", 6) != 0)
+            continue;
+
+        // Bitmap rows follow, one hex string each, top row first
+        int keep = encoding > 0x7f && encoding < 0x110000 && wanted((uint32_t)encoding) &&
+                   !haveGlyph((uint32_t)encoding) && dwidth > 0 && dwidth <= 16;
+        Glyph *g = keep ? newGlyph() : NULL;
+        if (g)
+        {
+            g->codepoint = (uint32_t)encoding;
+            g->cells = (dwidth > 8) ? 2 : 1;
+            seen[encoding / 8] |= (uint8_t)(1 << (encoding % 8));
+        }
+
+        int base = (ascent >= 0) ? ascent : bboxH + bboxY;
+        int top = base - (yoff + h);
+        for (int row = 0; row < h && fgets(line, sizeof(line), f); row++)
+        {
+            if (!g)
+                continue;
+            unsigned long bits = strtoul(line, NULL, 16);
+            int hexBits = (int)(strcspn(line, "\r\n") * 4);
+            if (hexBits > (int)(sizeof(bits) * CHAR_BIT))
+                continue; // wider than any glyph this keeps, and than strtoul() reads
+            int y = top + row;
+            if (y < 0 || y >= FONT_HEIGHT)
+            {
+                if (bits)
+                    clippedRows++;
+                continue;
+            }
+            // A BBX wider than the row's hex digits leaves the rest of the row blank
+            for (int x = 0; x < w && x < hexBits; x++)
+            {
+                int px = xoff + x;
+                if (px < 0 || px >= g->cells * 8 || !((bits >> (hexBits - 1 - x)) & 1))
+                    continue;
+                g->bits[y * g->cells + px / 8] |= (uint8_t)(0x80 >> (px % 8));
+            }
+        }
+        if (g)
+            added++;
+    }
+
+    fclose(f);
+    printf("bake_font: %s: %d glyphs\n", path, added);
+    return 1;
+}
+
+static void put32(FILE *f, uint32_t v)
+{
+    uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+    fwrite(b, 1, 4, f);
+}
+
+static void put16(FILE *f, uint16_t v)
+{
+    uint8_t b[2] = { (uint8_t)v, (uint8_t)(v >> 8) };
+    fwrite(b, 1, 2, f);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <output file> <font.bdf> [<font.bdf> ...]\n", argv[0]);
+        return 1;
+    }
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (!readBdf(argv[i]))
+            return 1;
+    }
+    if (clippedRows)
+        fprintf(stderr, "bake_font: warning: %d glyph rows fell outside the %d px cell\n",
+                clippedRows, FONT_HEIGHT);
+    qsort(glyphs, glyphCount, sizeof(Glyph), compareGlyphs);
+
+    FILE *f = fopen(argv[1], "wb");
+    if (!f)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    put32(f, FONT_MAGIC);
+    put32(f, FONT_VERSION);
+    put32(f, (uint32_t)glyphCount);
+
+    // 12 bytes per entry: codepoint, cells, reserved, offset
+    uint32_t offset = 12 + glyphCount * 12;
+    for (int i = 0; i < glyphCount; i++)
+    {
+        put32(f, glyphs[i].codepoint);
+        put16(f, (uint16_t)glyphs[i].cells);
+        put16(f, 0);
+        put32(f, offset);
+        offset += glyphs[i].cells * FONT_HEIGHT;
+    }
+
+    for (int i = 0; i < glyphCount; i++)
+        fwrite(glyphs[i].bits, 1, glyphs[i].cells * FONT_HEIGHT, f);
+    free(glyphs);
+
+    if (fclose(f) != 0)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    printf("bake_font: %d glyphs, %u bytes\n", glyphCount, offset);
+    return 0;
+}
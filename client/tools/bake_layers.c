@@ -0,0 +1,136 @@
+// Host tool: bakes the static layers of the top screen into romfs/layers.bin.
+// Built and run by the Makefile with the host compiler; see include/layers.h
+// for the file format.
+//
+// Usage: bake_layers <output file>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "layers.h"
+#include "layout.h"
+#include "shapes.h"
+
+#define MAX_LAYERS 8
+
+typedef struct
+{
+    LayerId id;
+    int w, h;
+    uint8_t *data;
+    uint32_t size;
+} Layer;
+
+static Layer layers[MAX_LAYERS];
+static int layerCount = 0;
+
+static uint8_t *addLayer(LayerId id, int w, int h, int bpp)
+{
+    Layer *layer = &layers[layerCount++];
+    layer->id = id;
+    layer->w = w;
+    layer->h = h;
+    layer->size = (uint32_t)w * h * bpp;
+    layer->data = (uint8_t *)calloc(layer->size, 1);
+    if (!layer->data)
+    {
+        fprintf(stderr, "bake_layers: out of memory\n");
+        exit(1);
+    }
+    return layer->data;
+}
+
+static void put32(FILE *f, uint32_t v)
+{
+    uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+    fwrite(b, 1, 4, f);
+}
+
+static void put16(FILE *f, uint16_t v)
+{
+    uint8_t b[2] = { (uint8_t)v, (uint8_t)(v >> 8) };
+    fwrite(b, 1, 2, f);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s <output file>\n", argv[0]);
+        return 1;
+    }
+
+    // Background gradient, BGR8 in framebuffer order
+    uint8_t *gradient = addLayer(LAYER_GRADIENT_BGR8, TOP_WIDTH, TOP_HEIGHT, 3);
+    for (int y = 0; y < TOP_HEIGHT; y++)
+    {
+        uint8_t r, g, b;
+        shapeGradientColor(y, TOP_HEIGHT, &r, &g, &b);
+        for (int x = 0; x < TOP_WIDTH; x++)
+        {
+            uint8_t *px = gradient + (x * TOP_HEIGHT + (TOP_HEIGHT - 1 - y)) * 3;
+            px[0] = b;
+            px[1] = g;
+            px[2] = r;
+        }
+    }
+
+    // Frame and shadow for the default (square) cover
+    int imageW, imageH;
+    float scale;
+    layoutArtSize(DEFAULT_COVER_SIZE, DEFAULT_COVER_SIZE, &imageW, &imageH, &scale);
+    int frameW = imageW + 2 * ART_BORDER;
+    int frameH = imageH + 2 * ART_BORDER;
+    const int outerCornerRadius = ART_CORNER_RADIUS + ART_BORDER;
+
+    shapeRoundedRectMask(addLayer(LAYER_FRAME_MASK, frameW, frameH, 1), frameW, frameH, outerCornerRadius);
+    shapeShadowMask(addLayer(LAYER_SHADOW_MASK, frameW + 2 * SHADOW_BLUR, frameH + 2 * SHADOW_BLUR, 1),
+                    frameW, frameH, outerCornerRadius, SHADOW_BLUR, SHADOW_MAX_ALPHA);
+
+    // Overlay shapes for the default icon size
+    int iconW, iconH;
+    layoutIconSize(imageW, imageH, &iconW, &iconH);
+    shapeRoundedRectMask(addLayer(LAYER_ICON_BG_MASK, iconW, iconH, 1), iconW, iconH, ICON_CORNER_RADIUS);
+    shapePlayMask(addLayer(LAYER_PLAY_MASK, iconW, iconH, 1), iconW, iconH);
+    shapePauseMask(addLayer(LAYER_PAUSE_MASK, iconW, iconH, 1), iconW, iconH);
+
+    FILE *f = fopen(argv[1], "wb");
+    if (!f)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    put32(f, LAYERS_MAGIC);
+    put32(f, LAYERS_VERSION);
+    put32(f, (uint32_t)layerCount);
+
+    // 16 bytes per entry: id, w, h, offset, size
+    uint32_t offset = 12 + layerCount * 16;
+    for (int i = 0; i < layerCount; i++)
+    {
+        put32(f, layers[i].id);
+        put16(f, (uint16_t)layers[i].w);
+        put16(f, (uint16_t)layers[i].h);
+        put32(f, offset);
+        put32(f, layers[i].size);
+        offset += layers[i].size;
+    }
+
+    for (int i = 0; i < layerCount; i++)
+    {
+        fwrite(layers[i].data, 1, layers[i].size, f);
+        free(layers[i].data);
+    }
+
+    if (fclose(f) != 0)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    printf("bake_layers: %d layers, %u bytes (cover %dx%d, icon %dx%d)\n",
+           layerCount, offset, imageW, imageH, iconW, iconH);
+    return 0;
+}
@@ -0,0 +1,811 @@
+// Generated by font_subset.py; do not edit.
+// CJK ideographs in JIS X 0208 level 1, GB 2312 level 1 or the Big5
+// frequently used set, and the Hangul syllables in KS X 1001, sorted for
+// bsearch().
+
+#ifndef FONT_SUBSET_H
+#define FONT_SUBSET_H
+
+#include <stdint.h>
+
+static const uint16_t commonIdeographs[7174] = {
+    0x4e00, 0x4e01, 0x4e03, 0x4e07, 0x4e08, 0x4e09, 0x4e0a, 0x4e0b, 0x4e0d, 0x4e0e, 0x4e10, 0x4e11,
+    0x4e13, 0x4e14, 0x4e15, 0x4e16, 0x4e18, 0x4e19, 0x4e1a, 0x4e1b, 0x4e1c, 0x4e1d, 0x4e1e, 0x4e1f,
+    0x4e21, 0x4e22, 0x4e24, 0x4e25, 0x4e26, 0x4e27, 0x4e2a, 0x4e2b, 0x4e2d, 0x4e30, 0x4e32, 0x4e34,
+    0x4e38, 0x4e39, 0x4e3a, 0x4e3b, 0x4e3d, 0x4e3e, 0x4e43, 0x4e45, 0x4e48, 0x4e49, 0x4e4b, 0x4e4c,
+    0x4e4d, 0x4e4e, 0x4e4f, 0x4e50, 0x4e52, 0x4e53, 0x4e54, 0x4e56, 0x4e57, 0x4e58, 0x4e59, 0x4e5d,
+    0x4e5e, 0x4e5f, 0x4e60, 0x4e61, 0x4e66, 0x4e69, 0x4e70, 0x4e71, 0x4e73, 0x4e7e, 0x4e80, 0x4e82,
+    0x4e86, 0x4e88, 0x4e89, 0x4e8b, 0x4e8c, 0x4e8e, 0x4e8f, 0x4e91, 0x4e92, 0x4e94, 0x4e95, 0x4e98,
+    0x4e99, 0x4e9a, 0x4e9b, 0x4e9c, 0x4e9e, 0x4e9f, 0x4ea1, 0x4ea2, 0x4ea4, 0x4ea5, 0x4ea6, 0x4ea7,
+    0x4ea8, 0x4ea9, 0x4eab, 0x4eac, 0x4ead, 0x4eae, 0x4eb2, 0x4eb3, 0x4eba, 0x4ebf, 0x4ec0, 0x4ec1,
+    0x4ec3, 0x4ec4, 0x4ec5, 0x4ec6, 0x4ec7, 0x4eca, 0x4ecb, 0x4ecd, 0x4ece, 0x4ecf, 0x4ed1, 0x4ed3,
+    0x4ed4, 0x4ed5, 0x4ed6, 0x4ed7, 0x4ed8, 0x4ed9, 0x4ede, 0x4edf, 0x4ee3, 0x4ee4, 0x4ee5, 0x4eea,
+    0x4eec, 0x4eee, 0x4ef0, 0x4ef2, 0x4ef3, 0x4ef6, 0x4ef7, 0x4efb, 0x4efd, 0x4eff, 0x4f01, 0x4f09,
+    0x4f0a, 0x4f0b, 0x4f0d, 0x4f0e, 0x4f0f, 0x4f10, 0x4f11, 0x4f15, 0x4f17, 0x4f18, 0x4f19, 0x4f1a,
+    0x4f1d, 0x4f1e, 0x4f1f, 0x4f20, 0x4f24, 0x4f26, 0x4f2a, 0x4f2f, 0x4f30, 0x4f34, 0x4f36, 0x4f38,
+    0x4f3a, 0x4f3c, 0x4f3d, 0x4f43, 0x4f46, 0x4f47, 0x4f48, 0x4f4d, 0x4f4e, 0x4f4f, 0x4f50, 0x4f51,
+    0x4f53, 0x4f54, 0x4f55, 0x4f57, 0x4f59, 0x4f5a, 0x4f5b, 0x4f5c, 0x4f5d, 0x4f5e, 0x4f60, 0x4f63,
+    0x4f69, 0x4f6c, 0x4f6f, 0x4f70, 0x4f73, 0x4f75, 0x4f7a, 0x4f7b, 0x4f7c, 0x4f7e, 0x4f7f, 0x4f83,
+    0x4f84, 0x4f86, 0x4f88, 0x4f8b, 0x4f8d, 0x4f8f, 0x4f91, 0x4f96, 0x4f97, 0x4f9b, 0x4f9d, 0x4fa0,
+    0x4fa1, 0x4fa3, 0x4fa5, 0x4fa6, 0x4fa7, 0x4fa8, 0x4fa9, 0x4fad, 0x4fae, 0x4faf, 0x4fb5, 0x4fb6,
+    0x4fb7, 0x4fbf, 0x4fc2, 0x4fc3, 0x4fc4, 0x4fca, 0x4fce, 0x4fcf, 0x4fd0, 0x4fd1, 0x4fd7, 0x4fd8,
+    0x4fda, 0x4fdd, 0x4fde, 0x4fdf, 0x4fe0, 0x4fe1, 0x4fe3, 0x4fe9, 0x4fed, 0x4fee, 0x4fef, 0x4ff1,
+    0x4ff3, 0x4ff5, 0x4ff8, 0x4ffa, 0x4ffe, 0x5000, 0x5006, 0x5009, 0x500b, 0x500c, 0x500d, 0x500f,
+    0x5011, 0x5012, 0x5014, 0x5016, 0x5018, 0x5019, 0x501a, 0x501f, 0x5021, 0x5023, 0x5024, 0x5025,
+    0x5026, 0x5028, 0x5029, 0x502a, 0x502b, 0x502d, 0x5036, 0x5039, 0x503a, 0x503c, 0x503e, 0x5043,
+    0x5047, 0x5049, 0x504c, 0x504e, 0x504f, 0x5055, 0x505a, 0x505c, 0x5065, 0x506d, 0x506f, 0x5072,
+    0x5074, 0x5075, 0x5076, 0x5077, 0x507a, 0x507d, 0x507f, 0x5080, 0x5085, 0x5088, 0x508d, 0x5091,
+    0x5096, 0x5098, 0x5099, 0x509a, 0x50a2, 0x50a3, 0x50a8, 0x50ac, 0x50ad, 0x50af, 0x50b2, 0x50b3,
+    0x50b5, 0x50b7, 0x50bb, 0x50be, 0x50c5, 0x50c7, 0x50cd, 0x50ce, 0x50cf, 0x50d1, 0x50d5, 0x50d6,
+    0x50da, 0x50e5, 0x50e7, 0x50e9, 0x50ed, 0x50ee, 0x50f1, 0x50f3, 0x50f5, 0x50f9, 0x50fb, 0x5100,
+    0x5102, 0x5104, 0x5105, 0x5108, 0x5109, 0x5110, 0x5112, 0x5114, 0x5115, 0x5118, 0x511f, 0x5121,
+    0x512a, 0x5132, 0x5133, 0x5137, 0x5138, 0x513b, 0x513c, 0x513f, 0x5140, 0x5141, 0x5143, 0x5144,
+    0x5145, 0x5146, 0x5147, 0x5148, 0x5149, 0x514b, 0x514c, 0x514d, 0x514e, 0x5150, 0x5151, 0x5152,
+    0x5154, 0x5155, 0x5157, 0x515a, 0x515c, 0x5162, 0x5165, 0x5167, 0x5168, 0x5169, 0x516b, 0x516c,
+    0x516d, 0x516e, 0x5170, 0x5171, 0x5173, 0x5174, 0x5175, 0x5176, 0x5177, 0x5178, 0x5179, 0x517b,
+    0x517c, 0x517d, 0x5180, 0x5185, 0x5186, 0x5188, 0x5189, 0x518a, 0x518c, 0x518d, 0x5191, 0x5192,
+    0x5195, 0x5197, 0x5199, 0x519b, 0x519c, 0x51a0, 0x51a2, 0x51a4, 0x51a5, 0x51a8, 0x51aa, 0x51ac,
+    0x51af, 0x51b0, 0x51b2, 0x51b3, 0x51b4, 0x51b5, 0x51b6, 0x51b7, 0x51bb, 0x51bd, 0x51c0, 0x51c4,
+    0x51c6, 0x51c9, 0x51cb, 0x51cc, 0x51cd, 0x51cf, 0x51d1, 0x51db, 0x51dc, 0x51dd, 0x51e0, 0x51e1,
+    0x51e4, 0x51e6, 0x51e7, 0x51ea, 0x51ed, 0x51ef, 0x51f0, 0x51f1, 0x51f3, 0x51f6, 0x51f8, 0x51f9,
+    0x51fa, 0x51fb, 0x51fd, 0x51ff, 0x5200, 0x5201, 0x5203, 0x5206, 0x5207, 0x5208, 0x520a, 0x520e,
+    0x5211, 0x5212, 0x5216, 0x5217, 0x5218, 0x5219, 0x521a, 0x521b, 0x521d, 0x5220, 0x5224, 0x5225,
+    0x5228, 0x5229, 0x522a, 0x522b, 0x522e, 0x5230, 0x5236, 0x5237, 0x5238, 0x5239, 0x523a, 0x523b,
+    0x523d, 0x5241, 0x5242, 0x5243, 0x5247, 0x524a, 0x524b, 0x524c, 0x524d, 0x524e, 0x5250, 0x5251,
+    0x5254, 0x5256, 0x525b, 0x525c, 0x525d, 0x5263, 0x5264, 0x5265, 0x5267, 0x5269, 0x526a, 0x526f,
+    0x5270, 0x5272, 0x5274, 0x5275, 0x5277, 0x527d, 0x527f, 0x5282, 0x5283, 0x5287, 0x5288, 0x5289,
+    0x528a, 0x528d, 0x5291, 0x5293, 0x529b, 0x529d, 0x529e, 0x529f, 0x52a0, 0x52a1, 0x52a3, 0x52a8,
+    0x52a9, 0x52aa, 0x52ab, 0x52ac, 0x52b1, 0x52b2, 0x52b3, 0x52b4, 0x52b9, 0x52bb, 0x52be, 0x52bf,
+    0x52c1, 0x52c3, 0x52c5, 0x52c7, 0x52c9, 0x52cb, 0x52d2, 0x52d5, 0x52d7, 0x52d8, 0x52d9, 0x52db,
+    0x52dd, 0x52de, 0x52df, 0x52e2, 0x52e3, 0x52e4, 0x52e6, 0x52e7, 0x52f0, 0x52f2, 0x52f3, 0x52f5,
+    0x52f8, 0x52fa, 0x52fb, 0x52fe, 0x52ff, 0x5300, 0x5301, 0x5302, 0x5305, 0x5306, 0x5308, 0x530d,
+    0x530f, 0x5310, 0x5315, 0x5316, 0x5317, 0x5319, 0x531d, 0x5320, 0x5321, 0x5323, 0x532a, 0x532f,
+    0x5331, 0x5339, 0x533a, 0x533b, 0x533e, 0x533f, 0x5340, 0x5341, 0x5343, 0x5345, 0x5347, 0x5348,
+    0x5349, 0x534a, 0x534e, 0x534f, 0x5351, 0x5352, 0x5353, 0x5354, 0x5355, 0x5356, 0x5357, 0x5358,
+    0x535a, 0x535c, 0x535e, 0x5360, 0x5361, 0x5362, 0x5364, 0x5366, 0x5367, 0x536b, 0x536e, 0x536f,
+    0x5370, 0x5371, 0x5373, 0x5374, 0x5375, 0x5377, 0x5378, 0x5379, 0x537b, 0x537f, 0x5382, 0x5384,
+    0x5385, 0x5386, 0x5389, 0x538b, 0x538c, 0x5395, 0x5398, 0x539a, 0x539d, 0x539f, 0x53a2, 0x53a5,
+    0x53a6, 0x53a8, 0x53a9, 0x53ad, 0x53b2, 0x53b3, 0x53bb, 0x53bf, 0x53c1, 0x53c2, 0x53c3, 0x53c8,
+    0x53c9, 0x53ca, 0x53cb, 0x53cc, 0x53cd, 0x53ce, 0x53d1, 0x53d4, 0x53d6, 0x53d7, 0x53d8, 0x53d9,
+    0x53db, 0x53df, 0x53e0, 0x53e1, 0x53e2, 0x53e3, 0x53e4, 0x53e5, 0x53e6, 0x53e8, 0x53e9, 0x53ea,
+    0x53eb, 0x53ec, 0x53ed, 0x53ee, 0x53ef, 0x53f0, 0x53f1, 0x53f2, 0x53f3, 0x53f5, 0x53f6, 0x53f7,
+    0x53f8, 0x53f9, 0x53fb, 0x53fc, 0x5401, 0x5403, 0x5404, 0x5406, 0x5408, 0x5409, 0x540a, 0x540b,
+    0x540c, 0x540d, 0x540e, 0x540f, 0x5410, 0x5411, 0x5412, 0x5413, 0x5415, 0x5417, 0x541b, 0x541d,
+    0x541e, 0x541f, 0x5420, 0x5426, 0x5427, 0x5428, 0x5429, 0x542b, 0x542c, 0x542d, 0x542e, 0x542f,
+    0x5431, 0x5433, 0x5434, 0x5435, 0x5436, 0x5438, 0x5439, 0x543b, 0x543c, 0x543e, 0x5440, 0x5442,
+    0x5443, 0x5446, 0x5448, 0x5449, 0x544a, 0x544e, 0x5450, 0x5451, 0x5455, 0x5458, 0x545b, 0x545c,
+    0x5462, 0x5468, 0x546a, 0x5471, 0x5473, 0x5475, 0x5476, 0x5477, 0x5478, 0x547b, 0x547c, 0x547d,
+    0x5480, 0x5484, 0x5486, 0x548b, 0x548c, 0x548e, 0x548f, 0x5490, 0x5492, 0x5495, 0x5496, 0x5499,
+    0x549a, 0x54a6, 0x54a7, 0x54a8, 0x54a9, 0x54aa, 0x54ab, 0x54ac, 0x54af, 0x54b1, 0x54b2, 0x54b3,
+    0x54b8, 0x54bb, 0x54bd, 0x54bf, 0x54c0, 0x54c1, 0x54c2, 0x54c4, 0x54c6, 0x54c7, 0x54c8, 0x54c9,
+    0x54cd, 0x54ce, 0x54d1, 0x54d7, 0x54df, 0x54e1, 0x54e5, 0x54e6, 0x54e8, 0x54e9, 0x54ea, 0x54ed,
+    0x54ee, 0x54f2, 0x54fa, 0x54fc, 0x54fd, 0x5501, 0x5504, 0x5506, 0x5507, 0x5509, 0x550f, 0x5510,
+    0x5514, 0x5516, 0x5524, 0x5527, 0x552c, 0x552e, 0x552f, 0x5531, 0x5533, 0x5537, 0x5538, 0x553e,
+    0x5541, 0x5543, 0x5544, 0x5546, 0x554a, 0x554f, 0x5553, 0x5555, 0x5556, 0x5557, 0x555c, 0x555e,
+    0x555f, 0x5561, 0x5563, 0x5564, 0x5565, 0x5566, 0x556a, 0x556e, 0x5578, 0x557b, 0x557c, 0x557e,
+    0x5580, 0x5582, 0x5583, 0x5584, 0x5587, 0x5589, 0x558a, 0x558b, 0x5594, 0x5598, 0x5599, 0x559a,
+    0x559c, 0x559d, 0x559f, 0x55a7, 0x55aa, 0x55ab, 0x55ac, 0x55ae, 0x55b0, 0x55b1, 0x55b2, 0x55b3,
+    0x55b6, 0x55b7, 0x55bb, 0x55c5, 0x55c6, 0x55c7, 0x55c9, 0x55ce, 0x55d1, 0x55d3, 0x55da, 0x55dc,
+    0x55df, 0x55e1, 0x55e3, 0x55e4, 0x55e5, 0x55e6, 0x55e8, 0x55ef, 0x55f6, 0x55f7, 0x55fd, 0x55fe,
+    0x5600, 0x5606, 0x5608, 0x5609, 0x560d, 0x560e, 0x5610, 0x5614, 0x5616, 0x5617, 0x5618, 0x561b,
+    0x561f, 0x5629, 0x562e, 0x562f, 0x5630, 0x5631, 0x5632, 0x5634, 0x5636, 0x5639, 0x563b, 0x563f,
+    0x5642, 0x564c, 0x564e, 0x5653, 0x5657, 0x5659, 0x565b, 0x5662, 0x5664, 0x5665, 0x5668, 0x5669,
+    0x566a, 0x566b, 0x566c, 0x566f, 0x5671, 0x5674, 0x5676, 0x5678, 0x5679, 0x567a, 0x5680, 0x5685,
+    0x5687, 0x568e, 0x568f, 0x5690, 0x5695, 0x56a2, 0x56a3, 0x56a5, 0x56a8, 0x56ae, 0x56b4, 0x56b6,
+    0x56b7, 0x56bc, 0x56c0, 0x56c1, 0x56c2, 0x56c8, 0x56c9, 0x56ca, 0x56cc, 0x56d1, 0x56da, 0x56db,
+    0x56dd, 0x56de, 0x56e0, 0x56e2, 0x56e3, 0x56e4, 0x56ea, 0x56eb, 0x56ed, 0x56f0, 0x56f1, 0x56f2,
+    0x56f3, 0x56f4, 0x56fa, 0x56fd, 0x56fe, 0x56ff, 0x5703, 0x5704, 0x5706, 0x5708, 0x5709, 0x570b,
+    0x570d, 0x570f, 0x5712, 0x5713, 0x5716, 0x5718, 0x571f, 0x5723, 0x5727, 0x5728, 0x5729, 0x572c,
+    0x572d, 0x572f, 0x5730, 0x5733, 0x573a, 0x573b, 0x573e, 0x5740, 0x5742, 0x5747, 0x574a, 0x574d,
+    0x574e, 0x574f, 0x5750, 0x5751, 0x5757, 0x575a, 0x575b, 0x575d, 0x575e, 0x575f, 0x5760, 0x5761,
+    0x5764, 0x5766, 0x5769, 0x576a, 0x576f, 0x5777, 0x577c, 0x5782, 0x5783, 0x5784, 0x578b, 0x5792,
+    0x5793, 0x579b, 0x57a0, 0x57a2, 0x57a3, 0x57a6, 0x57ab, 0x57ae, 0x57c2, 0x57c3, 0x57cb, 0x57ce,
+    0x57d4, 0x57dc, 0x57df, 0x57e0, 0x57e4, 0x57f4, 0x57f7, 0x57f9, 0x57fa, 0x57fc, 0x5800, 0x5802,
+    0x5805, 0x5806, 0x5809, 0x580a, 0x5811, 0x5815, 0x581d, 0x5820, 0x5821, 0x5824, 0x582a, 0x582f,
+    0x5830, 0x5831, 0x5834, 0x5835, 0x583a, 0x5840, 0x5841, 0x584a, 0x584b, 0x584c, 0x5851, 0x5852,
+    0x5854, 0x5857, 0x5858, 0x5859, 0x585a, 0x585e, 0x5862, 0x5869, 0x586b, 0x586d, 0x5875, 0x5879,
+    0x587d, 0x587e, 0x5880, 0x5883, 0x5885, 0x588a, 0x5892, 0x5893, 0x5897, 0x5899, 0x589c, 0x589e,
+    0x589f, 0x58a6, 0x58a8, 0x58a9, 0x58ae, 0x58b3, 0x58be, 0x58c1, 0x58c5, 0x58c7, 0x58ca, 0x58cc,
+    0x58ce, 0x58d1, 0x58d3, 0x58d5, 0x58d8, 0x58d9, 0x58de, 0x58df, 0x58e2, 0x58e4, 0x58e9, 0x58eb,
+    0x58ec, 0x58ee, 0x58ef, 0x58f0, 0x58f1, 0x58f2, 0x58f3, 0x58f6, 0x58f7, 0x58f9, 0x58fa, 0x58fd,
+    0x5904, 0x5907, 0x5909, 0x590d, 0x590f, 0x5914, 0x5915, 0x5916, 0x5919, 0x591a, 0x591c, 0x591f,
+    0x5920, 0x5922, 0x5924, 0x5925, 0x5927, 0x5929, 0x592a, 0x592b, 0x592d, 0x592e, 0x592f, 0x5931,
+    0x5934, 0x5937, 0x5938, 0x5939, 0x593a, 0x593e, 0x5944, 0x5947, 0x5948, 0x5949, 0x594b, 0x594e,
+    0x594f, 0x5950, 0x5951, 0x5954, 0x5955, 0x5956, 0x5957, 0x5958, 0x595a, 0x5960, 0x5962, 0x5965,
+    0x5967, 0x5968, 0x5969, 0x596a, 0x596d, 0x596e, 0x5973, 0x5974, 0x5976, 0x5978, 0x5979, 0x597d,
+    0x5981, 0x5982, 0x5983, 0x5984, 0x5986, 0x5987, 0x5988, 0x598a, 0x598d, 0x5992, 0x5993, 0x5996,
+    0x5999, 0x599d, 0x599e, 0x59a3, 0x59a4, 0x59a5, 0x59a8, 0x59ac, 0x59ae, 0x59af, 0x59b3, 0x59b9,
+    0x59bb, 0x59be, 0x59c5, 0x59c6, 0x59c9, 0x59ca, 0x59cb, 0x59cd, 0x59d0, 0x59d1, 0x59d2, 0x59d3,
+    0x59d4, 0x59d8, 0x59da, 0x59dc, 0x59e3, 0x59e5, 0x59e6, 0x59e8, 0x59ea, 0x59eb, 0x59ec, 0x59f6,
+    0x59fb, 0x59ff, 0x5a01, 0x5a03, 0x5a04, 0x5a07, 0x5a09, 0x5a0c, 0x5a11, 0x5a13, 0x5a18, 0x5a1b,
+    0x5a1c, 0x5a1f, 0x5a20, 0x5a23, 0x5a25, 0x5a29, 0x5a2f, 0x5a31, 0x5a36, 0x5a3c, 0x5a40, 0x5a41,
+    0x5a46, 0x5a49, 0x5a4a, 0x5a5a, 0x5a62, 0x5a66, 0x5a6a, 0x5a74, 0x5a76, 0x5a77, 0x5a7f, 0x5a92,
+    0x5a9a, 0x5a9b, 0x5aa7, 0x5ab2, 0x5ab3, 0x5abc, 0x5abd, 0x5abe, 0x5ac1, 0x5ac2, 0x5ac9, 0x5acc,
+    0x5ad6, 0x5ad7, 0x5ad8, 0x5ae1, 0x5ae3, 0x5ae6, 0x5ae9, 0x5af5, 0x5afb, 0x5b08, 0x5b09, 0x5b0b,
+    0x5b0c, 0x5b1d, 0x5b22, 0x5b24, 0x5b2a, 0x5b2c, 0x5b30, 0x5b34, 0x5b38, 0x5b40, 0x5b43, 0x5b50,
+    0x5b51, 0x5b53, 0x5b54, 0x5b55, 0x5b57, 0x5b58, 0x5b59, 0x5b5a, 0x5b5b, 0x5b5c, 0x5b5d, 0x5b5f,
+    0x5b63, 0x5b64, 0x5b66, 0x5b69, 0x5b6a, 0x5b6b, 0x5b70, 0x5b71, 0x5b73, 0x5b75, 0x5b78, 0x5b7a,
+    0x5b7d, 0x5b7f, 0x5b81, 0x5b83, 0x5b85, 0x5b87, 0x5b88, 0x5b89, 0x5b8b, 0x5b8c, 0x5b8d, 0x5b8f,
+    0x5b95, 0x5b97, 0x5b98, 0x5b99, 0x5b9a, 0x5b9b, 0x5b9c, 0x5b9d, 0x5b9e, 0x5b9f, 0x5ba0, 0x5ba1,
+    0x5ba2, 0x5ba3, 0x5ba4, 0x5ba5, 0x5ba6, 0x5baa, 0x5bab, 0x5bae, 0x5bb0, 0x5bb3, 0x5bb4, 0x5bb5,
+    0x5bb6, 0x5bb8, 0x5bb9, 0x5bbd, 0x5bbe, 0x5bbf, 0x5bc2, 0x5bc4, 0x5bc5, 0x5bc6, 0x5bc7, 0x5bcc,
+    0x5bd0, 0x5bd2, 0x5bd3, 0x5bdb, 0x5bdd, 0x5bde, 0x5bdf, 0x5be1, 0x5be2, 0x5be4, 0x5be5, 0x5be6,
+    0x5be7, 0x5be8, 0x5be9, 0x5beb, 0x5bec, 0x5bee, 0x5bf0, 0x5bf5, 0x5bf6, 0x5bf8, 0x5bf9, 0x5bfa,
+    0x5bfb, 0x5bfc, 0x5bfe, 0x5bff, 0x5c01, 0x5c02, 0x5c04, 0x5c06, 0x5c07, 0x5c08, 0x5c09, 0x5c0a,
+    0x5c0b, 0x5c0d, 0x5c0e, 0x5c0f, 0x5c11, 0x5c14, 0x5c16, 0x5c18, 0x5c1a, 0x5c1d, 0x5c22, 0x5c24,
+    0x5c27, 0x5c2c, 0x5c2d, 0x5c31, 0x5c37, 0x5c38, 0x5c39, 0x5c3a, 0x5c3b, 0x5c3c, 0x5c3d, 0x5c3e,
+    0x5c3f, 0x5c40, 0x5c41, 0x5c42, 0x5c45, 0x5c46, 0x5c48, 0x5c49, 0x5c4a, 0x5c4b, 0x5c4d, 0x5c4e,
+    0x5c4f, 0x5c50, 0x5c51, 0x5c55, 0x5c58, 0x5c5c, 0x5c5d, 0x5c5e, 0x5c60, 0x5c61, 0x5c62, 0x5c64,
+    0x5c65, 0x5c68, 0x5c6c, 0x5c6f, 0x5c71, 0x5c79, 0x5c7f, 0x5c81, 0x5c82, 0x5c8c, 0x5c90, 0x5c91,
+    0x5c94, 0x5c97, 0x5c9b, 0x5ca1, 0x5ca8, 0x5ca9, 0x5cab, 0x5cac, 0x5cad, 0x5cb1, 0x5cb3, 0x5cb7,
+    0x5cb8, 0x5cbf, 0x5cd2, 0x5cd9, 0x5ce0, 0x5ce1, 0x5ce6, 0x5ce8, 0x5cea, 0x5ced, 0x5cef, 0x5cf0,
+    0x5cf4, 0x5cf6, 0x5cfb, 0x5cfd, 0x5d01, 0x5d06, 0x5d07, 0x5d0e, 0x5d11, 0x5d14, 0x5d16, 0x5d17,
+    0x5d19, 0x5d1b, 0x5d22, 0x5d24, 0x5d27, 0x5d29, 0x5d2d, 0x5d34, 0x5d47, 0x5d4c, 0x5d50, 0x5d69,
+    0x5d6f, 0x5d84, 0x5d87, 0x5d8b, 0x5d94, 0x5d9d, 0x5db8, 0x5dba, 0x5dbc, 0x5dbd, 0x5dc9, 0x5dcc,
+    0x5dcd, 0x5dd2, 0x5dd4, 0x5dd6, 0x5ddd, 0x5dde, 0x5de1, 0x5de2, 0x5de3, 0x5de5, 0x5de6, 0x5de7,
+    0x5de8, 0x5de9, 0x5deb, 0x5dee, 0x5df1, 0x5df2, 0x5df3, 0x5df4, 0x5df7, 0x5dfb, 0x5dfd, 0x5dfe,
+    0x5e01, 0x5e02, 0x5e03, 0x5e05, 0x5e06, 0x5e08, 0x5e0c, 0x5e10, 0x5e11, 0x5e15, 0x5e16, 0x5e18,
+    0x5e1a, 0x5e1b, 0x5e1c, 0x5e1d, 0x5e1f, 0x5e25, 0x5e26, 0x5e27, 0x5e2b, 0x5e2d, 0x5e2e, 0x5e2f,
+    0x5e30, 0x5e33, 0x5e36, 0x5e37, 0x5e38, 0x5e3d, 0x5e40, 0x5e42, 0x5e43, 0x5e45, 0x5e4c, 0x5e54,
+    0x5e55, 0x5e57, 0x5e5b, 0x5e5f, 0x5e61, 0x5e62, 0x5e63, 0x5e6b, 0x5e72, 0x5e73, 0x5e74, 0x5e76,
+    0x5e78, 0x5e79, 0x5e7b, 0x5e7c, 0x5e7d, 0x5e7e, 0x5e7f, 0x5e81, 0x5e83, 0x5e84, 0x5e86, 0x5e87,
+    0x5e8a, 0x5e8f, 0x5e90, 0x5e93, 0x5e94, 0x5e95, 0x5e96, 0x5e97, 0x5e99, 0x5e9a, 0x5e9c, 0x5e9e,
+    0x5e9f, 0x5ea0, 0x5ea6, 0x5ea7, 0x5eab, 0x5ead, 0x5eb5, 0x5eb6, 0x5eb7, 0x5eb8, 0x5ebe, 0x5ec1,
+    0x5ec2, 0x5ec3, 0x5ec4, 0x5ec8, 0x5ec9, 0x5eca, 0x5ed3, 0x5ed6, 0x5eda, 0x5edd, 0x5edf, 0x5ee0,
+    0x5ee2, 0x5ee3, 0x5eec, 0x5ef3, 0x5ef6, 0x5ef7, 0x5efa, 0x5efb, 0x5efc, 0x5efe, 0x5eff, 0x5f00,
+    0x5f01, 0x5f02, 0x5f03, 0x5f04, 0x5f08, 0x5f0a, 0x5f0b, 0x5f0f, 0x5f10, 0x5f12, 0x5f13, 0x5f14,
+    0x5f15, 0x5f17, 0x5f18, 0x5f1b, 0x5f1f, 0x5f20, 0x5f25, 0x5f26, 0x5f27, 0x5f29, 0x5f2d, 0x5f2f,
+    0x5f31, 0x5f35, 0x5f37, 0x5f39, 0x5f3a, 0x5f3c, 0x5f3e, 0x5f46, 0x5f48, 0x5f4a, 0x5f4c, 0x5f4e,
+    0x5f52, 0x5f53, 0x5f55, 0x5f57, 0x5f59, 0x5f5d, 0x5f62, 0x5f64, 0x5f65, 0x5f66, 0x5f69, 0x5f6a,
+    0x5f6b, 0x5f6c, 0x5f6d, 0x5f70, 0x5f71, 0x5f77, 0x5f79, 0x5f7b, 0x5f7c, 0x5f7f, 0x5f80, 0x5f81,
+    0x5f84, 0x5f85, 0x5f87, 0x5f88, 0x5f89, 0x5f8a, 0x5f8b, 0x5f8c, 0x5f90, 0x5f91, 0x5f92, 0x5f93,
+    0x5f97, 0x5f98, 0x5f99, 0x5f9c, 0x5f9e, 0x5fa0, 0x5fa1, 0x5fa8, 0x5fa9, 0x5faa, 0x5fac, 0x5fae,
+    0x5fb3, 0x5fb4, 0x5fb5, 0x5fb7, 0x5fb9, 0x5fbd, 0x5fc3, 0x5fc5, 0x5fc6, 0x5fcc, 0x5fcd, 0x5fd6,
+    0x5fd7, 0x5fd8, 0x5fd9, 0x5fdc, 0x5fdd, 0x5fe0, 0x5fe7, 0x5fea, 0x5feb, 0x5ff1, 0x5ff5, 0x5ff8,
+    0x5ffb, 0x5ffd, 0x5fff, 0x6000, 0x6001, 0x6002, 0x600e, 0x600f, 0x6012, 0x6014, 0x6015, 0x6016,
+    0x601b, 0x601c, 0x601d, 0x6020, 0x6021, 0x6025, 0x6027, 0x6028, 0x6029, 0x602a, 0x602b, 0x602f,
+    0x6035, 0x603b, 0x6043, 0x6046, 0x604b, 0x604d, 0x6050, 0x6052, 0x6055, 0x6059, 0x6062, 0x6063,
+    0x6064, 0x6065, 0x6068, 0x6069, 0x606a, 0x606b, 0x606c, 0x606d, 0x606f, 0x6070, 0x6073, 0x6075,
+    0x6076, 0x607c, 0x607f, 0x6084, 0x6085, 0x6089, 0x608c, 0x608d, 0x6094, 0x6096, 0x609a, 0x609f,
+    0x60a0, 0x60a3, 0x60a6, 0x60a8, 0x60a9, 0x60aa, 0x60ac, 0x60af, 0x60b2, 0x60b4, 0x60b5, 0x60b6,
+    0x60b8, 0x60bb, 0x60bc, 0x60bd, 0x60c5, 0x60c6, 0x60c7, 0x60ca, 0x60cb, 0x60d1, 0x60d5, 0x60d8,
+    0x60da, 0x60dc, 0x60df, 0x60e0, 0x60e1, 0x60e3, 0x60e6, 0x60e7, 0x60e8, 0x60e9, 0x60eb, 0x60ed,
+    0x60ee, 0x60ef, 0x60f0, 0x60f1, 0x60f3, 0x60f4, 0x60f6, 0x60f9, 0x60fa, 0x60fb, 0x6100, 0x6101,
+    0x6106, 0x6108, 0x6109, 0x610d, 0x610e, 0x610f, 0x6112, 0x6115, 0x611a, 0x611b, 0x611c, 0x611f,
+    0x6123, 0x6124, 0x6127, 0x6134, 0x6137, 0x613e, 0x613f, 0x6144, 0x6147, 0x6148, 0x614b, 0x614c,
+    0x614d, 0x614e, 0x6151, 0x6155, 0x6158, 0x615a, 0x615d, 0x615f, 0x6162, 0x6163, 0x6167, 0x6168,
+    0x616b, 0x616e, 0x6170, 0x6175, 0x6176, 0x6177, 0x617c, 0x617e, 0x6182, 0x618a, 0x618b, 0x618e,
+    0x6190, 0x6191, 0x6194, 0x619a, 0x61a4, 0x61a7, 0x61a8, 0x61a9, 0x61ab, 0x61ac, 0x61ae, 0x61b2,
+    0x61b6, 0x61be, 0x61c2, 0x61c7, 0x61c8, 0x61c9, 0x61ca, 0x61cb, 0x61cd, 0x61d0, 0x61d2, 0x61e3,
+    0x61e6, 0x61f2, 0x61f5, 0x61f6, 0x61f7, 0x61f8, 0x61fa, 0x61fc, 0x61fe, 0x61ff, 0x6200, 0x6208,
+    0x620a, 0x620c, 0x620d, 0x620e, 0x620f, 0x6210, 0x6211, 0x6212, 0x6215, 0x6216, 0x6218, 0x621a,
+    0x621b, 0x621f, 0x6221, 0x6222, 0x6226, 0x622a, 0x622e, 0x622f, 0x6230, 0x6232, 0x6233, 0x6234,
+    0x6236, 0x6237, 0x6238, 0x623b, 0x623e, 0x623f, 0x6240, 0x6241, 0x6247, 0x6248, 0x6249, 0x624b,
+    0x624d, 0x624e, 0x6251, 0x6252, 0x6253, 0x6254, 0x6255, 0x6258, 0x625b, 0x6263, 0x6266, 0x6267,
+    0x6269, 0x626b, 0x626c, 0x626d, 0x626e, 0x626f, 0x6270, 0x6271, 0x6273, 0x6276, 0x6279, 0x627c,
+    0x627e, 0x627f, 0x6280, 0x6284, 0x6286, 0x6289, 0x628a, 0x6291, 0x6292, 0x6293, 0x6295, 0x6296,
+    0x6297, 0x6298, 0x629a, 0x629b, 0x629c, 0x629e, 0x62a0, 0x62a1, 0x62a2, 0x62a4, 0x62a5, 0x62a8,
+    0x62ab, 0x62ac, 0x62b1, 0x62b5, 0x62b9, 0x62bc, 0x62bd, 0x62bf, 0x62c2, 0x62c4, 0x62c5, 0x62c6,
+    0x62c7, 0x62c8, 0x62c9, 0x62cb, 0x62cc, 0x62cd, 0x62ce, 0x62d0, 0x62d2, 0x62d3, 0x62d4, 0x62d6,
+    0x62d7, 0x62d8, 0x62d9, 0x62da, 0x62db, 0x62dc, 0x62dd, 0x62df, 0x62e0, 0x62e1, 0x62e2, 0x62e3,
+    0x62e5, 0x62e6, 0x62e7, 0x62e8, 0x62e9, 0x62ec, 0x62ed, 0x62ee, 0x62ef, 0x62f1, 0x62f3, 0x62f4,
+    0x62f6, 0x62f7, 0x62fc, 0x62fd, 0x62fe, 0x62ff, 0x6301, 0x6302, 0x6307, 0x6308, 0x6309, 0x630e,
+    0x6311, 0x6316, 0x6319, 0x631a, 0x631b, 0x631d, 0x631e, 0x631f, 0x6320, 0x6321, 0x6323, 0x6324,
+    0x6325, 0x6328, 0x632a, 0x632b, 0x632f, 0x633a, 0x633d, 0x633e, 0x633f, 0x6342, 0x6345, 0x6346,
+    0x6349, 0x634c, 0x634d, 0x634e, 0x634f, 0x6350, 0x6355, 0x6357, 0x635c, 0x635e, 0x635f, 0x6361,
+    0x6362, 0x6363, 0x6367, 0x6368, 0x6369, 0x636b, 0x636e, 0x6371, 0x6372, 0x6376, 0x6377, 0x637a,
+    0x637b, 0x6380, 0x6382, 0x6383, 0x6384, 0x6387, 0x6388, 0x6389, 0x638c, 0x638f, 0x6390, 0x6392,
+    0x6396, 0x6398, 0x6399, 0x639b, 0x63a0, 0x63a1, 0x63a2, 0x63a3, 0x63a5, 0x63a7, 0x63a8, 0x63a9,
+    0x63aa, 0x63ac, 0x63b2, 0x63b3, 0x63b4, 0x63b7, 0x63b8, 0x63ba, 0x63bb, 0x63c0, 0x63c3, 0x63c6,
+    0x63c9, 0x63cd, 0x63cf, 0x63d0, 0x63d2, 0x63d6, 0x63da, 0x63db, 0x63e1, 0x63e3, 0x63e9, 0x63ea,
+    0x63ed, 0x63ee, 0x63f4, 0x63f9, 0x63fa, 0x63fd, 0x6400, 0x6401, 0x6402, 0x6405, 0x6406, 0x640d,
+    0x640f, 0x6410, 0x6413, 0x6414, 0x6416, 0x6417, 0x641c, 0x641e, 0x642a, 0x642c, 0x642d, 0x6434,
+    0x6436, 0x643a, 0x643d, 0x643e, 0x6442, 0x6444, 0x6446, 0x6447, 0x6448, 0x644a, 0x6451, 0x6452,
+    0x6454, 0x6458, 0x645f, 0x6467, 0x6469, 0x646d, 0x646f, 0x6478, 0x6479, 0x647a, 0x647b, 0x6482,
+    0x6483, 0x6485, 0x6487, 0x6488, 0x6490, 0x6491, 0x6492, 0x6493, 0x6495, 0x6499, 0x649a, 0x649e,
+    0x64a2, 0x64a4, 0x64a5, 0x64a9, 0x64ab, 0x64ac, 0x64ad, 0x64ae, 0x64b0, 0x64b2, 0x64b3, 0x64b5,
+    0x64b9, 0x64bb, 0x64bc, 0x64be, 0x64bf, 0x64c1, 0x64c2, 0x64c4, 0x64c5, 0x64c7, 0x64ca, 0x64cb,
+    0x64cd, 0x64ce, 0x64d2, 0x64d4, 0x64d8, 0x64da, 0x64de, 0x64e0, 0x64e2, 0x64e6, 0x64ec, 0x64ed,
+    0x64f0, 0x64f1, 0x64f2, 0x64f4, 0x64f7, 0x64fa, 0x64fb, 0x64fe, 0x6500, 0x6506, 0x650f, 0x6512,
+    0x6514, 0x6518, 0x6519, 0x651c, 0x651d, 0x6523, 0x6524, 0x652a, 0x652b, 0x652c, 0x652f, 0x6536,
+    0x6538, 0x6539, 0x653b, 0x653e, 0x653f, 0x6545, 0x6548, 0x6549, 0x654c, 0x654f, 0x6551, 0x6554,
+    0x6555, 0x6556, 0x6557, 0x6558, 0x6559, 0x655b, 0x655d, 0x655e, 0x6562, 0x6563, 0x6566, 0x656c,
+    0x6570, 0x6572, 0x6574, 0x6575, 0x6577, 0x6578, 0x6582, 0x6583, 0x6587, 0x6589, 0x658b, 0x658c,
+    0x658e, 0x6590, 0x6591, 0x6595, 0x6597, 0x6599, 0x659b, 0x659c, 0x659f, 0x65a1, 0x65a4, 0x65a5,
+    0x65a7, 0x65a9, 0x65ab, 0x65ac, 0x65ad, 0x65af, 0x65b0, 0x65b7, 0x65b9, 0x65bc, 0x65bd, 0x65c1,
+    0x65c5, 0x65cb, 0x65cc, 0x65ce, 0x65cf, 0x65d6, 0x65d7, 0x65e0, 0x65e2, 0x65e5, 0x65e6, 0x65e7,
+    0x65e8, 0x65e9, 0x65ec, 0x65ed, 0x65f1, 0x65f6, 0x65f7, 0x65fa, 0x6600, 0x6602, 0x6606, 0x6607,
+    0x660a, 0x660c, 0x660e, 0x660f, 0x6613, 0x6614, 0x6615, 0x661f, 0x6620, 0x6624, 0x6625, 0x6627,
+    0x6628, 0x662d, 0x662f, 0x6631, 0x663c, 0x663e, 0x6641, 0x6642, 0x6643, 0x6645, 0x6649, 0x664b,
+    0x664c, 0x664f, 0x6652, 0x6653, 0x6655, 0x665a, 0x665d, 0x665e, 0x6664, 0x6666, 0x6668, 0x6669,
+    0x666e, 0x666f, 0x6670, 0x6674, 0x6676, 0x6677, 0x667a, 0x667e, 0x6681, 0x6682, 0x6684, 0x6687,
+    0x6688, 0x6689, 0x668d, 0x6691, 0x6696, 0x6697, 0x6698, 0x669d, 0x66a2, 0x66a6, 0x66a8, 0x66ab,
+    0x66ae, 0x66b1, 0x66b4, 0x66b8, 0x66b9, 0x66c4, 0x66c6, 0x66c7, 0x66c9, 0x66d6, 0x66d9, 0x66dc,
+    0x66dd, 0x66e0, 0x66e6, 0x66e9, 0x66ec, 0x66f0, 0x66f2, 0x66f3, 0x66f4, 0x66f7, 0x66f8, 0x66f9,
+    0x66fc, 0x66fd, 0x66fe, 0x66ff, 0x6700, 0x6703, 0x6708, 0x6709, 0x670b, 0x670d, 0x6714, 0x6715,
+    0x6717, 0x671b, 0x671d, 0x671f, 0x6726, 0x6727, 0x6728, 0x672a, 0x672b, 0x672c, 0x672d, 0x672e,
+    0x672f, 0x6731, 0x6734, 0x6735, 0x673a, 0x673d, 0x6740, 0x6742, 0x6743, 0x6746, 0x6749, 0x674e,
+    0x674f, 0x6750, 0x6751, 0x6753, 0x6756, 0x6757, 0x675c, 0x675e, 0x675f, 0x6760, 0x6761, 0x6762,
+    0x6765, 0x6768, 0x676a, 0x676d, 0x676f, 0x6770, 0x6771, 0x6772, 0x6773, 0x6775, 0x6777, 0x677c,
+    0x677e, 0x677f, 0x6781, 0x6784, 0x6787, 0x6789, 0x678b, 0x6790, 0x6793, 0x6795, 0x6797, 0x679a,
+    0x679c, 0x679d, 0x67a0, 0x67a2, 0x67a3, 0x67aa, 0x67ab, 0x67af, 0x67b0, 0x67b4, 0x67b6, 0x67b7,
+    0x67b8, 0x67c1, 0x67c4, 0x67ca, 0x67cf, 0x67d0, 0x67d1, 0x67d2, 0x67d3, 0x67d4, 0x67d8, 0x67d9,
+    0x67da, 0x67dc, 0x67dd, 0x67de, 0x67e0, 0x67e2, 0x67e5, 0x67e9, 0x67ec, 0x67ef, 0x67f1, 0x67f3,
+    0x67f4, 0x67f5, 0x67fb, 0x67fe, 0x67ff, 0x6802, 0x6803, 0x6804, 0x6805, 0x6807, 0x6808, 0x680b,
+    0x680f, 0x6811, 0x6813, 0x6816, 0x6817, 0x6818, 0x6821, 0x6822, 0x6829, 0x682a, 0x6834, 0x6837,
+    0x6838, 0x6839, 0x683c, 0x683d, 0x6840, 0x6841, 0x6842, 0x6843, 0x6845, 0x6846, 0x6848, 0x684c,
+    0x6850, 0x6851, 0x6853, 0x6854, 0x685c, 0x685d, 0x685f, 0x6863, 0x6865, 0x6867, 0x6868, 0x6869,
+    0x6876, 0x687f, 0x6881, 0x6882, 0x6883, 0x6885, 0x6886, 0x6893, 0x6894, 0x6897, 0x689d, 0x689f,
+    0x68a1, 0x68a2, 0x68a6, 0x68a7, 0x68a8, 0x68ad, 0x68af, 0x68b0, 0x68b1, 0x68b3, 0x68b5, 0x68b6,
+    0x68bc, 0x68c0, 0x68c4, 0x68c9, 0x68cb, 0x68cd, 0x68d2, 0x68d5, 0x68d7, 0x68d8, 0x68da, 0x68df,
+    0x68e0, 0x68e3, 0x68e7, 0x68ee, 0x68f1, 0x68f2, 0x68f5, 0x68f9, 0x68fa, 0x68fb, 0x6900, 0x6905,
+    0x690b, 0x690d, 0x690e, 0x6912, 0x6919, 0x691b, 0x691c, 0x692d, 0x6930, 0x6934, 0x693d, 0x693f,
+    0x694a, 0x6953, 0x6954, 0x6955, 0x695a, 0x695b, 0x695d, 0x695e, 0x6960, 0x6962, 0x6963, 0x6968,
+    0x696b, 0x696d, 0x696e, 0x696f, 0x6973, 0x6975, 0x6977, 0x6979, 0x697c, 0x697d, 0x6982, 0x6986,
+    0x698a, 0x698e, 0x6994, 0x6995, 0x699b, 0x699c, 0x69a3, 0x69a6, 0x69a8, 0x69ab, 0x69ad, 0x69ae,
+    0x69b4, 0x69b7, 0x69bb, 0x69c1, 0x69c3, 0x69cb, 0x69cc, 0x69cd, 0x69d0, 0x69d3, 0x69d8, 0x69d9,
+    0x69db, 0x69e8, 0x69ed, 0x69f3, 0x69fb, 0x69fd, 0x6a01, 0x6a02, 0x6a05, 0x6a0a, 0x6a0b, 0x6a11,
+    0x6a13, 0x6a17, 0x6a19, 0x6a1e, 0x6a1f, 0x6a21, 0x6a23, 0x6a29, 0x6a2a, 0x6a2b, 0x6a31, 0x6a35,
+    0x6a38, 0x6a39, 0x6a3a, 0x6a3d, 0x6a44, 0x6a47, 0x6a48, 0x6a4b, 0x6a58, 0x6a59, 0x6a5f, 0x6a61,
+    0x6a62, 0x6a6b, 0x6a71, 0x6a7e, 0x6a7f, 0x6a80, 0x6a84, 0x6a8e, 0x6a90, 0x6a94, 0x6a97, 0x6a9c,
+    0x6aa0, 0x6aa2, 0x6aa3, 0x6aac, 0x6aae, 0x6aaf, 0x6ab3, 0x6ab8, 0x6abb, 0x6ac2, 0x6ac3, 0x6ad3,
+    0x6ada, 0x6adb, 0x6add, 0x6ae5, 0x6ae8, 0x6aec, 0x6afa, 0x6afb, 0x6b04, 0x6b0a, 0x6b10, 0x6b16,
+    0x6b1d, 0x6b20, 0x6b21, 0x6b22, 0x6b23, 0x6b27, 0x6b32, 0x6b3a, 0x6b3d, 0x6b3e, 0x6b47, 0x6b49,
+    0x6b4c, 0x6b4e, 0x6b50, 0x6b53, 0x6b59, 0x6b5c, 0x6b5f, 0x6b61, 0x6b62, 0x6b63, 0x6b64, 0x6b65,
+    0x6b66, 0x6b67, 0x6b69, 0x6b6a, 0x6b6f, 0x6b72, 0x6b73, 0x6b74, 0x6b77, 0x6b78, 0x6b79, 0x6b7b,
+    0x6b7c, 0x6b7f, 0x6b83, 0x6b86, 0x6b89, 0x6b8a, 0x6b8b, 0x6b96, 0x6b98, 0x6ba4, 0x6bae, 0x6baf,
+    0x6bb2, 0x6bb4, 0x6bb5, 0x6bb7, 0x6bba, 0x6bbb, 0x6bbc, 0x6bbf, 0x6bc0, 0x6bc1, 0x6bc5, 0x6bc6,
+    0x6bcb, 0x6bcd, 0x6bce, 0x6bcf, 0x6bd2, 0x6bd3, 0x6bd4, 0x6bd5, 0x6bd6, 0x6bd7, 0x6bd8, 0x6bd9,
+    0x6bda, 0x6bdb, 0x6be1, 0x6beb, 0x6bec, 0x6bef, 0x6bfd, 0x6c05, 0x6c08, 0x6c0f, 0x6c10, 0x6c11,
+    0x6c13, 0x6c14, 0x6c16, 0x6c17, 0x6c1b, 0x6c1f, 0x6c22, 0x6c23, 0x6c24, 0x6c26, 0x6c27, 0x6c28,
+    0x6c2b, 0x6c2c, 0x6c2e, 0x6c2f, 0x6c30, 0x6c33, 0x6c34, 0x6c37, 0x6c38, 0x6c3e, 0x6c40, 0x6c41,
+    0x6c42, 0x6c47, 0x6c49, 0x6c4d, 0x6c4e, 0x6c50, 0x6c55, 0x6c57, 0x6c59, 0x6c5a, 0x6c5b, 0x6c5d,
+    0x6c5e, 0x6c5f, 0x6c60, 0x6c61, 0x6c64, 0x6c68, 0x6c6a, 0x6c70, 0x6c72, 0x6c74, 0x6c76, 0x6c79,
+    0x6c7a, 0x6c7d, 0x6c7e, 0x6c81, 0x6c82, 0x6c83, 0x6c85, 0x6c86, 0x6c88, 0x6c89, 0x6c8c, 0x6c8d,
+    0x6c8f, 0x6c90, 0x6c92, 0x6c93, 0x6c94, 0x6c96, 0x6c98, 0x6c99, 0x6c9b, 0x6c9f, 0x6ca1, 0x6ca2,
+    0x6ca4, 0x6ca5, 0x6ca6, 0x6ca7, 0x6caa, 0x6cab, 0x6cac, 0x6cae, 0x6cb1, 0x6cb3, 0x6cb8, 0x6cb9,
+    0x6cbb, 0x6cbc, 0x6cbd, 0x6cbe, 0x6cbf, 0x6cc1, 0x6cc4, 0x6cc5, 0x6cc9, 0x6cca, 0x6ccc, 0x6cd3,
+    0x6cd5, 0x6cd6, 0x6cd7, 0x6cdb, 0x6cdc, 0x6cde, 0x6ce0, 0x6ce1, 0x6ce2, 0x6ce3, 0x6ce5, 0x6ce8,
+    0x6cea, 0x6cef, 0x6cf0, 0x6cf1, 0x6cf3, 0x6cf5, 0x6cfb, 0x6cfc, 0x6cfd, 0x6d01, 0x6d0b, 0x6d0c,
+    0x6d0e, 0x6d12, 0x6d17, 0x6d1b, 0x6d1e, 0x6d25, 0x6d27, 0x6d29, 0x6d2a, 0x6d2b, 0x6d2e, 0x6d31,
+    0x6d32, 0x6d35, 0x6d36, 0x6d38, 0x6d39, 0x6d3b, 0x6d3c, 0x6d3d, 0x6d3e, 0x6d41, 0x6d44, 0x6d45,
+    0x6d46, 0x6d47, 0x6d4a, 0x6d4b, 0x6d4e, 0x6d51, 0x6d53, 0x6d59, 0x6d5a, 0x6d5c, 0x6d65, 0x6d66,
+    0x6d69, 0x6d6a, 0x6d6c, 0x6d6e, 0x6d74, 0x6d77, 0x6d78, 0x6d79, 0x6d82, 0x6d85, 0x6d87, 0x6d88,
+    0x6d89, 0x6d8a, 0x6d8c, 0x6d8e, 0x6d93, 0x6d94, 0x6d95, 0x6d99, 0x6d9b, 0x6d9c, 0x6d9d, 0x6d9f,
+    0x6da1, 0x6da3, 0x6da4, 0x6da6, 0x6da7, 0x6da8, 0x6da9, 0x6daa, 0x6dae, 0x6daf, 0x6db2, 0x6db5,
+    0x6db8, 0x6dbc, 0x6dbf, 0x6dc0, 0x6dc4, 0x6dc5, 0x6dc6, 0x6dc7, 0x6dcb, 0x6dcc, 0x6dd1, 0x6dd2,
+    0x6dd6, 0x6dd8, 0x6dd9, 0x6dda, 0x6dde, 0x6de1, 0x6de4, 0x6de6, 0x6de8, 0x6dea, 0x6deb, 0x6dec,
+    0x6dee, 0x6df1, 0x6df3, 0x6df5, 0x6df7, 0x6df9, 0x6dfa, 0x6dfb, 0x6e05, 0x6e07, 0x6e08, 0x6e09,
+    0x6e0a, 0x6e0b, 0x6e0d, 0x6e10, 0x6e13, 0x6e14, 0x6e17, 0x6e19, 0x6e1a, 0x6e1b, 0x6e1d, 0x6e20,
+    0x6e21, 0x6e23, 0x6e24, 0x6e25, 0x6e26, 0x6e29, 0x6e2c, 0x6e2d, 0x6e2f, 0x6e32, 0x6e34, 0x6e38,
+    0x6e3a, 0x6e3e, 0x6e43, 0x6e44, 0x6e4a, 0x6e4d, 0x6e4e, 0x6e54, 0x6e56, 0x6e58, 0x6e5b, 0x6e5f,
+    0x6e63, 0x6e67, 0x6e69, 0x6e6e, 0x6e6f, 0x6e72, 0x6e7e, 0x6e7f, 0x6e80, 0x6e83, 0x6e85, 0x6e89,
+    0x6e8c, 0x6e90, 0x6e96, 0x6e98, 0x6e9c, 0x6e9d, 0x6ea2, 0x6ea5, 0x6ea7, 0x6eaa, 0x6eab, 0x6eaf,
+    0x6eb4, 0x6eb6, 0x6eba, 0x6ebc, 0x6ec1, 0x6ec2, 0x6ec4, 0x6ec5, 0x6ec7, 0x6ecb, 0x6ecc, 0x6ed1,
+    0x6ed3, 0x6ed4, 0x6ed5, 0x6eda, 0x6edd, 0x6ede, 0x6ee1, 0x6ee4, 0x6ee5, 0x6ee6, 0x6ee8, 0x6ee9,
+    0x6eec, 0x6eef, 0x6ef2, 0x6ef4, 0x6ef7, 0x6efe, 0x6eff, 0x6f01, 0x6f02, 0x6f06, 0x6f09, 0x6f0f,
+    0x6f13, 0x6f14, 0x6f15, 0x6f20, 0x6f22, 0x6f23, 0x6f29, 0x6f2a, 0x6f2b, 0x6f2c, 0x6f2f, 0x6f31,
+    0x6f32, 0x6f33, 0x6f38, 0x6f3e, 0x6f3f, 0x6f45, 0x6f4d, 0x6f51, 0x6f54, 0x6f58, 0x6f5b, 0x6f5c,
+    0x6f5e, 0x6f5f, 0x6f60, 0x6f64, 0x6f66, 0x6f6d, 0x6f6e, 0x6f6f, 0x6f70, 0x6f78, 0x6f7a, 0x6f7c,
+    0x6f80, 0x6f84, 0x6f86, 0x6f88, 0x6f8e, 0x6f97, 0x6f9c, 0x6fa0, 0x6fa1, 0x6fa4, 0x6fa6, 0x6fa7,
+    0x6fb1, 0x6fb3, 0x6fb4, 0x6fb6, 0x6fb9, 0x6fc0, 0x6fc1, 0x6fc2, 0x6fc3, 0x6fd2, 0x6fd5, 0x6fd8,
+    0x6fdb, 0x6fdf, 0x6fe0, 0x6fe1, 0x6fe4, 0x6fe9, 0x6feb, 0x6fec, 0x6fee, 0x6fef, 0x6ff0, 0x6ff1,
+    0x6ffa, 0x6ffe, 0x7006, 0x7009, 0x700b, 0x700f, 0x7011, 0x7015, 0x7018, 0x701a, 0x701b, 0x701d,
+    0x701e, 0x701f, 0x7026, 0x7027, 0x7028, 0x702c, 0x7030, 0x7032, 0x703e, 0x704c, 0x7051, 0x7058,
+    0x705e, 0x7063, 0x7064, 0x706b, 0x706d, 0x706f, 0x7070, 0x7075, 0x7076, 0x7078, 0x707c, 0x707d,
+    0x707e, 0x707f, 0x7089, 0x708a, 0x708e, 0x7092, 0x7094, 0x7095, 0x7099, 0x70a4, 0x70ab, 0x70ac,
+    0x70ad, 0x70ae, 0x70af, 0x70b3, 0x70b8, 0x70b9, 0x70ba, 0x70bc, 0x70bd, 0x70c1, 0x70c2, 0x70c3,
+    0x70c8, 0x70ca, 0x70cf, 0x70d8, 0x70d9, 0x70db, 0x70df, 0x70e4, 0x70e6, 0x70e7, 0x70e9, 0x70eb,
+    0x70ec, 0x70ed, 0x70ef, 0x70f7, 0x70f9, 0x70fd, 0x7109, 0x710a, 0x7114, 0x7115, 0x7119, 0x711a,
+    0x711c, 0x7121, 0x7126, 0x7130, 0x7136, 0x713c, 0x7146, 0x7149, 0x714c, 0x714e, 0x7156, 0x7159,
+    0x715c, 0x715e, 0x7164, 0x7165, 0x7166, 0x7167, 0x7168, 0x7169, 0x716c, 0x716e, 0x717d, 0x7184,
+    0x718a, 0x718f, 0x7192, 0x7194, 0x7199, 0x719f, 0x71a8, 0x71ac, 0x71b1, 0x71b9, 0x71be, 0x71c3,
+    0x71c4, 0x71c8, 0x71c9, 0x71ce, 0x71d0, 0x71d2, 0x71d5, 0x71d9, 0x71dc, 0x71df, 0x71e0, 0x71e5,
+    0x71e6, 0x71e7, 0x71ec, 0x71ed, 0x71ee, 0x71f4, 0x71f8, 0x71fb, 0x71fc, 0x71fe, 0x7206, 0x720d,
+    0x7210, 0x721b, 0x7228, 0x722a, 0x722c, 0x722d, 0x7230, 0x7231, 0x7235, 0x7236, 0x7237, 0x7238,
+    0x7239, 0x723a, 0x723b, 0x723d, 0x723e, 0x7246, 0x7247, 0x7248, 0x724c, 0x7252, 0x7256, 0x7258,
+    0x7259, 0x725b, 0x725d, 0x725f, 0x7260, 0x7261, 0x7262, 0x7267, 0x7269, 0x726f, 0x7272, 0x7274,
+    0x7275, 0x7279, 0x727a, 0x727d, 0x7280, 0x7281, 0x7284, 0x728a, 0x7292, 0x7296, 0x729b, 0x72a0,
+    0x72a2, 0x72a7, 0x72ac, 0x72af, 0x72b6, 0x72b9, 0x72c0, 0x72c2, 0x72c4, 0x72c8, 0x72ce, 0x72d0,
+    0x72d7, 0x72d9, 0x72db, 0x72de, 0x72e0, 0x72e1, 0x72e9, 0x72ec, 0x72ed, 0x72ee, 0x72f0, 0x72f1,
+    0x72f7, 0x72f8, 0x72f9, 0x72fc, 0x72fd, 0x730e, 0x7313, 0x7316, 0x7319, 0x731b, 0x731c, 0x731f,
+    0x7325, 0x7329, 0x732a, 0x732b, 0x732e, 0x7334, 0x7336, 0x7337, 0x733e, 0x733f, 0x7344, 0x7345,
+    0x734e, 0x7350, 0x7357, 0x7363, 0x7368, 0x736d, 0x7370, 0x7372, 0x7375, 0x7377, 0x7378, 0x737a,
+    0x737b, 0x7380, 0x7384, 0x7386, 0x7387, 0x7389, 0x738b, 0x7396, 0x739b, 0x739f, 0x73a5, 0x73a8,
+    0x73a9, 0x73ab, 0x73af, 0x73b0, 0x73b2, 0x73b3, 0x73b7, 0x73bb, 0x73c0, 0x73c2, 0x73ca, 0x73cd,
+    0x73d0, 0x73de, 0x73e0, 0x73ea, 0x73ed, 0x73ee, 0x73fe, 0x7403, 0x7405, 0x7406, 0x7409, 0x740a,
+    0x740d, 0x7410, 0x741b, 0x7422, 0x7425, 0x7426, 0x7428, 0x742a, 0x742f, 0x7433, 0x7434, 0x7435,
+    0x7436, 0x743a, 0x743c, 0x743f, 0x7441, 0x7455, 0x7459, 0x745a, 0x745b, 0x745c, 0x745e, 0x745f,
+    0x7460, 0x7463, 0x7464, 0x7469, 0x746a, 0x746d, 0x746f, 0x7470, 0x7473, 0x7476, 0x747e, 0x7480,
+    0x7483, 0x748b, 0x7498, 0x749c, 0x749e, 0x749f, 0x74a3, 0x74a6, 0x74a7, 0x74a8, 0x74a9, 0x74b0,
+    0x74bd, 0x74bf, 0x74ca, 0x74cf, 0x74d4, 0x74d6, 0x74da, 0x74dc, 0x74e0, 0x74e2, 0x74e3, 0x74e4,
+    0x74e6, 0x74ee, 0x74f6, 0x74f7, 0x7504, 0x750c, 0x750d, 0x7511, 0x7515, 0x7518, 0x751a, 0x751c,
+    0x751f, 0x7522, 0x7523, 0x7525, 0x7526, 0x7528, 0x7529, 0x752b, 0x752c, 0x752d, 0x7530, 0x7531,
+    0x7532, 0x7533, 0x7535, 0x7537, 0x7538, 0x753a, 0x753b, 0x753d, 0x7545, 0x754b, 0x754c, 0x754e,
+    0x754f, 0x7551, 0x7554, 0x7559, 0x755a, 0x755c, 0x755d, 0x7560, 0x7562, 0x7565, 0x7566, 0x756a,
+    0x756b, 0x7570, 0x7573, 0x7574, 0x7576, 0x7577, 0x7578, 0x757f, 0x7586, 0x7587, 0x758a, 0x758b,
+    0x758e, 0x758f, 0x7591, 0x7597, 0x7599, 0x759a, 0x759d, 0x759f, 0x75a1, 0x75a2, 0x75a3, 0x75a4,
+    0x75a5, 0x75ab, 0x75ae, 0x75af, 0x75b2, 0x75b3, 0x75b5, 0x75b8, 0x75b9, 0x75bc, 0x75bd, 0x75be,
+    0x75c2, 0x75c5, 0x75c7, 0x75c8, 0x75c9, 0x75ca, 0x75cd, 0x75d2, 0x75d4, 0x75d5, 0x75d8, 0x75d9,
+    0x75db, 0x75de, 0x75e0, 0x75e2, 0x75e3, 0x75e9, 0x75ea, 0x75f0, 0x75f1, 0x75f2, 0x75f3, 0x75f4,
+    0x75f9, 0x75fa, 0x75ff, 0x7600, 0x7601, 0x7609, 0x760b, 0x760d, 0x7613, 0x761f, 0x7620, 0x7621,
+    0x7622, 0x7624, 0x7626, 0x7627, 0x7629, 0x762a, 0x762b, 0x7634, 0x7638, 0x763a, 0x7642, 0x7646,
+    0x764c, 0x7652, 0x7656, 0x7658, 0x765f, 0x7661, 0x7662, 0x7663, 0x7665, 0x7669, 0x766c, 0x766e,
+    0x7671, 0x7672, 0x7678, 0x767a, 0x767b, 0x767c, 0x767d, 0x767e, 0x7682, 0x7684, 0x7686, 0x7687,
+    0x7688, 0x768b, 0x768e, 0x7690, 0x7691, 0x7693, 0x7696, 0x769a, 0x76ae, 0x76b0, 0x76b1, 0x76b4,
+    0x76ba, 0x76bf, 0x76c2, 0x76c3, 0x76c5, 0x76c6, 0x76c8, 0x76ca, 0x76cd, 0x76ce, 0x76cf, 0x76d0,
+    0x76d1, 0x76d2, 0x76d4, 0x76d6, 0x76d7, 0x76d8, 0x76db, 0x76dc, 0x76de, 0x76df, 0x76e1, 0x76e3,
+    0x76e4, 0x76e5, 0x76e7, 0x76ea, 0x76ee, 0x76ef, 0x76f2, 0x76f4, 0x76f8, 0x76f9, 0x76fc, 0x76fe,
+    0x7701, 0x7707, 0x7709, 0x770b, 0x770c, 0x771f, 0x7720, 0x7728, 0x7729, 0x772f, 0x7736, 0x7737,
+    0x7738, 0x773a, 0x773c, 0x773e, 0x7740, 0x7741, 0x774f, 0x775b, 0x775c, 0x775e, 0x7761, 0x7762,
+    0x7763, 0x7765, 0x7766, 0x7768, 0x776a, 0x776b, 0x776c, 0x7779, 0x777d, 0x777f, 0x7784, 0x7785,
+    0x7787, 0x778b, 0x778c, 0x778e, 0x7791, 0x7792, 0x779e, 0x779f, 0x77a0, 0x77a5, 0x77a7, 0x77a9,
+    0x77aa, 0x77ac, 0x77ad, 0x77b0, 0x77b3, 0x77bb, 0x77bc, 0x77bd, 0x77bf, 0x77c7, 0x77d3, 0x77d7,
+    0x77da, 0x77db, 0x77dc, 0x77e2, 0x77e3, 0x77e5, 0x77e7, 0x77e9, 0x77eb, 0x77ed, 0x77ee, 0x77ef,
+    0x77f3, 0x77fd, 0x77fe, 0x77ff, 0x7801, 0x7802, 0x780c, 0x780d, 0x7812, 0x7814, 0x7815, 0x7816,
+    0x781a, 0x781d, 0x781f, 0x7820, 0x7825, 0x7826, 0x7827, 0x782d, 0x7830, 0x7832, 0x7834, 0x7837,
+    0x7838, 0x783a, 0x783e, 0x783f, 0x7840, 0x7843, 0x7845, 0x784e, 0x7852, 0x7855, 0x785d, 0x786b,
+    0x786c, 0x786e, 0x786f, 0x7872, 0x7877, 0x787c, 0x787f, 0x7881, 0x7887, 0x7889, 0x788c, 0x788d,
+    0x788e, 0x7891, 0x7893, 0x7895, 0x7897, 0x7898, 0x789f, 0x78a3, 0x78a7, 0x78a9, 0x78b0, 0x78b1,
+    0x78b3, 0x78b4, 0x78ba, 0x78bc, 0x78be, 0x78c1, 0x78c5, 0x78ca, 0x78cb, 0x78d0, 0x78d5, 0x78da,
+    0x78e7, 0x78e8, 0x78ec, 0x78ef, 0x78f4, 0x78f7, 0x78fa, 0x7901, 0x790e, 0x7919, 0x7926, 0x792a,
+    0x792b, 0x792c, 0x793a, 0x793c, 0x793e, 0x7940, 0x7941, 0x7946, 0x7947, 0x7948, 0x7949, 0x7950,
+    0x7955, 0x7956, 0x7957, 0x795a, 0x795d, 0x795e, 0x795f, 0x7960, 0x7962, 0x7965, 0x7968, 0x796d,
+    0x7977, 0x7978, 0x797a, 0x797f, 0x7981, 0x7984, 0x7985, 0x798d, 0x798e, 0x798f, 0x79a6, 0x79a7,
+    0x79aa, 0x79ae, 0x79b0, 0x79b1, 0x79b3, 0x79b9, 0x79ba, 0x79bb, 0x79bd, 0x79be, 0x79bf, 0x79c0,
+    0x79c1, 0x79c3, 0x79c6, 0x79c8, 0x79c9, 0x79cb, 0x79cd, 0x79d1, 0x79d2, 0x79d8, 0x79df, 0x79e3,
+    0x79e4, 0x79e6, 0x79e7, 0x79e9, 0x79ef, 0x79f0, 0x79f8, 0x79fb, 0x79fd, 0x7a00, 0x7a05, 0x7a08,
+    0x7a0b, 0x7a0d, 0x7a0e, 0x7a14, 0x7a17, 0x7a1a, 0x7a1c, 0x7a1e, 0x7a1f, 0x7a20, 0x7a2e, 0x7a31,
+    0x7a32, 0x7a33, 0x7a37, 0x7a3b, 0x7a3c, 0x7a3d, 0x7a3f, 0x7a40, 0x7a42, 0x7a46, 0x7a4b, 0x7a4c,
+    0x7a4d, 0x7a4e, 0x7a4f, 0x7a50, 0x7a57, 0x7a60, 0x7a61, 0x7a62, 0x7a63, 0x7a69, 0x7a6b, 0x7a74,
+    0x7a76, 0x7a77, 0x7a79, 0x7a7a, 0x7a7f, 0x7a81, 0x7a83, 0x7a84, 0x7a88, 0x7a8d, 0x7a91, 0x7a92,
+    0x7a93, 0x7a95, 0x7a96, 0x7a97, 0x7a98, 0x7a9c, 0x7a9d, 0x7a9f, 0x7aa0, 0x7aa5, 0x7aa9, 0x7aaa,
+    0x7aae, 0x7aaf, 0x7aba, 0x7abf, 0x7ac3, 0x7ac4, 0x7ac5, 0x7ac7, 0x7aca, 0x7acb, 0x7ad6, 0x7ad9,
+    0x7adc, 0x7ade, 0x7adf, 0x7ae0, 0x7ae3, 0x7ae5, 0x7aea, 0x7aed, 0x7aef, 0x7af6, 0x7af9, 0x7afa,
+    0x7afd, 0x7aff, 0x7b06, 0x7b08, 0x7b0b, 0x7b11, 0x7b14, 0x7b19, 0x7b1b, 0x7b1e, 0x7b20, 0x7b25,
+    0x7b26, 0x7b28, 0x7b2c, 0x7b2e, 0x7b39, 0x7b3a, 0x7b3c, 0x7b46, 0x7b48, 0x7b49, 0x7b4b, 0x7b4d,
+    0x7b4f, 0x7b50, 0x7b51, 0x7b52, 0x7b54, 0x7b56, 0x7b5b, 0x7b60, 0x7b67, 0x7b6e, 0x7b75, 0x7b77,
+    0x7b79, 0x7b7e, 0x7b80, 0x7b84, 0x7b86, 0x7b87, 0x7b8b, 0x7b8d, 0x7b8f, 0x7b94, 0x7b95, 0x7b97,
+    0x7b9d, 0x7ba0, 0x7ba1, 0x7ba9, 0x7baa, 0x7bad, 0x7bb1, 0x7bb4, 0x7bb8, 0x7bc0, 0x7bc1, 0x7bc4,
+    0x7bc6, 0x7bc7, 0x7bc9, 0x7bcc, 0x7bd3, 0x7bd9, 0x7bdb, 0x7be0, 0x7be1, 0x7be4, 0x7be6, 0x7be9,
+    0x7bed, 0x7bee, 0x7bf1, 0x7bf7, 0x7bfe, 0x7c07, 0x7c0c, 0x7c0d, 0x7c11, 0x7c1e, 0x7c21, 0x7c23,
+    0x7c27, 0x7c2a, 0x7c2b, 0x7c37, 0x7c38, 0x7c3d, 0x7c3e, 0x7c3f, 0x7c40, 0x7c43, 0x7c4c, 0x7c4d,
+    0x7c50, 0x7c5f, 0x7c60, 0x7c63, 0x7c64, 0x7c65, 0x7c6c, 0x7c6e, 0x7c72, 0x7c73, 0x7c7b, 0x7c7d,
+    0x7c7e, 0x7c81, 0x7c82, 0x7c89, 0x7c8b, 0x7c8d, 0x7c92, 0x7c95, 0x7c97, 0x7c98, 0x7c9b, 0x7c9f,
+    0x7ca4, 0x7ca5, 0x7ca7, 0x7caa, 0x7cae, 0x7cb1, 0x7cb3, 0x7cb5, 0x7cb9, 0x7cbd, 0x7cbe, 0x7cca,
+    0x7cce, 0x7cd5, 0x7cd6, 0x7cd9, 0x7cdc, 0x7cdd, 0x7cde, 0x7cdf, 0x7ce0, 0x7ce2, 0x7ce7, 0x7cef,
+    0x7cf0, 0x7cf8, 0x7cfb, 0x7cfe, 0x7d00, 0x7d02, 0x7d04, 0x7d05, 0x7d06, 0x7d07, 0x7d09, 0x7d0a,
+    0x7d0b, 0x7d0d, 0x7d10, 0x7d14, 0x7d15, 0x7d17, 0x7d18, 0x7d19, 0x7d1a, 0x7d1b, 0x7d1c, 0x7d20,
+    0x7d21, 0x7d22, 0x7d27, 0x7d2b, 0x7d2c, 0x7d2e, 0x7d2f, 0x7d30, 0x7d31, 0x7d32, 0x7d33, 0x7d39,
+    0x7d3a, 0x7d3c, 0x7d40, 0x7d42, 0x7d43, 0x7d44, 0x7d46, 0x7d4c, 0x7d50, 0x7d55, 0x7d5b, 0x7d5e,
+    0x7d61, 0x7d62, 0x7d66, 0x7d68, 0x7d6e, 0x7d70, 0x7d71, 0x7d72, 0x7d73, 0x7d75, 0x7d76, 0x7d79,
+    0x7d81, 0x7d8f, 0x7d91, 0x7d93, 0x7d99, 0x7d9a, 0x7d9c, 0x7d9e, 0x7da0, 0x7da2, 0x7dac, 0x7dad,
+    0x7db0, 0x7db1, 0x7db2, 0x7db4, 0x7db5, 0x7db8, 0x7dba, 0x7dbb, 0x7dbd, 0x7dbe, 0x7dbf, 0x7dc7,
+    0x7dca, 0x7dcb, 0x7dcf, 0x7dd1, 0x7dd2, 0x7dd8, 0x7dd9, 0x7dda, 0x7ddd, 0x7dde, 0x7de0, 0x7de3,
+    0x7de8, 0x7de9, 0x7dec, 0x7def, 0x7df2, 0x7df4, 0x7df9, 0x7dfb, 0x7e01, 0x7e04, 0x7e08, 0x7e09,
+    0x7e0a, 0x7e10, 0x7e11, 0x7e1b, 0x7e1d, 0x7e1e, 0x7e23, 0x7e26, 0x7e2b, 0x7e2e, 0x7e2f, 0x7e31,
+    0x7e32, 0x7e34, 0x7e35, 0x7e37, 0x7e39, 0x7e3d, 0x7e3e, 0x7e3f, 0x7e41, 0x7e43, 0x7e45, 0x7e46,
+    0x7e48, 0x7e4a, 0x7e4b, 0x7e4d, 0x7e52, 0x7e54, 0x7e55, 0x7e59, 0x7e5a, 0x7e5e, 0x7e61, 0x7e69,
+    0x7e6a, 0x7e6b, 0x7e6d, 0x7e70, 0x7e73, 0x7e79, 0x7e7c, 0x7e7d, 0x7e82, 0x7e8c, 0x7e8f, 0x7e93,
+    0x7e94, 0x7e96, 0x7e9c, 0x7ea0, 0x7ea2, 0x7ea4, 0x7ea6, 0x7ea7, 0x7eaa, 0x7eab, 0x7eac, 0x7eaf,
+    0x7eb1, 0x7eb2, 0x7eb3, 0x7eb5, 0x7eb6, 0x7eb7, 0x7eb8, 0x7eb9, 0x7eba, 0x7ebd, 0x7ebf, 0x7ec3,
+    0x7ec4, 0x7ec5, 0x7ec6, 0x7ec7, 0x7ec8, 0x7eca, 0x7ecd, 0x7ece, 0x7ecf, 0x7ed1, 0x7ed2, 0x7ed3,
+    0x7ed5, 0x7ed8, 0x7ed9, 0x7eda, 0x7edc, 0x7edd, 0x7ede, 0x7edf, 0x7ee2, 0x7ee3, 0x7ee5, 0x7ee6,
+    0x7ee7, 0x7ee9, 0x7eea, 0x7eed, 0x7ef0, 0x7ef3, 0x7ef4, 0x7ef5, 0x7ef7, 0x7ef8, 0x7efc, 0x7efd,
+    0x7eff, 0x7f00, 0x7f04, 0x7f05, 0x7f06, 0x7f09, 0x7f0e, 0x7f13, 0x7f14, 0x7f15, 0x7f16, 0x7f18,
+    0x7f1a, 0x7f1d, 0x7f20, 0x7f28, 0x7f29, 0x7f2e, 0x7f34, 0x7f36, 0x7f38, 0x7f3a, 0x7f3d, 0x7f44,
+    0x7f48, 0x7f4c, 0x7f50, 0x7f51, 0x7f54, 0x7f55, 0x7f57, 0x7f5a, 0x7f5f, 0x7f62, 0x7f69, 0x7f6a,
+    0x7f6b, 0x7f6e, 0x7f70, 0x7f72, 0x7f75, 0x7f77, 0x7f79, 0x7f85, 0x7f88, 0x7f8a, 0x7f8b, 0x7f8c,
+    0x7f8e, 0x7f94, 0x7f9a, 0x7f9e, 0x7fa1, 0x7fa4, 0x7fa8, 0x7fa9, 0x7faf, 0x7fb2, 0x7fb6, 0x7fb8,
+    0x7fb9, 0x7fbc, 0x7fbd, 0x7fbf, 0x7fc1, 0x7fc5, 0x7fcc, 0x7fce, 0x7fd2, 0x7fd4, 0x7fd5, 0x7fd8,
+    0x7fdf, 0x7fe0, 0x7fe1, 0x7fe9, 0x7feb, 0x7fee, 0x7ff0, 0x7ff1, 0x7ff3, 0x7ff9, 0x7ffb, 0x7ffc,
+    0x8000, 0x8001, 0x8003, 0x8004, 0x8005, 0x8006, 0x800b, 0x800c, 0x800d, 0x8010, 0x8011, 0x8012,
+    0x8015, 0x8017, 0x8018, 0x8019, 0x801c, 0x8026, 0x8028, 0x802a, 0x8033, 0x8036, 0x8038, 0x803b,
+    0x803d, 0x803f, 0x8042, 0x8046, 0x804a, 0x804b, 0x804c, 0x8052, 0x8054, 0x8056, 0x8058, 0x805a,
+    0x805e, 0x8061, 0x806a, 0x806f, 0x8070, 0x8071, 0x8072, 0x8073, 0x8074, 0x8076, 0x8077, 0x807d,
+    0x807e, 0x807f, 0x8083, 0x8084, 0x8085, 0x8086, 0x8087, 0x8089, 0x808b, 0x808c, 0x8093, 0x8096,
+    0x8098, 0x809a, 0x809b, 0x809d, 0x80a0, 0x80a1, 0x80a2, 0x80a4, 0x80a5, 0x80a9, 0x80aa, 0x80ab,
+    0x80ae, 0x80af, 0x80b1, 0x80b2, 0x80b4, 0x80ba, 0x80be, 0x80bf, 0x80c0, 0x80c1, 0x80c3, 0x80c4,
+    0x80c6, 0x80cc, 0x80ce, 0x80d6, 0x80da, 0x80db, 0x80dc, 0x80dd, 0x80de, 0x80e1, 0x80e4, 0x80e5,
+    0x80ed, 0x80ef, 0x80f0, 0x80f1, 0x80f3, 0x80f4, 0x80f6, 0x80f8, 0x80fa, 0x80fc, 0x80fd, 0x8102,
+    0x8105, 0x8106, 0x8107, 0x8108, 0x8109, 0x810a, 0x810f, 0x8110, 0x8111, 0x8113, 0x8116, 0x811a,
+    0x8123, 0x8124, 0x8129, 0x812b, 0x812f, 0x8130, 0x8131, 0x8133, 0x8138, 0x8139, 0x813e, 0x8146,
+    0x814a, 0x814b, 0x814c, 0x814e, 0x8150, 0x8151, 0x8153, 0x8154, 0x8155, 0x8165, 0x8166, 0x816b,
+    0x816e, 0x8170, 0x8171, 0x8173, 0x8174, 0x8178, 0x8179, 0x817a, 0x817b, 0x817e, 0x817f, 0x8180,
+    0x8182, 0x8188, 0x818a, 0x818f, 0x8198, 0x819a, 0x819b, 0x819c, 0x819d, 0x81a0, 0x81a8, 0x81a9,
+    0x81b3, 0x81ba, 0x81bd, 0x81be, 0x81bf, 0x81c0, 0x81c2, 0x81c3, 0x81c6, 0x81c9, 0x81cd, 0x81cf,
+    0x81d3, 0x81d8, 0x81da, 0x81df, 0x81e2, 0x81e3, 0x81e5, 0x81e7, 0x81e8, 0x81ea, 0x81ec, 0x81ed,
+    0x81f3, 0x81f4, 0x81fa, 0x81fb, 0x81fc, 0x81fe, 0x8200, 0x8202, 0x8205, 0x8206, 0x8207, 0x8208,
+    0x8209, 0x820a, 0x820c, 0x820d, 0x820e, 0x8210, 0x8212, 0x8214, 0x8217, 0x8218, 0x821b, 0x821c,
+    0x821e, 0x821f, 0x8222, 0x8228, 0x822a, 0x822b, 0x822c, 0x8230, 0x8231, 0x8235, 0x8236, 0x8237,
+    0x8239, 0x8247, 0x824b, 0x8258, 0x8259, 0x8266, 0x826e, 0x826f, 0x8270, 0x8271, 0x8272, 0x8273,
+    0x8276, 0x8277, 0x827a, 0x827e, 0x8282, 0x828b, 0x828d, 0x8292, 0x8299, 0x829c, 0x829d, 0x829f,
+    0x82a3, 0x82a5, 0x82a6, 0x82ac, 0x82ad, 0x82af, 0x82b0, 0x82b1, 0x82b3, 0x82b7, 0x82b8, 0x82b9,
+    0x82bb, 0x82bd, 0x82be, 0x82c5, 0x82c7, 0x82cd, 0x82cf, 0x82d1, 0x82d2, 0x82d3, 0x82d4, 0x82d7,
+    0x82db, 0x82dc, 0x82de, 0x82df, 0x82e3, 0x82e5, 0x82e6, 0x82e7, 0x82eb, 0x82ef, 0x82f1, 0x82f9,
+    0x8301, 0x8302, 0x8303, 0x8304, 0x8305, 0x8306, 0x8309, 0x830e, 0x8317, 0x831c, 0x8327, 0x8328,
+    0x832b, 0x832c, 0x8331, 0x8332, 0x8334, 0x8335, 0x8336, 0x8338, 0x8339, 0x8340, 0x8343, 0x8346,
+    0x8349, 0x834a, 0x834f, 0x8350, 0x8352, 0x8354, 0x8358, 0x835a, 0x8361, 0x8363, 0x8364, 0x8367,
+    0x836b, 0x836f, 0x8377, 0x8378, 0x837b, 0x837c, 0x8386, 0x8389, 0x838a, 0x838e, 0x8392, 0x8393,
+    0x8396, 0x8398, 0x839e, 0x83a0, 0x83a2, 0x83a7, 0x83ab, 0x83b1, 0x83b2, 0x83b7, 0x83b9, 0x83bd,
+    0x83c1, 0x83c5, 0x83c7, 0x83ca, 0x83cc, 0x83cf, 0x83d3, 0x83d4, 0x83d6, 0x83dc, 0x83df, 0x83e0,
+    0x83e9, 0x83ef, 0x83f0, 0x83f1, 0x83f2, 0x83f4, 0x83f8, 0x83fd, 0x8403, 0x8404, 0x8407, 0x840a,
+    0x840b, 0x840c, 0x840d, 0x840e, 0x841d, 0x8424, 0x8425, 0x8427, 0x8428, 0x8429, 0x842c, 0x8431,
+    0x8435, 0x8438, 0x843c, 0x843d, 0x8446, 0x8449, 0x844e, 0x8457, 0x845b, 0x8461, 0x8463, 0x8466,
+    0x8469, 0x846b, 0x846c, 0x846d, 0x8471, 0x8475, 0x8477, 0x847a, 0x8482, 0x848b, 0x8490, 0x8494,
+    0x8499, 0x849c, 0x849e, 0x84b2, 0x84b8, 0x84bc, 0x84bf, 0x84c0, 0x84c4, 0x84c6, 0x84c9, 0x84ca,
+    0x84cb, 0x84d1, 0x84d3, 0x84d6, 0x84dd, 0x84df, 0x84ec, 0x84ee, 0x84ff, 0x8500, 0x8506, 0x8511,
+    0x8513, 0x8514, 0x8517, 0x851a, 0x8521, 0x8523, 0x8525, 0x8526, 0x852b, 0x852c, 0x852d, 0x8535,
+    0x8537, 0x853c, 0x853d, 0x8543, 0x8548, 0x8549, 0x854a, 0x854e, 0x8557, 0x8559, 0x855e, 0x8568,
+    0x8569, 0x856a, 0x856d, 0x8574, 0x857e, 0x8584, 0x8587, 0x858a, 0x8591, 0x8594, 0x8597, 0x8599,
+    0x859b, 0x859c, 0x85a6, 0x85a8, 0x85a9, 0x85aa, 0x85ab, 0x85ac, 0x85ae, 0x85af, 0x85b0, 0x85b9,
+    0x85ba, 0x85c1, 0x85c9, 0x85cd, 0x85cf, 0x85d0, 0x85d5, 0x85dd, 0x85e4, 0x85e5, 0x85e9, 0x85ea,
+    0x85f7, 0x85f9, 0x85fa, 0x85fb, 0x8606, 0x8607, 0x860a, 0x860b, 0x8611, 0x8617, 0x861a, 0x862d,
+    0x8638, 0x863f, 0x864e, 0x864f, 0x8650, 0x8651, 0x8654, 0x8655, 0x865a, 0x865b, 0x865c, 0x865e,
+    0x865f, 0x8667, 0x866b, 0x8671, 0x8679, 0x867a, 0x867b, 0x867d, 0x867e, 0x8680, 0x8681, 0x8682,
+    0x868a, 0x868c, 0x8693, 0x8695, 0x869c, 0x86a3, 0x86a4, 0x86a9, 0x86aa, 0x86af, 0x86b1, 0x86b5,
+    0x86b6, 0x86c0, 0x86c4, 0x86c6, 0x86c7, 0x86c9, 0x86ca, 0x86cb, 0x86cd, 0x86ce, 0x86d0, 0x86d4,
+    0x86d9, 0x86db, 0x86de, 0x86df, 0x86e4, 0x86ed, 0x86ee, 0x86f0, 0x86f8, 0x86f9, 0x86fb, 0x86fe,
+    0x8700, 0x8702, 0x8703, 0x8706, 0x8707, 0x8708, 0x870a, 0x8712, 0x8713, 0x8715, 0x8717, 0x8718,
+    0x871c, 0x8721, 0x8722, 0x8725, 0x8729, 0x8734, 0x8737, 0x873b, 0x873f, 0x8747, 0x8749, 0x874b,
+    0x874c, 0x874e, 0x8753, 0x8755, 0x8757, 0x8759, 0x8760, 0x8766, 0x8768, 0x8774, 0x8776, 0x8778,
+    0x877f, 0x8782, 0x8783, 0x878d, 0x879e, 0x879f, 0x87a2, 0x87ab, 0x87b3, 0x87ba, 0x87bb, 0x87c0,
+    0x87c6, 0x87c8, 0x87cb, 0x87d1, 0x87d2, 0x87e0, 0x87ec, 0x87ef, 0x87f2, 0x87f9, 0x87fb, 0x87fe,
+    0x8805, 0x880d, 0x8814, 0x8815, 0x881f, 0x8821, 0x8822, 0x8823, 0x8831, 0x8836, 0x8839, 0x883b,
+    0x8840, 0x8845, 0x8846, 0x884c, 0x884d, 0x8853, 0x8854, 0x8857, 0x8859, 0x885b, 0x885d, 0x8861,
+    0x8862, 0x8863, 0x8865, 0x8868, 0x886b, 0x886c, 0x8870, 0x8877, 0x8879, 0x887d, 0x887f, 0x8881,
+    0x8882, 0x8884, 0x8888, 0x888b, 0x888d, 0x8892, 0x8896, 0x889c, 0x889e, 0x88ab, 0x88ad, 0x88b1,
+    0x88b4, 0x88b7, 0x88c1, 0x88c2, 0x88c5, 0x88ca, 0x88cf, 0x88d2, 0x88d4, 0x88d5, 0x88d8, 0x88d9,
+    0x88dc, 0x88dd, 0x88df, 0x88e1, 0x88e4, 0x88e8, 0x88ef, 0x88f3, 0x88f4, 0x88f8, 0x88f9, 0x88fd,
+    0x88fe, 0x8902, 0x8907, 0x890a, 0x8910, 0x8912, 0x8913, 0x8915, 0x891a, 0x8921, 0x8925, 0x892a,
+    0x892b, 0x8932, 0x8936, 0x8938, 0x893b, 0x893d, 0x8944, 0x8956, 0x895e, 0x895f, 0x8960, 0x8964,
+    0x896a, 0x896c, 0x896f, 0x8972, 0x897f, 0x8981, 0x8983, 0x8986, 0x8987, 0x898b, 0x898f, 0x8993,
+    0x8996, 0x8997, 0x899a, 0x899c, 0x89a6, 0x89a7, 0x89aa, 0x89ac, 0x89b2, 0x89b3, 0x89ba, 0x89bd,
+    0x89c0, 0x89c1, 0x89c2, 0x89c4, 0x89c5, 0x89c6, 0x89c8, 0x89c9, 0x89d2, 0x89d4, 0x89e3, 0x89e6,
+    0x89f4, 0x89f8, 0x89fc, 0x8a00, 0x8a02, 0x8a03, 0x8a08, 0x8a0a, 0x8a0c, 0x8a0e, 0x8a0f, 0x8a10,
+    0x8a11, 0x8a13, 0x8a15, 0x8a16, 0x8a17, 0x8a18, 0x8a1b, 0x8a1d, 0x8a1f, 0x8a22, 0x8a23, 0x8a25,
+    0x8a2a, 0x8a2d, 0x8a31, 0x8a33, 0x8a34, 0x8a36, 0x8a3a, 0x8a3b, 0x8a3c, 0x8a3e, 0x8a41, 0x8a46,
+    0x8a50, 0x8a51, 0x8a54, 0x8a55, 0x8a56, 0x8a5b, 0x8a5e, 0x8a60, 0x8a62, 0x8a63, 0x8a66, 0x8a68,
+    0x8a69, 0x8a6b, 0x8a6c, 0x8a6d, 0x8a6e, 0x8a70, 0x8a71, 0x8a72, 0x8a73, 0x8a79, 0x8a7b, 0x8a7c,
+    0x8a85, 0x8a87, 0x8a89, 0x8a8a, 0x8a8c, 0x8a8d, 0x8a91, 0x8a93, 0x8a95, 0x8a98, 0x8a9a, 0x8a9e,
+    0x8aa0, 0x8aa1, 0x8aa3, 0x8aa4, 0x8aa5, 0x8aa6, 0x8aa7, 0x8aa8, 0x8aaa, 0x8aac, 0x8aad, 0x8ab0,
+    0x8ab2, 0x8ab6, 0x8ab9, 0x8abc, 0x8abf, 0x8ac2, 0x8ac4, 0x8ac7, 0x8ac9, 0x8acb, 0x8acc, 0x8acd,
+    0x8acf, 0x8ad2, 0x8ad6, 0x8adb, 0x8adc, 0x8ae6, 0x8ae7, 0x8aeb, 0x8aed, 0x8aee, 0x8af1, 0x8af3,
+    0x8af6, 0x8af7, 0x8af8, 0x8afa, 0x8afc, 0x8afe, 0x8b00, 0x8b01, 0x8b02, 0x8b04, 0x8b0a, 0x8b0e,
+    0x8b10, 0x8b17, 0x8b19, 0x8b1b, 0x8b1d, 0x8b20, 0x8b21, 0x8b28, 0x8b2b, 0x8b2c, 0x8b39, 0x8b41,
+    0x8b46, 0x8b49, 0x8b4e, 0x8b4f, 0x8b58, 0x8b59, 0x8b5a, 0x8b5c, 0x8b5f, 0x8b66, 0x8b6b, 0x8b6c,
+    0x8b6f, 0x8b70, 0x8b72, 0x8b74, 0x8b77, 0x8b7d, 0x8b80, 0x8b83, 0x8b8a, 0x8b90, 0x8b92, 0x8b93,
+    0x8b96, 0x8b9a, 0x8b9c, 0x8ba1, 0x8ba2, 0x8ba3, 0x8ba4, 0x8ba5, 0x8ba8, 0x8ba9, 0x8bab, 0x8bad,
+    0x8bae, 0x8baf, 0x8bb0, 0x8bb2, 0x8bb3, 0x8bb6, 0x8bb8, 0x8bb9, 0x8bba, 0x8bbc, 0x8bbd, 0x8bbe,
+    0x8bbf, 0x8bc0, 0x8bc1, 0x8bc4, 0x8bc5, 0x8bc6, 0x8bc8, 0x8bc9, 0x8bca, 0x8bcc, 0x8bcd, 0x8bd1,
+    0x8bd5, 0x8bd7, 0x8bda, 0x8bdb, 0x8bdd, 0x8bde, 0x8be1, 0x8be2, 0x8be3, 0x8be5, 0x8be6, 0x8be7,
+    0x8beb, 0x8bec, 0x8bed, 0x8bef, 0x8bf1, 0x8bf2, 0x8bf4, 0x8bf5, 0x8bf7, 0x8bf8, 0x8bfa, 0x8bfb,
+    0x8bfd, 0x8bfe, 0x8c01, 0x8c03, 0x8c05, 0x8c06, 0x8c08, 0x8c0a, 0x8c0b, 0x8c0d, 0x8c0e, 0x8c10,
+    0x8c13, 0x8c17, 0x8c1a, 0x8c1c, 0x8c22, 0x8c23, 0x8c24, 0x8c26, 0x8c28, 0x8c29, 0x8c2c, 0x8c2d,
+    0x8c30, 0x8c31, 0x8c34, 0x8c37, 0x8c3f, 0x8c41, 0x8c46, 0x8c48, 0x8c49, 0x8c4a, 0x8c4c, 0x8c4e,
+    0x8c50, 0x8c54, 0x8c55, 0x8c5a, 0x8c61, 0x8c62, 0x8c6a, 0x8c6b, 0x8c6c, 0x8c6d, 0x8c73, 0x8c79,
+    0x8c7a, 0x8c82, 0x8c89, 0x8c8a, 0x8c8c, 0x8c8d, 0x8c93, 0x8c9d, 0x8c9e, 0x8ca0, 0x8ca1, 0x8ca2,
+    0x8ca7, 0x8ca8, 0x8ca9, 0x8caa, 0x8cab, 0x8cac, 0x8caf, 0x8cb0, 0x8cb2, 0x8cb3, 0x8cb4, 0x8cb6,
+    0x8cb7, 0x8cb8, 0x8cbb, 0x8cbc, 0x8cbd, 0x8cbf, 0x8cc0, 0x8cc1, 0x8cc2, 0x8cc3, 0x8cc4, 0x8cc5,
+    0x8cc7, 0x8cc8, 0x8cca, 0x8cce, 0x8cd1, 0x8cd2, 0x8cd3, 0x8cdb, 0x8cdc, 0x8cde, 0x8ce0, 0x8ce1,
+    0x8ce2, 0x8ce3, 0x8ce4, 0x8ce6, 0x8cea, 0x8cec, 0x8ced, 0x8cf4, 0x8cf8, 0x8cfa, 0x8cfb, 0x8cfc,
+    0x8cfd, 0x8d05, 0x8d08, 0x8d0a, 0x8d0b, 0x8d0d, 0x8d0f, 0x8d13, 0x8d16, 0x8d17, 0x8d1b, 0x8d1d,
+    0x8d1e, 0x8d1f, 0x8d21, 0x8d22, 0x8d23, 0x8d24, 0x8d25, 0x8d26, 0x8d27, 0x8d28, 0x8d29, 0x8d2a,
+    0x8d2b, 0x8d2c, 0x8d2d, 0x8d2e, 0x8d2f, 0x8d30, 0x8d31, 0x8d34, 0x8d35, 0x8d37, 0x8d38, 0x8d39,
+    0x8d3a, 0x8d3c, 0x8d3e, 0x8d3f, 0x8d41, 0x8d42, 0x8d43, 0x8d44, 0x8d4a, 0x8d4b, 0x8d4c, 0x8d4e,
+    0x8d4f, 0x8d50, 0x8d54, 0x8d56, 0x8d58, 0x8d5a, 0x8d5b, 0x8d5e, 0x8d60, 0x8d61, 0x8d62, 0x8d63,
+    0x8d64, 0x8d66, 0x8d67, 0x8d6b, 0x8d6d, 0x8d70, 0x8d73, 0x8d74, 0x8d75, 0x8d76, 0x8d77, 0x8d81,
+    0x8d85, 0x8d8a, 0x8d8b, 0x8d95, 0x8d99, 0x8d9f, 0x8da3, 0x8da8, 0x8db3, 0x8db4, 0x8dba, 0x8dbe,
+    0x8dc3, 0x8dc6, 0x8dcb, 0x8dcc, 0x8dce, 0x8dd1, 0x8dda, 0x8ddb, 0x8ddd, 0x8ddf, 0x8de1, 0x8de4,
+    0x8de6, 0x8de8, 0x8dea, 0x8def, 0x8df3, 0x8df5, 0x8dfa, 0x8dfc, 0x8e0a, 0x8e0c, 0x8e0f, 0x8e10,
+    0x8e1d, 0x8e1e, 0x8e1f, 0x8e21, 0x8e22, 0x8e29, 0x8e2a, 0x8e2b, 0x8e31, 0x8e34, 0x8e35, 0x8e39,
+    0x8e42, 0x8e44, 0x8e48, 0x8e49, 0x8e4a, 0x8e4b, 0x8e55, 0x8e59, 0x8e5f, 0x8e63, 0x8e64, 0x8e66,
+    0x8e6c, 0x8e6d, 0x8e72, 0x8e74, 0x8e76, 0x8e7a, 0x8e7c, 0x8e7f, 0x8e81, 0x8e82, 0x8e85, 0x8e87,
+    0x8e89, 0x8e8a, 0x8e8b, 0x8e8d, 0x8e91, 0x8e93, 0x8ea1, 0x8eaa, 0x8eab, 0x8eac, 0x8eaf, 0x8eb2,
+    0x8eba, 0x8ec0, 0x8eca, 0x8ecb, 0x8ecc, 0x8ecd, 0x8ecf, 0x8ed2, 0x8ed4, 0x8edb, 0x8edf, 0x8ee2,
+    0x8ef8, 0x8efb, 0x8efc, 0x8efd, 0x8efe, 0x8f03, 0x8f09, 0x8f0a, 0x8f12, 0x8f13, 0x8f14, 0x8f15,
+    0x8f1b, 0x8f1c, 0x8f1d, 0x8f1e, 0x8f1f, 0x8f25, 0x8f26, 0x8f29, 0x8f2a, 0x8f2f, 0x8f33, 0x8f38,
+    0x8f3b, 0x8f3e, 0x8f3f, 0x8f42, 0x8f44, 0x8f45, 0x8f49, 0x8f4d, 0x8f4e, 0x8f54, 0x8f5f, 0x8f61,
+    0x8f66, 0x8f67, 0x8f68, 0x8f69, 0x8f6c, 0x8f6e, 0x8f6f, 0x8f70, 0x8f74, 0x8f7b, 0x8f7d, 0x8f7f,
+    0x8f83, 0x8f85, 0x8f86, 0x8f88, 0x8f89, 0x8f8a, 0x8f90, 0x8f91, 0x8f93, 0x8f95, 0x8f96, 0x8f97,
+    0x8f99, 0x8f9b, 0x8f9c, 0x8f9e, 0x8f9f, 0x8fa3, 0x8fa6, 0x8fa8, 0x8fa9, 0x8fab, 0x8fad, 0x8fae,
+    0x8faf, 0x8fb0, 0x8fb1, 0x8fb2, 0x8fb9, 0x8fba, 0x8fbb, 0x8fbc, 0x8fbd, 0x8fbe, 0x8fbf, 0x8fc1,
+    0x8fc2, 0x8fc4, 0x8fc5, 0x8fc6, 0x8fc7, 0x8fc8, 0x8fce, 0x8fd0, 0x8fd1, 0x8fd4, 0x8fd8, 0x8fd9,
+    0x8fdb, 0x8fdc, 0x8fdd, 0x8fde, 0x8fdf, 0x8fe2, 0x8fe4, 0x8fe5, 0x8fe6, 0x8fe8, 0x8fe9, 0x8fea,
+    0x8feb, 0x8fed, 0x8ff0, 0x8ff4, 0x8ff7, 0x8ff8, 0x8ff9, 0x8ffa, 0x8ffd, 0x9000, 0x9001, 0x9002,
+    0x9003, 0x9005, 0x9006, 0x9009, 0x900a, 0x900d, 0x900f, 0x9010, 0x9012, 0x9013, 0x9014, 0x9015,
+    0x9016, 0x9017, 0x9019, 0x901a, 0x901b, 0x901d, 0x901e, 0x901f, 0x9020, 0x9022, 0x9023, 0x902e,
+    0x9031, 0x9032, 0x9035, 0x9036, 0x9038, 0x903b, 0x903c, 0x903e, 0x9041, 0x9042, 0x9045, 0x9047,
+    0x904a, 0x904b, 0x904d, 0x904e, 0x904f, 0x9050, 0x9051, 0x9053, 0x9054, 0x9055, 0x9057, 0x9058,
+    0x9059, 0x905b, 0x905c, 0x905d, 0x905e, 0x9060, 0x9061, 0x9062, 0x9063, 0x9065, 0x9068, 0x9069,
+    0x906d, 0x906e, 0x9072, 0x9074, 0x9075, 0x9077, 0x9078, 0x907a, 0x907c, 0x907d, 0x907f, 0x9080,
+    0x9081, 0x9082, 0x9083, 0x9084, 0x9087, 0x9088, 0x908a, 0x908b, 0x908f, 0x9090, 0x9091, 0x9093,
+    0x9095, 0x90a2, 0x90a3, 0x90a6, 0x90aa, 0x90ae, 0x90af, 0x90b1, 0x90b5, 0x90b6, 0x90b8, 0x90b9,
+    0x90bb, 0x90c1, 0x90c3, 0x90ca, 0x90ce, 0x90d1, 0x90dd, 0x90e1, 0x90e2, 0x90e7, 0x90e8, 0x90ed,
+    0x90f4, 0x90f5, 0x90f7, 0x90f8, 0x90fd, 0x90fe, 0x9102, 0x9109, 0x9112, 0x9117, 0x9118, 0x9119,
+    0x911e, 0x9127, 0x912d, 0x9130, 0x9131, 0x9134, 0x9139, 0x9148, 0x9149, 0x914a, 0x914b, 0x914c,
+    0x914d, 0x914e, 0x9152, 0x9154, 0x9157, 0x915a, 0x915d, 0x915e, 0x9162, 0x9163, 0x9165, 0x9169,
+    0x916a, 0x916c, 0x916e, 0x9171, 0x9174, 0x9175, 0x9176, 0x9177, 0x9178, 0x917f, 0x9183, 0x9187,
+    0x9189, 0x918b, 0x918d, 0x9190, 0x9192, 0x9197, 0x919a, 0x919b, 0x919c, 0x919e, 0x91a3, 0x91a4,
+    0x91ab, 0x91ac, 0x91ae, 0x91b1, 0x91b4, 0x91b8, 0x91ba, 0x91c0, 0x91c1, 0x91c5, 0x91c6, 0x91c7,
+    0x91c8, 0x91c9, 0x91ca, 0x91cb, 0x91cc, 0x91cd, 0x91ce, 0x91cf, 0x91d0, 0x91d1, 0x91d7, 0x91d8,
+    0x91d9, 0x91dc, 0x91dd, 0x91e3, 0x91e6, 0x91e7, 0x91e9, 0x91ed, 0x91f5, 0x9207, 0x9209, 0x920d,
+    0x920e, 0x9210, 0x9211, 0x9214, 0x9215, 0x921e, 0x9223, 0x9234, 0x9237, 0x9238, 0x9239, 0x923d,
+    0x923e, 0x923f, 0x9240, 0x9244, 0x9245, 0x9249, 0x924b, 0x924d, 0x9251, 0x9257, 0x925a, 0x925b,
+    0x9262, 0x9264, 0x9266, 0x9271, 0x9274, 0x9278, 0x927b, 0x927c, 0x927e, 0x9280, 0x9283, 0x9285,
+    0x9291, 0x9293, 0x9296, 0x9298, 0x929a, 0x929c, 0x92a8, 0x92ac, 0x92ad, 0x92b2, 0x92b3, 0x92b7,
+    0x92bb, 0x92bc, 0x92c1, 0x92c5, 0x92c7, 0x92d2, 0x92e4, 0x92ea, 0x92ed, 0x92f0, 0x92f2, 0x92f3,
+    0x92f8, 0x92fc, 0x9304, 0x9306, 0x9310, 0x9315, 0x9318, 0x9319, 0x931a, 0x9320, 0x9321, 0x9322,
+    0x9326, 0x9328, 0x932b, 0x932c, 0x932e, 0x932f, 0x9332, 0x9333, 0x9336, 0x934a, 0x934b, 0x934d,
+    0x9354, 0x935a, 0x935b, 0x9365, 0x936c, 0x9370, 0x9375, 0x937e, 0x9382, 0x938a, 0x938c, 0x9394,
+    0x9396, 0x9397, 0x9398, 0x939a, 0x93a2, 0x93a7, 0x93ac, 0x93ae, 0x93b0, 0x93b3, 0x93c3, 0x93c8,
+    0x93cd, 0x93d1, 0x93d6, 0x93d7, 0x93d8, 0x93dc, 0x93dd, 0x93df, 0x93e1, 0x93e2, 0x93e4, 0x93e8,
+    0x93fd, 0x9403, 0x9418, 0x9419, 0x942b, 0x942e, 0x9432, 0x9433, 0x9435, 0x9438, 0x943a, 0x9444,
+    0x9451, 0x9452, 0x9453, 0x9460, 0x9463, 0x9464, 0x946a, 0x9470, 0x9472, 0x9477, 0x947c, 0x947d,
+    0x947e, 0x947f, 0x9488, 0x9489, 0x948e, 0x9492, 0x9493, 0x9499, 0x949d, 0x949e, 0x949f, 0x94a0,
+    0x94a1, 0x94a2, 0x94a5, 0x94a6, 0x94a7, 0x94a8, 0x94a9, 0x94ae, 0x94b1, 0x94b3, 0x94b5, 0x94bb,
+    0x94be, 0x94c0, 0x94c1, 0x94c2, 0x94c3, 0x94c5, 0x94c6, 0x94dc, 0x94dd, 0x94e1, 0x94e3, 0x94ec,
+    0x94ed, 0x94f0, 0x94f1, 0x94f2, 0x94f6, 0x94f8, 0x94fa, 0x94fe, 0x9500, 0x9501, 0x9504, 0x9505,
+    0x9508, 0x950b, 0x950c, 0x9510, 0x9511, 0x9517, 0x9519, 0x951a, 0x9521, 0x9523, 0x9524, 0x9525,
+    0x9526, 0x9528, 0x952d, 0x952e, 0x952f, 0x9530, 0x9539, 0x953b, 0x9540, 0x9541, 0x9547, 0x954a,
+    0x954d, 0x9550, 0x9551, 0x955c, 0x9563, 0x956d, 0x9570, 0x9576, 0x9577, 0x957f, 0x9580, 0x9582,
+    0x9583, 0x9589, 0x958b, 0x958e, 0x958f, 0x9591, 0x9592, 0x9593, 0x9594, 0x9598, 0x95a1, 0x95a2,
+    0x95a3, 0x95a4, 0x95a5, 0x95a8, 0x95a9, 0x95ad, 0x95b1, 0x95b2, 0x95bb, 0x95c6, 0x95c7, 0x95c8,
+    0x95ca, 0x95cb, 0x95cc, 0x95d0, 0x95d4, 0x95d5, 0x95d6, 0x95d8, 0x95dc, 0x95e1, 0x95e2, 0x95e8,
+    0x95ea, 0x95ed, 0x95ee, 0x95ef, 0x95f0, 0x95f2, 0x95f4, 0x95f7, 0x95f8, 0x95f9, 0x95fa, 0x95fb,
+    0x95fd, 0x9600, 0x9601, 0x9602, 0x9605, 0x9609, 0x960e, 0x9610, 0x9611, 0x9614, 0x961c, 0x961f,
+    0x9621, 0x962a, 0x962c, 0x962e, 0x9631, 0x9632, 0x9633, 0x9634, 0x9635, 0x9636, 0x963b, 0x963f,
+    0x9640, 0x9642, 0x9644, 0x9645, 0x9646, 0x9647, 0x9648, 0x964b, 0x964c, 0x964d, 0x9650, 0x9655,
+    0x9658, 0x965b, 0x965d, 0x965e, 0x9661, 0x9662, 0x9663, 0x9664, 0x9665, 0x9668, 0x9669, 0x966a,
+    0x966c, 0x9670, 0x9672, 0x9673, 0x9674, 0x9675, 0x9676, 0x9677, 0x9678, 0x967a, 0x967d, 0x9684,
+    0x9685, 0x9686, 0x9688, 0x968a, 0x968b, 0x968d, 0x968e, 0x968f, 0x9690, 0x9694, 0x9695, 0x9698,
+    0x9699, 0x969b, 0x969c, 0x96a0, 0x96a3, 0x96a7, 0x96a8, 0x96aa, 0x96b1, 0x96b4, 0x96b6, 0x96b7,
+    0x96b8, 0x96b9, 0x96bb, 0x96bc, 0x96be, 0x96c0, 0x96c1, 0x96c4, 0x96c5, 0x96c6, 0x96c7, 0x96c9,
+    0x96ca, 0x96cb, 0x96cc, 0x96cd, 0x96cf, 0x96d1, 0x96d2, 0x96d5, 0x96d6, 0x96d9, 0x96db, 0x96dc,
+    0x96de, 0x96e2, 0x96e3, 0x96e8, 0x96e9, 0x96ea, 0x96eb, 0x96ef, 0x96f0, 0x96f2, 0x96f6, 0x96f7,
+    0x96f9, 0x96fb, 0x96fe, 0x9700, 0x9704, 0x9706, 0x9707, 0x9709, 0x970a, 0x970d, 0x970e, 0x970f,
+    0x9711, 0x9713, 0x9716, 0x971c, 0x971e, 0x9724, 0x9727, 0x972a, 0x9730, 0x9732, 0x9738, 0x9739,
+    0x973d, 0x973e, 0x9742, 0x9744, 0x9748, 0x9752, 0x9756, 0x9759, 0x975b, 0x975c, 0x975e, 0x9760,
+    0x9761, 0x9762, 0x9766, 0x9768, 0x9769, 0x976d, 0x9773, 0x9774, 0x9776, 0x977c, 0x9784, 0x9785,
+    0x978b, 0x978d, 0x978f, 0x9798, 0x97a0, 0x97a3, 0x97a6, 0x97ad, 0x97c1, 0x97c3, 0x97c6, 0x97c9,
+    0x97cb, 0x97cc, 0x97d3, 0x97dc, 0x97e6, 0x97e7, 0x97e9, 0x97ed, 0x97ee, 0x97f3, 0x97f5, 0x97f6,
+    0x97f9, 0x97fb, 0x97ff, 0x9801, 0x9802, 0x9803, 0x9805, 0x9806, 0x9808, 0x980a, 0x980c, 0x9810,
+    0x9811, 0x9812, 0x9813, 0x9817, 0x9818, 0x981a, 0x981c, 0x9821, 0x9824, 0x982b, 0x982c, 0x982d,
+    0x9830, 0x9834, 0x9837, 0x9838, 0x9839, 0x983b, 0x983c, 0x9846, 0x984c, 0x984d, 0x984e, 0x984f,
+    0x9853, 0x9854, 0x9855, 0x9858, 0x985b, 0x985e, 0x9865, 0x9867, 0x986b, 0x986f, 0x9870, 0x9871,
+    0x9875, 0x9876, 0x9877, 0x9879, 0x987a, 0x987b, 0x987d, 0x987e, 0x987f, 0x9881, 0x9882, 0x9884,
+    0x9885, 0x9886, 0x9887, 0x9888, 0x988a, 0x9890, 0x9891, 0x9893, 0x9896, 0x9897, 0x9898, 0x989c,
+    0x989d, 0x98a0, 0x98a4, 0x98a7, 0x98a8, 0x98af, 0x98b1, 0x98b3, 0x98b6, 0x98ba, 0x98bc, 0x98c4,
+    0x98ce, 0x98d8, 0x98db, 0x98de, 0x98df, 0x98e2, 0x98e7, 0x98e9, 0x98ea, 0x98ed, 0x98ef, 0x98f2,
+    0x98f4, 0x98fc, 0x98fd, 0x98fe, 0x9903, 0x9905, 0x9909, 0x990a, 0x990c, 0x9910, 0x9912, 0x9913,
+    0x9918, 0x991a, 0x991b, 0x991e, 0x9921, 0x9928, 0x992e, 0x9935, 0x993d, 0x993e, 0x993f, 0x9945,
+    0x9949, 0x9951, 0x9952, 0x9955, 0x9957, 0x995c, 0x995e, 0x9965, 0x996d, 0x996e, 0x996f, 0x9970,
+    0x9971, 0x9972, 0x9975, 0x9976, 0x997a, 0x997c, 0x997f, 0x9981, 0x9985, 0x9986, 0x9988, 0x998b,
+    0x998f, 0x9992, 0x9996, 0x9999, 0x99a5, 0x99a8, 0x99ac, 0x99ad, 0x99ae, 0x99b1, 0x99b3, 0x99b4,
+    0x99c1, 0x99c4, 0x99c5, 0x99c6, 0x99c8, 0x99d0, 0x99d1, 0x99d2, 0x99d5, 0x99d9, 0x99db, 0x99dd,
+    0x99df, 0x99e2, 0x99ed, 0x99f1, 0x99ff, 0x9a01, 0x9a0e, 0x9a12, 0x9a13, 0x9a16, 0x9a19, 0x9a28,
+    0x9a2b, 0x9a30, 0x9a35, 0x9a37, 0x9a3e, 0x9a40, 0x9a43, 0x9a45, 0x9a4d, 0x9a55, 0x9a57, 0x9a5a,
+    0x9a5b, 0x9a5f, 0x9a62, 0x9a65, 0x9a6a, 0x9a6c, 0x9a6d, 0x9a6e, 0x9a6f, 0x9a70, 0x9a71, 0x9a73,
+    0x9a74, 0x9a76, 0x9a79, 0x9a7b, 0x9a7c, 0x9a7e, 0x9a82, 0x9a84, 0x9a86, 0x9a87, 0x9a8b, 0x9a8c,
+    0x9a8f, 0x9a91, 0x9a97, 0x9a9a, 0x9aa1, 0x9aa4, 0x9aa8, 0x9aaf, 0x9ab0, 0x9ab7, 0x9ab8, 0x9abc,
+    0x9ac1, 0x9ac4, 0x9acf, 0x9ad1, 0x9ad2, 0x9ad3, 0x9ad4, 0x9ad6, 0x9ad8, 0x9ae1, 0x9ae6, 0x9aea,
+    0x9aed, 0x9aee, 0x9aef, 0x9afb, 0x9b03, 0x9b06, 0x9b0d, 0x9b1a, 0x9b22, 0x9b23, 0x9b25, 0x9b27,
+    0x9b28, 0x9b31, 0x9b32, 0x9b3c, 0x9b41, 0x9b42, 0x9b44, 0x9b45, 0x9b4d, 0x9b4e, 0x9b4f, 0x9b51,
+    0x9b54, 0x9b58, 0x9b5a, 0x9b6f, 0x9b77, 0x9b8e, 0x9b91, 0x9b92, 0x9baa, 0x9bab, 0x9bad, 0x9bae,
+    0x9bc0, 0x9bc8, 0x9bc9, 0x9bca, 0x9bd6, 0x9bdb, 0x9be7, 0x9be8, 0x9bf5, 0x9bfd, 0x9c0d, 0x9c10,
+    0x9c13, 0x9c25, 0x9c2d, 0x9c2f, 0x9c31, 0x9c39, 0x9c3b, 0x9c3e, 0x9c48, 0x9c49, 0x9c52, 0x9c54,
+    0x9c56, 0x9c57, 0x9c5f, 0x9c77, 0x9c78, 0x9c7c, 0x9c81, 0x9c8d, 0x9c9c, 0x9ca4, 0x9cb8, 0x9cc3,
+    0x9cd6, 0x9cde, 0x9ce5, 0x9ce9, 0x9cf3, 0x9cf4, 0x9cf6, 0x9d03, 0x9d06, 0x9d07, 0x9d09, 0x9d0e,
+    0x9d12, 0x9d15, 0x9d1b, 0x9d23, 0x9d26, 0x9d28, 0x9d2b, 0x9d2c, 0x9d3b, 0x9d3f, 0x9d51, 0x9d5c,
+    0x9d5d, 0x9d60, 0x9d61, 0x9d6a, 0x9d6c, 0x9d72, 0x9d89, 0x9d8f, 0x9daf, 0x9db4, 0x9db8, 0x9dc2,
+    0x9dd3, 0x9dd7, 0x9de5, 0x9df2, 0x9df9, 0x9dfa, 0x9e1a, 0x9e1b, 0x9e1e, 0x9e1f, 0x9e21, 0x9e23,
+    0x9e25, 0x9e26, 0x9e2d, 0x9e2f, 0x9e33, 0x9e35, 0x9e3d, 0x9e3f, 0x9e43, 0x9e45, 0x9e4a, 0x9e4f,
+    0x9e64, 0x9e70, 0x9e75, 0x9e78, 0x9e79, 0x9e7c, 0x9e7d, 0x9e7f, 0x9e82, 0x9e8b, 0x9e92, 0x9e93,
+    0x9e97, 0x9e9d, 0x9e9f, 0x9ea5, 0x9ea6, 0x9ea9, 0x9eb4, 0x9eb5, 0x9eb9, 0x9eba, 0x9ebb, 0x9ebc,
+    0x9ebe, 0x9ebf, 0x9ec3, 0x9ec4, 0x9ecc, 0x9ecd, 0x9ece, 0x9ecf, 0x9ed1, 0x9ed2, 0x9ed4, 0x9ed8,
+    0x9ed9, 0x9edb, 0x9edc, 0x9edd, 0x9ede, 0x9ee0, 0x9ee8, 0x9eef, 0x9ef4, 0x9ef7, 0x9f07, 0x9f0e,
+    0x9f13, 0x9f15, 0x9f19, 0x9f20, 0x9f2c, 0x9f2f, 0x9f34, 0x9f3b, 0x9f3e, 0x9f4a, 0x9f4b, 0x9f50,
+    0x9f52, 0x9f5c, 0x9f5f, 0x9f61, 0x9f62, 0x9f63, 0x9f66, 0x9f67, 0x9f6a, 0x9f6c, 0x9f72, 0x9f77,
+    0x9f7f, 0x9f84, 0x9f8b, 0x9f8d, 0x9f90, 0x9f94, 0x9f99, 0x9f9a, 0x9f9c, 0x9f9f,
+};
+
+static const uint16_t commonHangul[2350] = {
+    0xac00, 0xac01, 0xac04, 0xac07, 0xac08, 0xac09, 0xac0a, 0xac10, 0xac11, 0xac12, 0xac13, 0xac14,
+    0xac15, 0xac16, 0xac17, 0xac19, 0xac1a, 0xac1b, 0xac1c, 0xac1d, 0xac20, 0xac24, 0xac2c, 0xac2d,
+    0xac2f, 0xac30, 0xac31, 0xac38, 0xac39, 0xac3c, 0xac40, 0xac4b, 0xac4d, 0xac54, 0xac58, 0xac5c,
+    0xac70, 0xac71, 0xac74, 0xac77, 0xac78, 0xac7a, 0xac80, 0xac81, 0xac83, 0xac84, 0xac85, 0xac86,
+    0xac89, 0xac8a, 0xac8b, 0xac8c, 0xac90, 0xac94, 0xac9c, 0xac9d, 0xac9f, 0xaca0, 0xaca1, 0xaca8,
+    0xaca9, 0xacaa, 0xacac, 0xacaf, 0xacb0, 0xacb8, 0xacb9, 0xacbb, 0xacbc, 0xacbd, 0xacc1, 0xacc4,
+    0xacc8, 0xaccc, 0xacd5, 0xacd7, 0xace0, 0xace1, 0xace4, 0xace7, 0xace8, 0xacea, 0xacec, 0xacef,
+    0xacf0, 0xacf1, 0xacf3, 0xacf5, 0xacf6, 0xacfc, 0xacfd, 0xad00, 0xad04, 0xad06, 0xad0c, 0xad0d,
+    0xad0f, 0xad11, 0xad18, 0xad1c, 0xad20, 0xad29, 0xad2c, 0xad2d, 0xad34, 0xad35, 0xad38, 0xad3c,
+    0xad44, 0xad45, 0xad47, 0xad49, 0xad50, 0xad54, 0xad58, 0xad61, 0xad63, 0xad6c, 0xad6d, 0xad70,
+    0xad73, 0xad74, 0xad75, 0xad76, 0xad7b, 0xad7c, 0xad7d, 0xad7f, 0xad81, 0xad82, 0xad88, 0xad89,
+    0xad8c, 0xad90, 0xad9c, 0xad9d, 0xada4, 0xadb7, 0xadc0, 0xadc1, 0xadc4, 0xadc8, 0xadd0, 0xadd1,
+    0xadd3, 0xaddc, 0xade0, 0xade4, 0xadf8, 0xadf9, 0xadfc, 0xadff, 0xae00, 0xae01, 0xae08, 0xae09,
+    0xae0b, 0xae0d, 0xae14, 0xae30, 0xae31, 0xae34, 0xae37, 0xae38, 0xae3a, 0xae40, 0xae41, 0xae43,
+    0xae45, 0xae46, 0xae4a, 0xae4c, 0xae4d, 0xae4e, 0xae50, 0xae54, 0xae56, 0xae5c, 0xae5d, 0xae5f,
+    0xae60, 0xae61, 0xae65, 0xae68, 0xae69, 0xae6c, 0xae70, 0xae78, 0xae79, 0xae7b, 0xae7c, 0xae7d,
+    0xae84, 0xae85, 0xae8c, 0xaebc, 0xaebd, 0xaebe, 0xaec0, 0xaec4, 0xaecc, 0xaecd, 0xaecf, 0xaed0,
+    0xaed1, 0xaed8, 0xaed9, 0xaedc, 0xaee8, 0xaeeb, 0xaeed, 0xaef4, 0xaef8, 0xaefc, 0xaf07, 0xaf08,
+    0xaf0d, 0xaf10, 0xaf2c, 0xaf2d, 0xaf30, 0xaf32, 0xaf34, 0xaf3c, 0xaf3d, 0xaf3f, 0xaf41, 0xaf42,
+    0xaf43, 0xaf48, 0xaf49, 0xaf50, 0xaf5c, 0xaf5d, 0xaf64, 0xaf65, 0xaf79, 0xaf80, 0xaf84, 0xaf88,
+    0xaf90, 0xaf91, 0xaf95, 0xaf9c, 0xafb8, 0xafb9, 0xafbc, 0xafc0, 0xafc7, 0xafc8, 0xafc9, 0xafcb,
+    0xafcd, 0xafce, 0xafd4, 0xafdc, 0xafe8, 0xafe9, 0xaff0, 0xaff1, 0xaff4, 0xaff8, 0xb000, 0xb001,
+    0xb004, 0xb00c, 0xb010, 0xb014, 0xb01c, 0xb01d, 0xb028, 0xb044, 0xb045, 0xb048, 0xb04a, 0xb04c,
+    0xb04e, 0xb053, 0xb054, 0xb055, 0xb057, 0xb059, 0xb05d, 0xb07c, 0xb07d, 0xb080, 0xb084, 0xb08c,
+    0xb08d, 0xb08f, 0xb091, 0xb098, 0xb099, 0xb09a, 0xb09c, 0xb09f, 0xb0a0, 0xb0a1, 0xb0a2, 0xb0a8,
+    0xb0a9, 0xb0ab, 0xb0ac, 0xb0ad, 0xb0ae, 0xb0af, 0xb0b1, 0xb0b3, 0xb0b4, 0xb0b5, 0xb0b8, 0xb0bc,
+    0xb0c4, 0xb0c5, 0xb0c7, 0xb0c8, 0xb0c9, 0xb0d0, 0xb0d1, 0xb0d4, 0xb0d8, 0xb0e0, 0xb0e5, 0xb108,
+    0xb109, 0xb10b, 0xb10c, 0xb110, 0xb112, 0xb113, 0xb118, 0xb119, 0xb11b, 0xb11c, 0xb11d, 0xb123,
+    0xb124, 0xb125, 0xb128, 0xb12c, 0xb134, 0xb135, 0xb137, 0xb138, 0xb139, 0xb140, 0xb141, 0xb144,
+    0xb148, 0xb150, 0xb151, 0xb154, 0xb155, 0xb158, 0xb15c, 0xb160, 0xb178, 0xb179, 0xb17c, 0xb180,
+    0xb182, 0xb188, 0xb189, 0xb18b, 0xb18d, 0xb192, 0xb193, 0xb194, 0xb198, 0xb19c, 0xb1a8, 0xb1cc,
+    0xb1d0, 0xb1d4, 0xb1dc, 0xb1dd, 0xb1df, 0xb1e8, 0xb1e9, 0xb1ec, 0xb1f0, 0xb1f9, 0xb1fb, 0xb1fd,
+    0xb204, 0xb205, 0xb208, 0xb20b, 0xb20c, 0xb214, 0xb215, 0xb217, 0xb219, 0xb220, 0xb234, 0xb23c,
+    0xb258, 0xb25c, 0xb260, 0xb268, 0xb269, 0xb274, 0xb275, 0xb27c, 0xb284, 0xb285, 0xb289, 0xb290,
+    0xb291, 0xb294, 0xb298, 0xb299, 0xb29a, 0xb2a0, 0xb2a1, 0xb2a3, 0xb2a5, 0xb2a6, 0xb2aa, 0xb2ac,
+    0xb2b0, 0xb2b4, 0xb2c8, 0xb2c9, 0xb2cc, 0xb2d0, 0xb2d2, 0xb2d8, 0xb2d9, 0xb2db, 0xb2dd, 0xb2e2,
+    0xb2e4, 0xb2e5, 0xb2e6, 0xb2e8, 0xb2eb, 0xb2ec, 0xb2ed, 0xb2ee, 0xb2ef, 0xb2f3, 0xb2f4, 0xb2f5,
+    0xb2f7, 0xb2f8, 0xb2f9, 0xb2fa, 0xb2fb, 0xb2ff, 0xb300, 0xb301, 0xb304, 0xb308, 0xb310, 0xb311,
+    0xb313, 0xb314, 0xb315, 0xb31c, 0xb354, 0xb355, 0xb356, 0xb358, 0xb35b, 0xb35c, 0xb35e, 0xb35f,
+    0xb364, 0xb365, 0xb367, 0xb369, 0xb36b, 0xb36e, 0xb370, 0xb371, 0xb374, 0xb378, 0xb380, 0xb381,
+    0xb383, 0xb384, 0xb385, 0xb38c, 0xb390, 0xb394, 0xb3a0, 0xb3a1, 0xb3a8, 0xb3ac, 0xb3c4, 0xb3c5,
+    0xb3c8, 0xb3cb, 0xb3cc, 0xb3ce, 0xb3d0, 0xb3d4, 0xb3d5, 0xb3d7, 0xb3d9, 0xb3db, 0xb3dd, 0xb3e0,
+    0xb3e4, 0xb3e8, 0xb3fc, 0xb410, 0xb418, 0xb41c, 0xb420, 0xb428, 0xb429, 0xb42b, 0xb434, 0xb450,
+    0xb451, 0xb454, 0xb458, 0xb460, 0xb461, 0xb463, 0xb465, 0xb46c, 0xb480, 0xb488, 0xb49d, 0xb4a4,
+    0xb4a8, 0xb4ac, 0xb4b5, 0xb4b7, 0xb4b9, 0xb4c0, 0xb4c4, 0xb4c8, 0xb4d0, 0xb4d5, 0xb4dc, 0xb4dd,
+    0xb4e0, 0xb4e3, 0xb4e4, 0xb4e6, 0xb4ec, 0xb4ed, 0xb4ef, 0xb4f1, 0xb4f8, 0xb514, 0xb515, 0xb518,
+    0xb51b, 0xb51c, 0xb524, 0xb525, 0xb527, 0xb528, 0xb529, 0xb52a, 0xb530, 0xb531, 0xb534, 0xb538,
+    0xb540, 0xb541, 0xb543, 0xb544, 0xb545, 0xb54b, 0xb54c, 0xb54d, 0xb550, 0xb554, 0xb55c, 0xb55d,
+    0xb55f, 0xb560, 0xb561, 0xb5a0, 0xb5a1, 0xb5a4, 0xb5a8, 0xb5aa, 0xb5ab, 0xb5b0, 0xb5b1, 0xb5b3,
+    0xb5b4, 0xb5b5, 0xb5bb, 0xb5bc, 0xb5bd, 0xb5c0, 0xb5c4, 0xb5cc, 0xb5cd, 0xb5cf, 0xb5d0, 0xb5d1,
+    0xb5d8, 0xb5ec, 0xb610, 0xb611, 0xb614, 0xb618, 0xb625, 0xb62c, 0xb634, 0xb648, 0xb664, 0xb668,
+    0xb69c, 0xb69d, 0xb6a0, 0xb6a4, 0xb6ab, 0xb6ac, 0xb6b1, 0xb6d4, 0xb6f0, 0xb6f4, 0xb6f8, 0xb700,
+    0xb701, 0xb705, 0xb728, 0xb729, 0xb72c, 0xb72f, 0xb730, 0xb738, 0xb739, 0xb73b, 0xb744, 0xb748,
+    0xb74c, 0xb754, 0xb755, 0xb760, 0xb764, 0xb768, 0xb770, 0xb771, 0xb773, 0xb775, 0xb77c, 0xb77d,
+    0xb780, 0xb784, 0xb78c, 0xb78d, 0xb78f, 0xb790, 0xb791, 0xb792, 0xb796, 0xb797, 0xb798, 0xb799,
+    0xb79c, 0xb7a0, 0xb7a8, 0xb7a9, 0xb7ab, 0xb7ac, 0xb7ad, 0xb7b4, 0xb7b5, 0xb7b8, 0xb7c7, 0xb7c9,
+    0xb7ec, 0xb7ed, 0xb7f0, 0xb7f4, 0xb7fc, 0xb7fd, 0xb7ff, 0xb800, 0xb801, 0xb807, 0xb808, 0xb809,
+    0xb80c, 0xb810, 0xb818, 0xb819, 0xb81b, 0xb81d, 0xb824, 0xb825, 0xb828, 0xb82c, 0xb834, 0xb835,
+    0xb837, 0xb838, 0xb839, 0xb840, 0xb844, 0xb851, 0xb853, 0xb85c, 0xb85d, 0xb860, 0xb864, 0xb86c,
+    0xb86d, 0xb86f, 0xb871, 0xb878, 0xb87c, 0xb88d, 0xb8a8, 0xb8b0, 0xb8b4, 0xb8b8, 0xb8c0, 0xb8c1,
+    0xb8c3, 0xb8c5, 0xb8cc, 0xb8d0, 0xb8d4, 0xb8dd, 0xb8df, 0xb8e1, 0xb8e8, 0xb8e9, 0xb8ec, 0xb8f0,
+    0xb8f8, 0xb8f9, 0xb8fb, 0xb8fd, 0xb904, 0xb918, 0xb920, 0xb93c, 0xb93d, 0xb940, 0xb944, 0xb94c,
+    0xb94f, 0xb951, 0xb958, 0xb959, 0xb95c, 0xb960, 0xb968, 0xb969, 0xb96b, 0xb96d, 0xb974, 0xb975,
+    0xb978, 0xb97c, 0xb984, 0xb985, 0xb987, 0xb989, 0xb98a, 0xb98d, 0xb98e, 0xb9ac, 0xb9ad, 0xb9b0,
+    0xb9b4, 0xb9bc, 0xb9bd, 0xb9bf, 0xb9c1, 0xb9c8, 0xb9c9, 0xb9cc, 0xb9ce, 0xb9cf, 0xb9d0, 0xb9d1,
+    0xb9d2, 0xb9d8, 0xb9d9, 0xb9db, 0xb9dd, 0xb9de, 0xb9e1, 0xb9e3, 0xb9e4, 0xb9e5, 0xb9e8, 0xb9ec,
+    0xb9f4, 0xb9f5, 0xb9f7, 0xb9f8, 0xb9f9, 0xb9fa, 0xba00, 0xba01, 0xba08, 0xba15, 0xba38, 0xba39,
+    0xba3c, 0xba40, 0xba42, 0xba48, 0xba49, 0xba4b, 0xba4d, 0xba4e, 0xba53, 0xba54, 0xba55, 0xba58,
+    0xba5c, 0xba64, 0xba65, 0xba67, 0xba68, 0xba69, 0xba70, 0xba71, 0xba74, 0xba78, 0xba83, 0xba84,
+    0xba85, 0xba87, 0xba8c, 0xbaa8, 0xbaa9, 0xbaab, 0xbaac, 0xbab0, 0xbab2, 0xbab8, 0xbab9, 0xbabb,
+    0xbabd, 0xbac4, 0xbac8, 0xbad8, 0xbad9, 0xbafc, 0xbb00, 0xbb04, 0xbb0d, 0xbb0f, 0xbb11, 0xbb18,
+    0xbb1c, 0xbb20, 0xbb29, 0xbb2b, 0xbb34, 0xbb35, 0xbb36, 0xbb38, 0xbb3b, 0xbb3c, 0xbb3d, 0xbb3e,
+    0xbb44, 0xbb45, 0xbb47, 0xbb49, 0xbb4d, 0xbb4f, 0xbb50, 0xbb54, 0xbb58, 0xbb61, 0xbb63, 0xbb6c,
+    0xbb88, 0xbb8c, 0xbb90, 0xbba4, 0xbba8, 0xbbac, 0xbbb4, 0xbbb7, 0xbbc0, 0xbbc4, 0xbbc8, 0xbbd0,
+    0xbbd3, 0xbbf8, 0xbbf9, 0xbbfc, 0xbbff, 0xbc00, 0xbc02, 0xbc08, 0xbc09, 0xbc0b, 0xbc0c, 0xbc0d,
+    0xbc0f, 0xbc11, 0xbc14, 0xbc15, 0xbc16, 0xbc17, 0xbc18, 0xbc1b, 0xbc1c, 0xbc1d, 0xbc1e, 0xbc1f,
+    0xbc24, 0xbc25, 0xbc27, 0xbc29, 0xbc2d, 0xbc30, 0xbc31, 0xbc34, 0xbc38, 0xbc40, 0xbc41, 0xbc43,
+    0xbc44, 0xbc45, 0xbc49, 0xbc4c, 0xbc4d, 0xbc50, 0xbc5d, 0xbc84, 0xbc85, 0xbc88, 0xbc8b, 0xbc8c,
+    0xbc8e, 0xbc94, 0xbc95, 0xbc97, 0xbc99, 0xbc9a, 0xbca0, 0xbca1, 0xbca4, 0xbca7, 0xbca8, 0xbcb0,
+    0xbcb1, 0xbcb3, 0xbcb4, 0xbcb5, 0xbcbc, 0xbcbd, 0xbcc0, 0xbcc4, 0xbccd, 0xbccf, 0xbcd0, 0xbcd1,
+    0xbcd5, 0xbcd8, 0xbcdc, 0xbcf4, 0xbcf5, 0xbcf6, 0xbcf8, 0xbcfc, 0xbd04, 0xbd05, 0xbd07, 0xbd09,
+    0xbd10, 0xbd14, 0xbd24, 0xbd2c, 0xbd40, 0xbd48, 0xbd49, 0xbd4c, 0xbd50, 0xbd58, 0xbd59, 0xbd64,
+    0xbd68, 0xbd80, 0xbd81, 0xbd84, 0xbd87, 0xbd88, 0xbd89, 0xbd8a, 0xbd90, 0xbd91, 0xbd93, 0xbd95,
+    0xbd99, 0xbd9a, 0xbd9c, 0xbda4, 0xbdb0, 0xbdb8, 0xbdd4, 0xbdd5, 0xbdd8, 0xbddc, 0xbde9, 0xbdf0,
+    0xbdf4, 0xbdf8, 0xbe00, 0xbe03, 0xbe05, 0xbe0c, 0xbe0d, 0xbe10, 0xbe14, 0xbe1c, 0xbe1d, 0xbe1f,
+    0xbe44, 0xbe45, 0xbe48, 0xbe4c, 0xbe4e, 0xbe54, 0xbe55, 0xbe57, 0xbe59, 0xbe5a, 0xbe5b, 0xbe60,
+    0xbe61, 0xbe64, 0xbe68, 0xbe6a, 0xbe70, 0xbe71, 0xbe73, 0xbe74, 0xbe75, 0xbe7b, 0xbe7c, 0xbe7d,
+    0xbe80, 0xbe84, 0xbe8c, 0xbe8d, 0xbe8f, 0xbe90, 0xbe91, 0xbe98, 0xbe99, 0xbea8, 0xbed0, 0xbed1,
+    0xbed4, 0xbed7, 0xbed8, 0xbee0, 0xbee3, 0xbee4, 0xbee5, 0xbeec, 0xbf01, 0xbf08, 0xbf09, 0xbf18,
+    0xbf19, 0xbf1b, 0xbf1c, 0xbf1d, 0xbf40, 0xbf41, 0xbf44, 0xbf48, 0xbf50, 0xbf51, 0xbf55, 0xbf94,
+    0xbfb0, 0xbfc5, 0xbfcc, 0xbfcd, 0xbfd0, 0xbfd4, 0xbfdc, 0xbfdf, 0xbfe1, 0xc03c, 0xc051, 0xc058,
+    0xc05c, 0xc060, 0xc068, 0xc069, 0xc090, 0xc091, 0xc094, 0xc098, 0xc0a0, 0xc0a1, 0xc0a3, 0xc0a5,
+    0xc0ac, 0xc0ad, 0xc0af, 0xc0b0, 0xc0b3, 0xc0b4, 0xc0b5, 0xc0b6, 0xc0bc, 0xc0bd, 0xc0bf, 0xc0c0,
+    0xc0c1, 0xc0c5, 0xc0c8, 0xc0c9, 0xc0cc, 0xc0d0, 0xc0d8, 0xc0d9, 0xc0db, 0xc0dc, 0xc0dd, 0xc0e4,
+    0xc0e5, 0xc0e8, 0xc0ec, 0xc0f4, 0xc0f5, 0xc0f7, 0xc0f9, 0xc100, 0xc104, 0xc108, 0xc110, 0xc115,
+    0xc11c, 0xc11d, 0xc11e, 0xc11f, 0xc120, 0xc123, 0xc124, 0xc126, 0xc127, 0xc12c, 0xc12d, 0xc12f,
+    0xc130, 0xc131, 0xc136, 0xc138, 0xc139, 0xc13c, 0xc140, 0xc148, 0xc149, 0xc14b, 0xc14c, 0xc14d,
+    0xc154, 0xc155, 0xc158, 0xc15c, 0xc164, 0xc165, 0xc167, 0xc168, 0xc169, 0xc170, 0xc174, 0xc178,
+    0xc185, 0xc18c, 0xc18d, 0xc18e, 0xc190, 0xc194, 0xc196, 0xc19c, 0xc19d, 0xc19f, 0xc1a1, 0xc1a5,
+    0xc1a8, 0xc1a9, 0xc1ac, 0xc1b0, 0xc1bd, 0xc1c4, 0xc1c8, 0xc1cc, 0xc1d4, 0xc1d7, 0xc1d8, 0xc1e0,
+    0xc1e4, 0xc1e8, 0xc1f0, 0xc1f1, 0xc1f3, 0xc1fc, 0xc1fd, 0xc200, 0xc204, 0xc20c, 0xc20d, 0xc20f,
+    0xc211, 0xc218, 0xc219, 0xc21c, 0xc21f, 0xc220, 0xc228, 0xc229, 0xc22b, 0xc22d, 0xc22f, 0xc231,
+    0xc232, 0xc234, 0xc248, 0xc250, 0xc251, 0xc254, 0xc258, 0xc260, 0xc265, 0xc26c, 0xc26d, 0xc270,
+    0xc274, 0xc27c, 0xc27d, 0xc27f, 0xc281, 0xc288, 0xc289, 0xc290, 0xc298, 0xc29b, 0xc29d, 0xc2a4,
+    0xc2a5, 0xc2a8, 0xc2ac, 0xc2ad, 0xc2b4, 0xc2b5, 0xc2b7, 0xc2b9, 0xc2dc, 0xc2dd, 0xc2e0, 0xc2e3,
+    0xc2e4, 0xc2eb, 0xc2ec, 0xc2ed, 0xc2ef, 0xc2f1, 0xc2f6, 0xc2f8, 0xc2f9, 0xc2fb, 0xc2fc, 0xc300,
+    0xc308, 0xc309, 0xc30c, 0xc30d, 0xc313, 0xc314, 0xc315, 0xc318, 0xc31c, 0xc324, 0xc325, 0xc328,
+    0xc329, 0xc345, 0xc368, 0xc369, 0xc36c, 0xc370, 0xc372, 0xc378, 0xc379, 0xc37c, 0xc37d, 0xc384,
+    0xc388, 0xc38c, 0xc3c0, 0xc3d8, 0xc3d9, 0xc3dc, 0xc3df, 0xc3e0, 0xc3e2, 0xc3e8, 0xc3e9, 0xc3ed,
+    0xc3f4, 0xc3f5, 0xc3f8, 0xc408, 0xc410, 0xc424, 0xc42c, 0xc430, 0xc434, 0xc43c, 0xc43d, 0xc448,
+    0xc464, 0xc465, 0xc468, 0xc46c, 0xc474, 0xc475, 0xc479, 0xc480, 0xc494, 0xc49c, 0xc4b8, 0xc4bc,
+    0xc4e9, 0xc4f0, 0xc4f1, 0xc4f4, 0xc4f8, 0xc4fa, 0xc4ff, 0xc500, 0xc501, 0xc50c, 0xc510, 0xc514,
+    0xc51c, 0xc528, 0xc529, 0xc52c, 0xc530, 0xc538, 0xc539, 0xc53b, 0xc53d, 0xc544, 0xc545, 0xc548,
+    0xc549, 0xc54a, 0xc54c, 0xc54d, 0xc54e, 0xc553, 0xc554, 0xc555, 0xc557, 0xc558, 0xc559, 0xc55d,
+    0xc55e, 0xc560, 0xc561, 0xc564, 0xc568, 0xc570, 0xc571, 0xc573, 0xc574, 0xc575, 0xc57c, 0xc57d,
+    0xc580, 0xc584, 0xc587, 0xc58c, 0xc58d, 0xc58f, 0xc591, 0xc595, 0xc597, 0xc598, 0xc59c, 0xc5a0,
+    0xc5a9, 0xc5b4, 0xc5b5, 0xc5b8, 0xc5b9, 0xc5bb, 0xc5bc, 0xc5bd, 0xc5be, 0xc5c4, 0xc5c5, 0xc5c6,
+    0xc5c7, 0xc5c8, 0xc5c9, 0xc5ca, 0xc5cc, 0xc5ce, 0xc5d0, 0xc5d1, 0xc5d4, 0xc5d8, 0xc5e0, 0xc5e1,
+    0xc5e3, 0xc5e5, 0xc5ec, 0xc5ed, 0xc5ee, 0xc5f0, 0xc5f4, 0xc5f6, 0xc5f7, 0xc5fc, 0xc5fd, 0xc5fe,
+    0xc5ff, 0xc600, 0xc601, 0xc605, 0xc606, 0xc607, 0xc608, 0xc60c, 0xc610, 0xc618, 0xc619, 0xc61b,
+    0xc61c, 0xc624, 0xc625, 0xc628, 0xc62c, 0xc62d, 0xc62e, 0xc630, 0xc633, 0xc634, 0xc635, 0xc637,
+    0xc639, 0xc63b, 0xc640, 0xc641, 0xc644, 0xc648, 0xc650, 0xc651, 0xc653, 0xc654, 0xc655, 0xc65c,
+    0xc65d, 0xc660, 0xc66c, 0xc66f, 0xc671, 0xc678, 0xc679, 0xc67c, 0xc680, 0xc688, 0xc689, 0xc68b,
+    0xc68d, 0xc694, 0xc695, 0xc698, 0xc69c, 0xc6a4, 0xc6a5, 0xc6a7, 0xc6a9, 0xc6b0, 0xc6b1, 0xc6b4,
+    0xc6b8, 0xc6b9, 0xc6ba, 0xc6c0, 0xc6c1, 0xc6c3, 0xc6c5, 0xc6cc, 0xc6cd, 0xc6d0, 0xc6d4, 0xc6dc,
+    0xc6dd, 0xc6e0, 0xc6e1, 0xc6e8, 0xc6e9, 0xc6ec, 0xc6f0, 0xc6f8, 0xc6f9, 0xc6fd, 0xc704, 0xc705,
+    0xc708, 0xc70c, 0xc714, 0xc715, 0xc717, 0xc719, 0xc720, 0xc721, 0xc724, 0xc728, 0xc730, 0xc731,
+    0xc733, 0xc735, 0xc737, 0xc73c, 0xc73d, 0xc740, 0xc744, 0xc74a, 0xc74c, 0xc74d, 0xc74f, 0xc751,
+    0xc752, 0xc753, 0xc754, 0xc755, 0xc756, 0xc757, 0xc758, 0xc75c, 0xc760, 0xc768, 0xc76b, 0xc774,
+    0xc775, 0xc778, 0xc77c, 0xc77d, 0xc77e, 0xc783, 0xc784, 0xc785, 0xc787, 0xc788, 0xc789, 0xc78a,
+    0xc78e, 0xc790, 0xc791, 0xc794, 0xc796, 0xc797, 0xc798, 0xc79a, 0xc7a0, 0xc7a1, 0xc7a3, 0xc7a4,
+    0xc7a5, 0xc7a6, 0xc7ac, 0xc7ad, 0xc7b0, 0xc7b4, 0xc7bc, 0xc7bd, 0xc7bf, 0xc7c0, 0xc7c1, 0xc7c8,
+    0xc7c9, 0xc7cc, 0xc7ce, 0xc7d0, 0xc7d8, 0xc7dd, 0xc7e4, 0xc7e8, 0xc7ec, 0xc800, 0xc801, 0xc804,
+    0xc808, 0xc80a, 0xc810, 0xc811, 0xc813, 0xc815, 0xc816, 0xc81c, 0xc81d, 0xc820, 0xc824, 0xc82c,
+    0xc82d, 0xc82f, 0xc831, 0xc838, 0xc83c, 0xc840, 0xc848, 0xc849, 0xc84c, 0xc84d, 0xc854, 0xc870,
+    0xc871, 0xc874, 0xc878, 0xc87a, 0xc880, 0xc881, 0xc883, 0xc885, 0xc886, 0xc887, 0xc88b, 0xc88c,
+    0xc88d, 0xc894, 0xc89d, 0xc89f, 0xc8a1, 0xc8a8, 0xc8bc, 0xc8bd, 0xc8c4, 0xc8c8, 0xc8cc, 0xc8d4,
+    0xc8d5, 0xc8d7, 0xc8d9, 0xc8e0, 0xc8e1, 0xc8e4, 0xc8f5, 0xc8fc, 0xc8fd, 0xc900, 0xc904, 0xc905,
+    0xc906, 0xc90c, 0xc90d, 0xc90f, 0xc911, 0xc918, 0xc92c, 0xc934, 0xc950, 0xc951, 0xc954, 0xc958,
+    0xc960, 0xc961, 0xc963, 0xc96c, 0xc970, 0xc974, 0xc97c, 0xc988, 0xc989, 0xc98c, 0xc990, 0xc998,
+    0xc999, 0xc99b, 0xc99d, 0xc9c0, 0xc9c1, 0xc9c4, 0xc9c7, 0xc9c8, 0xc9ca, 0xc9d0, 0xc9d1, 0xc9d3,
+    0xc9d5, 0xc9d6, 0xc9d9, 0xc9da, 0xc9dc, 0xc9dd, 0xc9e0, 0xc9e2, 0xc9e4, 0xc9e7, 0xc9ec, 0xc9ed,
+    0xc9ef, 0xc9f0, 0xc9f1, 0xc9f8, 0xc9f9, 0xc9fc, 0xca00, 0xca08, 0xca09, 0xca0b, 0xca0c, 0xca0d,
+    0xca14, 0xca18, 0xca29, 0xca4c, 0xca4d, 0xca50, 0xca54, 0xca5c, 0xca5d, 0xca5f, 0xca60, 0xca61,
+    0xca68, 0xca7d, 0xca84, 0xca98, 0xcabc, 0xcabd, 0xcac0, 0xcac4, 0xcacc, 0xcacd, 0xcacf, 0xcad1,
+    0xcad3, 0xcad8, 0xcad9, 0xcae0, 0xcaec, 0xcaf4, 0xcb08, 0xcb10, 0xcb14, 0xcb18, 0xcb20, 0xcb21,
+    0xcb41, 0xcb48, 0xcb49, 0xcb4c, 0xcb50, 0xcb58, 0xcb59, 0xcb5d, 0xcb64, 0xcb78, 0xcb79, 0xcb9c,
+    0xcbb8, 0xcbd4, 0xcbe4, 0xcbe7, 0xcbe9, 0xcc0c, 0xcc0d, 0xcc10, 0xcc14, 0xcc1c, 0xcc1d, 0xcc21,
+    0xcc22, 0xcc27, 0xcc28, 0xcc29, 0xcc2c, 0xcc2e, 0xcc30, 0xcc38, 0xcc39, 0xcc3b, 0xcc3c, 0xcc3d,
+    0xcc3e, 0xcc44, 0xcc45, 0xcc48, 0xcc4c, 0xcc54, 0xcc55, 0xcc57, 0xcc58, 0xcc59, 0xcc60, 0xcc64,
+    0xcc66, 0xcc68, 0xcc70, 0xcc75, 0xcc98, 0xcc99, 0xcc9c, 0xcca0, 0xcca8, 0xcca9, 0xccab, 0xccac,
+    0xccad, 0xccb4, 0xccb5, 0xccb8, 0xccbc, 0xccc4, 0xccc5, 0xccc7, 0xccc9, 0xccd0, 0xccd4, 0xcce4,
+    0xccec, 0xccf0, 0xcd01, 0xcd08, 0xcd09, 0xcd0c, 0xcd10, 0xcd18, 0xcd19, 0xcd1b, 0xcd1d, 0xcd24,
+    0xcd28, 0xcd2c, 0xcd39, 0xcd5c, 0xcd60, 0xcd64, 0xcd6c, 0xcd6d, 0xcd6f, 0xcd71, 0xcd78, 0xcd88,
+    0xcd94, 0xcd95, 0xcd98, 0xcd9c, 0xcda4, 0xcda5, 0xcda7, 0xcda9, 0xcdb0, 0xcdc4, 0xcdcc, 0xcdd0,
+    0xcde8, 0xcdec, 0xcdf0, 0xcdf8, 0xcdf9, 0xcdfb, 0xcdfd, 0xce04, 0xce08, 0xce0c, 0xce14, 0xce19,
+    0xce20, 0xce21, 0xce24, 0xce28, 0xce30, 0xce31, 0xce33, 0xce35, 0xce58, 0xce59, 0xce5c, 0xce5f,
+    0xce60, 0xce61, 0xce68, 0xce69, 0xce6b, 0xce6d, 0xce74, 0xce75, 0xce78, 0xce7c, 0xce84, 0xce85,
+    0xce87, 0xce89, 0xce90, 0xce91, 0xce94, 0xce98, 0xcea0, 0xcea1, 0xcea3, 0xcea4, 0xcea5, 0xceac,
+    0xcead, 0xcec1, 0xcee4, 0xcee5, 0xcee8, 0xceeb, 0xceec, 0xcef4, 0xcef5, 0xcef7, 0xcef8, 0xcef9,
+    0xcf00, 0xcf01, 0xcf04, 0xcf08, 0xcf10, 0xcf11, 0xcf13, 0xcf15, 0xcf1c, 0xcf20, 0xcf24, 0xcf2c,
+    0xcf2d, 0xcf2f, 0xcf30, 0xcf31, 0xcf38, 0xcf54, 0xcf55, 0xcf58, 0xcf5c, 0xcf64, 0xcf65, 0xcf67,
+    0xcf69, 0xcf70, 0xcf71, 0xcf74, 0xcf78, 0xcf80, 0xcf85, 0xcf8c, 0xcfa1, 0xcfa8, 0xcfb0, 0xcfc4,
+    0xcfe0, 0xcfe1, 0xcfe4, 0xcfe8, 0xcff0, 0xcff1, 0xcff3, 0xcff5, 0xcffc, 0xd000, 0xd004, 0xd011,
+    0xd018, 0xd02d, 0xd034, 0xd035, 0xd038, 0xd03c, 0xd044, 0xd045, 0xd047, 0xd049, 0xd050, 0xd054,
+    0xd058, 0xd060, 0xd06c, 0xd06d, 0xd070, 0xd074, 0xd07c, 0xd07d, 0xd081, 0xd0a4, 0xd0a5, 0xd0a8,
+    0xd0ac, 0xd0b4, 0xd0b5, 0xd0b7, 0xd0b9, 0xd0c0, 0xd0c1, 0xd0c4, 0xd0c8, 0xd0c9, 0xd0d0, 0xd0d1,
+    0xd0d3, 0xd0d4, 0xd0d5, 0xd0dc, 0xd0dd, 0xd0e0, 0xd0e4, 0xd0ec, 0xd0ed, 0xd0ef, 0xd0f0, 0xd0f1,
+    0xd0f8, 0xd10d, 0xd130, 0xd131, 0xd134, 0xd138, 0xd13a, 0xd140, 0xd141, 0xd143, 0xd144, 0xd145,
+    0xd14c, 0xd14d, 0xd150, 0xd154, 0xd15c, 0xd15d, 0xd15f, 0xd161, 0xd168, 0xd16c, 0xd17c, 0xd184,
+    0xd188, 0xd1a0, 0xd1a1, 0xd1a4, 0xd1a8, 0xd1b0, 0xd1b1, 0xd1b3, 0xd1b5, 0xd1ba, 0xd1bc, 0xd1c0,
+    0xd1d8, 0xd1f4, 0xd1f8, 0xd207, 0xd209, 0xd210, 0xd22c, 0xd22d, 0xd230, 0xd234, 0xd23c, 0xd23d,
+    0xd23f, 0xd241, 0xd248, 0xd25c, 0xd264, 0xd280, 0xd281, 0xd284, 0xd288, 0xd290, 0xd291, 0xd295,
+    0xd29c, 0xd2a0, 0xd2a4, 0xd2ac, 0xd2b1, 0xd2b8, 0xd2b9, 0xd2bc, 0xd2bf, 0xd2c0, 0xd2c2, 0xd2c8,
+    0xd2c9, 0xd2cb, 0xd2d4, 0xd2d8, 0xd2dc, 0xd2e4, 0xd2e5, 0xd2f0, 0xd2f1, 0xd2f4, 0xd2f8, 0xd300,
+    0xd301, 0xd303, 0xd305, 0xd30c, 0xd30d, 0xd30e, 0xd310, 0xd314, 0xd316, 0xd31c, 0xd31d, 0xd31f,
+    0xd320, 0xd321, 0xd325, 0xd328, 0xd329, 0xd32c, 0xd330, 0xd338, 0xd339, 0xd33b, 0xd33c, 0xd33d,
+    0xd344, 0xd345, 0xd37c, 0xd37d, 0xd380, 0xd384, 0xd38c, 0xd38d, 0xd38f, 0xd390, 0xd391, 0xd398,
+    0xd399, 0xd39c, 0xd3a0, 0xd3a8, 0xd3a9, 0xd3ab, 0xd3ad, 0xd3b4, 0xd3b8, 0xd3bc, 0xd3c4, 0xd3c5,
+    0xd3c8, 0xd3c9, 0xd3d0, 0xd3d8, 0xd3e1, 0xd3e3, 0xd3ec, 0xd3ed, 0xd3f0, 0xd3f4, 0xd3fc, 0xd3fd,
+    0xd3ff, 0xd401, 0xd408, 0xd41d, 0xd440, 0xd444, 0xd45c, 0xd460, 0xd464, 0xd46d, 0xd46f, 0xd478,
+    0xd479, 0xd47c, 0xd47f, 0xd480, 0xd482, 0xd488, 0xd489, 0xd48b, 0xd48d, 0xd494, 0xd4a9, 0xd4cc,
+    0xd4d0, 0xd4d4, 0xd4dc, 0xd4df, 0xd4e8, 0xd4ec, 0xd4f0, 0xd4f8, 0xd4fb, 0xd4fd, 0xd504, 0xd508,
+    0xd50c, 0xd514, 0xd515, 0xd517, 0xd53c, 0xd53d, 0xd540, 0xd544, 0xd54c, 0xd54d, 0xd54f, 0xd551,
+    0xd558, 0xd559, 0xd55c, 0xd560, 0xd565, 0xd568, 0xd569, 0xd56b, 0xd56d, 0xd574, 0xd575, 0xd578,
+    0xd57c, 0xd584, 0xd585, 0xd587, 0xd588, 0xd589, 0xd590, 0xd5a5, 0xd5c8, 0xd5c9, 0xd5cc, 0xd5d0,
+    0xd5d2, 0xd5d8, 0xd5d9, 0xd5db, 0xd5dd, 0xd5e4, 0xd5e5, 0xd5e8, 0xd5ec, 0xd5f4, 0xd5f5, 0xd5f7,
+    0xd5f9, 0xd600, 0xd601, 0xd604, 0xd608, 0xd610, 0xd611, 0xd613, 0xd614, 0xd615, 0xd61c, 0xd620,
+    0xd624, 0xd62d, 0xd638, 0xd639, 0xd63c, 0xd640, 0xd645, 0xd648, 0xd649, 0xd64b, 0xd64d, 0xd651,
+    0xd654, 0xd655, 0xd658, 0xd65c, 0xd667, 0xd669, 0xd670, 0xd671, 0xd674, 0xd683, 0xd685, 0xd68c,
+    0xd68d, 0xd690, 0xd694, 0xd69d, 0xd69f, 0xd6a1, 0xd6a8, 0xd6ac, 0xd6b0, 0xd6b9, 0xd6bb, 0xd6c4,
+    0xd6c5, 0xd6c8, 0xd6cc, 0xd6d1, 0xd6d4, 0xd6d7, 0xd6d9, 0xd6e0, 0xd6e4, 0xd6e8, 0xd6f0, 0xd6f5,
+    0xd6fc, 0xd6fd, 0xd700, 0xd704, 0xd711, 0xd718, 0xd719, 0xd71c, 0xd720, 0xd728, 0xd729, 0xd72b,
+    0xd72d, 0xd734, 0xd735, 0xd738, 0xd73c, 0xd744, 0xd747, 0xd749, 0xd750, 0xd751, 0xd754, 0xd756,
+    0xd757, 0xd758, 0xd759, 0xd760, 0xd761, 0xd763, 0xd765, 0xd769, 0xd76c, 0xd770, 0xd774, 0xd77c,
+    0xd77d, 0xd781, 0xd788, 0xd789, 0xd78c, 0xd790, 0xd798, 0xd799, 0xd79b, 0xd79d,
+};
+
+#endif // FONT_SUBSET_H
@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+# Writes font_subset.h, the CJK ideographs and Hangul syllables bake_font keeps.
+#
+# "Common" is taken from the national character sets, which cover everyday
+# text and leave the rare and historic characters out:
+#   - JIS X 0208 level 1 kanji (2965)
+#   - GB 2312 level 1 hanzi (3755)
+#   - Big5 frequently used hanzi (5401)
+#   - KS X 1001 Hangul syllables (2350)
+# Python's codecs carry the tables, so this needs nothing beyond the standard
+# library. Run it from this directory: python3 font_subset.py > font_subset.h
+
+import sys
+
+
+def rows(codec, first, last):
+    """Codepoints in rows first..last of a 94x94 EUC-encoded character set."""
+    found = set()
+    for row in range(first, last + 1):
+        for cell in range(0xA1, 0xFF):
+            try:
+                text = bytes([row + 0xA0, cell]).decode(codec)
+            except UnicodeDecodeError:
+                continue
+            if len(text) == 1:
+                found.add(ord(text))
+    return found
+
+
+def big5Frequent():
+    """Codepoints of the Big5 frequently used hanzi, lead bytes 0xa4..0xc6."""
+    found = set()
+    for lead in range(0xA4, 0xC7):
+        for trail in list(range(0x40, 0x7F)) + list(range(0xA1, 0xFF)):
+            try:
+                text = bytes([lead, trail]).decode("big5")
+            except UnicodeDecodeError:
+                continue
+            # Some decoders extend row 0xc6 with kana; keep the ideographs only
+            if len(text) == 1 and 0x4E00 <= ord(text) <= 0x9FFF:
+                found.add(ord(text))
+    return found
+
+
+def table(out, name, codepoints):
+    out.write("static const uint16_t %s[%d] = {\n" % (name, len(codepoints)))
+    for i in range(0, len(codepoints), 12):
+        out.write("    " + " ".join("0x%04x," % cp for cp in codepoints[i:i + 12]) + "\n")
+    out.write("};\n")
+
+
+def main():
+    ideographs = sorted(rows("euc_jp", 16, 47) | rows("gb2312", 16, 55) | big5Frequent())
+    hangul = sorted(rows("euc_kr", 16, 40))
+    assert all(0x4E00 <= cp <= 0x9FFF for cp in ideographs)
+    assert all(0xAC00 <= cp <= 0xD7A3 for cp in hangul)
+
+    out = sys.stdout
+    out.write("// Generated by font_subset.py; do not edit.\n")
+    out.write("// CJK ideographs in JIS X 0208 level 1, GB 2312 level 1 or the Big5\n")
+    out.write("// frequently used set, and the Hangul syllables in KS X 1001, sorted for\n")
+    out.write("// bsearch().\n\n")
+    out.write("#ifndef FONT_SUBSET_H\n#define FONT_SUBSET_H\n\n#include <stdint.h>\n\n")
+    table(out, "commonIdeographs", ideographs)
+    out.write("\n")
+    table(out, "commonHangul", hangul)
+    out.write("\n#endif // FONT_SUBSET_H\n")
+
+
+if __name__ == "__main__":
+    main()
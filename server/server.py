@@ -1,9 +1,11 @@
 from fastapi import FastAPI, Request
 from fastapi.responses import HTMLResponse, RedirectResponse, JSONResponse
-import json, os, requests, base64, webbrowser
+import copy, json, os, requests, base64, threading, time, webbrowser
 from contextlib import asynccontextmanager
+from functools import lru_cache
 from pykakasi import kakasi
 from unidecode import unidecode
+from PIL import Image, ImageDraw, ImageFont
 
 # Initialize pykakasi converter (Kanji/Hiragana/Katakana -> Latin)
 _kakasi_conv = None
@@ -38,6 +40,78 @@ def _contains_hangul(s: str) -> bool:
     return False
 
 
+def _romanize(s: str) -> str:
+    """Latin transliteration for clients that can only draw ASCII."""
+    if not _contains_non_latin(s):
+        return s
+    try:
+        if _contains_hangul(s):
+            # Use Unidecode for Hangul/Korean
+            return unidecode(s)
+        if _kakasi_conv:
+            return _kakasi_conv.do(s)
+        return unidecode(s)
+    except Exception:
+        return s
+
+
+# ----------------------------
+# Text strips: non-Latin text rendered here so the console needs no font
+# ----------------------------
+STRIP_FONT = os.environ.get("STRIP_FONT")  # TTF/OTF or PIL font with the glyphs needed
+STRIP_FONT_SIZE = int(os.environ.get("STRIP_FONT_SIZE", "8"))
+STRIP_HEIGHT = 8       # the console's text height
+STRIP_MAX_CELLS = 128  # 8 px cells; longer text is cut
+
+
+@lru_cache(maxsize=1)
+def _strip_font():
+    if not STRIP_FONT:
+        return None
+    try:
+        if STRIP_FONT.endswith(".pil"):
+            return ImageFont.load(STRIP_FONT)
+        return ImageFont.truetype(STRIP_FONT, STRIP_FONT_SIZE)
+    except Exception as e:
+        print(f"WARNING: Can't load STRIP_FONT {STRIP_FONT}: {e}")
+        return None
+
+
+@lru_cache(maxsize=256)
+def _text_strip(s: str):
+    """1 bit per pixel, STRIP_HEIGHT rows of one byte per 8 px cell, MSB leftmost; base64."""
+    font = _strip_font()
+    if font is None or not s:
+        return None
+    try:
+        width = int(font.getlength(s))
+        cells = min(max(1, (width + 7) // 8), STRIP_MAX_CELLS)
+        image = Image.new("1", (cells * 8, STRIP_HEIGHT), 0)
+        draw = ImageDraw.Draw(image)
+        draw.fontmode = "1"  # no antialiasing, the console has one color per glyph
+        # Center the font's ascent + descent on the strip so every string shares a baseline
+        y = 0
+        if hasattr(font, "getmetrics"):
+            ascent, descent = font.getmetrics()
+            y = (STRIP_HEIGHT - ascent - descent) // 2
+        draw.text((0, y), s, font=font, fill=1)
+        return base64.b64encode(image.tobytes()).decode("ascii")
+    except Exception:
+        return None
+
+
+
+def _now_ms() -> int:
+    return int(time.time() * 1000)
+
+
+def _stamp(result: dict, received_ms: int) -> dict:
+    """Add when the request came in and when the reply went out, so the client can
+    estimate its clock's offset from ours (NTP-style)."""
+    result["request_ms"] = received_ms
+    result["server_time_ms"] = _now_ms()
+    return result
+
 
 def _safe_json(resp):
     """Try to decode JSON from a requests.Response; on failure return a fallback dict."""
@@ -206,17 +280,14 @@ async def authorize(client_id: str, client_secret: str):
 # ----------------------------
 # Unified endpoint for now-playing and player state
 # ----------------------------
-@app.get("/now-playing")
-def now_playing_and_state():
-    token_data, error = get_access_token()
-    if error:
-        return JSONResponse({"error": error}, status_code=400)
-
-    access_token = token_data["access_token"]
+def _player_state(access_token, romanize, strips):
+    """Current track and player state from Spotify, as /now-playing sends them, and when
+    the track (and so progress_ms) was read."""
     headers = {"Authorization": f"Bearer {access_token}"}
 
     # Get currently playing track
     resp_track = requests.get("https://api.spotify.com/v1/me/player/currently-playing", headers=headers)
+    track_read_ms = _now_ms()
     # Get player state
     resp_state = requests.get("https://api.spotify.com/v1/me/player", headers=headers)
 
@@ -235,37 +306,24 @@ def now_playing_and_state():
         else:
             name = data["item"]["name"]
             artist_name = data["item"]["artists"][0]["name"]
-
-        # Romanize if needed (replace with romanized text for client simplicity)
-        if _contains_non_latin(name):
-            try:
-                if _contains_hangul(name):
-                    # Use Unidecode for Hangul/Korean
-                    name = unidecode(name)
-                elif _kakasi_conv:
-                    name = _kakasi_conv.do(name)
-                else:
-                    name = unidecode(name)
-            except Exception:
-                pass
-
-        if _contains_non_latin(artist_name):
-            try:
-                if _contains_hangul(artist_name):
-                    artist_name = unidecode(artist_name)
-                elif _kakasi_conv:
-                    artist_name = _kakasi_conv.do(artist_name)
-                else:
-                    artist_name = unidecode(artist_name)
-            except Exception:
-                pass
-
-        result["track"] = {
-            "name": name,
-            "artist": artist_name,
-            "album": data["item"]["album"]["name"],
-            "is_playing": data["is_playing"]
-        }
+            album_name = data["item"]["album"]["name"]
+            fields = {"name": name, "artist": artist_name, "album": album_name}
+
+            # Where playback is, so the client can poll again just after the track ends
+            result["track"] = {
+                "is_playing": data["is_playing"],
+                "progress_ms": data.get("progress_ms"),
+                "duration_ms": data["item"].get("duration_ms"),
+            }
+            for key, text in fields.items():
+                # Text the client can't draw goes as a pre-rendered strip if asked
+                # for, keeping it exact; otherwise romanized unless the client has a font
+                strip = _text_strip(text) if strips and _contains_non_latin(text) else None
+                if strip:
+                    result["track"][key + "_strip"] = strip
+                elif romanize:
+                    text = _romanize(text)
+                result["track"][key] = text
 
     # Player state
     if resp_state.status_code == 204:
@@ -286,6 +344,49 @@ def now_playing_and_state():
             except Exception:
                 pass
 
+    return result, track_read_ms
+
+
+def _advance(result, since_ms, until_ms):
+    """Move progress_ms on by the time between two reads, if playing."""
+    track = result.get("track", {})
+    if track.get("is_playing") and track.get("progress_ms") is not None and until_ms > since_ms:
+        track["progress_ms"] += until_ms - since_ms
+
+
+# The state last sent to the client, with the options it asked for: control
+# endpoints answer with it, patched with their effect, instead of making the client
+# poll again. Each control bumps the generation, so a background refresh started
+# before it doesn't overwrite its patch.
+_state_lock = threading.Lock()
+_last_state = None  # (result, track_read_ms)
+_last_options = {"romanize": True, "strips": False}
+_state_generation = 0
+
+
+def _remember(result, track_read_ms, generation=None):
+    global _last_state
+    with _state_lock:
+        if generation is None or generation == _state_generation:
+            _last_state = (copy.deepcopy(result), track_read_ms)
+
+
+@app.get("/now-playing")
+def now_playing_and_state(romanize: bool = True, strips: bool = False):
+    received_ms = _now_ms()
+    token_data, error = get_access_token()
+    if error:
+        return JSONResponse({"error": error}, status_code=400)
+
+    result, track_read_ms = _player_state(token_data["access_token"], romanize, strips)
+    with _state_lock:
+        _last_options.update(romanize=romanize, strips=strips)
+    _remember(result, track_read_ms)
+
+    # progress_ms is brought up to server_time_ms, which the client maps onto its own
+    # clock to run the progress bar on from there
+    _stamp(result, received_ms)
+    _advance(result, track_read_ms, result["server_time_ms"])
     return JSONResponse(result)
 
 # ----------------------------
@@ -305,42 +406,130 @@ def spotify_post(endpoint, access_token, device_id=None):
     headers = {"Authorization": f"Bearer {access_token}"}
     return requests.post(url, headers=headers)
 
+# Spotify takes a moment to show a control in the player state: it is read again
+# this often, until it does or the tries run out
+CONTROL_SETTLE_S = 0.5
+CONTROL_SETTLE_TRIES = 4
+
+
+def _refresh_state(access_token, generation, shows):
+    """Read the real state once Spotify has caught up with a control."""
+    with _state_lock:
+        options = dict(_last_options)
+    for attempt in range(CONTROL_SETTLE_TRIES):
+        time.sleep(CONTROL_SETTLE_S)
+        try:
+            result, track_read_ms = _player_state(access_token, **options)
+        except Exception:
+            return
+        if shows(result) or attempt == CONTROL_SETTLE_TRIES - 1:
+            _remember(result, track_read_ms, generation)
+            return
+
+
+def _control_reply(resp, access_token, received_ms, control):
+    """Spotify's status and, if it took the control, the last known state with the
+    control's effect applied (skips have none: the new track is only known once
+    Spotify moved on). The real state is then read in the background."""
+    global _state_generation
+    patch, shows = control
+    reply = {"status": resp.status_code}
+    now_ms = _now_ms()
+    with _state_lock:
+        _state_generation += 1
+        generation = _state_generation
+        state = copy.deepcopy(_last_state) if _last_state else None
+
+    if state and resp.status_code < 300:
+        result, track_read_ms = state
+        _advance(result, track_read_ms, now_ms)
+        before = copy.deepcopy(result)
+        if patch:
+            patch(result)
+        _remember(result, now_ms, generation)
+        reply.update(result)
+        threading.Thread(target=_refresh_state,
+                         args=(access_token, generation, lambda fresh: shows(before, fresh, now_ms)),
+                         daemon=True).start()
+
+    _stamp(reply, received_ms)
+    _advance(reply, now_ms, reply["server_time_ms"])
+    return JSONResponse(reply)
+
+
+# Controls, as a patch to the state (or None) and a test of whether a state read
+# from Spotify since shows them: shows(before, fresh, sent_ms)
+def _set_playing(playing):
+    def patch(result):
+        if "is_playing" in result.get("track", {}):
+            result["track"]["is_playing"] = playing
+
+    def shows(before, fresh, sent_ms):
+        return fresh.get("track", {}).get("is_playing") == playing
+    return patch, shows
+
+
+def _set_volume(volume_percent):
+    def patch(result):
+        if "volume_percent" in result.get("player_state", {}):
+            result["player_state"]["volume_percent"] = volume_percent
+
+    def shows(before, fresh, sent_ms):
+        return fresh.get("player_state", {}).get("volume_percent") == volume_percent
+    return patch, shows
+
+
+def _skip():
+    # Another track, or the same one started over (previous, a few seconds in, restarts it)
+    def shows(before, fresh, sent_ms):
+        old, new = before.get("track", {}), fresh.get("track", {})
+        if (new.get("name"), new.get("artist")) != (old.get("name"), old.get("artist")):
+            return True
+        progress = new.get("progress_ms")
+        return progress is not None and progress <= _now_ms() - sent_ms + 1500
+    return None, shows
+
 @app.get("/pause")
 def pause(device_id: str = None):
+    received_ms = _now_ms()
     token_data, error = get_access_token()
     if error:
         return JSONResponse({"error": error}, status_code=400)
     resp = spotify_put("pause", token_data["access_token"], device_id)
-    return JSONResponse({"status": resp.status_code})
+    return _control_reply(resp, token_data["access_token"], received_ms, _set_playing(False))
 
 @app.get("/play")
 def play(device_id: str = None):
+    received_ms = _now_ms()
     token_data, error = get_access_token()
     if error:
         return JSONResponse({"error": error}, status_code=400)
     resp = spotify_put("play", token_data["access_token"], device_id)
-    return JSONResponse({"status": resp.status_code})
+    return _control_reply(resp, token_data["access_token"], received_ms, _set_playing(True))
 
 @app.get("/next")
 def next_track(device_id: str = None):
+    received_ms = _now_ms()
     token_data, error = get_access_token()
     if error:
         return JSONResponse({"error": error}, status_code=400)
     resp = spotify_post("next", token_data["access_token"], device_id)
-    return JSONResponse({"status": resp.status_code})
+    return _control_reply(resp, token_data["access_token"], received_ms, _skip())
 
 @app.get("/previous")
 def previous_track(device_id: str = None):
+    received_ms = _now_ms()
     token_data, error = get_access_token()
     if error:
         return JSONResponse({"error": error}, status_code=400)
     resp = spotify_post("previous", token_data["access_token"], device_id)
-    return JSONResponse({"status": resp.status_code})
+    return _control_reply(resp, token_data["access_token"], received_ms, _skip())
 
 @app.get("/volume")
 def volume_up(device_id: str = None, volume_percent: int = 10):
+    received_ms = _now_ms()
     token_data, error = get_access_token()
     if error:
         return JSONResponse({"error": error}, status_code=400)
     resp = spotify_put("volume", token_data["access_token"], device_id, params={"volume_percent": volume_percent})
-    return JSONResponse({"status": resp.status_code})
\ No newline at end of file
+    return _control_reply(resp, token_data["access_token"], received_ms, _set_volume(volume_percent))